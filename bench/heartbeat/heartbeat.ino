@@ -0,0 +1,178 @@
+// Replay vehicle traffic through the state nodes with fixed and adaptive
+// heartbeats and report the number of state events each yields.
+
+#include <Arduino.h>
+#include <Canny.h>
+#include <Caster.h>
+#include <Faker.h>
+#include <R51Core.h>
+#include <R51Vehicle.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+extern int epoxy_argc;
+extern const char* const* epoxy_argv;
+
+using ::Canny::Frame;
+using ::Faker::FakeClock;
+using namespace ::R51;
+
+// Fixed heartbeat interval and adaptive maximum in milliseconds.
+static const uint32_t TICK = 1000;
+static const uint32_t MAX_TICK = 30000;
+
+// Interval at which nodes are polled for output.
+static const uint32_t LOOP = 10;
+
+// Counts yielded system events.
+class CountingYield : public Caster::Yield<Message> {
+    public:
+        CountingYield() : count(0) {}
+
+        void operator()(const Message& msg) const override {
+            if (msg.type() == Message::SYSTEM_EVENT) {
+                ++count;
+            }
+        }
+
+        mutable uint32_t count;
+};
+
+// The state nodes of a gateway.
+class Nodes {
+    public:
+        Nodes(const char* name, FakeClock* clock) : name(name),
+            climate(TICK, clock), ecm(TICK, clock), ipdm(TICK, clock), tires(TICK, clock) {}
+
+        void backoff() {
+            climate.backoff(MAX_TICK);
+            ecm.backoff(MAX_TICK);
+            ipdm.backoff(MAX_TICK);
+            tires.backoff(MAX_TICK);
+        }
+
+        void handle(const Frame& frame) {
+            Message msg(frame);
+            climate.handle(msg);
+            ecm.handle(msg);
+            ipdm.handle(msg);
+            tires.handle(msg);
+        }
+
+        void emit() {
+            climate.emit(climate_yield);
+            ecm.emit(ecm_yield);
+            ipdm.emit(ipdm_yield);
+            tires.emit(tires_yield);
+        }
+
+        const char* name;
+        Climate climate;
+        EngineTempState ecm;
+        IPDM ipdm;
+        TirePressureState tires;
+        CountingYield climate_yield;
+        CountingYield ecm_yield;
+        CountingYield ipdm_yield;
+        CountingYield tires_yield;
+};
+
+FakeClock clock_;
+Nodes fixed("fixed", &clock_);
+Nodes adaptive("adaptive", &clock_);
+
+// Advance the clock to now polling the nodes along the way.
+void advance(uint32_t now) {
+    while (clock_.millis() + LOOP <= now) {
+        clock_.delay(LOOP);
+        fixed.emit();
+        adaptive.emit();
+    }
+}
+
+void replay(const Frame& frame, uint32_t now) {
+    advance(now);
+    fixed.handle(frame);
+    adaptive.handle(frame);
+}
+
+bool replayLog(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (file == nullptr) {
+        fprintf(stderr, "failed to open %s\n", path);
+        return false;
+    }
+    char line[128];
+    Frame frame(0, 0, 8);
+    uint64_t timestamp;
+    uint64_t start = 0;
+    bool started = false;
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        if (!parseCanDump(line, &timestamp, &frame)) {
+            continue;
+        }
+        if (!started) {
+            start = timestamp;
+            started = true;
+        }
+        replay(frame, (timestamp - start) / 1000);
+    }
+    fclose(file);
+    return true;
+}
+
+// Replay a 20 minute drive. The engine warms up over the first 5 minutes,
+// the headlights are switched on and off, and climate and tire state hold.
+void replaySynthetic() {
+    static const uint32_t DURATION = 20 * 60 * 1000;
+    Frame ecm(0x551, 0, {0x29, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+    Frame ipdm(0x625, 0, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+    Frame tires(0x385, 0, {0x00, 0x00, 0x5C, 0x5D, 0x5C, 0x5E, 0x00, 0xF0});
+    Frame temp(0x54A, 0, {0x3C, 0x3E, 0x7F, 0x80, 0x44, 0x44, 0x00, 0x58});
+    Frame airflow(0x54B, 0, {0x59, 0x84, 0x05, 0x24, 0x00, 0x00, 0x00, 0x02});
+
+    for (uint32_t now = 0; now < DURATION; now += 100) {
+        if (now < 300000 && now % 6000 == 0) {
+            ++ecm.data()[0];
+        }
+        ipdm.data()[1] = (now >= 120000 && now < 900000) ? 0x60 : 0x00;
+        replay(ecm, now);
+        replay(ipdm, now);
+        replay(temp, now);
+        replay(airflow, now);
+        if (now % 1000 == 0) {
+            replay(tires, now);
+        }
+    }
+    advance(DURATION);
+}
+
+void report(const char* node, uint32_t base, uint32_t adapt) {
+    printf("%-8s %8lu %8lu %6.1f%%\n", node, (unsigned long)base, (unsigned long)adapt,
+            base == 0 ? 0.0 : 100.0 * (base - adapt) / base);
+}
+
+void setup() {
+    adaptive.backoff();
+    if (epoxy_argc > 1) {
+        if (!replayLog(epoxy_argv[1])) {
+            exit(1);
+        }
+    } else {
+        replaySynthetic();
+    }
+
+    printf("%-8s %8s %8s %7s\n", "node", fixed.name, adaptive.name, "saved");
+    report("climate", fixed.climate_yield.count, adaptive.climate_yield.count);
+    report("ecm", fixed.ecm_yield.count, adaptive.ecm_yield.count);
+    report("ipdm", fixed.ipdm_yield.count, adaptive.ipdm_yield.count);
+    report("tires", fixed.tires_yield.count, adaptive.tires_yield.count);
+    uint32_t base = fixed.climate_yield.count + fixed.ecm_yield.count +
+        fixed.ipdm_yield.count + fixed.tires_yield.count;
+    uint32_t adapt = adaptive.climate_yield.count + adaptive.ecm_yield.count +
+        adaptive.ipdm_yield.count + adaptive.tires_yield.count;
+    report("total", base, adapt);
+    exit(0);
+}
+
+void loop() {}
@@ -0,0 +1,103 @@
+#include <Arduino.h>
+#include <Canny.h>
+#include <Caster.h>
+#include <Faker.h>
+#include <R51Core.h>
+#include <R51Vehicle.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+using ::Canny::Frame;
+using ::Faker::FakeClock;
+using namespace ::R51;
+
+static const uint32_t ITERATIONS = 200000;
+
+// Discards all yielded messages.
+class NullYield : public Caster::Yield<Message> {
+    public:
+        void operator()(const Message&) const override {}
+};
+
+// Typical mix of broadcast frames on the body bus. Most frames are not
+// consumed by any node.
+static const Frame FRAMES[] = {
+    Frame(0x002, 0, {0x00, 0x00, 0x00, 0x00, 0x00}),
+    Frame(0x160, 0, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}),
+    Frame(0x180, 0, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}),
+    Frame(0x54A, 0, {0x3C, 0x3E, 0x7F, 0x80, 0x44, 0x44, 0x00, 0x58}),
+    Frame(0x54B, 0, {0x59, 0x84, 0x05, 0x24, 0x00, 0x00, 0x00, 0x02}),
+    Frame(0x551, 0, {0x50, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}),
+    Frame(0x625, 0, {0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}),
+    Frame(0x385, 0, {0x00, 0x00, 0x5C, 0x5D, 0x5C, 0x5E, 0x00, 0xF0}),
+};
+static const size_t FRAME_COUNT = sizeof(FRAMES) / sizeof(FRAMES[0]);
+
+// The vehicle nodes driven by a gateway.
+class Vehicle {
+    public:
+        Vehicle(FakeClock* clock) :
+            climate(1000, clock), ecm(1000, clock), ipdm(1000, clock),
+            tires(1000, clock), settings(false, clock) {}
+
+        Climate climate;
+        EngineTempState ecm;
+        IPDM ipdm;
+        TirePressureState tires;
+        Settings settings;
+};
+
+void report(const char* name, uint32_t elapsed_us) {
+    printf("%-8s %8.1f ns/frame\n", name, 1000.0 * elapsed_us / ITERATIONS);
+}
+
+uint32_t benchVirtual(const Message* messages) {
+    FakeClock clock;
+    NullYield yield;
+    Vehicle vehicle(&clock);
+    Caster::Node<Message>* nodes[] = {&vehicle.climate, &vehicle.ecm,
+        &vehicle.ipdm, &vehicle.tires, &vehicle.settings};
+
+    uint32_t start = micros();
+    for (uint32_t i = 0; i < ITERATIONS; ++i) {
+        const Message& msg = messages[i % FRAME_COUNT];
+        for (auto* node : nodes) {
+            node->handle(msg);
+        }
+        for (auto* node : nodes) {
+            node->emit(yield);
+        }
+    }
+    return micros() - start;
+}
+
+uint32_t benchStatic(const Message* messages) {
+    FakeClock clock;
+    NullYield yield;
+    Vehicle vehicle(&clock);
+    VehicleNodes<Climate, EngineTempState, IPDM, TirePressureState, Settings> nodes(
+        vehicle.climate, vehicle.ecm, vehicle.ipdm, vehicle.tires, vehicle.settings);
+
+    uint32_t start = micros();
+    for (uint32_t i = 0; i < ITERATIONS; ++i) {
+        const Message& msg = messages[i % FRAME_COUNT];
+        nodes.handle(msg);
+        nodes.emit(yield);
+    }
+    return micros() - start;
+}
+
+void setup() {
+    Message messages[FRAME_COUNT] = {
+        FRAMES[0], FRAMES[1], FRAMES[2], FRAMES[3],
+        FRAMES[4], FRAMES[5], FRAMES[6], FRAMES[7],
+    };
+    uint32_t virt = benchVirtual(messages);
+    uint32_t stat = benchStatic(messages);
+    report("virtual", virt);
+    report("static", stat);
+    printf("%-8s %8.1f%%\n", "gain", 100.0 * ((double)virt - stat) / virt);
+    exit(0);
+}
+
+void loop() {}
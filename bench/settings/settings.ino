@@ -0,0 +1,77 @@
+#include <Arduino.h>
+#include <Canny.h>
+#include <Caster.h>
+#include <Faker.h>
+#include <R51Core.h>
+#include <R51Vehicle.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+using ::Canny::Frame;
+using ::Faker::FakeClock;
+using ::R51::Message;
+using ::R51::Settings;
+
+static const uint32_t ITERATIONS = 200000;
+
+// Discards all yielded messages.
+class NullYield : public Caster::Yield<Message> {
+    public:
+        void operator()(const Message&) const override {}
+};
+
+// Multi-frame state response from the BCM on the 0x71E channel.
+static const Frame STATE_FRAMES[] = {
+    Frame(0x72E, 0, {0x10, 0x11, 0x61, 0x01, 0x00, 0x1E, 0x24, 0x00}),
+    Frame(0x72E, 0, {0x21, 0x10, 0x0C, 0x40, 0x40, 0x01, 0x64, 0x00}),
+    Frame(0x72E, 0, {0x22, 0x94, 0x00, 0x00, 0x47, 0xFF, 0xFF, 0xFF}),
+};
+
+// Single frame acknowledgement from the BCM.
+static const Frame ACK_FRAME(0x72E, 0, {0x02, 0x50, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF});
+
+// Report the average time spent per frame.
+void report(const char* name, uint32_t elapsed_us, uint32_t frames) {
+    printf("%-12s %8.1f ns/frame (%lu frames)\n", name,
+            1000.0 * elapsed_us / frames, (unsigned long)frames);
+}
+
+void benchState() {
+    FakeClock clock;
+    Settings settings(false, &clock);
+    NullYield yield;
+    Message first(STATE_FRAMES[0]);
+    Message second(STATE_FRAMES[1]);
+    Message third(STATE_FRAMES[2]);
+
+    // Each response also pays for one emit to send the flow control frame.
+    uint32_t start = micros();
+    for (uint32_t i = 0; i < ITERATIONS; ++i) {
+        settings.handle(first);
+        settings.emit(yield);
+        settings.handle(second);
+        settings.handle(third);
+    }
+    uint32_t elapsed = micros() - start;
+    report("state", elapsed, ITERATIONS * 3);
+}
+
+void benchAck() {
+    FakeClock clock;
+    Settings settings(false, &clock);
+    Message ack(ACK_FRAME);
+
+    uint32_t start = micros();
+    for (uint32_t i = 0; i < ITERATIONS; ++i) {
+        settings.handle(ack);
+    }
+    report("ack", micros() - start, ITERATIONS);
+}
+
+void setup() {
+    benchState();
+    benchAck();
+    exit(0);
+}
+
+void loop() {}
@@ -0,0 +1,165 @@
+#include <Arduino.h>
+#include <Canny.h>
+#include <Caster.h>
+#include <Faker.h>
+#include <R51Core.h>
+#include <R51Vehicle.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using ::Canny::Frame;
+using ::Faker::FakeClock;
+using namespace ::R51;
+
+static const uint32_t ITERATIONS = 200000;
+
+// A driver mailbox as filled by the CAN controller.
+struct Mailbox {
+    uint32_t id;
+    uint8_t size;
+    byte data[8];
+};
+
+// Typical mix of broadcast frames on the body bus as received into the
+// driver's mailboxes.
+static const Mailbox RX[] = {
+    {0x002, 5, {0x00, 0x00, 0x00, 0x00, 0x00}},
+    {0x160, 8, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {0x180, 8, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {0x54A, 8, {0x3C, 0x3E, 0x7F, 0x80, 0x44, 0x44, 0x00, 0x58}},
+    {0x54B, 8, {0x59, 0x84, 0x05, 0x24, 0x00, 0x00, 0x00, 0x02}},
+    {0x551, 8, {0x50, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {0x60D, 8, {0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {0x625, 8, {0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {0x385, 8, {0x00, 0x00, 0x5C, 0x5D, 0x5C, 0x5E, 0x00, 0xF0}},
+};
+static const size_t RX_COUNT = sizeof(RX) / sizeof(RX[0]);
+
+// Copies yielded frames into a transmit mailbox and discards events.
+class TxYield : public Caster::Yield<Message> {
+    public:
+        TxYield(Mailbox* tx) : tx_(tx), frames(0) {}
+
+        void operator()(const Message& msg) const override {
+            if (msg.type() != Message::CAN_FRAME) {
+                return;
+            }
+            const Frame& frame = msg.can_frame();
+            tx_->id = frame.id();
+            tx_->size = frame.size();
+            memcpy(tx_->data, frame.data(), frame.size());
+            ++frames;
+        }
+
+    private:
+        Mailbox* tx_;
+
+    public:
+        mutable uint32_t frames;
+};
+
+// The vehicle nodes driven by a gateway.
+class Vehicle {
+    public:
+        Vehicle(FakeClock* clock) :
+            climate(1000, clock), doors(1000, clock), ecm(1000, clock),
+            ipdm(1000, clock), tires(1000, clock), settings(true, clock) {}
+
+        Climate climate;
+        Doors doors;
+        EngineTempState ecm;
+        IPDM ipdm;
+        TirePressureState tires;
+        Settings settings;
+};
+
+void report(const char* name, uint32_t elapsed_us, uint32_t copies, uint32_t sent) {
+    printf("%-8s %8.1f ns/frame %8.2f copies/frame %8lu sent\n", name,
+            1000.0 * elapsed_us / ITERATIONS, (double)copies / ITERATIONS,
+            (unsigned long)sent);
+}
+
+// Copy each frame out of its mailbox into a Message and copy each control
+// frame yielded by the nodes into the transmit mailbox.
+uint32_t benchCopy() {
+    FakeClock clock;
+    Vehicle vehicle(&clock);
+    Mailbox tx;
+    TxYield yield(&tx);
+    Frame frame(0, 0, 8);
+
+    uint32_t start = micros();
+    for (uint32_t i = 0; i < ITERATIONS; ++i) {
+        const Mailbox& rx = RX[i % RX_COUNT];
+        frame.id(rx.id, 0);
+        frame.resize(rx.size);
+        memcpy(frame.data(), rx.data, rx.size);
+        Message msg(frame);
+        vehicle.climate.handle(msg);
+        vehicle.doors.handle(msg);
+        vehicle.ecm.handle(msg);
+        vehicle.ipdm.handle(msg);
+        vehicle.tires.handle(msg);
+        vehicle.settings.handle(msg);
+
+        vehicle.climate.emit(yield);
+        vehicle.doors.emit(yield);
+        vehicle.ecm.emit(yield);
+        vehicle.ipdm.emit(yield);
+        vehicle.tires.emit(yield);
+        vehicle.settings.emit(yield);
+        clock.delay(1);
+    }
+    uint32_t elapsed = micros() - start;
+    report("copy", elapsed, ITERATIONS + yield.frames, yield.frames);
+    return elapsed;
+}
+
+// Handle each frame in place in its mailbox and encode control frames
+// directly into the transmit mailbox.
+uint32_t benchInPlace() {
+    FakeClock clock;
+    Vehicle vehicle(&clock);
+    Mailbox tx;
+    TxYield yield(&tx);
+    FrameSlot slot(tx.data);
+    uint32_t sent = 0;
+
+    uint32_t start = micros();
+    for (uint32_t i = 0; i < ITERATIONS; ++i) {
+        const Mailbox& rx = RX[i % RX_COUNT];
+        FrameView frame(rx.id, 0, rx.data, rx.size);
+        vehicle.climate.handle(frame);
+        vehicle.doors.handle(frame);
+        vehicle.ecm.handle(frame);
+        vehicle.ipdm.handle(frame);
+        vehicle.tires.handle(frame);
+        vehicle.settings.handle(frame);
+
+        vehicle.climate.poll(yield);
+        vehicle.doors.emit(yield);
+        vehicle.ecm.emit(yield);
+        vehicle.ipdm.emit(yield);
+        vehicle.tires.emit(yield);
+        vehicle.settings.poll(yield);
+        while (vehicle.climate.encode(&slot) || vehicle.settings.encode(&slot)) {
+            tx.id = slot.id();
+            tx.size = slot.size();
+            ++sent;
+        }
+        clock.delay(1);
+    }
+    uint32_t elapsed = micros() - start;
+    report("inplace", elapsed, yield.frames, sent);
+    return elapsed;
+}
+
+void setup() {
+    uint32_t copy = benchCopy();
+    uint32_t inplace = benchInPlace();
+    printf("%-8s %8.1f%%\n", "gain", 100.0 * ((double)copy - inplace) / copy);
+    exit(0);
+}
+
+void loop() {}
@@ -1,12 +1,33 @@
 #ifndef _R51_VEHICLE_H_
 #define _R51_VEHICLE_H_
 
+#include "R51Vehicle/Batch.h"
+#include "R51Vehicle/BlackBox.h"
+#include "R51Vehicle/Bus.h"
+#include "R51Vehicle/CanDump.h"
+#include "R51Vehicle/CanLog.h"
 #include "R51Vehicle/Climate.h"
 #include "R51Vehicle/ClimateEvents.h"
 #include "R51Vehicle/ClimateFrames.h"
+#include "R51Vehicle/Controller.h"
+#include "R51Vehicle/Deadline.h"
+#include "R51Vehicle/Doors.h"
 #include "R51Vehicle/ECM.h"
+#include "R51Vehicle/Events.h"
+#include "R51Vehicle/Filter.h"
+#include "R51Vehicle/FlightLog.h"
+#include "R51Vehicle/FlightLogFile.h"
+#include "R51Vehicle/Freshness.h"
+#include "R51Vehicle/Handler.h"
+#include "R51Vehicle/Heartbeat.h"
 #include "R51Vehicle/IPDM.h"
+#include "R51Vehicle/IsoTp.h"
+#include "R51Vehicle/Node.h"
+#include "R51Vehicle/Pipeline.h"
+#include "R51Vehicle/Power.h"
 #include "R51Vehicle/Settings.h"
+#include "R51Vehicle/Simulator.h"
+#include "R51Vehicle/SocketCan.h"
 #include "R51Vehicle/Tires.h"
 #include "R51Vehicle/Units.h"
 
@@ -0,0 +1,126 @@
+#ifndef _R51_VEHICLE_BATCH_H_
+#define _R51_VEHICLE_BATCH_H_
+
+#include <Arduino.h>
+#include <Canny.h>
+#include <Caster.h>
+#include <R51Core.h>
+
+namespace R51 {
+
+// Maximum number of messages held by a batch. This must cover the largest
+// single emit of any node. Settings may emit nine messages in one pass.
+#ifndef BATCH_SIZE
+#define BATCH_SIZE 10
+#endif
+
+// A fixed array of messages emitted by a node in a single pass. Payloads are
+// copied into the batch so nodes may reuse their buffers between messages.
+class MessageBatch {
+    public:
+        // The message type enum.
+        typedef decltype(Message::CAN_FRAME) Type;
+
+        MessageBatch() : size_(0), overflow_(0) {}
+
+        // Append a copy of a frame. Return false if the batch is full.
+        bool push(const Canny::Frame& frame) {
+            if (size_ >= BATCH_SIZE) {
+                ++overflow_;
+                return false;
+            }
+            Canny::Frame& dst = frames_[size_];
+            dst.id(frame.id(), frame.ext());
+            dst.resize(frame.size());
+            memcpy(dst.data(), frame.data(), frame.size());
+            types_[size_++] = Message::CAN_FRAME;
+            return true;
+        }
+
+        // Append a copy of an event. Return false if the batch is full.
+        bool push(const SystemEvent& event) {
+            if (size_ >= BATCH_SIZE) {
+                ++overflow_;
+                return false;
+            }
+            events_[size_] = event;
+            types_[size_++] = Message::SYSTEM_EVENT;
+            return true;
+        }
+
+        // Append a copy of a message's payload.
+        bool push(const Message& msg) {
+            switch (msg.type()) {
+                case Message::CAN_FRAME:
+                    return push(msg.can_frame());
+                case Message::SYSTEM_EVENT:
+                    return push(msg.system_event());
+                default:
+                    return false;
+            }
+        }
+
+        // Operator form of push so a batch can stand in for a yield.
+        void operator()(const Canny::Frame& frame) { push(frame); }
+        void operator()(const SystemEvent& event) { push(event); }
+
+        // Return the number of messages in the batch.
+        size_t size() const { return size_; }
+
+        // Return the number of messages dropped because the batch was full.
+        uint32_t overflow() const { return overflow_; }
+
+        // Return the type of the message at index.
+        Type type(size_t index) const { return types_[index]; }
+
+        // Return the payload of the message at index. Only valid for the
+        // message's type.
+        const Canny::Frame& can_frame(size_t index) const { return frames_[index]; }
+        const SystemEvent& system_event(size_t index) const { return events_[index]; }
+
+        // Empty the batch.
+        void clear() { size_ = 0; }
+
+        // Pass each message in order to a yield. Used to hand a batch to
+        // consumers which do not accept batches.
+        void flush(const Caster::Yield<Message>& yield) const {
+            for (size_t i = 0; i < size_; ++i) {
+                if (types_[i] == Message::CAN_FRAME) {
+                    yield(frames_[i]);
+                } else {
+                    yield(events_[i]);
+                }
+            }
+        }
+
+    private:
+        size_t size_;
+        uint32_t overflow_;
+        Type types_[BATCH_SIZE];
+        Canny::Frame frames_[BATCH_SIZE];
+        SystemEvent events_[BATCH_SIZE];
+};
+
+// Implemented by consumers which process a batch of messages in one call.
+class BatchHandler {
+    public:
+        virtual ~BatchHandler() = default;
+
+        // Handle each message in the batch.
+        virtual void handle(const MessageBatch& batch) = 0;
+};
+
+// Collects the output of a node which does not emit batches.
+class BatchYield : public Caster::Yield<Message> {
+    public:
+        BatchYield(MessageBatch* batch) : batch_(batch) {}
+
+        void operator()(const Message& msg) const override { batch_->push(msg); }
+
+    private:
+        MessageBatch* batch_;
+};
+
+}  // namespace R51
+
+#endif  // _R51_VEHICLE_BATCH_H_
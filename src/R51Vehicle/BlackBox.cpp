@@ -0,0 +1,242 @@
+#include "BlackBox.h"
+
+#include <Arduino.h>
+#include <Caster.h>
+#include <Faker.h>
+#include <R51Core.h>
+
+namespace R51 {
+namespace {
+
+// Maximum length of a dumped frame line.
+static const size_t LINE_SIZE = 56;
+
+// Return the channel index of a recorded frame ID or -1 if the ID is not
+// recorded.
+int8_t channelIndex(uint32_t id) {
+    switch (id) {
+        case 0x385: return 0;
+        case 0x54A: return 1;
+        case 0x54B: return 2;
+        case 0x551: return 3;
+        case 0x60D: return 4;
+        case 0x625: return 5;
+        case 0x71E: return 6;
+        case 0x71F: return 7;
+        case 0x72E: return 8;
+        case 0x72F: return 9;
+        default: return -1;
+    }
+}
+
+// Frame IDs by channel index.
+static const uint16_t CHANNEL_IDS[BLACK_BOX_CHANNELS] = {
+    0x385, 0x54A, 0x54B, 0x551, 0x60D, 0x625, 0x71E, 0x71F, 0x72E, 0x72F,
+};
+
+// Write value as width zero padded decimal digits. Return the end of the
+// written digits.
+char* formatDecimal(char* p, uint32_t value, uint8_t width) {
+    for (uint8_t i = width; i > 0; --i) {
+        p[i - 1] = '0' + value % 10;
+        value /= 10;
+    }
+    return p + width;
+}
+
+// Write value as width zero padded uppercase hex digits. Return the end of
+// the written digits.
+char* formatHex(char* p, uint32_t value, uint8_t width) {
+    static const char digits[] = "0123456789ABCDEF";
+    for (uint8_t i = width; i > 0; --i) {
+        p[i - 1] = digits[value & 0x0F];
+        value >>= 4;
+    }
+    return p + width;
+}
+
+}  // namespace
+
+BlackBox::BlackBox(Print* out, Faker::Clock* clock) :
+    out_(out), clock_(clock), trigger_enabled_(false), trigger_event_(0),
+    cause_(CAUSE_NONE), frozen_(false), cause_id_(0), cause_service_(0),
+    cause_reason_(0), cause_time_(0), dumped_(false), last_dump_(0), dumps_(0),
+    suppressed_(0) {
+    memset(channels_, 0, sizeof(channels_));
+}
+
+void BlackBox::handle(const Message& msg) {
+    switch (msg.type()) {
+        case Message::CAN_FRAME:
+            handle(FrameView(msg.can_frame()));
+            break;
+        case Message::SYSTEM_EVENT:
+            if (trigger_enabled_ && msg.system_event().id == trigger_event_) {
+                trigger();
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+bool BlackBox::handle(const FrameView& frame) {
+    if (frozen_ || frame.ext() != 0) {
+        return false;
+    }
+    int8_t index = channelIndex(frame.id());
+    if (index < 0) {
+        return false;
+    }
+    Channel* channel = &channels_[index];
+    Entry* entry = &channel->entries[channel->head];
+    entry->time = clock_->millis();
+    entry->size = frame.size() > 8 ? 8 : frame.size();
+    memcpy(entry->data, frame.data(), entry->size);
+    channel->head = (channel->head + 1) % BLACK_BOX_DEPTH;
+    if (channel->count < BLACK_BOX_DEPTH) {
+        ++channel->count;
+    }
+    return false;
+}
+
+void BlackBox::emit(const Caster::Yield<Message>&) {
+    if (cause_ == CAUSE_NONE) {
+        return;
+    }
+    uint8_t lines = BLACK_BOX_DUMP_LINES;
+    if (!frozen_) {
+        // Recording pauses once the dump starts so frames are not
+        // overwritten while they are written out.
+        frozen_ = true;
+        for (uint8_t i = 0; i < BLACK_BOX_CHANNELS; ++i) {
+            channels_[i].dumped = 0;
+        }
+        writeHeader();
+        --lines;
+    }
+    for (; lines > 0; --lines) {
+        if (!writeNext()) {
+            finish();
+            return;
+        }
+    }
+}
+
+void BlackBox::triggerEvent(Event event) {
+    trigger_enabled_ = true;
+    trigger_event_ = (uint8_t)event;
+}
+
+void BlackBox::trigger() {
+    start(CAUSE_TRIGGER, false);
+}
+
+void BlackBox::unexpected(const FrameView& frame) {
+    // The frame is recorded by handle() before the dump starts on the next
+    // emit regardless of the order nodes handle it in.
+    if (start(CAUSE_UNEXPECTED, true)) {
+        cause_id_ = frame.id();
+    }
+}
+
+void BlackBox::failed(uint32_t request_id, uint8_t service, uint8_t reason) {
+    if (start(CAUSE_FAILED, true)) {
+        cause_id_ = request_id;
+        cause_service_ = service;
+        cause_reason_ = reason;
+    }
+}
+
+bool BlackBox::start(Cause cause, bool holdoff) {
+    uint32_t now = clock_->millis();
+    if (cause_ != CAUSE_NONE ||
+            (holdoff && dumped_ && now - last_dump_ < BLACK_BOX_HOLDOFF)) {
+        if (holdoff) {
+            ++suppressed_;
+        }
+        return false;
+    }
+    cause_ = cause;
+    cause_time_ = now;
+    return true;
+}
+
+void BlackBox::writeHeader() {
+    switch (cause_) {
+        case CAUSE_UNEXPECTED:
+            out_->print("# unexpected ");
+            out_->print(cause_id_, HEX);
+            break;
+        case CAUSE_FAILED:
+            out_->print("# failed ");
+            out_->print(cause_id_, HEX);
+            out_->print(" service ");
+            out_->print(cause_service_, HEX);
+            out_->print(" reason ");
+            out_->print(cause_reason_, HEX);
+            break;
+        case CAUSE_TRIGGER:
+        default:
+            out_->print("# trigger");
+            break;
+    }
+    out_->print(" at ");
+    out_->print(cause_time_);
+    out_->print("\n");
+}
+
+bool BlackBox::writeNext() {
+    uint32_t now = clock_->millis();
+    const Entry* oldest = nullptr;
+    uint8_t oldest_index = 0;
+    uint32_t oldest_age = 0;
+    for (uint8_t i = 0; i < BLACK_BOX_CHANNELS; ++i) {
+        const Channel* channel = &channels_[i];
+        if (channel->dumped >= channel->count) {
+            continue;
+        }
+        uint8_t pos = (channel->head + BLACK_BOX_DEPTH - channel->count +
+                channel->dumped) % BLACK_BOX_DEPTH;
+        const Entry* entry = &channel->entries[pos];
+        uint32_t age = now - entry->time;
+        if (oldest == nullptr || age > oldest_age) {
+            oldest = entry;
+            oldest_index = i;
+            oldest_age = age;
+        }
+    }
+    if (oldest == nullptr) {
+        return false;
+    }
+    ++channels_[oldest_index].dumped;
+
+    char line[LINE_SIZE];
+    char* p = line;
+    *p++ = '(';
+    p = formatDecimal(p, oldest->time / 1000, 10);
+    *p++ = '.';
+    p = formatDecimal(p, oldest->time % 1000, 3);
+    p = formatDecimal(p, 0, 3);
+    memcpy(p, ") blackbox ", 11);
+    p += 11;
+    p = formatHex(p, CHANNEL_IDS[oldest_index], 3);
+    *p++ = '#';
+    for (uint8_t i = 0; i < oldest->size; ++i) {
+        p = formatHex(p, oldest->data[i], 2);
+    }
+    *p++ = '\n';
+    out_->write((const uint8_t*)line, p - line);
+    return true;
+}
+
+void BlackBox::finish() {
+    out_->print("# end\n");
+    cause_ = CAUSE_NONE;
+    frozen_ = false;
+    dumped_ = true;
+    last_dump_ = clock_->millis();
+    ++dumps_;
+}
+
+}  // namespace R51
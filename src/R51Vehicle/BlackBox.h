@@ -0,0 +1,146 @@
+#ifndef _R51_VEHICLE_BLACK_BOX_H_
+#define _R51_VEHICLE_BLACK_BOX_H_
+
+#include <Arduino.h>
+#include <Canny.h>
+#include <Caster.h>
+#include <Faker.h>
+#include <R51Core.h>
+#include "Deadline.h"
+#include "Handler.h"
+#include "Node.h"
+#include "SettingsSequence.h"
+
+namespace R51 {
+
+// Number of frames kept for each recorded frame ID.
+#ifndef BLACK_BOX_DEPTH
+#define BLACK_BOX_DEPTH 4
+#endif
+
+// Time in milliseconds after a dump during which decode anomalies and
+// settings failures do not start another dump. Explicit triggers are always
+// dumped.
+#ifndef BLACK_BOX_HOLDOFF
+#define BLACK_BOX_HOLDOFF 10000
+#endif
+
+// Maximum number of lines written by each call to emit() while dumping.
+#ifndef BLACK_BOX_DUMP_LINES
+#define BLACK_BOX_DUMP_LINES 4
+#endif
+
+// Number of frame IDs recorded by the black box.
+static const uint8_t BLACK_BOX_CHANNELS = 10;
+
+// Keeps the last BLACK_BOX_DEPTH raw frames of each frame ID consumed by the
+// vehicle nodes and of the 0x71E, 0x71F, 0x72E, and 0x72F settings channels
+// in fixed RAM. Other frame IDs are ignored.
+//
+// The recorded frames are dumped to a Print when the trigger event is
+// received, when trigger() is called, when a node reports a frame it cannot
+// decode, or when a settings sequence fails. The dump starts on the next
+// emit() so the frame which caused it is recorded whichever order the nodes
+// handle it in. Recording pauses while the dump is written.
+//
+// A dump starts with a "#" comment line describing its cause and ends with a
+// "# end" line. Frames are written oldest first in candump -l format with the
+// interface name "blackbox" so the dump may be replayed by the log tools.
+// Frames recorded in the same millisecond are written in frame ID order:
+//   (0000000012.345000) blackbox 54B#0084052400000002
+// Dumps are written a few lines per emit() so they do not stall the loop.
+class BlackBox : public VehicleNode, public Handler, public DecodeObserver,
+        public SettingsObserver {
+    public:
+        BlackBox(Print* out, Faker::Clock* clock = Faker::Clock::real());
+
+        // Record frames and dump on the trigger event.
+        void handle(const Message& msg) override;
+
+        // Record a frame in place. Always returns false as the black box has
+        // no state to publish.
+        bool handle(const FrameView& frame) override;
+
+        // Write the next lines of a pending dump. Nothing is yielded.
+        void emit(const Caster::Yield<Message>& yield) override;
+
+        // Return 0 while a dump is pending so it is written without waiting
+        // for traffic.
+        uint32_t nextDeadline() override { return dumping() ? 0 : DEADLINE_NONE; }
+
+        // Dump when the given system event is received.
+        void triggerEvent(Event event);
+
+        // Dump the recorded frames on the next emit.
+        void trigger();
+
+        // Dump after a node reports a frame it cannot decode. Ignored while a
+        // dump is in progress or within BLACK_BOX_HOLDOFF of the previous
+        // dump.
+        void unexpected(const FrameView& frame) override;
+
+        // Dump after a settings sequence is abandoned. Ignored as above.
+        void failed(uint32_t request_id, uint8_t service, uint8_t reason) override;
+
+        // Return true if a dump is pending or in progress.
+        bool dumping() const { return cause_ != CAUSE_NONE; }
+
+        // Return the number of dumps completed.
+        uint32_t dumps() const { return dumps_; }
+
+        // Return the number of dumps skipped due to the holdoff.
+        uint32_t suppressed() const { return suppressed_; }
+
+    private:
+        enum Cause : uint8_t {
+            CAUSE_NONE,
+            CAUSE_TRIGGER,
+            CAUSE_UNEXPECTED,
+            CAUSE_FAILED,
+        };
+
+        struct Entry {
+            uint32_t time;
+            uint8_t size;
+            byte data[8];
+        };
+
+        struct Channel {
+            uint8_t head;
+            uint8_t count;
+            uint8_t dumped;
+            Entry entries[BLACK_BOX_DEPTH];
+        };
+
+        Print* out_;
+        Faker::Clock* clock_;
+        bool trigger_enabled_;
+        uint8_t trigger_event_;
+        Cause cause_;
+        bool frozen_;
+        uint32_t cause_id_;
+        uint8_t cause_service_;
+        uint8_t cause_reason_;
+        uint32_t cause_time_;
+        bool dumped_;
+        uint32_t last_dump_;
+        uint32_t dumps_;
+        uint32_t suppressed_;
+        Channel channels_[BLACK_BOX_CHANNELS];
+
+        // Start a dump. Return false if a dump is in progress or the holdoff
+        // applies.
+        bool start(Cause cause, bool holdoff);
+
+        void writeHeader();
+
+        // Write the oldest frame not yet dumped. Return false if all frames
+        // have been dumped.
+        bool writeNext();
+
+        void finish();
+};
+
+}  // namespace R51
+
+#endif  // _R51_VEHICLE_BLACK_BOX_H_
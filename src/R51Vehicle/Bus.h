@@ -0,0 +1,165 @@
+#ifndef _R51_VEHICLE_BUS_H_
+#define _R51_VEHICLE_BUS_H_
+
+#include <Arduino.h>
+#include <Canny.h>
+#include <Caster.h>
+#include <R51Core.h>
+#include "Controller.h"
+#include "Handler.h"
+
+namespace R51 {
+
+// CAN frames carry the bus they were received on or are destined for in the
+// top three bits of the frame ID. These bits are unused by both standard and
+// extended IDs. Bus 0 is untagged so a single bus gateway sees unmodified
+// frame IDs.
+static const uint8_t BUS_ID_SHIFT = 29;
+static const uint32_t BUS_ID_MASK = 0x1FFFFFFF;
+static const uint8_t BUS_MAX = 7;
+
+// Return the bus encoded in a frame ID.
+constexpr uint8_t busOf(uint32_t id) {
+    return id >> BUS_ID_SHIFT;
+}
+
+// Return a frame ID without its bus.
+constexpr uint32_t busFrameId(uint32_t id) {
+    return id & BUS_ID_MASK;
+}
+
+// Return a frame ID tagged with a bus.
+constexpr uint32_t busTag(uint8_t bus, uint32_t id) {
+    return ((uint32_t)bus << BUS_ID_SHIFT) | (id & BUS_ID_MASK);
+}
+
+// Return the bus a frame was received on or is destined for.
+inline uint8_t busOf(const Canny::Frame& frame) {
+    return busOf(frame.id());
+}
+
+// Tag a frame received from a CAN controller with the controller's bus.
+inline void busTag(Canny::Frame& frame, uint8_t bus) {
+    frame.id(busTag(bus, frame.id()), frame.ext());
+}
+
+// Remove the bus from a frame before writing it to a CAN controller.
+inline void busUntag(Canny::Frame& frame) {
+    frame.id(busFrameId(frame.id()), frame.ext());
+}
+
+// Runs a vehicle node on a specific bus. Frames from other buses are ignored
+// and frames from the node's bus are passed to the node untagged so the node
+// may continue to match on its usual frame IDs. Frames yielded by the node
+// are tagged with the bus. Frames handled in place, encoded into transmit
+// slots, and left by poll() are adapted the same way when the node supports
+// them.
+//
+// Nodes on bus 0 need no adapter as untagged frame IDs never match frames
+// from other buses. OnBus<Node, 0> is the node itself.
+//
+// Example:
+//   IPDM body_ipdm;                // bus 0
+//   OnBus<Climate, 1> aux_climate;  // bus 1
+template <typename Node, uint8_t BUS>
+class OnBus : public Node {
+    static_assert(BUS <= BUS_MAX, "bus out of range");
+
+    public:
+        template <typename... Args>
+        OnBus(Args... args) : Node(args...), frame_(0, 0, 8) {}
+
+        // Pass frames from this bus and all system events to the node.
+        void handle(const Message& msg) override {
+            if (msg.type() != Message::CAN_FRAME) {
+                Node::handle(msg);
+                return;
+            }
+            forward(this, msg.can_frame());
+        }
+
+        // Pass a frame from this bus to the node in place. Return false if
+        // the frame is from another bus.
+        bool handle(const FrameView& frame) {
+            if (busOf(frame.id()) != BUS) {
+                return false;
+            }
+            return Node::handle(FrameView(busFrameId(frame.id()), frame.ext(),
+                        frame.data(), frame.size()));
+        }
+
+        // Yield the node's messages with its frames tagged for this bus.
+        void emit(const Caster::Yield<Message>& yield) override {
+            Node::emit(TagYield(this, yield));
+        }
+
+        // Poll the node with any yielded frames tagged for this bus.
+        void poll(const Caster::Yield<Message>& yield) {
+            Node::poll(TagYield(this, yield));
+        }
+
+        // Encode the node's next control frame tagged for this bus.
+        bool encode(FrameSlot* slot) {
+            if (!Node::encode(slot)) {
+                return false;
+            }
+            slot->id(busTag(BUS, slot->id()), slot->ext());
+            return true;
+        }
+
+    private:
+        class TagYield : public Caster::Yield<Message> {
+            public:
+                TagYield(OnBus* bus, const Caster::Yield<Message>& yield) :
+                    bus_(bus), yield_(yield) {}
+
+                void operator()(const Message& msg) const override {
+                    if (msg.type() != Message::CAN_FRAME) {
+                        yield_(msg);
+                        return;
+                    }
+                    const Canny::Frame& frame = msg.can_frame();
+                    bus_->copy(frame, busTag(BUS, frame.id()));
+                    yield_(bus_->frame_);
+                }
+
+            private:
+                OnBus* bus_;
+                const Caster::Yield<Message>& yield_;
+        };
+
+        Canny::Frame frame_;
+
+        // Handlers forward frames to their in place path, which would
+        // otherwise re-enter handle(const FrameView&) with an untagged frame.
+        void forward(Handler*, const Canny::Frame& frame) {
+            handle(FrameView(frame));
+        }
+
+        // Other nodes are passed an untagged copy.
+        void forward(void*, const Canny::Frame& frame) {
+            if (busOf(frame) != BUS) {
+                return;
+            }
+            copy(frame, busFrameId(frame.id()));
+            Node::handle(frame_);
+        }
+
+        void copy(const Canny::Frame& frame, uint32_t id) {
+            frame_.id(id, frame.ext());
+            frame_.resize(frame.size());
+            memcpy(frame_.data(), frame.data(), frame.size());
+        }
+};
+
+// Nodes on bus 0 are not adapted.
+template <typename Node>
+class OnBus<Node, 0> : public Node {
+    public:
+        template <typename... Args>
+        OnBus(Args... args) : Node(args...) {}
+};
+
+}  // namespace R51
+
+#endif  // _R51_VEHICLE_BUS_H_
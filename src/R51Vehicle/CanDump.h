@@ -0,0 +1,115 @@
+#ifndef _R51_VEHICLE_CAN_DUMP_H_
+#define _R51_VEHICLE_CAN_DUMP_H_
+
+// Log file parsing for native builds.
+#if defined(EPOXY_DUINO)
+
+#include <Arduino.h>
+#include <Canny.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace R51 {
+
+// Parse a line of a candump -l log, e.g.
+//   (1609459200.123456) can0 551#2900000000000000
+// The timestamp is returned in microseconds. The interface name is copied
+// into iface if it is not null. Return false if the line is not a classic
+// CAN data frame.
+inline bool parseCanDump(const char* line, uint64_t* timestamp_us,
+        Canny::Frame* frame, char* iface = nullptr, size_t iface_size = 0) {
+    const char* p = line;
+    while (*p == ' ' || *p == '\t') {
+        ++p;
+    }
+    if (*p++ != '(') {
+        return false;
+    }
+    char* end;
+    uint64_t seconds = strtoull(p, &end, 10);
+    if (end == p || *end != '.') {
+        return false;
+    }
+    p = end + 1;
+    uint64_t fraction = 0;
+    int digits = 0;
+    for (; *p >= '0' && *p <= '9'; ++p, ++digits) {
+        if (digits < 6) {
+            fraction = fraction * 10 + (*p - '0');
+        }
+    }
+    for (; digits < 6; ++digits) {
+        fraction *= 10;
+    }
+    if (*p++ != ')') {
+        return false;
+    }
+    *timestamp_us = seconds * 1000000 + fraction;
+
+    while (*p == ' ') {
+        ++p;
+    }
+    const char* name = p;
+    while (*p != ' ' && *p != 0) {
+        ++p;
+    }
+    if (iface != nullptr && iface_size > 0) {
+        size_t n = p - name < (ptrdiff_t)iface_size - 1 ? p - name : iface_size - 1;
+        memcpy(iface, name, n);
+        iface[n] = 0;
+    }
+    while (*p == ' ') {
+        ++p;
+    }
+
+    const char* id = p;
+    uint32_t value = strtoul(id, &end, 16);
+    if (end == id || *end != '#' || end[1] == 'R') {
+        return false;
+    }
+    bool ext = end - id > 3;
+    p = end + 1;
+
+    size_t size = 0;
+    byte data[8];
+    while (size < 8) {
+        char hex[3] = {p[0], p[0] == 0 ? (char)0 : p[1], 0};
+        if (hex[0] == 0 || hex[1] == 0) {
+            break;
+        }
+        data[size] = strtoul(hex, &end, 16);
+        if (end != hex + 2) {
+            break;
+        }
+        ++size;
+        p += 2;
+    }
+    if (*p != 0 && *p != '\n' && *p != '\r' && *p != ' ') {
+        return false;
+    }
+    frame->id(value, ext);
+    frame->resize(size);
+    memcpy(frame->data(), data, size);
+    return true;
+}
+
+// Format a frame as a line of a candump -l log without a trailing newline.
+// Return the number of characters written as snprintf does.
+inline int formatCanDump(char* buffer, size_t size, uint64_t timestamp_us,
+        const char* iface, const Canny::Frame& frame) {
+    int n = snprintf(buffer, size, frame.ext() ? "(%llu.%06llu) %s %08lX#" : "(%llu.%06llu) %s %03lX#",
+            (unsigned long long)(timestamp_us / 1000000),
+            (unsigned long long)(timestamp_us % 1000000),
+            iface, (unsigned long)frame.id());
+    for (size_t i = 0; i < frame.size() && n >= 0 && (size_t)n < size; ++i) {
+        n += snprintf(buffer + n, size - n, "%02X", frame.data()[i]);
+    }
+    return n;
+}
+
+}  // namespace R51
+
+#endif  // defined(EPOXY_DUINO)
+
+#endif  // _R51_VEHICLE_CAN_DUMP_H_
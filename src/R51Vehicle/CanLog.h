@@ -0,0 +1,375 @@
+#ifndef _R51_VEHICLE_CAN_LOG_H_
+#define _R51_VEHICLE_CAN_LOG_H_
+
+// Indexed binary CAN logs for native builds.
+#if defined(EPOXY_DUINO)
+
+#include <Arduino.h>
+#include <Canny.h>
+#include <Caster.h>
+#include <Faker.h>
+#include <R51Core.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace R51 {
+
+// Number of frame records in each block of a binary CAN log.
+#ifndef CAN_LOG_BLOCK_SIZE
+#define CAN_LOG_BLOCK_SIZE 256
+#endif
+
+// Binary CAN log layout. All values are little endian.
+//
+//   header  | block 0 | block 1 | ... | block N-1 | index
+//
+// Each block holds CAN_LOG_BLOCK_SIZE fixed size records; the last block may
+// be short. The index follows the blocks and holds one entry per block with
+// the block's time range and a bitmap of the frame IDs it contains. Readers
+// check the index to find relevant blocks so blocks which are skipped are
+// never paged in.
+static const char CAN_LOG_MAGIC[8] = {'R', '5', '1', 'C', 'A', 'N', 'L', 'G'};
+static const uint16_t CAN_LOG_VERSION = 1;
+
+// Set in a record's ID for extended frames.
+static const uint32_t CAN_LOG_EXT = 0x80000000;
+
+struct CanLogHeader {
+    char magic[8];
+    uint16_t version;
+    uint16_t block_size;
+    uint32_t blocks;
+    uint64_t records;
+    uint64_t index_offset;
+};
+
+// A single frame. The ID has CAN_LOG_EXT set for extended frames.
+struct CanLogRecord {
+    uint64_t timestamp;
+    uint32_t id;
+    uint8_t size;
+    uint8_t reserved[3];
+    byte data[8];
+
+    uint32_t frameId() const { return id & ~CAN_LOG_EXT; }
+    bool ext() const { return (id & CAN_LOG_EXT) != 0; }
+};
+
+// Index entry for a block. Each frame ID sets one bit in the ID bitmap so
+// the bitmap may match IDs which are not in the block but will never miss
+// one which is.
+struct CanLogBlock {
+    uint64_t start;
+    uint64_t end;
+    uint32_t count;
+    uint32_t reserved;
+    byte ids[32];
+
+    static uint8_t bit(uint32_t id) { return (id * 2654435761u) >> 24; }
+
+    void add(uint32_t id) { ids[bit(id) / 8] |= 1 << (bit(id) % 8); }
+
+    bool mayContain(uint32_t id) const {
+        return (ids[bit(id) / 8] & (1 << (bit(id) % 8))) != 0;
+    }
+};
+
+static_assert(sizeof(CanLogHeader) == 32, "unexpected CanLogHeader size");
+static_assert(sizeof(CanLogRecord) == 24, "unexpected CanLogRecord size");
+static_assert(sizeof(CanLogBlock) == 56, "unexpected CanLogBlock size");
+
+// Writes a binary CAN log. Frames should be written in time order so block
+// time ranges do not overlap.
+class CanLogWriter {
+    public:
+        CanLogWriter() : file_(nullptr), count_(0), records_(0) {}
+        ~CanLogWriter() { close(); }
+
+        // Create the log at path. Return false on error.
+        bool open(const char* path) {
+            close();
+            file_ = fopen(path, "wb");
+            if (file_ == nullptr) {
+                return false;
+            }
+            index_.clear();
+            count_ = 0;
+            records_ = 0;
+            CanLogHeader header;
+            memset(&header, 0, sizeof(header));
+            return fwrite(&header, sizeof(header), 1, file_) == 1;
+        }
+
+        // Append a frame with a timestamp in microseconds.
+        bool write(uint64_t timestamp, const Canny::Frame& frame) {
+            if (file_ == nullptr) {
+                return false;
+            }
+            CanLogRecord& record = block_[count_];
+            memset(&record, 0, sizeof(record));
+            record.timestamp = timestamp;
+            record.id = frame.id() | (frame.ext() ? CAN_LOG_EXT : 0);
+            record.size = frame.size() > 8 ? 8 : frame.size();
+            memcpy(record.data, frame.data(), record.size);
+            if (++count_ == CAN_LOG_BLOCK_SIZE) {
+                return flush();
+            }
+            return true;
+        }
+
+        // Write the final block, index, and header and close the file. Return
+        // false on error.
+        bool close() {
+            if (file_ == nullptr) {
+                return true;
+            }
+            bool ok = flush();
+            CanLogHeader header;
+            memcpy(header.magic, CAN_LOG_MAGIC, sizeof(header.magic));
+            header.version = CAN_LOG_VERSION;
+            header.block_size = CAN_LOG_BLOCK_SIZE;
+            header.blocks = index_.size();
+            header.records = records_;
+            header.index_offset = sizeof(CanLogHeader) +
+                (uint64_t)records_ * sizeof(CanLogRecord);
+            ok = ok && fwrite(index_.data(), sizeof(CanLogBlock), index_.size(), file_) ==
+                index_.size();
+            ok = ok && fseek(file_, 0, SEEK_SET) == 0 &&
+                fwrite(&header, sizeof(header), 1, file_) == 1;
+            ok = fclose(file_) == 0 && ok;
+            file_ = nullptr;
+            return ok;
+        }
+
+    private:
+        FILE* file_;
+        std::vector<CanLogBlock> index_;
+        CanLogRecord block_[CAN_LOG_BLOCK_SIZE];
+        uint32_t count_;
+        uint64_t records_;
+
+        bool flush() {
+            if (count_ == 0) {
+                return true;
+            }
+            CanLogBlock entry;
+            memset(&entry, 0, sizeof(entry));
+            entry.start = block_[0].timestamp;
+            entry.end = block_[0].timestamp;
+            entry.count = count_;
+            for (uint32_t i = 0; i < count_; ++i) {
+                if (block_[i].timestamp < entry.start) {
+                    entry.start = block_[i].timestamp;
+                }
+                if (block_[i].timestamp > entry.end) {
+                    entry.end = block_[i].timestamp;
+                }
+                entry.add(block_[i].id);
+            }
+            index_.push_back(entry);
+            records_ += count_;
+            bool ok = fwrite(block_, sizeof(CanLogRecord), count_, file_) == count_;
+            count_ = 0;
+            return ok;
+        }
+};
+
+// Selects records from a log. Timestamps are in microseconds and the range
+// is inclusive. IDs of extended frames include CAN_LOG_EXT. An empty ID list
+// matches every frame.
+struct CanLogQuery {
+    uint64_t start;
+    uint64_t end;
+    const uint32_t* ids;
+    size_t id_count;
+
+    CanLogQuery(uint64_t start = 0, uint64_t end = UINT64_MAX,
+            const uint32_t* ids = nullptr, size_t id_count = 0) :
+        start(start), end(end), ids(ids), id_count(id_count) {}
+
+    bool matches(const CanLogBlock& block) const {
+        if (block.end < start || block.start > end) {
+            return false;
+        }
+        if (id_count == 0) {
+            return true;
+        }
+        for (size_t i = 0; i < id_count; ++i) {
+            if (block.mayContain(ids[i])) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool matches(const CanLogRecord& record) const {
+        if (record.timestamp < start || record.timestamp > end) {
+            return false;
+        }
+        if (id_count == 0) {
+            return true;
+        }
+        for (size_t i = 0; i < id_count; ++i) {
+            if (record.id == ids[i]) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// Reads a binary CAN log through a read-only memory mapping. Records are
+// returned as pointers into the mapping so nothing is copied until a frame is
+// handed to a node.
+class CanLogReader {
+    public:
+        CanLogReader() : map_(nullptr), size_(0), header_(nullptr), index_(nullptr),
+            records_(nullptr), block_(0), pos_(0), touched_(0) {}
+        ~CanLogReader() { close(); }
+
+        // Map the log at path. Return false if it cannot be mapped or is not
+        // a valid log.
+        bool open(const char* path) {
+            close();
+            int fd = ::open(path, O_RDONLY);
+            if (fd < 0) {
+                return false;
+            }
+            struct stat st;
+            if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CanLogHeader)) {
+                ::close(fd);
+                return false;
+            }
+            size_ = st.st_size;
+            void* map = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (map == MAP_FAILED) {
+                return false;
+            }
+            map_ = (const byte*)map;
+            header_ = (const CanLogHeader*)map_;
+            if (memcmp(header_->magic, CAN_LOG_MAGIC, sizeof(CAN_LOG_MAGIC)) != 0 ||
+                    header_->version != CAN_LOG_VERSION ||
+                    header_->index_offset + (uint64_t)header_->blocks * sizeof(CanLogBlock) >
+                        size_ ||
+                    header_->index_offset != sizeof(CanLogHeader) +
+                        header_->records * sizeof(CanLogRecord)) {
+                close();
+                return false;
+            }
+            index_ = (const CanLogBlock*)(map_ + header_->index_offset);
+            records_ = (const CanLogRecord*)(map_ + sizeof(CanLogHeader));
+            query(CanLogQuery());
+            return true;
+        }
+
+        // Unmap the log.
+        void close() {
+            if (map_ != nullptr) {
+                munmap((void*)map_, size_);
+            }
+            map_ = nullptr;
+            header_ = nullptr;
+            index_ = nullptr;
+            records_ = nullptr;
+        }
+
+        // Return the number of blocks in the log.
+        uint32_t blocks() const { return header_ == nullptr ? 0 : header_->blocks; }
+
+        // Return the index entry for a block.
+        const CanLogBlock& block(uint32_t index) const { return index_[index]; }
+
+        // Return the number of records in the log.
+        uint64_t records() const { return header_ == nullptr ? 0 : header_->records; }
+
+        // Restart reading with a new query.
+        void query(const CanLogQuery& query) {
+            query_ = query;
+            block_ = 0;
+            pos_ = 0;
+            touched_ = 0;
+            seek();
+        }
+
+        // Return the next record matching the query or nullptr when done.
+        const CanLogRecord* next() {
+            while (block_ < blocks()) {
+                const CanLogBlock& entry = index_[block_];
+                while (pos_ < entry.count) {
+                    const CanLogRecord* record =
+                        &records_[(uint64_t)block_ * header_->block_size + pos_++];
+                    if (query_.matches(*record)) {
+                        return record;
+                    }
+                }
+                ++block_;
+                pos_ = 0;
+                seek();
+            }
+            return nullptr;
+        }
+
+        // Return the number of blocks read by the current query.
+        uint32_t touched() const { return touched_; }
+
+        // Load a record into a frame.
+        static void frame(const CanLogRecord& record, Canny::Frame* frame) {
+            frame->id(record.frameId(), record.ext());
+            frame->resize(record.size);
+            memcpy(frame->data(), record.data, record.size);
+        }
+
+        // Pass each record matching the query to the node and emit the node
+        // after each one. The clock is set to the record time in milliseconds
+        // if not null. Return the number of records replayed.
+        uint64_t replay(const CanLogQuery& query, Caster::Node<Message>* node,
+                const Caster::Yield<Message>& yield, Faker::FakeClock* clock = nullptr) {
+            this->query(query);
+            Canny::Frame frame(0, 0, 8);
+            uint64_t count = 0;
+            const CanLogRecord* record;
+            while ((record = next()) != nullptr) {
+                if (clock != nullptr) {
+                    clock->set(record->timestamp / 1000);
+                }
+                this->frame(*record, &frame);
+                node->handle(frame);
+                node->emit(yield);
+                ++count;
+            }
+            return count;
+        }
+
+    private:
+        const byte* map_;
+        size_t size_;
+        const CanLogHeader* header_;
+        const CanLogBlock* index_;
+        const CanLogRecord* records_;
+        CanLogQuery query_;
+        uint32_t block_;
+        uint32_t pos_;
+        uint32_t touched_;
+
+        // Advance to the next block which may hold matching records.
+        void seek() {
+            while (block_ < blocks() && !query_.matches(index_[block_])) {
+                ++block_;
+            }
+            if (block_ < blocks()) {
+                ++touched_;
+            }
+        }
+};
+
+}  // namespace R51
+
+#endif  // defined(EPOXY_DUINO)
+
+#endif  // _R51_VEHICLE_CAN_LOG_H_
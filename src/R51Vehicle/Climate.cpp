@@ -24,22 +24,72 @@ enum AirflowMode : uint8_t {
     AIRFLOW_AUTO_FEET = 0x8C,
 };
 
+namespace {
+
+// Control frames left for encode() by poll().
+enum ControlPending : uint8_t {
+    CONTROL_PENDING_SYSTEM = 0x01,
+    CONTROL_PENDING_FAN = 0x02,
+};
+
+// Yields events and marks control frames pending instead of yielding them.
+class PullYield {
+    public:
+        PullYield(const Caster::Yield<Message>& yield, const Canny::Frame* system,
+                uint8_t* pending) :
+            yield_(yield), system_(system), pending_(pending) {}
+
+        void operator()(const Canny::Frame& frame) const {
+            *pending_ |= &frame == system_ ? CONTROL_PENDING_SYSTEM : CONTROL_PENDING_FAN;
+        }
+
+        void operator()(const SystemEvent& event) const { yield_(event); }
+
+    private:
+        const Caster::Yield<Message>& yield_;
+        const Canny::Frame* system_;
+        uint8_t* pending_;
+};
+
+// Convert a temperature byte between units. Results outside of the byte's
+// range are clamped.
+uint8_t convertTempByte(uint8_t value, Units from, Units to) {
+    int16_t converted = convertTemp((int16_t)value, from, to);
+    return converted < 0 ? 0 : converted > 0xFF ? 0xFF : converted;
+}
+
+// Convert an outside temperature between units. Results outside of the range
+// held by the temperature state event are clamped.
+int16_t convertOutsideTemp(int16_t value, Units from, Units to) {
+    int16_t converted = convertTemp(value, from, to);
+    return converted < CLIMATE_OUTSIDE_TEMP_MIN ? CLIMATE_OUTSIDE_TEMP_MIN :
+        converted > CLIMATE_OUTSIDE_TEMP_MAX ? CLIMATE_OUTSIDE_TEMP_MAX : converted;
+}
+
+}  // namespace
+
 #define CONTROL_INIT_EXPIRE 450
 #define CONTROL_INIT_TICK 100
 #define CONTROL_FRAME_TICK 200
 
 Climate::Climate(uint32_t tick_ms, Faker::Clock* clock) :
     clock_(clock),
-    state_ticker_(tick_ms, clock), control_ticker_(CONTROL_INIT_TICK, clock),
-    state_init_(0), control_init_(false),
+    state_heartbeat_(tick_ms, clock), control_heartbeat_(CONTROL_INIT_TICK, clock),
+    state_init_(0), control_init_(false), init_sent_(false), awake_(false),
+    reinit_(false), suspended_(false), last_state_(0),
     temp_state_changed_(false), system_state_changed_(false), airflow_state_changed_(false),
-    system_control_changed_(false), fan_control_changed_(false) {}
+    system_control_changed_(false), fan_control_changed_(false), control_pending_(0),
+    units_preferred_(false), units_(UNITS_METRIC),
+    temp_source_(0x54A, CLIMATE_FRAME_PERIOD, clock),
+    system_source_(0x54B, CLIMATE_FRAME_PERIOD, clock), decode_observer_(nullptr),
+    control_rtt_(0), control_retries_(0), control_failures_(0) {
+    memset(pending_, 0, sizeof(pending_));
+}
 
 void Climate::handle(const Message& msg) {
     switch (msg.type()) {
         case Message::CAN_FRAME:
-            handleSystemFrame(msg.can_frame());
-            handleTempFrame(msg.can_frame());
+            handle(FrameView(msg.can_frame()));
             break;
         case Message::SYSTEM_EVENT:
             handleEvent(msg.system_event());
@@ -49,22 +99,66 @@ void Climate::handle(const Message& msg) {
     }
 }
 
-void Climate::handleTempFrame(const Canny::Frame& frame) {
+bool Climate::handle(const FrameView& frame) {
+    // Changes pending emit are set aside to detect changes made by this
+    // frame.
+    bool temp = temp_state_changed_;
+    bool system = system_state_changed_;
+    bool airflow = airflow_state_changed_;
+    temp_state_changed_ = false;
+    system_state_changed_ = false;
+    airflow_state_changed_ = false;
+
+    handleSystemFrame(frame);
+    handleTempFrame(frame);
+
+    bool changed = temp_state_changed_ || system_state_changed_ ||
+        airflow_state_changed_;
+    temp_state_changed_ |= temp;
+    system_state_changed_ |= system;
+    airflow_state_changed_ |= airflow;
+    return changed;
+}
+
+void Climate::handleTempFrame(const FrameView& frame) {
     if (frame.id() != 0x54A || frame.size() < 8) {
         return;
     }
+    wake();
+    temp_state_changed_ |= temp_source_.received();
+
+    temp_reported_.driver_temp(frame.data()[4]);
+    temp_reported_.passenger_temp(frame.data()[5]);
+    temp_reported_.outside_temp(frame.data()[7]);
+    temp_reported_.units(frame.data()[3] == 0x40 ? UNITS_METRIC : UNITS_US);
+    temp_state_changed_ |= updateTemp();
+    acknowledge();
+}
 
-    temp_state_changed_ |= (
-        temp_state_.driver_temp(frame.data()[4]) |
-        temp_state_.passenger_temp(frame.data()[5]) |
-        temp_state_.outside_temp(frame.data()[7]) |
-        temp_state_.units(frame.data()[3] == 0x40 ? UNITS_METRIC : UNITS_US));
+bool Climate::updateTemp() {
+    Units from = temp_reported_.units();
+    Units to = units_preferred_ ? units_ : from;
+    return temp_state_.driver_temp(convertTempByte(temp_reported_.driver_temp(), from, to)) |
+        temp_state_.passenger_temp(convertTempByte(temp_reported_.passenger_temp(), from, to)) |
+        temp_state_.outside_temp(convertOutsideTemp(temp_reported_.outside_temp(), from, to)) |
+        temp_state_.units(to);
 }
 
-void Climate::handleSystemFrame(const Canny::Frame& frame) {
+void Climate::units(Units units) {
+    units_preferred_ = true;
+    units_ = units;
+    temp_state_changed_ |= updateTemp();
+}
+
+void Climate::handleSystemFrame(const FrameView& frame) {
     if (frame.id() != 0x54B || frame.size() < 8) {
         return;
     }
+    wake();
+    if (system_source_.received()) {
+        system_state_changed_ = true;
+        airflow_state_changed_ = true;
+    }
 
     airflow_state_changed_ |= (
         airflow_state_.fan_speed((frame.data()[2] + 1) / 2) |
@@ -110,6 +204,11 @@ void Climate::handleSystemFrame(const Canny::Frame& frame) {
                 airflow_state_.feet(false) |
                 airflow_state_.windshield(true));
             break;
+        default:
+            if (decode_observer_ != nullptr) {
+                decode_observer_->unexpected(frame);
+            }
+            break;
     }
 
     system_state_changed_ |= (
@@ -125,68 +224,61 @@ void Climate::handleSystemFrame(const Canny::Frame& frame) {
     } else {
         system_state_changed_ |= system_state_.mode(CLIMATE_SYSTEM_MANUAL);
     }
+    acknowledge();
 }
 
 void Climate::handleEvent(const SystemEvent& event) {
     switch ((Event)event.id) {
         case Event::CLIMATE_TURN_OFF:
-            system_control_.turnOff();
-            system_control_changed_ = true;
+            if (system_state_.mode() == CLIMATE_SYSTEM_OFF) {
+                // no state change to wait for
+                apply(CONTROL_TURN_OFF);
+            } else {
+                press(CONTROL_TURN_OFF);
+            }
             break;
         case Event::CLIMATE_TOGGLE_AUTO:
-            system_control_.toggleAuto();
-            system_control_changed_ = true;
+            press(CONTROL_AUTO);
             break;
         case Event::CLIMATE_TOGGLE_AC:
-            system_control_.toggleAC();
-            system_control_changed_ = true;
+            press(CONTROL_AC);
             break;
         case Event::CLIMATE_TOGGLE_DUAL:
-            system_control_.toggleDual();
-            system_control_changed_ = true;
+            press(CONTROL_DUAL);
             break;
         case Event::CLIMATE_TOGGLE_DEFROST:
-            system_control_.toggleDefrost();
-            system_control_changed_ = true;
+            press(CONTROL_DEFROST);
             break;
         case Event::CLIMATE_INC_FAN_SPEED:
-            fan_control_.incFanSpeed();
-            fan_control_changed_ = true;
+            press(CONTROL_FAN_UP);
             break;
         case Event::CLIMATE_DEC_FAN_SPEED:
-            fan_control_.decFanSpeed();
-            fan_control_changed_ = true;
+            press(CONTROL_FAN_DOWN);
             break;
         case Event::CLIMATE_TOGGLE_RECIRCULATE:
-            fan_control_.toggleRecirculate();
-            fan_control_changed_ = true;
+            press(CONTROL_RECIRCULATE);
             break;
         case Event::CLIMATE_CYCLE_AIRFLOW_MODE:
-            system_control_.cycleMode();
-            system_control_changed_ = true;
+            press(CONTROL_MODE);
             break;
         case Event::CLIMATE_INC_DRIVER_TEMP:
             if (system_state_.mode() != CLIMATE_SYSTEM_OFF) {
-                system_control_.incDriverTemp();
-                system_control_changed_ = true;
+                press(CONTROL_DRIVER_TEMP_UP);
             }
             break;
         case Event::CLIMATE_DEC_DRIVER_TEMP:
             if (system_state_.mode() != CLIMATE_SYSTEM_OFF) {
-                system_control_.decDriverTemp();
-                system_control_changed_ = true;
+                press(CONTROL_DRIVER_TEMP_DOWN);
             }
             break;
         case Event::CLIMATE_INC_PASSENGER_TEMP:
             if (system_state_.mode() != CLIMATE_SYSTEM_OFF) {
-                system_control_.incPassengerTemp();
-                system_control_changed_ = true;
+                press(CONTROL_PASSENGER_TEMP_UP);
             }
             break;
         case Event::CLIMATE_DEC_PASSENGER_TEMP:
             if (system_state_.mode() != CLIMATE_SYSTEM_OFF) {
-                system_control_.decPassengerTemp();
-                system_control_changed_ = true;
+                press(CONTROL_PASSENGER_TEMP_DOWN);
             }
             break;
         default:
@@ -194,20 +286,258 @@ void Climate::handleEvent(const SystemEvent& event) {
     }
 }
 
-void Climate::emit(const Caster::Yield<Message>& yield) {
-    if (!control_init_ && clock_->millis() >= CONTROL_INIT_EXPIRE) {
+void Climate::apply(Control control) {
+    switch (control) {
+        case CONTROL_TURN_OFF:
+            system_control_.turnOff();
+            system_control_changed_ = true;
+            break;
+        case CONTROL_AUTO:
+            system_control_.toggleAuto();
+            system_control_changed_ = true;
+            break;
+        case CONTROL_AC:
+            system_control_.toggleAC();
+            system_control_changed_ = true;
+            break;
+        case CONTROL_DUAL:
+            system_control_.toggleDual();
+            system_control_changed_ = true;
+            break;
+        case CONTROL_DEFROST:
+            system_control_.toggleDefrost();
+            system_control_changed_ = true;
+            break;
+        case CONTROL_MODE:
+            system_control_.cycleMode();
+            system_control_changed_ = true;
+            break;
+        case CONTROL_RECIRCULATE:
+            fan_control_.toggleRecirculate();
+            fan_control_changed_ = true;
+            break;
+        case CONTROL_FAN_UP:
+            fan_control_.incFanSpeed();
+            fan_control_changed_ = true;
+            break;
+        case CONTROL_FAN_DOWN:
+            fan_control_.decFanSpeed();
+            fan_control_changed_ = true;
+            break;
+        case CONTROL_DRIVER_TEMP_UP:
+            system_control_.incDriverTemp();
+            system_control_changed_ = true;
+            break;
+        case CONTROL_DRIVER_TEMP_DOWN:
+            system_control_.decDriverTemp();
+            system_control_changed_ = true;
+            break;
+        case CONTROL_PASSENGER_TEMP_UP:
+            system_control_.incPassengerTemp();
+            system_control_changed_ = true;
+            break;
+        case CONTROL_PASSENGER_TEMP_DOWN:
+            system_control_.decPassengerTemp();
+            system_control_changed_ = true;
+            break;
+        default:
+            break;
+    }
+}
+
+void Climate::press(Control control) {
+    apply(control);
+    if (!control_init_) {
+        // control frames ignore changes until they are ready
+        return;
+    }
+
+    uint32_t now = clock_->millis();
+    PendingControl& pending = pending_[control];
+    if (pending.active) {
+        switch (control) {
+            case CONTROL_AUTO:
+            case CONTROL_AC:
+            case CONTROL_DUAL:
+            case CONTROL_DEFROST:
+            case CONTROL_RECIRCULATE:
+                // a second toggle undoes the first so no change is expected
+                pending.active = false;
+                return;
+            default:
+                break;
+        }
+    } else {
+        pending.active = true;
+        pending.baseline = observe(control);
+    }
+    pending.retries = 0;
+    pending.sent = now;
+}
+
+uint8_t Climate::observe(Control control) {
+    switch (control) {
+        case CONTROL_TURN_OFF:
+        case CONTROL_AUTO:
+        case CONTROL_DEFROST:
+            return system_state_.mode();
+        case CONTROL_AC:
+            return system_state_.ac();
+        case CONTROL_DUAL:
+            return system_state_.dual();
+        case CONTROL_MODE:
+            return airflow_state_.face() |
+                (airflow_state_.feet() << 1) |
+                (airflow_state_.windshield() << 2);
+        case CONTROL_RECIRCULATE:
+            return airflow_state_.recirculate();
+        case CONTROL_FAN_UP:
+        case CONTROL_FAN_DOWN:
+            return airflow_state_.fan_speed();
+        // Converted setpoints may not change on every step so controls are
+        // acknowledged against the reported values.
+        case CONTROL_DRIVER_TEMP_UP:
+        case CONTROL_DRIVER_TEMP_DOWN:
+            return temp_reported_.driver_temp();
+        case CONTROL_PASSENGER_TEMP_UP:
+        case CONTROL_PASSENGER_TEMP_DOWN:
+            return temp_reported_.passenger_temp();
+        default:
+            return 0;
+    }
+}
+
+void Climate::acknowledge() {
+    uint32_t now = clock_->millis();
+    for (uint8_t i = 0; i < CONTROL_COUNT; ++i) {
+        PendingControl& pending = pending_[i];
+        if (pending.active && observe((Control)i) != pending.baseline) {
+            pending.active = false;
+            control_rtt_ = now - pending.sent;
+        }
+    }
+}
+
+void Climate::retransmit() {
+    uint32_t now = clock_->millis();
+    for (uint8_t i = 0; i < CONTROL_COUNT; ++i) {
+        PendingControl& pending = pending_[i];
+        if (!pending.active || now - pending.sent < CLIMATE_CONTROL_TIMEOUT) {
+            continue;
+        }
+        if (pending.retries >= CLIMATE_CONTROL_RETRIES) {
+            // The unit did not act on the control. Resync the control frame
+            // and re-publish the observed state so consumers resync with
+            // what the unit reports.
+            pending.active = false;
+            ++control_failures_;
+            resync();
+            temp_state_changed_ = true;
+            system_state_changed_ = true;
+            airflow_state_changed_ = true;
+            continue;
+        }
+        // Resend the frame holding the control. The unit acts on bit changes
+        // so a lost frame is recovered while a frame it has already acted on
+        // is not applied twice.
+        switch (i) {
+            case CONTROL_RECIRCULATE:
+            case CONTROL_FAN_UP:
+            case CONTROL_FAN_DOWN:
+                fan_control_changed_ = true;
+                break;
+            default:
+                system_control_changed_ = true;
+                break;
+        }
+        ++pending.retries;
+        ++control_retries_;
+        pending.sent = now;
+    }
+}
+
+void Climate::resync() {
+    // The frame has been resent on each retry so the unit has seen its
+    // toggles. Only the setpoints are changed so nothing is re-requested.
+    if (temp_source_.deadline() == DEADLINE_NONE) {
+        return;
+    }
+    system_control_.syncTemps(temp_reported_.driver_temp(),
+            temp_reported_.passenger_temp());
+    system_control_changed_ = true;
+}
+
+void Climate::wake() {
+    awake_ = true;
+    last_state_ = clock_->millis();
+}
+
+void Climate::checkSleep() {
+    if (!awake_ || clock_->millis() - last_state_ < CLIMATE_SLEEP_TIMEOUT) {
+        return;
+    }
+    reinit();
+}
+
+void Climate::reinit() {
+    // The unit may have rebooted while silent so run the init handshake
+    // again. Pending controls are dropped as the unit will not act on them.
+    awake_ = false;
+    reinit_ = true;
+    init_sent_ = false;
+    control_init_ = false;
+    system_control_.reset();
+    fan_control_.reset();
+    memset(pending_, 0, sizeof(pending_));
+    control_heartbeat_.reset(CONTROL_INIT_TICK);
+}
+
+void Climate::power(PowerMode mode) {
+    if (mode == POWER_SLEEP) {
+        if (!suspended_) {
+            reinit();
+        }
+        suspended_ = true;
+        control_pending_ = 0;
+    } else if (suspended_) {
+        suspended_ = false;
+        control_heartbeat_.reset(CONTROL_INIT_TICK);
+        state_heartbeat_.change();
+        state_heartbeat_.reset();
+    }
+}
+
+void Climate::observer(FreshnessObserver* observer) {
+    temp_source_.observer(observer);
+    system_source_.observer(observer);
+}
+
+template <typename Out>
+void Climate::emitTo(Out& yield) {
+    if (suspended_) {
+        return;
+    }
+    checkSleep();
+
+    // Go ready once the unit has been seen after the init frames were sent.
+    // Fall back to a fixed delay on boot for units which are not yet
+    // broadcasting.
+    if (!control_init_ && ((init_sent_ && awake_) ||
+            (!reinit_ && clock_->millis() >= CONTROL_INIT_EXPIRE))) {
         system_control_.ready();
         fan_control_.ready();
         yield(system_control_);
         yield(fan_control_);
-        control_ticker_.reset(CONTROL_FRAME_TICK);
+        control_heartbeat_.reset(CONTROL_FRAME_TICK);
         control_init_ = true;
     }
+    retransmit();
 
-    if (control_ticker_.active()) {
+    if (control_heartbeat_.active()) {
         yield(system_control_);
         yield(fan_control_);
-        control_ticker_.reset();
+        control_heartbeat_.reset();
+        init_sent_ |= !control_init_;
     } else {
         if (system_control_changed_) {
             yield(system_control_);
@@ -217,21 +547,25 @@ void Climate::emit(const Caster::Yield<Message>& yield) {
         }
     }
 
-    if (state_ticker_.active()) {
+    bool changed = temp_state_changed_ || system_state_changed_ ||
+        airflow_state_changed_;
+    if (changed) {
+        state_heartbeat_.change();
+    }
+    bool tick = state_heartbeat_.active();
+    if (tick || changed) {
+        state_heartbeat_.reset();
+    }
+    bool temp_tick = tick && !temp_source_.stale();
+    bool system_tick = tick && !system_source_.stale();
+    if (temp_state_changed_ || temp_tick) {
         yield(temp_state_);
+    }
+    if (system_state_changed_ || system_tick) {
         yield(system_state_);
+    }
+    if (airflow_state_changed_ || system_tick) {
         yield(airflow_state_);
-        state_ticker_.reset();
-    } else {
-        if (temp_state_changed_) {
-            yield(temp_state_);
-        }
-        if (system_state_changed_) {
-            yield(system_state_);
-        }
-        if (airflow_state_changed_) {
-            yield(airflow_state_);
-        }
     }
 
     temp_state_changed_ = false;
@@ -241,5 +575,58 @@ void Climate::emit(const Caster::Yield<Message>& yield) {
     fan_control_changed_ = false;
 }
 
+void Climate::emit(const Caster::Yield<Message>& yield) {
+    emitTo(yield);
+}
+
+void Climate::emit(MessageBatch* batch) {
+    emitTo(*batch);
+}
+
+uint32_t Climate::nextDeadline() {
+    if (suspended_) {
+        return DEADLINE_NONE;
+    }
+    if (temp_state_changed_ || system_state_changed_ || airflow_state_changed_ ||
+            system_control_changed_ || fan_control_changed_ || control_pending_ != 0 ||
+            (!control_init_ && init_sent_ && awake_)) {
+        return 0;
+    }
+
+    uint32_t now = clock_->millis();
+    uint32_t next = earliestDeadline(control_heartbeat_.deadline(),
+            state_heartbeat_.deadline());
+    if (!control_init_ && !reinit_) {
+        next = earliestDeadline(next, deadlineAfter(now, 0, CONTROL_INIT_EXPIRE));
+    }
+    if (awake_) {
+        next = earliestDeadline(next, deadlineAfter(now, last_state_, CLIMATE_SLEEP_TIMEOUT));
+    }
+    for (uint8_t i = 0; i < CONTROL_COUNT; ++i) {
+        if (pending_[i].active) {
+            next = earliestDeadline(next,
+                    deadlineAfter(now, pending_[i].sent, CLIMATE_CONTROL_TIMEOUT));
+        }
+    }
+    return next;
+}
+
+void Climate::poll(const Caster::Yield<Message>& yield) {
+    PullYield pull(yield, &system_control_, &control_pending_);
+    emitTo(pull);
+}
+
+bool Climate::encode(FrameSlot* slot) {
+    if ((control_pending_ & CONTROL_PENDING_SYSTEM) != 0) {
+        system_control_.encode(slot);
+        control_pending_ &= ~CONTROL_PENDING_SYSTEM;
+    } else if ((control_pending_ & CONTROL_PENDING_FAN) != 0) {
+        fan_control_.encode(slot);
+        control_pending_ &= ~CONTROL_PENDING_FAN;
+    } else {
+        return false;
+    }
+    return true;
+}
 
 }  // namespace R51
@@ -6,13 +6,46 @@
 #include <Caster.h>
 #include <Faker.h>
 #include <R51Core.h>
+#include "Batch.h"
 #include "ClimateEvents.h"
 #include "ClimateFrames.h"
+#include "Controller.h"
+#include "Deadline.h"
+#include "Freshness.h"
+#include "Handler.h"
+#include "Heartbeat.h"
+#include "Node.h"
+#include "Units.h"
 
 namespace R51 {
 
-// Manages the vehicle climate control system.
-class Climate : public Caster::Node<Message> {
+// Time in milliseconds to wait for a control action to be reflected in the
+// climate state frames before the action is re-issued.
+#ifndef CLIMATE_CONTROL_TIMEOUT
+#define CLIMATE_CONTROL_TIMEOUT 500
+#endif
+
+// Number of times a control action is re-issued before it is abandoned.
+#ifndef CLIMATE_CONTROL_RETRIES
+#define CLIMATE_CONTROL_RETRIES 2
+#endif
+
+// Time in milliseconds without 0x54A or 0x54B state frames after which the
+// climate unit is considered asleep. The control init handshake is run again
+// once the unit wakes.
+#ifndef CLIMATE_SLEEP_TIMEOUT
+#define CLIMATE_SLEEP_TIMEOUT 2000
+#endif
+
+// Expected broadcast period of the 0x54A and 0x54B climate state frames in
+// milliseconds.
+#ifndef CLIMATE_FRAME_PERIOD
+#define CLIMATE_FRAME_PERIOD 100
+#endif
+
+// Manages the vehicle climate control system. Publishes the 0x54A and 0x54B
+// state frames as events and sends control events as 0x540 and 0x541 frames.
+class Climate : public VehicleNode, public Handler, public Controller {
     public:
         Climate(uint32_t tick_ms = 0, Faker::Clock* clock = Faker::Clock::real());
 
@@ -20,29 +53,161 @@ class Climate : public Caster::Node<Message> {
         // control frames.
         void handle(const Message& msg) override;
 
+        // Handle a 0x54A or 0x54B state frame in place. Return true if the
+        // climate state changed.
+        bool handle(const FrameView& frame) override;
+
         // Emit control frames to the vehicle and climate state system events.
+        // Control actions which are not reflected in the climate state frames
+        // within CLIMATE_CONTROL_TIMEOUT are re-issued. Periodic re-emits of
+        // state stop while its source frame is stale.
         void emit(const Caster::Yield<Message>& yield) override;
 
+        // Emit into a batch instead of yielding each message.
+        void emit(MessageBatch* batch);
+
+        // Emit as above but leave control frames for encode() instead of
+        // yielding them. Use in place of emit() when the driver pulls control
+        // frames into its transmit slots.
+        void poll(const Caster::Yield<Message>& yield);
+
+        // Encode a control frame left by poll() into the slot.
+        bool encode(FrameSlot* slot) override;
+
+        // Return the time until the next control frame tick, control
+        // timeout, state re-emit, or sleep check.
+        uint32_t nextDeadline() override;
+
+        // Return the time in milliseconds between the most recently
+        // acknowledged control action and its state change.
+        uint32_t controlRtt() const { return control_rtt_; }
+
+        // Return the number of control actions re-issued after a timeout.
+        uint32_t controlRetries() const { return control_retries_; }
+
+        // Return the number of control actions abandoned after exhausting
+        // their retries.
+        uint32_t controlFailures() const { return control_failures_; }
+
+        // Stop sending control frames while the vehicle sleeps and run the
+        // init handshake again once it wakes.
+        void power(PowerMode mode) override;
+
+        // Publish temperatures in the given units instead of the units
+        // reported by the climate unit.
+        void units(Units units) override;
+
+        // Set the observer notified when the climate unit stops or resumes
+        // broadcasting 0x54A or 0x54B.
+        void observer(FreshnessObserver* observer);
+
+        // Set the observer notified when a state frame holds a value the
+        // climate unit is not known to send.
+        void observer(DecodeObserver* observer) { decode_observer_ = observer; }
+
+        // Back off periodic state re-emits up to max_ms while the state
+        // holds. See Heartbeat.
+        void backoff(uint32_t max_ms, uint8_t fast = HEARTBEAT_FAST_COUNT) {
+            state_heartbeat_.backoff(max_ms, fast);
+        }
+
     private:
+        // Control actions tracked until acknowledged by a state change.
+        enum Control : uint8_t {
+            CONTROL_TURN_OFF,
+            CONTROL_AUTO,
+            CONTROL_AC,
+            CONTROL_DUAL,
+            CONTROL_DEFROST,
+            CONTROL_MODE,
+            CONTROL_RECIRCULATE,
+            CONTROL_FAN_UP,
+            CONTROL_FAN_DOWN,
+            CONTROL_DRIVER_TEMP_UP,
+            CONTROL_DRIVER_TEMP_DOWN,
+            CONTROL_PASSENGER_TEMP_UP,
+            CONTROL_PASSENGER_TEMP_DOWN,
+            CONTROL_COUNT,
+        };
+
+        struct PendingControl {
+            bool active;
+            uint8_t retries;
+            uint8_t baseline;
+            uint32_t sent;
+        };
+
         Faker::Clock* clock_;
-        Ticker state_ticker_;
-        Ticker control_ticker_;
+        Heartbeat state_heartbeat_;
+        Heartbeat control_heartbeat_;
         uint8_t state_init_;
         bool control_init_;
+        bool init_sent_;
+        bool awake_;
+        bool reinit_;
+        bool suspended_;
+        uint32_t last_state_;
         bool temp_state_changed_;
         bool system_state_changed_;
         bool airflow_state_changed_;
         bool system_control_changed_;
         bool fan_control_changed_;
+        uint8_t control_pending_;
+        bool units_preferred_;
+        Units units_;
+        ClimateTempStateEvent temp_reported_;
         ClimateTempStateEvent temp_state_;
         ClimateAirflowStateEvent airflow_state_;
         ClimateSystemStateEvent system_state_;
         ClimateSystemControlFrame system_control_;
         ClimateFanControlFrame fan_control_;
+        PendingControl pending_[CONTROL_COUNT];
+        Freshness temp_source_;
+        Freshness system_source_;
+        DecodeObserver* decode_observer_;
+        uint32_t control_rtt_;
+        uint32_t control_retries_;
+        uint32_t control_failures_;
 
-        void handleTempFrame(const Canny::Frame& frame);
-        void handleSystemFrame(const Canny::Frame& frame);
+        template <typename Out>
+        void emitTo(Out& yield);
+
+        void handleTempFrame(const FrameView& frame);
+        void handleSystemFrame(const FrameView& frame);
         void handleEvent(const SystemEvent& event);
+
+        // Update the temperature state from the reported temperatures.
+        // Return true if it changed.
+        bool updateTemp();
+
+        // Apply a control action to the control frames.
+        void apply(Control control);
+
+        // Apply a control action and track it until acknowledged.
+        void press(Control control);
+
+        // Return the observed state affected by the control action.
+        uint8_t observe(Control control);
+
+        // Acknowledge pending control actions whose state has changed.
+        void acknowledge();
+
+        // Re-issue or abandon pending control actions which have timed out.
+        void retransmit();
+
+        // Sync the control frame's temperature setpoints with the 0x54A
+        // state after a control action is abandoned.
+        void resync();
+
+        // Record state traffic from the climate unit.
+        void wake();
+
+        // Return the control frames to the init state.
+        void reinit();
+
+        // Reinit the control frames if the climate unit has stopped
+        // broadcasting state.
+        void checkSleep();
 };
 
 }  // namespace R51
@@ -14,14 +14,23 @@ enum ClimateSystemMode : uint8_t {
     CLIMATE_SYSTEM_DEFROST = 3,
 };
 
-// Climate temperature state event.
+// Range of outside temperatures held by a ClimateTempStateEvent.
+static const int16_t CLIMATE_OUTSIDE_TEMP_MIN = -255;
+static const int16_t CLIMATE_OUTSIDE_TEMP_MAX = 255;
+
+// Climate temperature state event. Byte 2 holds the outside temperature
+// clamped at zero and byte 4 holds the degrees below zero so consumers of
+// byte 2 read the same values as before temperatures below zero were
+// published.
 class ClimateTempStateEvent : public SystemEvent {
     public:
-        ClimateTempStateEvent() : SystemEvent(Event::CLIMATE_TEMP_STATE, {0x00, 0x00, 0x00, 0x00}) {}
+        ClimateTempStateEvent() : SystemEvent(Event::CLIMATE_TEMP_STATE, {0x00, 0x00, 0x00, 0x00, 0x00}) {}
 
         SYSTEM_EVENT_PROPERTY(uint8_t, driver_temp, data[0], data[0] = value)
         SYSTEM_EVENT_PROPERTY(uint8_t, passenger_temp, data[1], data[1] = value)
-        SYSTEM_EVENT_PROPERTY(uint8_t, outside_temp, data[2], data[2] = value)
+        SYSTEM_EVENT_PROPERTY(int16_t, outside_temp,
+                (int16_t)data[2] - (int16_t)data[4],
+                (data[2] = value > 0 ? value : 0, data[4] = value < 0 ? -value : 0))
         SYSTEM_EVENT_PROPERTY(Units, units, (Units)data[3], data[3] = (uint8_t)value)
 };
 
@@ -11,10 +11,15 @@ bool isInit(const Canny::Frame* frame) {
     return frame->data()[0] == 0x80;
 }
 
+void setInit(Canny::Frame* frame) {
+    memset(frame->data(), 0x00, 8);
+    frame->data()[0] = 0x80;
+}
+
 }  // namespace
 
 ClimateSystemControlFrame::ClimateSystemControlFrame(bool ready) : Canny::Frame(0x540, 0, 8) {
-    data()[0] = 0x80;
+    setInit(this);
     if (ready) {
         this->ready();
     }
@@ -29,6 +34,10 @@ void ClimateSystemControlFrame::ready() {
     data()[6] = 0x04;
 }
 
+void ClimateSystemControlFrame::reset() {
+    setInit(this);
+}
+
 void ClimateSystemControlFrame::turnOff() {
     if (isInit(this)) {
         return;
@@ -103,8 +112,31 @@ void ClimateSystemControlFrame::decPassengerTemp() {
     data()[4]--;
 }
 
+void ClimateSystemControlFrame::syncTemps(uint8_t driver, uint8_t passenger) {
+    if (isInit(this)) {
+        return;
+    }
+    data()[3] = driver;
+    data()[4] = passenger;
+}
+
+void ClimateSystemControlFrame::encode(FrameSlot* slot) const {
+    // Bytes 2 and 7 are never set.
+    slot->id(id(), ext());
+    slot->resize(8);
+    byte* out = slot->data();
+    out[0] = data()[0];
+    out[1] = data()[1];
+    out[2] = 0x00;
+    out[3] = data()[3];
+    out[4] = data()[4];
+    out[5] = data()[5];
+    out[6] = data()[6];
+    out[7] = 0x00;
+}
+
 ClimateFanControlFrame::ClimateFanControlFrame(bool ready) : Canny::Frame(0x541, 0, 8) {
-    data()[0] = 0x80;
+    setInit(this);
     if (ready) {
         this->ready();
     }
@@ -117,6 +149,10 @@ void ClimateFanControlFrame::ready() {
     data()[0] = 0x00;
 }
 
+void ClimateFanControlFrame::reset() {
+    setInit(this);
+}
+
 void ClimateFanControlFrame::toggleRecirculate() {
     if (isInit(this)) {
         return;
@@ -138,4 +174,14 @@ void ClimateFanControlFrame::decFanSpeed() {
     toggleBit(data(), 0, 4);
 }
 
+void ClimateFanControlFrame::encode(FrameSlot* slot) const {
+    // Only the fan and recirculation bytes are set.
+    slot->id(id(), ext());
+    slot->resize(8);
+    byte* out = slot->data();
+    out[0] = data()[0];
+    out[1] = data()[1];
+    memset(out + 2, 0x00, 6);
+}
+
 }  // namespace R51
@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include <Canny.h>
+#include "Controller.h"
 
 namespace R51 {
 
@@ -23,6 +24,10 @@ class ClimateSystemControlFrame : public Canny::Frame {
         // ready() was already called.
         void ready();
 
+        // Return the control frame to the init state. The frame must be
+        // readied again before changes take effect.
+        void reset();
+
         // Turn off the climate control system.
         // This is a noop until ready() is called.
         void turnOff();
@@ -66,6 +71,14 @@ class ClimateSystemControlFrame : public Canny::Frame {
         // be sent while the climate control system is in the off state. 
         // This is a noop until ready() is called.
         void decPassengerTemp();
+
+        // Set the driver and passenger temperature bytes to the setpoints
+        // reported by the climate unit without signalling a change.
+        // This is a noop until ready() is called.
+        void syncTemps(uint8_t driver, uint8_t passenger);
+
+        // Encode the control frame into a driver transmit slot.
+        void encode(FrameSlot* slot) const;
 };
 
 // Manages changes to the 0x541 CAN frame for controlling climate fan speed and
@@ -85,6 +98,10 @@ class ClimateFanControlFrame : public Canny::Frame {
         // ready() was already called.
         void ready();
 
+        // Return the control frame to the init state. The frame must be
+        // readied again before changes take effect.
+        void reset();
+
         // Toggle cabin recirculation.
         // This is a noop until ready() is called.
         void toggleRecirculate();
@@ -96,6 +113,9 @@ class ClimateFanControlFrame : public Canny::Frame {
         // Decrease fan speed.
         // This is a noop until ready() is called.
         void decFanSpeed();
+
+        // Encode the control frame into a driver transmit slot.
+        void encode(FrameSlot* slot) const;
 };
 
 }  // namespace R51
@@ -1,23 +1,43 @@
 #ifndef _R51_VEHICLE_CONTROLLER_H_
 #define _R51_VEHICLE_CONTROLLER_H_
 
-#include <Canny.h>
+#include <Arduino.h>
 
 namespace R51 {
 
-// Controller manages a frame that is sent to control connected CAN devices.
+// A driver transmit slot. Controllers encode control frames in place into
+// the slot's data, which must hold at least 8 bytes. The accessors match
+// Canny::Frame so encoders work with either.
+class FrameSlot {
+    public:
+        FrameSlot(byte* data) : id_(0), ext_(0), size_(0), data_(data) {}
+
+        uint32_t id() const { return id_; }
+        uint8_t ext() const { return ext_; }
+        void id(uint32_t id, uint8_t ext) { id_ = id; ext_ = ext; }
+        uint8_t size() const { return size_; }
+        void resize(uint8_t size) { size_ = size > 8 ? 8 : size; }
+        byte* data() { return data_; }
+        const byte* data() const { return data_; }
+
+    private:
+        uint32_t id_;
+        uint8_t ext_;
+        uint8_t size_;
+        byte* data_;
+};
+
+// Controller encodes the frames sent to control connected CAN devices
+// directly into driver transmit slots. The driver pulls frames by calling
+// encode() until it returns false or the driver runs out of slots.
 class Controller {
     public:
         Controller() = default;
         virtual ~Controller() = default;
 
-        // Return true if the control frame has available changes that should
-        // be sent immediately. This is reset to false after a call to frame().
-        virtual bool available() = 0;
-
-        // Return a reference to the control frame. The lifecycle of the frame
-        // is tied to the controller that returns it.
-        virtual const Canny::Frame& frame() = 0;
+        // Encode the next control frame into the slot. Return false if no
+        // frame is due, in which case the slot is unmodified.
+        virtual bool encode(FrameSlot* slot) = 0;
 };
 
 }  // namespace R51
@@ -0,0 +1,59 @@
+#ifndef _R51_VEHICLE_DEADLINE_H_
+#define _R51_VEHICLE_DEADLINE_H_
+
+#include <Arduino.h>
+#include "Node.h"
+
+namespace R51 {
+
+// Maximum number of nodes tracked by a scheduler.
+#ifndef SCHEDULER_MAX_NODES
+#define SCHEDULER_MAX_NODES 8
+#endif
+
+// Return the time in milliseconds from now until period_ms has elapsed
+// since start. Return 0 if it has already elapsed.
+inline uint32_t deadlineAfter(uint32_t now, uint32_t start, uint32_t period_ms) {
+    uint32_t elapsed = now - start;
+    return elapsed >= period_ms ? 0 : period_ms - elapsed;
+}
+
+// Return the earlier of two deadlines.
+inline uint32_t earliestDeadline(uint32_t a, uint32_t b) {
+    return a < b ? a : b;
+}
+
+// Tracks the deadlines of a set of nodes so the main loop can sleep until
+// the earliest deadline or the next received frame instead of emitting
+// continuously. The nodes are emitted whenever the loop wakes.
+class Scheduler {
+    public:
+        Scheduler() : nodes_count_(0) {}
+
+        // Attach a node. Return false if the scheduler is full.
+        bool attach(VehicleNode* node) {
+            if (nodes_count_ >= SCHEDULER_MAX_NODES) {
+                return false;
+            }
+            nodes_[nodes_count_++] = node;
+            return true;
+        }
+
+        // Return the time in milliseconds until the earliest deadline of the
+        // attached nodes or DEADLINE_NONE if none are scheduled.
+        uint32_t next() {
+            uint32_t next = DEADLINE_NONE;
+            for (size_t i = 0; i < nodes_count_ && next > 0; ++i) {
+                next = earliestDeadline(next, nodes_[i]->nextDeadline());
+            }
+            return next;
+        }
+
+    private:
+        VehicleNode* nodes_[SCHEDULER_MAX_NODES];
+        size_t nodes_count_;
+};
+
+}  // namespace R51
+
+#endif  // _R51_VEHICLE_DEADLINE_H_
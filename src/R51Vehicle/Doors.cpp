@@ -0,0 +1,81 @@
+#include "Doors.h"
+
+#include <Arduino.h>
+#include <Caster.h>
+#include <R51Core.h>
+
+namespace R51 {
+
+void Doors::handle(const Message& msg) {
+    if (msg.type() == Message::CAN_FRAME) {
+        handle(FrameView(msg.can_frame()));
+    }
+}
+
+bool Doors::handle(const FrameView& frame) {
+    if (frame.id() != 0x60D || frame.size() < 3) {
+        return false;
+    }
+    // Publish the current value as soon as the BCM returns.
+    bool republish = source_.received();
+    republish_ |= republish;
+
+    const byte* data = frame.data();
+    uint8_t state = 0x00;
+    setBit(&state, 0, DOOR_DRIVER, getBit(data, 0, 4));
+    setBit(&state, 0, DOOR_PASSENGER, getBit(data, 0, 3));
+    setBit(&state, 0, DOOR_REAR_LEFT, getBit(data, 0, 5));
+    setBit(&state, 0, DOOR_REAR_RIGHT, getBit(data, 0, 6));
+    setBit(&state, 0, DOOR_HATCH, getBit(data, 0, 7));
+    setBit(&state, 0, DOOR_LOCKED, getBit(data, 2, 3));
+
+    uint8_t changed = state ^ state_.data[0];
+    state_.data[0] = state;
+    if (changed != 0) {
+        queueEdge(changed, state);
+    }
+    return changed != 0 || republish;
+}
+
+void Doors::queueEdge(uint8_t changed, uint8_t state) {
+    if (edge_count_ == DOORS_EDGE_QUEUE_SIZE) {
+        edges_[edge_count_ - 1][0] |= changed;
+        edges_[edge_count_ - 1][1] = state;
+        return;
+    }
+    edges_[edge_count_][0] = changed;
+    edges_[edge_count_][1] = state;
+    ++edge_count_;
+}
+
+void Doors::emit(const Caster::Yield<Message>& yield) {
+    bool stale = source_.stale();
+    bool changed = edge_count_ != 0 || republish_;
+    for (uint8_t i = 0; i < edge_count_; ++i) {
+        edge_.changed(edges_[i][0]);
+        edge_.state(edges_[i][1]);
+        yield(edge_);
+    }
+    if (changed || (!suspended_ && !stale && heartbeat_.active())) {
+        if (changed) {
+            heartbeat_.change();
+        }
+        heartbeat_.reset();
+        yield(state_);
+    }
+    edge_count_ = 0;
+    republish_ = false;
+}
+
+uint32_t Doors::nextDeadline() {
+    if (edge_count_ != 0 || republish_) {
+        return 0;
+    }
+    uint32_t next = source_.deadline();
+    if (!suspended_ && !source_.expired()) {
+        next = earliestDeadline(next, heartbeat_.deadline());
+    }
+    return next;
+}
+
+}  // namespace R51
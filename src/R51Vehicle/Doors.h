@@ -0,0 +1,137 @@
+#ifndef _R51_VEHICLE_DOORS_H_
+#define _R51_VEHICLE_DOORS_H_
+
+#include <Arduino.h>
+#include <Caster.h>
+#include <Faker.h>
+#include <R51Core.h>
+#include "Deadline.h"
+#include "Events.h"
+#include "Freshness.h"
+#include "Handler.h"
+#include "Heartbeat.h"
+#include "Node.h"
+
+namespace R51 {
+
+// Expected broadcast period of the BCM 0x60D frame in milliseconds.
+#ifndef DOORS_FRAME_PERIOD
+#define DOORS_FRAME_PERIOD 100
+#endif
+
+// Maximum door edges held between emits. An edge received while the queue is
+// full is merged into the last queued edge.
+#ifndef DOORS_EDGE_QUEUE_SIZE
+#define DOORS_EDGE_QUEUE_SIZE 4
+#endif
+
+// Bits of the door state.
+enum DoorBit : uint8_t {
+    DOOR_DRIVER = 0,
+    DOOR_PASSENGER = 1,
+    DOOR_REAR_LEFT = 2,
+    DOOR_REAR_RIGHT = 3,
+    DOOR_HATCH = 4,
+    DOOR_LOCKED = 7,
+};
+
+// Door state event. A bit is set while its door is open or the doors are
+// locked.
+class DoorStateEvent : public SystemEvent {
+    public:
+        DoorStateEvent() : SystemEvent(vehicleEvent(VehicleEvent::DOOR_STATE), {0x00}) {}
+
+        SYSTEM_EVENT_PROPERTY(bool, driver, getBit(data, 0, DOOR_DRIVER),
+                setBit(data, 0, DOOR_DRIVER, value))
+        SYSTEM_EVENT_PROPERTY(bool, passenger, getBit(data, 0, DOOR_PASSENGER),
+                setBit(data, 0, DOOR_PASSENGER, value))
+        SYSTEM_EVENT_PROPERTY(bool, rear_left, getBit(data, 0, DOOR_REAR_LEFT),
+                setBit(data, 0, DOOR_REAR_LEFT, value))
+        SYSTEM_EVENT_PROPERTY(bool, rear_right, getBit(data, 0, DOOR_REAR_RIGHT),
+                setBit(data, 0, DOOR_REAR_RIGHT, value))
+        SYSTEM_EVENT_PROPERTY(bool, hatch, getBit(data, 0, DOOR_HATCH),
+                setBit(data, 0, DOOR_HATCH, value))
+        SYSTEM_EVENT_PROPERTY(bool, locked, getBit(data, 0, DOOR_LOCKED),
+                setBit(data, 0, DOOR_LOCKED, value))
+};
+
+// Door edge event. Reports the bits of the door state which changed in one
+// transition and the state after the transition.
+class DoorEdgeEvent : public SystemEvent {
+    public:
+        DoorEdgeEvent() : SystemEvent(vehicleEvent(VehicleEvent::DOOR_EDGE), {0x00, 0x00}) {}
+
+        SYSTEM_EVENT_PROPERTY(uint8_t, changed, data[0], data[0] = value)
+        SYSTEM_EVENT_PROPERTY(uint8_t, state, data[1], data[1] = value)
+
+        // Return true if the bit changed from clear to set, e.g. a door
+        // opened.
+        bool rising(DoorBit bit) const {
+            return getBit(data, 0, bit) && getBit(data, 1, bit);
+        }
+
+        // Return true if the bit changed from set to clear, e.g. a door
+        // closed.
+        bool falling(DoorBit bit) const {
+            return getBit(data, 0, bit) && !getBit(data, 1, bit);
+        }
+};
+
+// Tracks door and lock state stored in the BCM 0x60D CAN frame. The state
+// is emitted on change or tick like the other state nodes. Every change is
+// also emitted as an edge event on the next emit so consumers see each door
+// open or close within one frame period. Edges are queued so a door which
+// opens and closes between emits yields both edges. Periodic re-emits stop
+// while the frame is stale.
+class Doors : public VehicleNode, public Handler {
+    public:
+        Doors(uint32_t tick_ms = 0, Faker::Clock* clock = Faker::Clock::real()) :
+            edge_count_(0), republish_(false), suspended_(false), heartbeat_(tick_ms, clock),
+            source_(0x60D, DOORS_FRAME_PERIOD, clock) {}
+
+        // Handle a 0x60D BCM state frame.
+        void handle(const Message& msg) override;
+
+        // Handle a 0x60D state frame in place. Return true if the state
+        // changed.
+        bool handle(const FrameView& frame) override;
+
+        // Yield the queued door edge events followed by a door state event on
+        // change and a door state event on tick.
+        void emit(const Caster::Yield<Message>& yield) override;
+
+        // Return the time until the next change or periodic re-emit is
+        // emitted or the 0x60D frame goes stale.
+        uint32_t nextDeadline() override;
+
+        // Suspend periodic re-emits while the vehicle sleeps.
+        void power(PowerMode mode) override { suspended_ = mode == POWER_SLEEP; }
+
+        // Back off periodic re-emits up to max_ms while the state holds.
+        // See Heartbeat.
+        void backoff(uint32_t max_ms, uint8_t fast = HEARTBEAT_FAST_COUNT) {
+            heartbeat_.backoff(max_ms, fast);
+        }
+
+        // Set the observer notified when the BCM stops or resumes
+        // broadcasting 0x60D.
+        void observer(FreshnessObserver* observer) { source_.observer(observer); }
+
+    private:
+        void queueEdge(uint8_t changed, uint8_t state);
+
+        // Edges received since the last emit as changed bits and the state
+        // after the change.
+        uint8_t edges_[DOORS_EDGE_QUEUE_SIZE][2];
+        uint8_t edge_count_;
+        bool republish_;
+        bool suspended_;
+        DoorStateEvent state_;
+        DoorEdgeEvent edge_;
+        Heartbeat heartbeat_;
+        Freshness source_;
+};
+
+}  // namespace R51
+
+#endif  // _R51_VEHICLE_DOORS_H_
@@ -7,27 +7,57 @@
 namespace R51 {
 
 void EngineTempState::handle(const Message& msg) {
-    if (msg.type() != Message::CAN_FRAME ||
-            msg.can_frame().id() != 0x551 ||
-            msg.can_frame().size() < 1) {
-        return;
+    if (msg.type() == Message::CAN_FRAME) {
+        handle(FrameView(msg.can_frame()));
     }
+}
 
-    // The value sent by the ECM and our event are offset by -40 so we don't
-    // need to perform any adjustements.
-    uint8_t value = msg.can_frame().data()[0];
-    if (value != event_.data[0]) {
-        event_.data[0] = value;
-        changed_ = true;
+bool EngineTempState::handle(const FrameView& frame) {
+    if (frame.id() != 0x551 || frame.size() < 1) {
+        return false;
     }
+    // Publish the current value as soon as the ECM returns.
+    bool changed = source_.received();
+
+    // The ECM reports Celsius offset by 40.
+    coolant_ = frame.data()[0];
+    changed |= update();
+    changed_ |= changed;
+    return changed;
+}
+
+void EngineTempState::units(Units units) {
+    changed_ |= event_.units(units);
+    changed_ |= update();
+}
+
+bool EngineTempState::update() {
+    int16_t celsius = (int16_t)coolant_ - 40;
+    return event_.coolant_celsius(celsius) |
+        event_.coolant_fahrenheit(event_.units() == UNITS_US ? celsiusToFahrenheit(celsius) : 0);
 }
 
 void EngineTempState::emit(const Caster::Yield<Message>& yield) {
-    if (changed_ || ticker_.active()) {
-        ticker_.reset();
+    bool stale = source_.stale();
+    if (changed_ || (!suspended_ && !stale && heartbeat_.active())) {
+        if (changed_) {
+            heartbeat_.change();
+        }
+        heartbeat_.reset();
         yield(event_);
         changed_ = false;
     }
 }
 
+uint32_t EngineTempState::nextDeadline() {
+    if (changed_) {
+        return 0;
+    }
+    uint32_t next = source_.deadline();
+    if (!suspended_ && !source_.expired()) {
+        next = earliestDeadline(next, heartbeat_.deadline());
+    }
+    return next;
+}
+
 }  // namespace R51
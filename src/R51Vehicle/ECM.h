@@ -5,26 +5,92 @@
 #include <Caster.h>
 #include <Faker.h>
 #include <R51Core.h>
+#include "Deadline.h"
+#include "Freshness.h"
+#include "Handler.h"
+#include "Heartbeat.h"
+#include "Node.h"
+#include "Units.h"
 
 namespace R51 {
 
+// Expected broadcast period of the ECM 0x551 frame in milliseconds.
+#ifndef ECM_FRAME_PERIOD
+#define ECM_FRAME_PERIOD 100
+#endif
+
+// Engine temperature state event. Byte 0 holds the coolant temperature in
+// Celsius offset by 40 as reported by the ECM whatever the units. When US
+// units are published the Fahrenheit temperature is held in bytes 2 and 3
+// and is otherwise zero.
+class EngineTempStateEvent : public SystemEvent {
+    public:
+        EngineTempStateEvent() : SystemEvent(Event::ENGINE_TEMP_STATE, {0x00, 0x00, 0x00, 0x00}) {}
+
+        SYSTEM_EVENT_PROPERTY(int16_t, coolant_celsius, (int16_t)data[0] - 40,
+                data[0] = (uint8_t)(value + 40))
+        SYSTEM_EVENT_PROPERTY(Units, units, (Units)data[1], data[1] = (uint8_t)value)
+        SYSTEM_EVENT_PROPERTY(int16_t, coolant_fahrenheit,
+                (int16_t)(data[2] | (data[3] << 8)),
+                (data[2] = value & 0xFF, data[3] = (uint16_t)value >> 8))
+
+        // Return the coolant temperature in the published units.
+        int16_t coolant_temp() const {
+            return units() == UNITS_US ? coolant_fahrenheit() : coolant_celsius();
+        }
+};
+
 // Track reported coolant temperature from the ECM via the 0x551 CAN frame.
-class EngineTempState : public Caster::Node<Message> {
+// Periodic re-emits stop while the frame is stale. The temperature is
+// published in Celsius unless US units are preferred.
+class EngineTempState : public VehicleNode, public Handler {
     public:
         EngineTempState(uint32_t tick_ms = 0, Faker::Clock* clock = Faker::Clock::real()) :
-            changed_(false), event_(Event::ENGINE_TEMP_STATE, {0x00}), ticker_(tick_ms, clock) {}
+            changed_(false), suspended_(false), coolant_(0x00), heartbeat_(tick_ms, clock),
+            source_(0x551, ECM_FRAME_PERIOD, clock) {}
 
         // Handle ECM 0x551 state frames. Returns true if the state changed as
         // a result of handling the frame.
         void handle(const Message& msg) override;
 
+        // Handle a 0x551 state frame in place. Return true if the state
+        // changed.
+        bool handle(const FrameView& frame) override;
+
         // Yield an ENGINE_TEMP_STATE frame on change or tick.
         void emit(const Caster::Yield<Message>& yield) override;
 
+        // Return the time until the next change or periodic re-emit is
+        // emitted or the 0x551 frame goes stale.
+        uint32_t nextDeadline() override;
+
+        // Suspend periodic re-emits while the vehicle sleeps.
+        void power(PowerMode mode) override { suspended_ = mode == POWER_SLEEP; }
+
+        // Publish the temperature in the given units.
+        void units(Units units) override;
+
+        // Back off periodic re-emits up to max_ms while the state holds.
+        // See Heartbeat.
+        void backoff(uint32_t max_ms, uint8_t fast = HEARTBEAT_FAST_COUNT) {
+            heartbeat_.backoff(max_ms, fast);
+        }
+
+        // Set the observer notified when the ECM stops or resumes
+        // broadcasting 0x551.
+        void observer(FreshnessObserver* observer) { source_.observer(observer); }
+
     private:
         bool changed_;
-        SystemEvent event_;
-        Ticker ticker_;
+        bool suspended_;
+        uint8_t coolant_;
+        EngineTempStateEvent event_;
+        Heartbeat heartbeat_;
+        Freshness source_;
+
+        // Update the event from the reported value. Return true if it
+        // changed.
+        bool update();
 };
 
 }  // namespace R51
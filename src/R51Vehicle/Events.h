@@ -0,0 +1,26 @@
+#ifndef _R51_VEHICLE_EVENTS_H_
+#define _R51_VEHICLE_EVENTS_H_
+
+#include <Arduino.h>
+#include <R51Core.h>
+
+namespace R51 {
+
+// Vehicle events defined by this library rather than by R51Core. IDs are
+// taken from the top of the ID space so they do not collide with the
+// R51Core events which are numbered from zero.
+enum class VehicleEvent : uint8_t {
+    // Door and lock state. See DoorStateEvent.
+    DOOR_STATE = 0xF0,
+    // Door and lock state changes. See DoorEdgeEvent.
+    DOOR_EDGE = 0xF1,
+};
+
+// Return the system event ID of a vehicle event.
+constexpr Event vehicleEvent(VehicleEvent event) {
+    return (Event)event;
+}
+
+}  // namespace R51
+
+#endif  // _R51_VEHICLE_EVENTS_H_
@@ -0,0 +1,282 @@
+#include "Filter.h"
+
+#include <Arduino.h>
+
+namespace R51 {
+namespace {
+
+// Mask of all bits in a standard frame ID.
+static const uint16_t STANDARD_MASK = 0x7FF;
+
+}  // namespace
+
+AcceptanceFilter::AcceptanceFilter(const uint8_t* groups, uint8_t group_count) :
+        group_count_(0), slot_count_(0), id_count_(0), cluster_count_(0),
+        best_cost_(0) {
+    for (uint8_t i = 0; i < group_count && i < FILTER_MAX_GROUPS; ++i) {
+        if (slot_count_ + groups[i] > FILTER_MAX_SLOTS) {
+            break;
+        }
+        groups_[i] = groups[i];
+        slot_count_ += groups[i];
+        ++group_count_;
+    }
+    memset(masks_, 0, sizeof(masks_));
+    memset(filters_, 0, sizeof(filters_));
+}
+
+bool AcceptanceFilter::add(uint32_t id) {
+    if (id > STANDARD_MASK) {
+        return false;
+    }
+    if (consumes(id)) {
+        return true;
+    }
+    if (id_count_ >= FILTER_MAX_IDS) {
+        return false;
+    }
+    ids_[id_count_++] = id;
+    return true;
+}
+
+bool AcceptanceFilter::add(const Climate&) {
+    return add(0x54A, 0x54B);
+}
+
+bool AcceptanceFilter::add(const Doors&) {
+    return add(0x60D);
+}
+
+bool AcceptanceFilter::add(const EngineTempState&) {
+    return add(0x551);
+}
+
+bool AcceptanceFilter::add(const IPDM&) {
+    return add(0x625);
+}
+
+bool AcceptanceFilter::add(const PowerManager&) {
+    return add(0x54A, 0x54B, 0x551, 0x625, 0x385);
+}
+
+bool AcceptanceFilter::add(const Settings&) {
+    bool ok = true;
+    if (settingsEnabled(SETTINGS_FEATURE_CHANNEL_E)) {
+        ok = add(0x72E) && ok;
+    }
+    if (settingsEnabled(SETTINGS_FEATURE_CHANNEL_F)) {
+        ok = add(0x72F) && ok;
+    }
+    return ok;
+}
+
+bool AcceptanceFilter::add(const TirePressureState&) {
+    return add(0x385);
+}
+
+uint16_t AcceptanceFilter::filter(uint8_t group, uint8_t index) const {
+    uint8_t slot = 0;
+    for (uint8_t i = 0; i < group; ++i) {
+        slot += groups_[i];
+    }
+    return filters_[slot + index];
+}
+
+bool AcceptanceFilter::accepts(uint32_t id) const {
+    if (id > STANDARD_MASK) {
+        return false;
+    }
+    return accepts(masks_, filters_, id);
+}
+
+bool AcceptanceFilter::consumes(uint32_t id) const {
+    for (uint8_t i = 0; i < id_count_; ++i) {
+        if (ids_[i] == id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+float AcceptanceFilter::falsePositiveRate(const TrafficSample* traffic, size_t count) const {
+    uint32_t unwanted = 0;
+    uint32_t accepted = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (consumes(traffic[i].id)) {
+            continue;
+        }
+        unwanted += traffic[i].count;
+        if (accepts(traffic[i].id)) {
+            accepted += traffic[i].count;
+        }
+    }
+    if (unwanted == 0) {
+        return 0;
+    }
+    return (float)accepted / unwanted;
+}
+
+bool AcceptanceFilter::compute(const TrafficSample* traffic, size_t count) {
+    if (id_count_ == 0 || slot_count_ == 0) {
+        return false;
+    }
+    cluster(traffic, count);
+
+    memset(used_, 0, sizeof(used_));
+    best_cost_ = UINT32_MAX;
+    search(0, traffic, count);
+    return true;
+}
+
+bool AcceptanceFilter::accepts(const uint16_t* masks, const uint16_t* filters,
+        uint16_t id) const {
+    uint8_t slot = 0;
+    for (uint8_t g = 0; g < group_count_; ++g) {
+        for (uint8_t i = 0; i < groups_[g]; ++i) {
+            if (((id ^ filters[slot + i]) & masks[g]) == 0) {
+                return true;
+            }
+        }
+        slot += groups_[g];
+    }
+    return false;
+}
+
+uint32_t AcceptanceFilter::cost(const uint16_t* masks, const uint16_t* filters,
+        const TrafficSample* traffic, size_t count) const {
+    uint32_t total = 0;
+    if (traffic != nullptr) {
+        for (size_t i = 0; i < count; ++i) {
+            if (!consumes(traffic[i].id) && accepts(masks, filters, traffic[i].id)) {
+                total += traffic[i].count;
+            }
+        }
+    } else {
+        for (uint16_t id = 0; id <= STANDARD_MASK; ++id) {
+            if (!consumes(id) && accepts(masks, filters, id)) {
+                ++total;
+            }
+        }
+    }
+    return total;
+}
+
+uint32_t AcceptanceFilter::cost(uint16_t value, uint16_t mask,
+        const TrafficSample* traffic, size_t count) const {
+    uint32_t total = 0;
+    if (traffic != nullptr) {
+        for (size_t i = 0; i < count; ++i) {
+            if (((traffic[i].id ^ value) & mask) == 0 && !consumes(traffic[i].id)) {
+                total += traffic[i].count;
+            }
+        }
+    } else {
+        // Every combination of the unmasked bits is accepted.
+        uint8_t wild = 0;
+        for (uint16_t bits = ~mask & STANDARD_MASK; bits != 0; bits >>= 1) {
+            wild += bits & 1;
+        }
+        total = 1 << wild;
+        for (uint8_t i = 0; i < id_count_; ++i) {
+            if (((ids_[i] ^ value) & mask) == 0) {
+                --total;
+            }
+        }
+    }
+    return total;
+}
+
+void AcceptanceFilter::cluster(const TrafficSample* traffic, size_t count) {
+    cluster_count_ = id_count_;
+    for (uint8_t i = 0; i < id_count_; ++i) {
+        cluster_values_[i] = ids_[i];
+        cluster_masks_[i] = STANDARD_MASK;
+    }
+
+    // Greedily merge the pair of clusters which admits the fewest false
+    // positives until there is a filter register for each cluster.
+    while (cluster_count_ > slot_count_) {
+        uint8_t best_a = 0;
+        uint8_t best_b = 1;
+        uint16_t best_mask = 0;
+        uint32_t best = UINT32_MAX;
+        for (uint8_t a = 0; a < cluster_count_; ++a) {
+            for (uint8_t b = a + 1; b < cluster_count_; ++b) {
+                uint16_t mask = cluster_masks_[a] & cluster_masks_[b] &
+                    ~(cluster_values_[a] ^ cluster_values_[b]);
+                uint32_t c = cost(cluster_values_[a], mask, traffic, count);
+                if (c < best) {
+                    best = c;
+                    best_a = a;
+                    best_b = b;
+                    best_mask = mask;
+                }
+            }
+        }
+        cluster_masks_[best_a] = best_mask;
+        --cluster_count_;
+        cluster_values_[best_b] = cluster_values_[cluster_count_];
+        cluster_masks_[best_b] = cluster_masks_[cluster_count_];
+    }
+}
+
+void AcceptanceFilter::search(uint8_t index, const TrafficSample* traffic, size_t count) {
+    if (index == cluster_count_) {
+        build();
+        uint32_t c = cost(trial_masks_, trial_filters_, traffic, count);
+        if (c < best_cost_) {
+            best_cost_ = c;
+            memcpy(masks_, trial_masks_, sizeof(masks_));
+            memcpy(filters_, trial_filters_, sizeof(filters_));
+        }
+        return;
+    }
+
+    for (uint8_t g = 0; g < group_count_; ++g) {
+        if (used_[g] >= groups_[g]) {
+            continue;
+        }
+        // Empty groups of the same size are interchangeable so only the
+        // first is tried.
+        bool skip = false;
+        if (used_[g] == 0) {
+            for (uint8_t p = 0; p < g; ++p) {
+                if (used_[p] == 0 && groups_[p] == groups_[g]) {
+                    skip = true;
+                    break;
+                }
+            }
+        }
+        if (skip) {
+            continue;
+        }
+        assign_[index] = g;
+        ++used_[g];
+        search(index + 1, traffic, count);
+        --used_[g];
+    }
+}
+
+void AcceptanceFilter::build() {
+    uint8_t slot = 0;
+    for (uint8_t g = 0; g < group_count_; ++g) {
+        uint16_t mask = STANDARD_MASK;
+        uint8_t filled = 0;
+        for (uint8_t c = 0; c < cluster_count_; ++c) {
+            if (assign_[c] == g) {
+                mask &= cluster_masks_[c];
+                trial_filters_[slot + filled++] = cluster_values_[c];
+            }
+        }
+        // Unused filters repeat a filter already in use so they accept
+        // nothing new. Groups without clusters match a consumed ID exactly.
+        uint16_t fill = filled > 0 ? trial_filters_[slot] : cluster_values_[0];
+        for (uint8_t i = filled; i < groups_[g]; ++i) {
+            trial_filters_[slot + i] = fill;
+        }
+        trial_masks_[g] = mask;
+        slot += groups_[g];
+    }
+}
+
+}  // namespace R51
@@ -0,0 +1,145 @@
+#ifndef _R51_VEHICLE_FILTER_H_
+#define _R51_VEHICLE_FILTER_H_
+
+#include <Arduino.h>
+#include "Climate.h"
+#include "Doors.h"
+#include "ECM.h"
+#include "IPDM.h"
+#include "Power.h"
+#include "Settings.h"
+#include "Tires.h"
+
+namespace R51 {
+
+// Maximum number of frame IDs an acceptance filter can be computed for.
+#ifndef FILTER_MAX_IDS
+#define FILTER_MAX_IDS 16
+#endif
+
+// Maximum number of mask registers supported.
+#ifndef FILTER_MAX_GROUPS
+#define FILTER_MAX_GROUPS 16
+#endif
+
+// Maximum number of filter registers supported across all masks.
+#ifndef FILTER_MAX_SLOTS
+#define FILTER_MAX_SLOTS 32
+#endif
+
+// Number of times a frame ID was seen in recorded traffic.
+struct TrafficSample {
+    uint16_t id;
+    uint32_t count;
+};
+
+// Computes hardware acceptance mask and filter registers which pass the frame
+// IDs consumed by the vehicle nodes. A controller is described as a list of
+// mask registers and the number of filter registers sharing each mask. A
+// frame is accepted if (id & mask) == (filter & mask) for any filter. For
+// example:
+//
+//   MCP2515: two masks with 2 and 4 filters, {2, 4}
+//   bxCAN:   one mask and one filter per bank in 32-bit mask mode, {1, 1, ...}
+//
+// When the controller has fewer filters than consumed IDs some filters must
+// match several IDs and so also pass frames no node consumes. The filters are
+// chosen to minimize these false positives, either against a recorded traffic
+// mix or against the full ID space when no traffic is given.
+//
+// Only standard 11-bit frame IDs are supported. The search is exhaustive
+// over the mask assignment and is intended to run once at setup or offline.
+class AcceptanceFilter {
+    public:
+        // Create a filter for a controller with group_count mask registers.
+        // The number of filter registers sharing each mask is given in
+        // groups.
+        AcceptanceFilter(const uint8_t* groups, uint8_t group_count);
+
+        // Add a consumed frame ID. Return false if the ID is extended or the
+        // filter is full.
+        bool add(uint32_t id);
+
+        // Add the frame IDs consumed by a node.
+        bool add(const Climate& node);
+        bool add(const Doors& node);
+        bool add(const EngineTempState& node);
+        bool add(const IPDM& node);
+        bool add(const PowerManager& node);
+        bool add(const Settings& node);
+        bool add(const TirePressureState& node);
+
+        // Add the frame IDs consumed by several nodes.
+        template <typename A, typename B, typename... Nodes>
+        bool add(const A& a, const B& b, const Nodes&... nodes) {
+            bool ok = add(a);
+            return add(b, nodes...) && ok;
+        }
+
+        // Compute the mask and filter registers. The optional traffic mix is
+        // used to weigh false positives. Return false if no IDs have been
+        // added.
+        bool compute(const TrafficSample* traffic = nullptr, size_t count = 0);
+
+        // Return the number of mask registers.
+        uint8_t groups() const { return group_count_; }
+
+        // Return the number of filter registers sharing a mask.
+        uint8_t filters(uint8_t group) const { return groups_[group]; }
+
+        // Return the computed value of a mask register.
+        uint16_t mask(uint8_t group) const { return masks_[group]; }
+
+        // Return the computed value of a filter register.
+        uint16_t filter(uint8_t group, uint8_t index) const;
+
+        // Return true if the computed registers accept the frame ID.
+        bool accepts(uint32_t id) const;
+
+        // Return true if a node consumes the frame ID.
+        bool consumes(uint32_t id) const;
+
+        // Return the fraction of frames in the traffic mix which no node
+        // consumes but are accepted by the computed registers.
+        float falsePositiveRate(const TrafficSample* traffic, size_t count) const;
+
+    private:
+        uint8_t groups_[FILTER_MAX_GROUPS];
+        uint8_t group_count_;
+        uint8_t slot_count_;
+        uint16_t ids_[FILTER_MAX_IDS];
+        uint8_t id_count_;
+        uint16_t masks_[FILTER_MAX_GROUPS];
+        uint16_t filters_[FILTER_MAX_SLOTS];
+
+        // Clusters of IDs matched by a single filter register.
+        uint16_t cluster_values_[FILTER_MAX_SLOTS];
+        uint16_t cluster_masks_[FILTER_MAX_SLOTS];
+        uint8_t cluster_count_;
+
+        // Search state for assigning clusters to mask registers.
+        uint8_t assign_[FILTER_MAX_SLOTS];
+        uint8_t used_[FILTER_MAX_GROUPS];
+        uint16_t trial_masks_[FILTER_MAX_GROUPS];
+        uint16_t trial_filters_[FILTER_MAX_SLOTS];
+        uint32_t best_cost_;
+
+        bool accepts(const uint16_t* masks, const uint16_t* filters, uint16_t id) const;
+        uint32_t cost(const uint16_t* masks, const uint16_t* filters,
+                const TrafficSample* traffic, size_t count) const;
+        uint32_t cost(uint16_t value, uint16_t mask,
+                const TrafficSample* traffic, size_t count) const;
+
+        // Merge clusters until each fits in a filter register.
+        void cluster(const TrafficSample* traffic, size_t count);
+
+        // Assign clusters to mask registers keeping the best assignment.
+        void search(uint8_t index, const TrafficSample* traffic, size_t count);
+
+        // Build trial registers from the current assignment.
+        void build();
+};
+
+}  // namespace R51
+
+#endif  // _R51_VEHICLE_FILTER_H_
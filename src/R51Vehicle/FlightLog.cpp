@@ -0,0 +1,259 @@
+#include "FlightLog.h"
+
+#include <Arduino.h>
+#include <Caster.h>
+#include <Faker.h>
+#include <R51Core.h>
+#include "Events.h"
+
+namespace R51 {
+namespace {
+
+static const byte PAGE_MARKER = 0xA5;
+static const size_t HEADER_SIZE = 9;
+static const byte END_OF_PAGE = 0xFF;
+
+void writeUint32(byte* data, uint32_t value) {
+    data[0] = value & 0xFF;
+    data[1] = (value >> 8) & 0xFF;
+    data[2] = (value >> 16) & 0xFF;
+    data[3] = (value >> 24) & 0xFF;
+}
+
+uint32_t readUint32(const byte* data) {
+    return (uint32_t)data[0] |
+        ((uint32_t)data[1] << 8) |
+        ((uint32_t)data[2] << 16) |
+        ((uint32_t)data[3] << 24);
+}
+
+// Encode a varint into data. Returns the number of bytes written.
+size_t writeVarint(byte* data, uint32_t value) {
+    size_t i = 0;
+    while (value >= 0x80) {
+        data[i++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    data[i++] = value;
+    return i;
+}
+
+// Decode a varint from data. Returns the number of bytes read or 0 if the
+// varint overruns the end of the buffer.
+size_t readVarint(const byte* data, size_t size, uint32_t* value) {
+    *value = 0;
+    for (size_t i = 0; i < size && i < 5; i++) {
+        *value |= (uint32_t)(data[i] & 0x7F) << (7 * i);
+        if ((data[i] & 0x80) == 0) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+// Return true if the page has a valid header. The sequence number is stored
+// in sequence.
+bool readHeader(const byte* page, uint32_t* sequence) {
+    if (page[0] != PAGE_MARKER) {
+        return false;
+    }
+    *sequence = readUint32(page + 1);
+    return true;
+}
+
+}  // namespace
+
+bool isStateEvent(const SystemEvent& event) {
+    switch ((VehicleEvent)event.id) {
+        case VehicleEvent::DOOR_STATE:
+        case VehicleEvent::DOOR_EDGE:
+            return true;
+        default:
+            break;
+    }
+    switch ((Event)event.id) {
+        case Event::CLIMATE_TEMP_STATE:
+        case Event::CLIMATE_AIRFLOW_STATE:
+        case Event::CLIMATE_SYSTEM_STATE:
+        case Event::ENGINE_TEMP_STATE:
+        case Event::BODY_POWER_STATE:
+        case Event::TIRE_PRESSURE_STATE:
+        case Event::SETTINGS_STATE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+FlightLog::FlightLog(FlightLogStorage* storage, Faker::Clock* clock) :
+    storage_(storage), clock_(clock), seeked_(false),
+    sequence_(0), last_(0), size_(0) {}
+
+void FlightLog::handle(const Message& msg) {
+    if (msg.type() != Message::SYSTEM_EVENT ||
+            !isStateEvent(msg.system_event())) {
+        return;
+    }
+    append(msg.system_event());
+}
+
+void FlightLog::handle(const MessageBatch& batch) {
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (batch.type(i) == Message::SYSTEM_EVENT &&
+                isStateEvent(batch.system_event(i))) {
+            append(batch.system_event(i));
+        }
+    }
+}
+
+void FlightLog::append(const SystemEvent& event) {
+    uint32_t now = clock_->millis();
+
+    // trim trailing zeros from the payload
+    uint8_t len = sizeof(event.data);
+    while (len > 0 && event.data[len - 1] == 0x00) {
+        --len;
+    }
+
+    byte delta[5];
+    size_t delta_size = writeVarint(delta, size_ == 0 ? 0 : now - last_);
+    size_t record_size = 2 + delta_size + len;
+    if (size_ != 0 && size_ + record_size > FLIGHT_LOG_PAGE_SIZE) {
+        flush();
+        delta_size = writeVarint(delta, 0);
+        record_size = 2 + delta_size + len;
+    }
+    if (size_ == 0) {
+        seek();
+        reset(now);
+    }
+
+    page_[size_++] = len;
+    memcpy(page_ + size_, delta, delta_size);
+    size_ += delta_size;
+    page_[size_++] = event.id;
+    memcpy(page_ + size_, event.data, len);
+    size_ += len;
+    last_ = now;
+}
+
+bool FlightLog::flush() {
+    if (size_ <= HEADER_SIZE) {
+        return true;
+    }
+    memset(page_ + size_, END_OF_PAGE, FLIGHT_LOG_PAGE_SIZE - size_);
+    bool ok = storage_->write(sequence_ % storage_->pages(), page_);
+    ++sequence_;
+    size_ = 0;
+    return ok;
+}
+
+void FlightLog::seek() {
+    // Resume after the newest page already in storage so a restart does not
+    // overwrite the most recent history.
+    if (seeked_) {
+        return;
+    }
+    seeked_ = true;
+
+    // The page buffer is empty at this point so use it to scan headers.
+    bool found = false;
+    uint32_t newest = 0;
+    for (uint32_t i = 0; i < storage_->pages(); i++) {
+        uint32_t sequence;
+        if (storage_->read(i, page_) && readHeader(page_, &sequence) &&
+                (!found || sequence > newest)) {
+            newest = sequence;
+            found = true;
+        }
+    }
+    if (found) {
+        sequence_ = newest + 1;
+    }
+}
+
+void FlightLog::reset(uint32_t timestamp) {
+    page_[0] = PAGE_MARKER;
+    writeUint32(page_ + 1, sequence_);
+    writeUint32(page_ + 5, timestamp);
+    size_ = HEADER_SIZE;
+    last_ = timestamp;
+}
+
+FlightLogReader::FlightLogReader(FlightLogStorage* storage) :
+    storage_(storage), seeked_(false), page_index_(0), pages_read_(0),
+    sequence_(0), timestamp_(0), pos_(FLIGHT_LOG_PAGE_SIZE) {}
+
+void FlightLogReader::seek() {
+    seeked_ = true;
+
+    bool found = false;
+    uint32_t oldest = 0;
+    uint32_t oldest_index = 0;
+    for (uint32_t i = 0; i < storage_->pages(); i++) {
+        uint32_t sequence;
+        if (storage_->read(i, page_) && readHeader(page_, &sequence) &&
+                (!found || sequence < oldest)) {
+            oldest = sequence;
+            oldest_index = i;
+            found = true;
+        }
+    }
+    if (found) {
+        load(oldest_index);
+    }
+}
+
+bool FlightLogReader::load(uint32_t index) {
+    uint32_t sequence;
+    if (pages_read_ >= storage_->pages() ||
+            !storage_->read(index, page_) ||
+            !readHeader(page_, &sequence) ||
+            (pages_read_ > 0 && sequence != sequence_ + 1)) {
+        pos_ = FLIGHT_LOG_PAGE_SIZE;
+        return false;
+    }
+    ++pages_read_;
+    page_index_ = index;
+    sequence_ = sequence;
+    timestamp_ = readUint32(page_ + 5);
+    pos_ = HEADER_SIZE;
+    return true;
+}
+
+bool FlightLogReader::next(uint32_t* timestamp, SystemEvent* event) {
+    if (!seeked_) {
+        seek();
+    }
+    while (pos_ >= FLIGHT_LOG_PAGE_SIZE || page_[pos_] == END_OF_PAGE) {
+        if (pages_read_ == 0 ||
+                !load((page_index_ + 1) % storage_->pages())) {
+            return false;
+        }
+    }
+
+    uint8_t len = page_[pos_];
+    if (len > sizeof(event->data)) {
+        pos_ = FLIGHT_LOG_PAGE_SIZE;
+        return false;
+    }
+    uint32_t delta;
+    size_t delta_size = readVarint(page_ + pos_ + 1,
+            FLIGHT_LOG_PAGE_SIZE - pos_ - 1, &delta);
+    if (delta_size == 0 ||
+            pos_ + 2 + delta_size + len > FLIGHT_LOG_PAGE_SIZE) {
+        pos_ = FLIGHT_LOG_PAGE_SIZE;
+        return false;
+    }
+    pos_ += 1 + delta_size;
+
+    timestamp_ += delta;
+    *timestamp = timestamp_;
+    event->id = page_[pos_++];
+    memset(event->data, 0, sizeof(event->data));
+    memcpy(event->data, page_ + pos_, len);
+    pos_ += len;
+    return true;
+}
+
+}  // namespace R51
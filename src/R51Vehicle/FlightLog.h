@@ -0,0 +1,107 @@
+#ifndef _R51_VEHICLE_FLIGHT_LOG_H_
+#define _R51_VEHICLE_FLIGHT_LOG_H_
+
+#include <Arduino.h>
+#include <Caster.h>
+#include <Faker.h>
+#include <R51Core.h>
+#include "Batch.h"
+
+namespace R51 {
+
+// Size of a flight log page in bytes. This should match the program page or
+// sector size of the underlying storage so that every write covers exactly
+// one page.
+#ifndef FLIGHT_LOG_PAGE_SIZE
+#define FLIGHT_LOG_PAGE_SIZE 256
+#endif
+
+// Page oriented storage used to persist the flight log. Pages are always read
+// and written whole.
+class FlightLogStorage {
+    public:
+        FlightLogStorage() = default;
+        virtual ~FlightLogStorage() = default;
+
+        // Return the number of pages available to the log.
+        virtual uint32_t pages() const = 0;
+
+        // Read a page into data. Return false on error.
+        virtual bool read(uint32_t page, byte* data) = 0;
+
+        // Write a page from data. Return false on error.
+        virtual bool write(uint32_t page, const byte* data) = 0;
+};
+
+// Return true if the event is a state event recorded by the flight log.
+bool isStateEvent(const SystemEvent& event);
+
+// Appends emitted state events to a circular log. Records are batched in RAM
+// and written to storage one full page at a time.
+//
+// Each page begins with a 9 byte header containing a marker byte followed by
+// a sequence number and the page's base timestamp in milliseconds, both
+// little endian. Records follow the header and are encoded as:
+//   [length] [delta] [id] [data...]
+// The length byte holds the number of data bytes stored after trailing zeros
+// are trimmed. The delta is the number of milliseconds since the previous
+// record in the page (or the base timestamp) encoded as a base-128 varint.
+// Unused space at the end of a page is filled with 0xFF.
+class FlightLog : public Caster::Node<Message>, public BatchHandler {
+    public:
+        FlightLog(FlightLogStorage* storage, Faker::Clock* clock = Faker::Clock::real());
+
+        // Append state events to the log.
+        void handle(const Message& msg) override;
+
+        // Append the state events in a batch.
+        void handle(const MessageBatch& batch) override;
+
+        // The flight log does not emit messages.
+        void emit(const Caster::Yield<Message>&) override {}
+
+        // Write the buffered page to storage even if it is not full. The next
+        // record begins a new page.
+        bool flush();
+
+    private:
+        FlightLogStorage* storage_;
+        Faker::Clock* clock_;
+        bool seeked_;
+        uint32_t sequence_;
+        uint32_t last_;
+        size_t size_;
+        byte page_[FLIGHT_LOG_PAGE_SIZE];
+
+        void append(const SystemEvent& event);
+        void seek();
+        void reset(uint32_t timestamp);
+};
+
+// Reads records back out of a flight log in the order they were written.
+class FlightLogReader {
+    public:
+        FlightLogReader(FlightLogStorage* storage);
+
+        // Read the next event from the log. The timestamp is set to the time
+        // the event was logged. Return false when the end of the log is
+        // reached.
+        bool next(uint32_t* timestamp, SystemEvent* event);
+
+    private:
+        FlightLogStorage* storage_;
+        bool seeked_;
+        uint32_t page_index_;
+        uint32_t pages_read_;
+        uint32_t sequence_;
+        uint32_t timestamp_;
+        size_t pos_;
+        byte page_[FLIGHT_LOG_PAGE_SIZE];
+
+        void seek();
+        bool load(uint32_t index);
+};
+
+}  // namespace R51
+
+#endif  // _R51_VEHICLE_FLIGHT_LOG_H_
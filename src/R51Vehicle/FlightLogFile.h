@@ -0,0 +1,65 @@
+#ifndef _R51_VEHICLE_FLIGHT_LOG_FILE_H_
+#define _R51_VEHICLE_FLIGHT_LOG_FILE_H_
+
+// File backed flight log storage for native builds.
+#if defined(EPOXY_DUINO)
+
+#include <Arduino.h>
+#include <stdio.h>
+#include "FlightLog.h"
+
+namespace R51 {
+
+// Stores flight log pages in a regular file. Pages which have not been
+// written read back as erased flash (all 0xFF).
+class FileFlightLogStorage : public FlightLogStorage {
+    public:
+        // Open the file at path. The file is created if it does not exist.
+        FileFlightLogStorage(const char* path, uint32_t pages) : pages_(pages) {
+            file_ = fopen(path, "r+b");
+            if (file_ == nullptr) {
+                file_ = fopen(path, "w+b");
+            }
+        }
+
+        ~FileFlightLogStorage() override {
+            if (file_ != nullptr) {
+                fclose(file_);
+            }
+        }
+
+        // Return true if the file was opened successfully.
+        bool ok() const { return file_ != nullptr; }
+
+        uint32_t pages() const override { return pages_; }
+
+        bool read(uint32_t page, byte* data) override {
+            if (file_ == nullptr || page >= pages_ ||
+                    fseek(file_, (long)page * FLIGHT_LOG_PAGE_SIZE, SEEK_SET) != 0) {
+                return false;
+            }
+            size_t n = fread(data, 1, FLIGHT_LOG_PAGE_SIZE, file_);
+            memset(data + n, 0xFF, FLIGHT_LOG_PAGE_SIZE - n);
+            return true;
+        }
+
+        bool write(uint32_t page, const byte* data) override {
+            if (file_ == nullptr || page >= pages_ ||
+                    fseek(file_, (long)page * FLIGHT_LOG_PAGE_SIZE, SEEK_SET) != 0) {
+                return false;
+            }
+            bool ok = fwrite(data, 1, FLIGHT_LOG_PAGE_SIZE, file_) == FLIGHT_LOG_PAGE_SIZE;
+            fflush(file_);
+            return ok;
+        }
+
+    private:
+        FILE* file_;
+        uint32_t pages_;
+};
+
+}  // namespace R51
+
+#endif  // defined(EPOXY_DUINO)
+
+#endif  // _R51_VEHICLE_FLIGHT_LOG_FILE_H_
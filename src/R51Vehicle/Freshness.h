@@ -0,0 +1,97 @@
+#ifndef _R51_VEHICLE_FRESHNESS_H_
+#define _R51_VEHICLE_FRESHNESS_H_
+
+#include <Arduino.h>
+#include <Faker.h>
+#include "Deadline.h"
+
+namespace R51 {
+
+// Number of expected broadcast periods a source frame may go missing before
+// it is considered stale.
+#ifndef FRESHNESS_STALE_PERIODS
+#define FRESHNESS_STALE_PERIODS 3
+#endif
+
+// Notified when a vehicle module stops or resumes broadcasting a frame.
+class FreshnessObserver {
+    public:
+        virtual ~FreshnessObserver() = default;
+
+        // Called with the source frame ID when it goes stale or is received
+        // again after going stale.
+        virtual void available(uint32_t id, bool available) = 0;
+};
+
+// Tracks the last receive time of a periodic source frame. A source is stale
+// once it has gone FRESHNESS_STALE_PERIODS of its expected period without a
+// frame. Sources which have never been received are not stale.
+class Freshness {
+    public:
+        Freshness(uint32_t id, uint32_t period_ms, Faker::Clock* clock = Faker::Clock::real()) :
+            id_(id), timeout_(period_ms * FRESHNESS_STALE_PERIODS), clock_(clock),
+            observer_(nullptr), last_(0), seen_(false), stale_(false) {}
+
+        // Set the observer notified of availability changes.
+        void observer(FreshnessObserver* observer) { observer_ = observer; }
+
+        // Record receipt of the source frame. Return true if the source was
+        // stale.
+        bool received() {
+            last_ = clock_->millis();
+            seen_ = true;
+            if (!stale_) {
+                return false;
+            }
+            stale_ = false;
+            notify(true);
+            return true;
+        }
+
+        // Return true if the source is stale.
+        bool stale() {
+            if (!stale_ && seen_ && clock_->millis() - last_ >= timeout_) {
+                stale_ = true;
+                notify(false);
+            }
+            return stale_;
+        }
+
+        // Return true if the source is stale or will be found stale by the
+        // next call to stale().
+        bool expired() const {
+            return stale_ || (seen_ && clock_->millis() - last_ >= timeout_);
+        }
+
+        // Return the time in milliseconds until the source goes stale.
+        // Return DEADLINE_NONE if the source has not been received or is
+        // already stale.
+        uint32_t deadline() const {
+            if (!seen_ || stale_) {
+                return DEADLINE_NONE;
+            }
+            return deadlineAfter(clock_->millis(), last_, timeout_);
+        }
+
+        // Return the time the source frame was last received.
+        uint32_t last() const { return last_; }
+
+    private:
+        const uint32_t id_;
+        const uint32_t timeout_;
+        Faker::Clock* clock_;
+        FreshnessObserver* observer_;
+        uint32_t last_;
+        bool seen_;
+        bool stale_;
+
+        void notify(bool available) {
+            if (observer_ != nullptr) {
+                observer_->available(id_, available);
+            }
+        }
+};
+
+}  // namespace R51
+
+#endif  // _R51_VEHICLE_FRESHNESS_H_
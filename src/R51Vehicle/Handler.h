@@ -1,11 +1,48 @@
 #ifndef _R51_VEHICLE_HANDLER_H_
 #define _R51_VEHICLE_HANDLER_H_
 
+#include <Arduino.h>
 #include <Canny.h>
 
 namespace R51 {
 
-// Handle CAN state update frames.
+// A borrowed view of a received CAN frame. The data is owned by the driver's
+// receive buffer and is only valid until the driver reads again. The
+// accessors match Canny::Frame so decoders work with either.
+class FrameView {
+    public:
+        FrameView(uint32_t id, uint8_t ext, const byte* data, uint8_t size) :
+            id_(id), ext_(ext), size_(size), data_(data) {}
+
+        // View the data of an existing frame without copying it.
+        explicit FrameView(const Canny::Frame& frame) :
+            id_(frame.id()), ext_(frame.ext()), size_(frame.size()),
+            data_(frame.data()) {}
+
+        uint32_t id() const { return id_; }
+        uint8_t ext() const { return ext_; }
+        uint8_t size() const { return size_; }
+        const byte* data() const { return data_; }
+
+    private:
+        uint32_t id_;
+        uint8_t ext_;
+        uint8_t size_;
+        const byte* data_;
+};
+
+// Notified when a handler receives a frame with a payload it does not know
+// how to decode.
+class DecodeObserver {
+    public:
+        virtual ~DecodeObserver() = default;
+
+        // Called with the frame which could not be decoded. The frame is
+        // only valid for the duration of the call.
+        virtual void unexpected(const FrameView& frame) = 0;
+};
+
+// Handle CAN state update frames in place from a driver receive buffer.
 class Handler {
     public:
         Handler() = default;
@@ -13,7 +50,7 @@ class Handler {
 
         // Handle a state update CAN frame. Return true if the frame modified
         // the current state.
-        virtual bool handle(const Canny::Frame& frame) = 0;
+        virtual bool handle(const FrameView& frame) = 0;
 };
 
 }  // namespace R51
@@ -0,0 +1,93 @@
+#ifndef _R51_VEHICLE_HEARTBEAT_H_
+#define _R51_VEHICLE_HEARTBEAT_H_
+
+#include <Arduino.h>
+#include <Faker.h>
+#include "Deadline.h"
+
+namespace R51 {
+
+// Default number of re-emits at the base interval after a change before a
+// heartbeat starts backing off.
+#ifndef HEARTBEAT_FAST_COUNT
+#define HEARTBEAT_FAST_COUNT 3
+#endif
+
+// Schedules periodic re-emits of a state value. After a change the value is
+// re-emitted at the base interval a few times and then the interval doubles
+// on each re-emit up to a maximum while the value holds. The next change
+// returns the heartbeat to the base interval.
+//
+// The heartbeat behaves like a fixed interval Ticker until backoff() is
+// called. A base interval of 0 disables the heartbeat.
+class Heartbeat {
+    public:
+        Heartbeat(uint32_t interval_ms, Faker::Clock* clock = Faker::Clock::real()) :
+            clock_(clock), base_(interval_ms), max_(interval_ms),
+            interval_(interval_ms), fast_(0), fast_left_(0),
+            last_(clock->millis()) {}
+
+        // Back off up to max_ms after fast re-emits at the base interval.
+        // A max_ms at or below the base interval disables backoff.
+        void backoff(uint32_t max_ms, uint8_t fast = HEARTBEAT_FAST_COUNT) {
+            max_ = max_ms > base_ ? max_ms : base_;
+            fast_ = fast;
+            change();
+        }
+
+        // Return true if a re-emit is due.
+        bool active() const {
+            return interval_ > 0 && clock_->millis() - last_ >= interval_;
+        }
+
+        // Return the heartbeat to the base interval. Call when the value
+        // changes.
+        void change() {
+            interval_ = base_;
+            fast_left_ = fast_;
+        }
+
+        // Schedule the next re-emit. Call after each emit.
+        void reset() {
+            last_ = clock_->millis();
+            if (fast_left_ > 0) {
+                --fast_left_;
+            } else if (interval_ < max_) {
+                interval_ = interval_ > max_ / 2 ? max_ : interval_ * 2;
+            }
+        }
+
+        // Restart at a fixed interval of interval_ms, discarding any
+        // backoff. The next re-emit is due interval_ms from now.
+        void reset(uint32_t interval_ms) {
+            base_ = interval_ms;
+            max_ = interval_ms;
+            interval_ = interval_ms;
+            fast_ = 0;
+            fast_left_ = 0;
+            last_ = clock_->millis();
+        }
+
+        // Return the time in milliseconds until the next re-emit is due or
+        // DEADLINE_NONE if the heartbeat is disabled.
+        uint32_t deadline() const {
+            return interval_ == 0 ? DEADLINE_NONE :
+                deadlineAfter(clock_->millis(), last_, interval_);
+        }
+
+        // Return the current re-emit interval.
+        uint32_t interval() const { return interval_; }
+
+    private:
+        Faker::Clock* clock_;
+        uint32_t base_;
+        uint32_t max_;
+        uint32_t interval_;
+        uint8_t fast_;
+        uint8_t fast_left_;
+        uint32_t last_;
+};
+
+}  // namespace R51
+
+#endif  // _R51_VEHICLE_HEARTBEAT_H_
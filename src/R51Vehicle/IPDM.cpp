@@ -7,38 +7,61 @@
 namespace R51 {
 
 void IPDM::handle(const Message& msg) {
-    if (msg.type() != Message::CAN_FRAME ||
-            msg.can_frame().id() != 0x625 ||
-            msg.can_frame().size() < 6) {
-        return;
+    if (msg.type() == Message::CAN_FRAME) {
+        handle(FrameView(msg.can_frame()));
     }
+}
+
+bool IPDM::handle(const FrameView& frame) {
+    if (frame.id() != 0x625 || frame.size() < 6) {
+        return false;
+    }
+    // Publish the current value as soon as the IPDM returns.
+    bool changed = source_.received();
 
     uint8_t state = 0x00;
     // high beams
-    setBit(&state, 0, 0, getBit(msg.can_frame().data(), 1, 4));
+    setBit(&state, 0, 0, getBit(frame.data(), 1, 4));
     // low beams
-    setBit(&state, 0, 1, getBit(msg.can_frame().data(), 1, 5));
+    setBit(&state, 0, 1, getBit(frame.data(), 1, 5));
     // running lights
-    setBit(&state, 0, 2, getBit(msg.can_frame().data(), 1, 6));
+    setBit(&state, 0, 2, getBit(frame.data(), 1, 6));
     // fog lights
-    setBit(&state, 0, 3, getBit(msg.can_frame().data(), 1, 3));
+    setBit(&state, 0, 3, getBit(frame.data(), 1, 3));
     // defog heaters
-    setBit(&state, 0, 6, getBit(msg.can_frame().data(), 0, 0));
+    setBit(&state, 0, 6, getBit(frame.data(), 0, 0));
     // a/c compressor
-    setBit(&state, 0, 7, getBit(msg.can_frame().data(), 1, 7));
+    setBit(&state, 0, 7, getBit(frame.data(), 1, 7));
 
     if (state != event_.data[0]) {
         event_.data[0] = state;
-        changed_ = true;
+        changed = true;
     }
+    changed_ |= changed;
+    return changed;
 }
 
 void IPDM::emit(const Caster::Yield<Message>& yield) {
-    if (changed_ || ticker_.active()) {
-        ticker_.reset();
+    bool stale = source_.stale();
+    if (changed_ || (!suspended_ && !stale && heartbeat_.active())) {
+        if (changed_) {
+            heartbeat_.change();
+        }
+        heartbeat_.reset();
         yield(event_);
         changed_ = false;
     }
 }
 
+uint32_t IPDM::nextDeadline() {
+    if (changed_) {
+        return 0;
+    }
+    uint32_t next = source_.deadline();
+    if (!suspended_ && !source_.expired()) {
+        next = earliestDeadline(next, heartbeat_.deadline());
+    }
+    return next;
+}
+
 }  // namespace R51
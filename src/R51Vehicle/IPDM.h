@@ -5,26 +5,61 @@
 #include <Caster.h>
 #include <Faker.h>
 #include <R51Core.h>
+#include "Deadline.h"
+#include "Freshness.h"
+#include "Handler.h"
+#include "Heartbeat.h"
+#include "Node.h"
 
 namespace R51 {
 
-// Tracks IPDM state stored in the 0x625 CAN frame.
-class IPDM : public Caster::Node<Message> {
+// Expected broadcast period of the IPDM 0x625 frame in milliseconds.
+#ifndef IPDM_FRAME_PERIOD
+#define IPDM_FRAME_PERIOD 100
+#endif
+
+// Tracks IPDM state stored in the 0x625 CAN frame. Periodic re-emits stop
+// while the frame is stale.
+class IPDM : public VehicleNode, public Handler {
     public:
         IPDM(uint32_t tick_ms = 0, Faker::Clock* clock = Faker::Clock::real()) :
-            changed_(false), event_(Event::BODY_POWER_STATE, {0x00}), ticker_(tick_ms, clock) {}
+            changed_(false), suspended_(false), event_(Event::BODY_POWER_STATE, {0x00}), heartbeat_(tick_ms, clock),
+            source_(0x625, IPDM_FRAME_PERIOD, clock) {}
 
         // Handle a 0x625 IPDM state frame. Returns true if the state changed
         // as a result of handling the frame.
         void handle(const Message& msg) override;
 
+        // Handle a 0x625 state frame in place. Return true if the state
+        // changed.
+        bool handle(const FrameView& frame) override;
+
         // Yield a BODY_POWER_STATE frame on change or tick.
         void emit(const Caster::Yield<Message>& yield) override;
 
+        // Return the time until the next change or periodic re-emit is
+        // emitted or the 0x625 frame goes stale.
+        uint32_t nextDeadline() override;
+
+        // Suspend periodic re-emits while the vehicle sleeps.
+        void power(PowerMode mode) override { suspended_ = mode == POWER_SLEEP; }
+
+        // Back off periodic re-emits up to max_ms while the state holds.
+        // See Heartbeat.
+        void backoff(uint32_t max_ms, uint8_t fast = HEARTBEAT_FAST_COUNT) {
+            heartbeat_.backoff(max_ms, fast);
+        }
+
+        // Set the observer notified when the IPDM stops or resumes
+        // broadcasting 0x625.
+        void observer(FreshnessObserver* observer) { source_.observer(observer); }
+
     private:
         bool changed_;
+        bool suspended_;
         SystemEvent event_;
-        Ticker ticker_;
+        Heartbeat heartbeat_;
+        Freshness source_;
 };
 
 }  // namespace R51
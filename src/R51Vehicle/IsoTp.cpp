@@ -0,0 +1,277 @@
+#include "IsoTp.h"
+
+#include <Arduino.h>
+#include <Canny.h>
+#include <Faker.h>
+
+namespace R51 {
+namespace {
+
+// Protocol control information frame types.
+enum FrameType : uint8_t {
+    FRAME_SINGLE = 0x00,
+    FRAME_FIRST = 0x10,
+    FRAME_CONSECUTIVE = 0x20,
+    FRAME_FLOW_CONTROL = 0x30,
+};
+
+// Flow control status values.
+enum FlowStatus : uint8_t {
+    FLOW_CONTINUE = 0x00,
+    FLOW_WAIT = 0x01,
+    FLOW_OVERFLOW = 0x02,
+};
+
+// Time to wait for the next consecutive or flow control frame before a
+// message is abandoned (N_Cr and N_Bs).
+static const uint32_t TIMEOUT = 1000;
+
+// Convert an STmin value into milliseconds. Sub-millisecond values round
+// down to 0 and reserved values are treated as the maximum.
+uint32_t stMinMillis(uint8_t st_min) {
+    if (st_min <= 0x7F) {
+        return st_min;
+    } else if (st_min >= 0xF1 && st_min <= 0xF9) {
+        return 0;
+    }
+    return 0x7F;
+}
+
+}  // namespace
+
+IsoTp::IsoTp(uint32_t tx_id, uint32_t rx_id, uint8_t block_size,
+        uint8_t st_min, Faker::Clock* clock) :
+    tx_id_(tx_id), rx_id_(rx_id), clock_(clock),
+    block_size_(block_size), st_min_(st_min),
+    rx_state_(RX_IDLE), rx_seq_(0), rx_block_(0),
+    rx_size_(0), rx_pos_(0), rx_last_(0),
+    tx_state_(TX_IDLE), tx_seq_(0), tx_block_(0), tx_block_size_(0),
+    tx_st_min_(0), tx_size_(0), tx_pos_(0), tx_last_(0), tx_(nullptr) {}
+
+void IsoTp::flowControl(uint8_t block_size, uint8_t st_min) {
+    block_size_ = block_size;
+    st_min_ = st_min;
+}
+
+void IsoTp::reset() {
+    rx_state_ = RX_IDLE;
+    rx_size_ = 0;
+    tx_state_ = TX_IDLE;
+}
+
+bool IsoTp::handle(const FrameView& frame) {
+    if (frame.id() != rx_id_ || frame.size() < 1) {
+        return false;
+    }
+
+    const byte* data = frame.data();
+    switch (data[0] & 0xF0) {
+        case FRAME_SINGLE: {
+            size_t size = data[0] & 0x0F;
+            if (size == 0 || size > 7 || size >= frame.size()) {
+                return false;
+            }
+            memcpy(rx_, data + 1, size);
+            rx_size_ = size;
+            rx_state_ = RX_IDLE;
+            return true;
+        }
+        case FRAME_FIRST: {
+            if (frame.size() < 8) {
+                return false;
+            }
+            size_t size = ((data[0] & 0x0F) << 8) | data[1];
+            if (size < 8) {
+                return false;
+            }
+            if (size > ISOTP_RX_BUFFER_SIZE) {
+                rx_state_ = RX_OVERFLOW;
+                return false;
+            }
+            memcpy(rx_, data + 2, 6);
+            rx_size_ = size;
+            rx_pos_ = 6;
+            rx_seq_ = 1;
+            rx_block_ = 0;
+            rx_state_ = RX_FLOW_CONTROL;
+            return false;
+        }
+        case FRAME_CONSECUTIVE: {
+            if (rx_state_ != RX_CONSECUTIVE) {
+                return false;
+            }
+            if ((data[0] & 0x0F) != rx_seq_ ||
+                    clock_->millis() - rx_last_ > TIMEOUT) {
+                rx_state_ = RX_IDLE;
+                return false;
+            }
+            size_t size = rx_size_ - rx_pos_;
+            if (size > 7) {
+                size = 7;
+            }
+            if (size >= frame.size()) {
+                rx_state_ = RX_IDLE;
+                return false;
+            }
+            memcpy(rx_ + rx_pos_, data + 1, size);
+            rx_pos_ += size;
+            rx_seq_ = (rx_seq_ + 1) & 0x0F;
+            rx_last_ = clock_->millis();
+            if (rx_pos_ >= rx_size_) {
+                rx_state_ = RX_IDLE;
+                return true;
+            }
+            if (block_size_ > 0 && ++rx_block_ >= block_size_) {
+                rx_block_ = 0;
+                rx_state_ = RX_FLOW_CONTROL;
+            }
+            return false;
+        }
+        case FRAME_FLOW_CONTROL:
+            handleFlowControl(data);
+            return false;
+        default:
+            return false;
+    }
+}
+
+void IsoTp::handleFlowControl(const byte* data) {
+    if (tx_state_ != TX_WAIT) {
+        return;
+    }
+    switch (data[0] & 0x0F) {
+        case FLOW_CONTINUE:
+            tx_block_size_ = data[1];
+            tx_st_min_ = stMinMillis(data[2]);
+            tx_block_ = 0;
+            // allow the next consecutive frame to be sent immediately
+            tx_last_ = clock_->millis() - tx_st_min_;
+            tx_state_ = TX_CONSECUTIVE;
+            break;
+        case FLOW_WAIT:
+            tx_last_ = clock_->millis();
+            break;
+        case FLOW_OVERFLOW:
+        default:
+            tx_state_ = TX_IDLE;
+            break;
+    }
+}
+
+bool IsoTp::send(const byte* data, size_t size) {
+    if (tx_state_ != TX_IDLE || size == 0 || size > 0xFFF) {
+        return false;
+    }
+    tx_ = data;
+    tx_size_ = size;
+    tx_state_ = size <= 7 ? TX_SINGLE : TX_FIRST;
+    return true;
+}
+
+bool IsoTp::read(Canny::Frame* frame) {
+    return readTo(frame);
+}
+
+bool IsoTp::read(FrameSlot* slot) {
+    return readTo(slot);
+}
+
+template <typename F>
+bool IsoTp::readTo(F* frame) {
+    switch (rx_state_) {
+        case RX_FLOW_CONTROL: {
+            byte fc[] = {(byte)(FRAME_FLOW_CONTROL | FLOW_CONTINUE), block_size_, st_min_};
+            fillFrame(frame, fc, sizeof(fc), nullptr, 0);
+            rx_last_ = clock_->millis();
+            rx_state_ = RX_CONSECUTIVE;
+            return true;
+        }
+        case RX_OVERFLOW: {
+            byte fc[] = {(byte)(FRAME_FLOW_CONTROL | FLOW_OVERFLOW), 0x00, 0x00};
+            fillFrame(frame, fc, sizeof(fc), nullptr, 0);
+            rx_state_ = RX_IDLE;
+            return true;
+        }
+        default:
+            break;
+    }
+
+    switch (tx_state_) {
+        case TX_SINGLE: {
+            byte pci = FRAME_SINGLE | tx_size_;
+            fillFrame(frame, &pci, 1, tx_, tx_size_);
+            tx_state_ = TX_IDLE;
+            return true;
+        }
+        case TX_FIRST: {
+            byte pci[] = {(byte)(FRAME_FIRST | (tx_size_ >> 8)), (byte)(tx_size_ & 0xFF)};
+            fillFrame(frame, pci, sizeof(pci), tx_, 6);
+            tx_pos_ = 6;
+            tx_seq_ = 1;
+            tx_last_ = clock_->millis();
+            tx_state_ = TX_WAIT;
+            return true;
+        }
+        case TX_WAIT:
+            if (clock_->millis() - tx_last_ > TIMEOUT) {
+                tx_state_ = TX_IDLE;
+            }
+            return false;
+        case TX_CONSECUTIVE: {
+            if (clock_->millis() - tx_last_ < tx_st_min_) {
+                return false;
+            }
+            size_t size = tx_size_ - tx_pos_;
+            if (size > 7) {
+                size = 7;
+            }
+            byte pci = FRAME_CONSECUTIVE | tx_seq_;
+            fillFrame(frame, &pci, 1, tx_ + tx_pos_, size);
+            tx_pos_ += size;
+            tx_seq_ = (tx_seq_ + 1) & 0x0F;
+            tx_last_ = clock_->millis();
+            if (tx_pos_ >= tx_size_) {
+                tx_state_ = TX_IDLE;
+            } else if (tx_block_size_ > 0 && ++tx_block_ >= tx_block_size_) {
+                tx_state_ = TX_WAIT;
+            }
+            return true;
+        }
+        case TX_IDLE:
+        default:
+            return false;
+    }
+}
+
+uint32_t IsoTp::deadline() const {
+    if (rx_state_ == RX_FLOW_CONTROL || rx_state_ == RX_OVERFLOW) {
+        return 0;
+    }
+    switch (tx_state_) {
+        case TX_SINGLE:
+        case TX_FIRST:
+            return 0;
+        case TX_WAIT:
+            // read() abandons the message once the timeout is exceeded.
+            return deadlineAfter(clock_->millis(), tx_last_, TIMEOUT + 1);
+        case TX_CONSECUTIVE:
+            return deadlineAfter(clock_->millis(), tx_last_, tx_st_min_);
+        case TX_IDLE:
+        default:
+            return DEADLINE_NONE;
+    }
+}
+
+template <typename F>
+void IsoTp::fillFrame(F* frame, const byte* pci, size_t pci_size,
+        const byte* data, size_t size) {
+    frame->id(tx_id_, 0);
+    frame->resize(8);
+    memcpy(frame->data(), pci, pci_size);
+    if (size > 0) {
+        memcpy(frame->data() + pci_size, data, size);
+    }
+    memset(frame->data() + pci_size + size, 0xFF, 8 - pci_size - size);
+}
+
+}  // namespace R51
@@ -0,0 +1,121 @@
+#ifndef _R51_VEHICLE_ISO_TP_H_
+#define _R51_VEHICLE_ISO_TP_H_
+
+#include <Arduino.h>
+#include <Canny.h>
+#include <Faker.h>
+#include "Controller.h"
+#include "Deadline.h"
+#include "Handler.h"
+
+namespace R51 {
+
+// Size of the receive buffer. Received messages longer than this are
+// rejected with an overflow flow control frame.
+#ifndef ISOTP_RX_BUFFER_SIZE
+#define ISOTP_RX_BUFFER_SIZE 64
+#endif
+
+// ISO 15765-2 transport over a pair of CAN IDs. Outgoing messages are
+// segmented into single, first, and consecutive frames. Incoming segmented
+// messages are reassembled directly into a fixed receive buffer and flow
+// control frames are generated as needed. Frames are padded to 8 bytes with
+// 0xFF.
+class IsoTp {
+    public:
+        // Construct a transport which sends on tx_id and receives on rx_id.
+        // The block size and minimum separation time (STmin) are advertised
+        // to the sender in flow control frames.
+        IsoTp(uint32_t tx_id, uint32_t rx_id, uint8_t block_size = 0,
+                uint8_t st_min = 0x0A, Faker::Clock* clock = Faker::Clock::real());
+
+        // Set the block size and STmin advertised in flow control frames.
+        void flowControl(uint8_t block_size, uint8_t st_min);
+
+        // Handle an incoming frame. Return true if the frame completed a
+        // message. The message is available through data() and size() until
+        // the next call to handle().
+        bool handle(const FrameView& frame);
+        bool handle(const Canny::Frame& frame) { return handle(FrameView(frame)); }
+
+        // Queue a message for sending. The data is not copied and must
+        // remain valid until idle() returns true. Return false if a message
+        // is already being sent or the message is too large.
+        bool send(const byte* data, size_t size);
+
+        // Fill frame with the next outgoing frame if one is due. Return true
+        // if the frame should be sent.
+        bool read(Canny::Frame* frame);
+
+        // Encode the next outgoing frame into a driver transmit slot if one
+        // is due. Return true if the slot should be sent.
+        bool read(FrameSlot* slot);
+
+        // Return the time in milliseconds until read() next has a frame or
+        // timeout to process. Return 0 if a frame is due now and
+        // DEADLINE_NONE if nothing is pending.
+        uint32_t deadline() const;
+
+        // Return true if no outgoing message is pending.
+        bool idle() const { return tx_state_ == TX_IDLE; }
+
+        // Return the most recently received message.
+        const byte* data() const { return rx_; }
+        size_t size() const { return rx_size_; }
+
+        // Abort any messages in progress.
+        void reset();
+
+    private:
+        enum RxState : uint8_t {
+            RX_IDLE,
+            RX_FLOW_CONTROL,
+            RX_OVERFLOW,
+            RX_CONSECUTIVE,
+        };
+
+        enum TxState : uint8_t {
+            TX_IDLE,
+            TX_SINGLE,
+            TX_FIRST,
+            TX_WAIT,
+            TX_CONSECUTIVE,
+        };
+
+        const uint32_t tx_id_;
+        const uint32_t rx_id_;
+        Faker::Clock* clock_;
+        uint8_t block_size_;
+        uint8_t st_min_;
+
+        RxState rx_state_;
+        uint8_t rx_seq_;
+        uint8_t rx_block_;
+        size_t rx_size_;
+        size_t rx_pos_;
+        uint32_t rx_last_;
+        byte rx_[ISOTP_RX_BUFFER_SIZE];
+
+        TxState tx_state_;
+        uint8_t tx_seq_;
+        uint8_t tx_block_;
+        uint8_t tx_block_size_;
+        uint32_t tx_st_min_;
+        size_t tx_size_;
+        size_t tx_pos_;
+        uint32_t tx_last_;
+        const byte* tx_;
+
+        template <typename F>
+        bool readTo(F* frame);
+
+        void handleFlowControl(const byte* data);
+
+        template <typename F>
+        void fillFrame(F* frame, const byte* pci, size_t pci_size,
+                const byte* data, size_t size);
+};
+
+}  // namespace R51
+
+#endif  // _R51_VEHICLE_ISO_TP_H_
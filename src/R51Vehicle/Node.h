@@ -0,0 +1,44 @@
+#ifndef _R51_VEHICLE_NODE_H_
+#define _R51_VEHICLE_NODE_H_
+
+#include <Arduino.h>
+#include <Caster.h>
+#include <R51Core.h>
+#include "Units.h"
+
+namespace R51 {
+
+// Returned by nextDeadline() when a node has no time driven work scheduled.
+static const uint32_t DEADLINE_NONE = 0xFFFFFFFF;
+
+// Vehicle power modes.
+enum PowerMode : uint8_t {
+    // The bus is silent.
+    POWER_SLEEP = 0,
+    // Body modules are broadcasting but the ignition is off.
+    POWER_AWAKE = 1,
+    // The ECM is broadcasting.
+    POWER_IGNITION = 2,
+};
+
+// Base of the vehicle nodes. Adds the scheduling, power, and units hooks to
+// the Caster node so a node carries a single vtable whichever it overrides.
+class VehicleNode : public Caster::Node<Message> {
+    public:
+        // Return the time in milliseconds until emit() next has work to do.
+        // Return 0 if work is due now and DEADLINE_NONE if nothing is
+        // scheduled. Handling a message may move the deadline earlier.
+        virtual uint32_t nextDeadline() { return DEADLINE_NONE; }
+
+        // Called when the vehicle power mode changes. Nodes which suspend
+        // periodic work while the vehicle sleeps override this.
+        virtual void power(PowerMode) {}
+
+        // Called to set the units published by the node. Affected state is
+        // re-published on the next emit.
+        virtual void units(Units) {}
+};
+
+}  // namespace R51
+
+#endif  // _R51_VEHICLE_NODE_H_
@@ -0,0 +1,103 @@
+#ifndef _R51_VEHICLE_PIPELINE_H_
+#define _R51_VEHICLE_PIPELINE_H_
+
+#include <Arduino.h>
+#include <Caster.h>
+#include <R51Core.h>
+#include "Deadline.h"
+#include "Node.h"
+#include "Units.h"
+
+namespace R51 {
+
+// Compile-time list of nodes used by VehicleNodes. Each node is called
+// through its concrete type so calls are not virtual and may be inlined.
+template <typename... Nodes>
+class VehicleNodeList;
+
+template <>
+class VehicleNodeList<> {
+    public:
+        void handle(const Message&) {}
+        void emit(const Caster::Yield<Message>&) {}
+        uint32_t nextDeadline() { return DEADLINE_NONE; }
+        void power(PowerMode) {}
+        void units(Units) {}
+};
+
+template <typename Head, typename... Tail>
+class VehicleNodeList<Head, Tail...> {
+    public:
+        VehicleNodeList(Head& head, Tail&... tail) : head_(head), tail_(tail...) {}
+
+        void handle(const Message& msg) {
+            head_.Head::handle(msg);
+            tail_.handle(msg);
+        }
+
+        void emit(const Caster::Yield<Message>& yield) {
+            head_.Head::emit(yield);
+            tail_.emit(yield);
+        }
+
+        uint32_t nextDeadline() {
+            return earliestDeadline(head_.Head::nextDeadline(), tail_.nextDeadline());
+        }
+
+        void power(PowerMode mode) {
+            head_.Head::power(mode);
+            tail_.power(mode);
+        }
+
+        void units(Units units) {
+            head_.Head::units(units);
+            tail_.units(units);
+        }
+
+    private:
+        Head& head_;
+        VehicleNodeList<Tail...> tail_;
+};
+
+// Drives a fixed set of vehicle nodes as a single node. Each message is
+// passed to every node and every node is emitted in the order given. The
+// node types are known at compile time so the per-node handle and emit calls
+// bypass virtual dispatch and their frame ID checks can be inlined.
+//
+// Messages emitted by one node are not delivered to the others in the same
+// set. Vehicle nodes only consume vehicle frames and external events so this
+// matches driving each node separately. The set is itself a vehicle node:
+// its deadline is the earliest of its nodes' and power and units changes
+// are passed to every node.
+//
+// Example:
+//   Climate climate;
+//   IPDM ipdm;
+//   VehicleNodes<Climate, IPDM> vehicle(climate, ipdm);
+template <typename... Nodes>
+class VehicleNodes : public VehicleNode {
+    public:
+        VehicleNodes(Nodes&... nodes) : nodes_(nodes...) {}
+
+        // Pass the message to each node.
+        void handle(const Message& msg) override { nodes_.handle(msg); }
+
+        // Emit each node in order.
+        void emit(const Caster::Yield<Message>& yield) override { nodes_.emit(yield); }
+
+        // Return the earliest deadline of the nodes.
+        uint32_t nextDeadline() override { return nodes_.nextDeadline(); }
+
+        // Pass the power mode to each node in order.
+        void power(PowerMode mode) override { nodes_.power(mode); }
+
+        // Pass the units to each node in order.
+        void units(Units units) override { nodes_.units(units); }
+
+    private:
+        VehicleNodeList<Nodes...> nodes_;
+};
+
+}  // namespace R51
+
+#endif  // _R51_VEHICLE_PIPELINE_H_
@@ -0,0 +1,87 @@
+#include "Power.h"
+
+#include <Arduino.h>
+#include <Canny.h>
+#include <Caster.h>
+#include <Faker.h>
+#include <R51Core.h>
+
+namespace R51 {
+
+bool PowerManager::attach(VehicleNode* node) {
+    if (nodes_count_ >= POWER_MAX_NODES) {
+        return false;
+    }
+    nodes_[nodes_count_++] = node;
+    node->power(mode_);
+    return true;
+}
+
+void PowerManager::handle(const Message& msg) {
+    if (msg.type() == Message::CAN_FRAME) {
+        handle(FrameView(msg.can_frame()));
+    }
+}
+
+bool PowerManager::handle(const FrameView& frame) {
+    switch (frame.id()) {
+        case 0x551:
+            last_ignition_ = clock_->millis();
+            ignition_seen_ = true;
+            // fall through
+        case 0x54A:
+        case 0x54B:
+        case 0x625:
+        case 0x385:
+            last_traffic_ = clock_->millis();
+            traffic_seen_ = true;
+            return true;
+        default:
+            return false;
+    }
+}
+
+PowerMode PowerManager::observe(uint32_t now) const {
+    if (ignition_seen_ && now - last_ignition_ < POWER_IGNITION_TIMEOUT) {
+        return POWER_IGNITION;
+    } else if (traffic_seen_ && now - last_traffic_ < POWER_SLEEP_TIMEOUT) {
+        return POWER_AWAKE;
+    }
+    return POWER_SLEEP;
+}
+
+void PowerManager::emit(const Caster::Yield<Message>&) {
+    PowerMode mode = observe(clock_->millis());
+    if (mode == mode_) {
+        return;
+    }
+    mode_ = mode;
+
+    if (mode == POWER_SLEEP) {
+        for (size_t i = nodes_count_; i > 0; --i) {
+            nodes_[i - 1]->power(mode);
+        }
+    } else {
+        for (size_t i = 0; i < nodes_count_; ++i) {
+            nodes_[i]->power(mode);
+        }
+    }
+}
+
+uint32_t PowerManager::nextDeadline() {
+    uint32_t now = clock_->millis();
+    if (observe(now) != mode_) {
+        return 0;
+    }
+    switch (mode_) {
+        case POWER_IGNITION:
+            return deadlineAfter(now, last_ignition_, POWER_IGNITION_TIMEOUT);
+        case POWER_AWAKE:
+            return deadlineAfter(now, last_traffic_, POWER_SLEEP_TIMEOUT);
+        case POWER_SLEEP:
+        default:
+            return DEADLINE_NONE;
+    }
+}
+
+}  // namespace R51
@@ -0,0 +1,84 @@
+#ifndef _R51_VEHICLE_POWER_H_
+#define _R51_VEHICLE_POWER_H_
+
+#include <Arduino.h>
+#include <Canny.h>
+#include <Caster.h>
+#include <Faker.h>
+#include <R51Core.h>
+#include "Deadline.h"
+#include "Handler.h"
+#include "Node.h"
+
+namespace R51 {
+
+// Time in milliseconds without vehicle broadcasts after which the vehicle is
+// considered asleep.
+#ifndef POWER_SLEEP_TIMEOUT
+#define POWER_SLEEP_TIMEOUT 3000
+#endif
+
+// Time in milliseconds without ECM broadcasts after which the ignition is
+// considered off.
+#ifndef POWER_IGNITION_TIMEOUT
+#define POWER_IGNITION_TIMEOUT 1000
+#endif
+
+// Maximum number of nodes managed by a power manager.
+#ifndef POWER_MAX_NODES
+#define POWER_MAX_NODES 8
+#endif
+
+// Follows vehicle power from body module broadcasts and notifies attached
+// nodes when the power mode changes. Only periodic vehicle broadcasts (0x54A,
+// 0x54B, 0x551, 0x625, and 0x385) are considered so frames sent by our own
+// nodes do not keep the vehicle awake. The ignition is considered on while
+// the ECM broadcasts 0x551.
+//
+// Nodes are woken in the order they were attached and put to sleep in the
+// reverse order.
+class PowerManager : public VehicleNode, public Handler {
+    public:
+        PowerManager(Faker::Clock* clock = Faker::Clock::real()) :
+            clock_(clock), mode_(POWER_SLEEP), nodes_count_(0),
+            last_traffic_(0), last_ignition_(0),
+            traffic_seen_(false), ignition_seen_(false) {}
+
+        // Attach a node. The node is immediately notified of the current
+        // power mode. Return false if the manager is full.
+        bool attach(VehicleNode* node);
+
+        // Track vehicle broadcasts.
+        void handle(const Message& msg) override;
+
+        // Track a vehicle broadcast in place. Return true if the frame is a
+        // vehicle broadcast.
+        bool handle(const FrameView& frame) override;
+
+        // Notify attached nodes of power mode changes. Nothing is yielded.
+        void emit(const Caster::Yield<Message>& yield) override;
+
+        // Return the time until the power mode next changes if no further
+        // broadcasts are received.
+        uint32_t nextDeadline() override;
+
+        // Return the current power mode.
+        PowerMode mode() const { return mode_; }
+
+    private:
+        Faker::Clock* clock_;
+        PowerMode mode_;
+        VehicleNode* nodes_[POWER_MAX_NODES];
+        size_t nodes_count_;
+        uint32_t last_traffic_;
+        uint32_t last_ignition_;
+        bool traffic_seen_;
+        bool ignition_seen_;
+
+        // Return the power mode indicated by the broadcasts seen so far.
+        PowerMode observe(uint32_t now) const;
+};
+
+}  // namespace R51
+
+#endif  // _R51_VEHICLE_POWER_H_
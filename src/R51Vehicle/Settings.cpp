@@ -7,11 +7,8 @@
 namespace R51 {
 namespace {
 
-// Valid frame IDs for settings.
-enum SettingsFrameId : uint32_t {
-    SETTINGS_FRAME_E = 0x71E,
-    SETTINGS_FRAME_F = 0x71F,
-};
+// Time in milliseconds a sequence waits for a response before failing.
+static const uint32_t SEQUENCE_TIMEOUT = 500;
 
 // Available sequence states. States other than "ready" represent a frame which
 // is sent on the bus which requires a specific response.
@@ -29,30 +26,62 @@ enum State : uint8_t {
     STATE_INIT_40,
     STATE_INIT_60,
 
-    // Settings requests.
-    STATE_AUTO_INTERIOR_ILLUM,
-    STATE_AUTO_HL_SENS,
-    STATE_AUTO_HL_DELAY,
-    STATE_SPEED_SENS_WIPER,
-    STATE_REMOTE_KEY_HORN,
-    STATE_REMOTE_KEY_LIGHT,
-    STATE_AUTO_RELOCK_TIME,
-    STATE_SELECT_DOOR_UNLOCK,
-    STATE_SLIDE_DRIVER_SEAT,
-    STATE_RETRIEVE_71E_10,
-    STATE_RETRIEVE_71E_2X,
-    STATE_RETRIEVE_71F_05,
+    STATE_RETRIEVE,
     STATE_RESET,
+
+    // Settings update requests. The update request for a setting is
+    // STATE_SETTING plus the slot of the setting's descriptor.
+    STATE_SETTING,
 };
 
-// Available Remote Key Response Lights values.
-enum RemoteKeyResponseLights : uint8_t {
-    LIGHTS_OFF = 0,
-    LIGHTS_UNLOCK = 1,
-    LIGHTS_LOCK = 2,
-    LIGHTS_ON = 3,
+// Setting indexes. Each setting's SettingsFeature flag is 1 << index.
+enum SettingIndex : uint8_t {
+    SETTING_AUTO_INTERIOR_ILLUMINATION,
+    SETTING_AUTO_HEADLIGHT_SENSITIVITY,
+    SETTING_AUTO_HEADLIGHT_OFF_DELAY,
+    SETTING_SPEED_SENSING_WIPER_INTERVAL,
+    SETTING_REMOTE_KEY_RESPONSE_HORN,
+    SETTING_REMOTE_KEY_RESPONSE_LIGHTS,
+    SETTING_AUTO_RELOCK_TIME,
+    SETTING_SELECTIVE_DOOR_UNLOCK,
+    SETTING_SLIDE_DRIVER_SEAT_BACK_ON_EXIT,
+    SETTING_COUNT,
 };
 
+static_assert(SETTINGS_FEATURE_SLIDE_DRIVER_SEAT_BACK_ON_EXIT ==
+        1 << SETTING_SLIDE_DRIVER_SEAT_BACK_ON_EXIT,
+        "setting indexes must match feature flags");
+
+// Return true if the setting is compiled in.
+constexpr bool settingEnabled(uint8_t setting) {
+    return settingsEnabled(1 << setting);
+}
+
+// Return true if the setting is stored on the 0x71F channel.
+constexpr bool settingChannelF(uint8_t setting) {
+    return ((1 << setting) & SETTINGS_FEATURE_CHANNEL_F) != 0;
+}
+
+// Return the number of enabled settings with an index below the setting.
+// This is the position of an enabled setting's descriptor in SettingTable.
+constexpr uint8_t settingSlot(uint8_t setting) {
+    return setting == 0 ? 0 :
+        settingSlot(setting - 1) + (settingEnabled(setting - 1) ? 1 : 0);
+}
+
+// Number of settings compiled in.
+static const uint8_t SETTING_SLOTS = settingSlot(SETTING_COUNT);
+
+// Number of states.
+static const uint8_t STATE_COUNT = STATE_SETTING + SETTING_SLOTS;
+
+// Return the index of the enabled setting at the given slot.
+constexpr uint8_t slotSetting(uint8_t slot, uint8_t setting = 0) {
+    return setting >= SETTING_COUNT ? (uint8_t)SETTING_COUNT :
+        !settingEnabled(setting) ? slotSetting(slot, setting + 1) :
+        slot == 0 ? setting : slotSetting(slot - 1, setting + 1);
+}
+
 // Available Auto Headlight Off Delay values.
 enum AutoHeadlightOffDelay : uint8_t {
     DELAY_0S = 0,
@@ -72,505 +101,437 @@ enum AutoReLockTime : uint8_t {
     RELOCK_5M = 5,
 };
 
-// Return the ID of the response frame for the given settings request frame.
-uint32_t responseId(uint32_t request_id) {
-    return (request_id & ~0x010) | 0x020;
-}
+// Describes the request sent for a state. The response to a request echoes
+// the command with 0x40 added to the service byte.
+struct RequestDescriptor {
+    byte service;
+    byte command;
+    // Payload size. Requests with a size of 3 carry a value.
+    uint8_t size;
+};
 
-// Fill a settings frame with a payload.
-bool fillRequest(Canny::Frame* frame, uint32_t id, byte prefix0, byte prefix1, byte prefix2, uint8_t value = 0xFF) {
-    frame->id(id, 0);
-    frame->resize(8);
-    frame->data()[0] = prefix0;
-    frame->data()[1] = prefix1;
-    frame->data()[2] = prefix2;
-    frame->data()[3] = value;
-    memset(frame->data()+4, 0xFF, 4);
-    return true;
-}
+// Describes how a setting is encoded in BCM messages and in the
+// SETTINGS_STATE event. A setting has an ordered list of values. Each value
+// has a wire encoding used in BCM requests and responses and a logical
+// encoding stored in the event.
+struct SettingDescriptor {
+    // Command of the request which updates the setting.
+    byte command;
+
+    // Location of the value in the BCM state response. The value is read
+    // from the big endian word starting at response_byte so that it may span
+    // two bytes.
+    uint8_t response_byte;
+    uint8_t response_shift;
+    uint8_t response_mask;
+
+    // Location of the value in the SETTINGS_STATE event.
+    uint8_t event_byte;
+    uint8_t event_shift;
+    uint8_t event_mask;
+
+    // Number of values and whether stepping past either end wraps around.
+    uint8_t count;
+    bool wrap;
+
+    // Wire and logical values in order. decode maps each wire value in
+    // response_mask to its index, or 0xFF if the value is not valid.
+    const uint8_t* wire;
+    const uint8_t* logical;
+    const uint8_t* decode;
+};
 
-// Fill a settings frame with data to be sent when the sequence transitions to
-// the given state. Some state transitions require value be attached.
-bool fillRequest(Canny::Frame* frame, uint32_t id, uint8_t state, uint8_t value = 0xFF) {
-    switch (state) {
-        case STATE_READY:
-            return false;
-        case STATE_ENTER:
-            return fillRequest(frame, id, 0x02, 0x10, 0xC0);
-        case STATE_EXIT:
-            return fillRequest(frame, id, 0x02, 0x10, 0x81);
-        case STATE_INIT_00:
-            return fillRequest(frame, id, 0x02, 0x3B, 0x00);
-        case STATE_INIT_20:
-            return fillRequest(frame, id, 0x02, 0x3B, 0x20);
-        case STATE_INIT_40:
-            return fillRequest(frame, id, 0x02, 0x3B, 0x40);
-        case STATE_INIT_60:
-            return fillRequest(frame, id, 0x02, 0x3B, 0x60);
-        case STATE_AUTO_INTERIOR_ILLUM:
-            return fillRequest(frame, id, 0x03, 0x3B, 0x10, value);
-        case STATE_AUTO_HL_SENS:
-            return fillRequest(frame, id, 0x03, 0x3B, 0x37, value);
-        case STATE_AUTO_HL_DELAY:
-            return fillRequest(frame, id, 0x03, 0x3B, 0x39, value);
-        case STATE_SPEED_SENS_WIPER:
-            return fillRequest(frame, id, 0x03, 0x3B, 0x47, value);
-        case STATE_REMOTE_KEY_HORN:
-            return fillRequest(frame, id, 0x03, 0x3B, 0x2A, value);
-        case STATE_REMOTE_KEY_LIGHT:
-            return fillRequest(frame, id, 0x03, 0x3B, 0x2E, value);
-        case STATE_AUTO_RELOCK_TIME:
-            return fillRequest(frame, id, 0x03, 0x3B, 0x2F, value);
-        case STATE_SELECT_DOOR_UNLOCK:
-            return fillRequest(frame, id, 0x03, 0x3B, 0x02, value);
-        case STATE_SLIDE_DRIVER_SEAT:
-            return fillRequest(frame, id, 0x03, 0x3B, 0x01, value);
-        case STATE_RETRIEVE_71E_10:
-            return fillRequest(frame, id, 0x02, 0x21, 0x01);
-        case STATE_RETRIEVE_71E_2X:
-            return fillRequest(frame, id, 0x30, 0x00, 0x0A);
-        case STATE_RETRIEVE_71F_05:
-            return fillRequest(frame, id, 0x02, 0x21, 0x01);
-        case STATE_RESET:
-            return fillRequest(frame, id, 0x03, 0x3B, 0x1F, 0x00);
-        default:
-            return false;
-    }
-}
+static const uint8_t VALUES_BOOL[] PROGMEM = {0, 1};
+static const uint8_t VALUES_BOOL_INVERTED[] PROGMEM = {1, 0};
+static const uint8_t VALUES_0_TO_3[] PROGMEM = {0, 1, 2, 3};
+
+static const uint8_t SENSITIVITY_WIRE[] PROGMEM = {0x03, 0x00, 0x01, 0x02};
+static const uint8_t SENSITIVITY_DECODE[] PROGMEM = {1, 2, 3, 0};
+
+static const uint8_t OFF_DELAY_WIRE[] PROGMEM = {
+    0x01, 0x02, 0x00, 0x03, 0x04, 0x05, 0x06, 0x07};
+static const uint8_t OFF_DELAY_LOGICAL[] PROGMEM = {
+    DELAY_0S, DELAY_30S, DELAY_45S, DELAY_60S,
+    DELAY_90S, DELAY_120S, DELAY_150S, DELAY_180S};
+static const uint8_t OFF_DELAY_DECODE[] PROGMEM = {2, 0, 1, 3, 4, 5, 6, 7};
+
+static const uint8_t RELOCK_WIRE[] PROGMEM = {0x01, 0x00, 0x02};
+static const uint8_t RELOCK_LOGICAL[] PROGMEM = {RELOCK_OFF, RELOCK_1M, RELOCK_5M};
+static const uint8_t RELOCK_DECODE[] PROGMEM = {1, 0, 2, 0xFF};
+
+// Return the descriptor of a setting.
+constexpr SettingDescriptor describeSetting(uint8_t setting) {
+    return setting == SETTING_AUTO_INTERIOR_ILLUMINATION ?
+            SettingDescriptor{0x10, 1, 5, 0x01, 0, 0, 0x01, 2, true,
+                VALUES_BOOL, VALUES_BOOL, VALUES_BOOL} :
+        setting == SETTING_AUTO_HEADLIGHT_SENSITIVITY ?
+            SettingDescriptor{0x37, 6, 2, 0x03, 1, 0, 0x03, 4, false,
+                SENSITIVITY_WIRE, VALUES_0_TO_3, SENSITIVITY_DECODE} :
+        setting == SETTING_AUTO_HEADLIGHT_OFF_DELAY ?
+            SettingDescriptor{0x39, 7, 6, 0x07, 1, 4, 0x0F, 8, false,
+                OFF_DELAY_WIRE, OFF_DELAY_LOGICAL, OFF_DELAY_DECODE} :
+        setting == SETTING_SPEED_SENSING_WIPER_INTERVAL ?
+            SettingDescriptor{0x47, 12, 7, 0x01, 0, 2, 0x01, 2, true,
+                VALUES_BOOL_INVERTED, VALUES_BOOL, VALUES_BOOL_INVERTED} :
+        setting == SETTING_REMOTE_KEY_RESPONSE_HORN ?
+            SettingDescriptor{0x2A, 4, 3, 0x01, 3, 0, 0x01, 2, true,
+                VALUES_BOOL, VALUES_BOOL, VALUES_BOOL} :
+        setting == SETTING_REMOTE_KEY_RESPONSE_LIGHTS ?
+            SettingDescriptor{0x2E, 5, 6, 0x03, 3, 2, 0x03, 4, false,
+                VALUES_0_TO_3, VALUES_0_TO_3, VALUES_0_TO_3} :
+        setting == SETTING_AUTO_RELOCK_TIME ?
+            SettingDescriptor{0x2F, 5, 4, 0x03, 2, 4, 0x0F, 3, false,
+                RELOCK_WIRE, RELOCK_LOGICAL, RELOCK_DECODE} :
+        setting == SETTING_SELECTIVE_DOOR_UNLOCK ?
+            SettingDescriptor{0x02, 1, 7, 0x01, 2, 0, 0x01, 2, true,
+                VALUES_BOOL, VALUES_BOOL, VALUES_BOOL} :
+            SettingDescriptor{0x01, 1, 0, 0x01, 0, 1, 0x01, 2, true,
+                VALUES_BOOL, VALUES_BOOL, VALUES_BOOL};
+}
+
+// Requests indexed by state and descriptors indexed by slot for the enabled
+// settings. Disabled settings and the values only they reference are not
+// compiled in.
+template <uint8_t... slot>
+struct SettingTable {
+    static const RequestDescriptor requests[STATE_SETTING + sizeof...(slot)];
+    static const SettingDescriptor descriptors[sizeof...(slot) > 0 ? sizeof...(slot) : 1];
+};
 
-// Match the frame against the given byte prefix.
-bool matchPrefix(const byte* data, byte prefix0) {
-    return data[0] == prefix0;
-}
+template <uint8_t... slot>
+const RequestDescriptor SettingTable<slot...>::requests[
+        STATE_SETTING + sizeof...(slot)] PROGMEM = {
+    {0x00, 0x00, 0},  // STATE_READY
+    {0x10, 0xC0, 2},  // STATE_ENTER
+    {0x10, 0x81, 2},  // STATE_EXIT
+    {0x3B, 0x00, 2},  // STATE_INIT_00
+    {0x3B, 0x20, 2},  // STATE_INIT_20
+    {0x3B, 0x40, 2},  // STATE_INIT_40
+    {0x3B, 0x60, 2},  // STATE_INIT_60
+    {0x21, 0x01, 2},  // STATE_RETRIEVE
+    {0x3B, 0x1F, 3},  // STATE_RESET
+    // STATE_SETTING + slot
+    {0x3B, describeSetting(slotSetting(slot)).command, 3}...
+};
 
-// Match the frame against the given byte prefix.
-bool matchPrefix(const byte* data, byte prefix0, byte prefix1, byte prefix2) {
-    return data[0] == prefix0 && data[1] == prefix1 && data[2] == prefix2;
-}
+template <uint8_t... slot>
+const SettingDescriptor SettingTable<slot...>::descriptors[
+        sizeof...(slot) > 0 ? sizeof...(slot) : 1] PROGMEM = {
+    describeSetting(slotSetting(slot))...
+};
 
-// Return true if the frame matches the given state.
-bool matchState(const byte* data, uint8_t state) {
-    switch (state) {
-        case STATE_READY:
-            return false;
-        case STATE_ENTER:
-            return matchPrefix(data, 0x02, 0x50, 0xC0);
-        case STATE_EXIT:
-            return matchPrefix(data, 0x02, 0x50, 0x81);
-        case STATE_INIT_00:
-            return matchPrefix(data, 0x06, 0x7B, 0x00);
-        case STATE_INIT_20:
-            return matchPrefix(data, 0x06, 0x7B, 0x20);
-        case STATE_INIT_40:
-            return matchPrefix(data, 0x06, 0x7B, 0x40);
-        case STATE_INIT_60:
-            return matchPrefix(data, 0x06, 0x7B, 0x60);
-        case STATE_AUTO_INTERIOR_ILLUM:
-            return matchPrefix(data, 0x02, 0x7B, 0x10);
-        case STATE_AUTO_HL_SENS:
-            return matchPrefix(data, 0x02, 0x7B, 0x37);
-        case STATE_AUTO_HL_DELAY:
-            return matchPrefix(data, 0x02, 0x7B, 0x39);
-        case STATE_SPEED_SENS_WIPER:
-            return matchPrefix(data, 0x02, 0x7B, 0x47);
-        case STATE_REMOTE_KEY_HORN:
-            return matchPrefix(data, 0x02, 0x7B, 0x2A);
-        case STATE_REMOTE_KEY_LIGHT:
-            return matchPrefix(data, 0x02, 0x7B, 0x2E);
-        case STATE_AUTO_RELOCK_TIME:
-            return matchPrefix(data, 0x02, 0x7B, 0x2F);
-        case STATE_SELECT_DOOR_UNLOCK:
-            return matchPrefix(data, 0x02, 0x7B, 0x02);
-        case STATE_SLIDE_DRIVER_SEAT:
-            return matchPrefix(data, 0x02, 0x7B, 0x01);
-        case STATE_RETRIEVE_71E_10:
-            return matchPrefix(data, 0x10);
-        case STATE_RETRIEVE_71E_2X:
-            return matchPrefix(data, 0x21) || matchPrefix(data, 0x22);
-        case STATE_RETRIEVE_71F_05:
-            return matchPrefix(data, 0x05);
-        case STATE_RESET:
-            return matchPrefix(data, 0x02, 0x7B, 0x1F);
-        default:
-            return false;
-    }
-}
+// Builds the SettingTable for slots 0 through count - 1.
+template <uint8_t count, uint8_t... slot>
+struct MakeSettingTable : MakeSettingTable<count - 1, count - 1, slot...> {};
+
+template <uint8_t... slot>
+struct MakeSettingTable<0, slot...> {
+    typedef SettingTable<slot...> Table;
+};
 
-// Return true if auto interior illumination is enabled.
-bool getAutoInteriorIllumination(const SystemEvent& event) {
-    return getBit(event.data, 0, 0);
+typedef MakeSettingTable<SETTING_SLOTS>::Table EnabledSettings;
+
+// Load the setting descriptor in the given slot from flash.
+void loadSetting(SettingDescriptor* setting, uint8_t slot) {
+    memcpy_P(setting, &EnabledSettings::descriptors[slot], sizeof(SettingDescriptor));
 }
 
-void setAutoInteriorIllumination(SystemEvent* event, bool value) {
-    setBit(event->data, 0, 0, value);
+// Load a request descriptor from flash.
+void loadRequest(RequestDescriptor* request, uint8_t state) {
+    memcpy_P(request, &EnabledSettings::requests[state], sizeof(RequestDescriptor));
 }
 
-// Return the auto-headlight sensitivity setting. Returns a value from
-// 0 to 3 inclusive.
-uint8_t getAutoHeadlightSensitivity(const SystemEvent& event) {
-    return event.data[1] & 0x03;
+// Return the ID of the response frame for the given settings request frame.
+uint32_t responseId(uint32_t request_id) {
+    return (request_id & ~0x010) | 0x020;
 }
 
-void setAutoHeadlightSensitivity(SystemEvent* event, uint8_t value) {
-    if (value > 3) {
-        value = 3;
+// Fill a settings request payload with data to be sent when the sequence
+// transitions to the given state. Some state transitions require value be
+// attached. Returns the size of the payload or 0 if nothing should be sent.
+size_t fillRequest(byte* payload, uint8_t state, uint8_t value = 0xFF) {
+    if (state >= STATE_COUNT) {
+        return 0;
+    }
+    RequestDescriptor request;
+    loadRequest(&request, state);
+    if (request.size == 0) {
+        return 0;
     }
-    event->data[1] &= 0xFC;
-    event->data[1] |= (value & 0x03);
+    payload[0] = request.service;
+    payload[1] = request.command;
+    if (request.size > 2) {
+        payload[2] = value;
+    }
+    return request.size;
 }
 
-// Return the auto-headlight off delay setting.
-AutoHeadlightOffDelay getAutoHeadlightOffDelay(const SystemEvent& event) {
-    return (AutoHeadlightOffDelay)((event.data[1] >> 4) & 0x0F);
+// Match the message against the given byte prefix.
+bool matchPrefix(const byte* data, size_t size, byte prefix0, byte prefix1) {
+    return size >= 2 && data[0] == prefix0 && data[1] == prefix1;
 }
 
-void setAutoHeadlightOffDelay(SystemEvent* event, AutoHeadlightOffDelay value) {
-    event->data[1] &= 0x0F;
-    event->data[1] |= value << 4;
+// Return true if the response message matches the given state.
+bool matchState(const byte* data, size_t size, uint8_t state) {
+    if (state == STATE_READY || state >= STATE_COUNT) {
+        return false;
+    }
+    RequestDescriptor request;
+    loadRequest(&request, state);
+    return matchPrefix(data, size, request.service + 0x40, request.command);
 }
 
-// Return true if speed sensitive wiper interval is enabled.
-bool getSpeedSensingWiperInterval(const SystemEvent& event) {
-    return getBit(event.data, 0, 2);
+// Return true if the response message is a negative response to the request
+// sent for the given state.
+bool matchNegative(const byte* data, size_t size, uint8_t state) {
+    if (state == STATE_READY || state >= STATE_COUNT) {
+        return false;
+    }
+    RequestDescriptor request;
+    loadRequest(&request, state);
+    return size >= 3 && matchPrefix(data, size, 0x7F, request.service);
 }
 
-void setSpeedSensingWiperInterval(SystemEvent* event, bool value) {
-    setBit(event->data, 0, 2, value);
+// Return the service of the request sent for the given state.
+uint8_t requestService(uint8_t state) {
+    RequestDescriptor request;
+    loadRequest(&request, state);
+    return request.service;
 }
 
-// Return true if the remote key response horn is enabled.
-bool getRemoteKeyResponseHorn(const SystemEvent& event) {
-    return getBit(event.data, 3, 0);
+// Return the setting's logical value stored in the event.
+uint8_t getEventValue(const SystemEvent& event, const SettingDescriptor& setting) {
+    return (event.data[setting.event_byte] >> setting.event_shift) & setting.event_mask;
 }
 
-void setRemoteKeyResponseHorn(SystemEvent* event, bool value) {
-    setBit(event->data, 3, 0, value);
+// Store the setting's logical value in the event.
+void setEventValue(SystemEvent* event, const SettingDescriptor& setting, uint8_t value) {
+    byte* data = event->data + setting.event_byte;
+    *data = (*data & ~(setting.event_mask << setting.event_shift)) |
+        ((value & setting.event_mask) << setting.event_shift);
 }
 
-// Return the remote key response lights setting.
-RemoteKeyResponseLights getRemoteKeyResponseLights(const SystemEvent& event) {
-    return (RemoteKeyResponseLights)((event.data[3] >> 2) & 0x03);
-}
+}  // namespace
 
-void setRemoteKeyResponseLights(SystemEvent* event, RemoteKeyResponseLights value) {
-    event->data[3] &= 0xF3;
-    event->data[3] |= (value & 0x03) << 2;
+bool SettingsSequence::trigger() {
+    if (state_ != STATE_READY) {
+        return false;
+    }
+    started_ = clock_->millis();
+    state_ = STATE_ENTER;
+    retries_ = 0;
+    pending_retries_ = 0;
+    sent_ = false;
+    return true;
 }
 
-// Return the auto re-lock time setting.
-AutoReLockTime getAutoReLockTime(const SystemEvent& event) {
-    return (AutoReLockTime)((event.data[2] >> 4) & 0x0F);
+bool SettingsSequence::send() {
+    if (clock_->millis() - started_ >= SEQUENCE_TIMEOUT) {
+        if (state_ != STATE_READY) {
+            fail(SETTINGS_ERROR_TIMEOUT);
+        }
+        return false;
+    }
+    if (state_ == STATE_READY || sent_) {
+        return false;
+    }
+    size_t size = fillRequest(payload_, state_, value_);
+    if (size == 0 || !transport_->send(payload_, size)) {
+        return false;
+    }
+    sent_ = true;
+    return true;
 }
 
-void setAutoReLockTime(SystemEvent* event, AutoReLockTime value) {
-    event->data[2] &= 0x0F;
-    event->data[2] |= value << 4;
+uint32_t SettingsSequence::deadline() const {
+    if (state_ == STATE_READY) {
+        return DEADLINE_NONE;
+    }
+    if (!sent_) {
+        return 0;
+    }
+    return deadlineAfter(clock_->millis(), started_, SEQUENCE_TIMEOUT);
 }
 
-// Return true if selective door unlock is enabled.
-bool getSelectiveDoorUnlock(const SystemEvent& event) {
-    return getBit(event.data, 2, 0);
+void SettingsSequence::handle(const byte* data, size_t size) {
+    if (matchNegative(data, size, state_)) {
+        switch (data[2]) {
+            case SETTINGS_ERROR_PENDING:
+                if (pending_retries_ < SETTINGS_PENDING_RETRIES) {
+                    ++pending_retries_;
+                    started_ = clock_->millis();
+                    break;
+                }
+                fail(data[2]);
+                break;
+            case SETTINGS_ERROR_BUSY:
+                if (retries_ < SETTINGS_BUSY_RETRIES) {
+                    ++retries_;
+                    sent_ = false;
+                    break;
+                }
+                fail(data[2]);
+                break;
+            default:
+                fail(data[2]);
+                break;
+        }
+        return;
+    }
+    if (!matchState(data, size, state_)) {
+        // message does not match the current state
+        return;
+    }
+    uint8_t nextState = next();
+    if (state_ != nextState) {
+        state_ = nextState;
+        retries_ = 0;
+        pending_retries_ = 0;
+        sent_ = false;
+    }
 }
 
-void setSelectiveDoorUnlock(SystemEvent* event, bool value) {
-    setBit(event->data, 2, 0, value);
+void SettingsSequence::fail(uint8_t reason) {
+    uint8_t service = requestService(state_);
+    cancel();
+    if (observer_ != nullptr) {
+        observer_->failed(request_id_, service, reason);
+    }
 }
 
-// Return true if the "slide driver seat back on exit" setting is enabled.
-bool getSlideDriverSeatBackOnExit(const SystemEvent& event) {
-    return getBit(event.data, 0, 1);
+uint8_t SettingsInit::next() {
+    if (requestId() == SETTINGS_FRAME_F) {
+        return nextF();
+    }
+    return nextE();
 }
 
-void setSlideDriverSeatBackOnExit(SystemEvent* event, bool value) {
-    setBit(event->data, 0, 1, value);
+uint8_t SettingsInit::nextE() {
+    switch (state()) {
+        case STATE_ENTER:
+            return STATE_INIT_00;
+        case STATE_INIT_00:
+            return STATE_INIT_20;
+        case STATE_INIT_20:
+            return STATE_INIT_40;
+        case STATE_INIT_40:
+            return STATE_INIT_60;
+        case STATE_INIT_60:
+            return STATE_EXIT;
+        default:
+            return STATE_READY;
+    }
 }
 
-}  // namespace
-
-// Send a sequence of frames for managing settings.
-class SettingsSequence {
-    public:
-        // Create a sequence that communicates over the given frame ID.
-        SettingsSequence(SettingsFrameId id, Faker::Clock* clock = Faker::Clock::real()) :
-            request_id_((uint32_t)id), clock_(clock), started_(0),
-            value_(0xFF), state_(0), sent_(false) {}
-
-        // Trigger the sequence. The next call to receive will broadcast the
-        // first frame of the sequence. The sequence expects the next frame to
-        // match otherwise it resets.
-        bool trigger() {
-            if (state_ != STATE_READY) {
-                return false;
-            }
-            started_ = clock_->millis();
-            state_ = STATE_ENTER;
-            sent_ = false;
-            return true;
-        }
-
-        // Return true if the sequence is ready to send.
-        bool ready() const {
-            return state_ == STATE_READY;
-        }
-
-        // Read the next outgoing frame in the sequence if available. Return
-        // true if the frame should be sent or false otherwise.
-        bool read(Canny::Frame* frame) {
-            if (clock_->millis() - started_ >= 500) {
-                state_ = STATE_READY;
-                return false;
-            }
-            if (state_ == STATE_READY || sent_) {
-                return false;
-            }
-            sent_ = true;
-            return fillRequest(frame, request_id_, state_, value_);
-        }
-
-        // Handle the next incoming frame in the sequence. If the frame matches
-        // the next expected frame in the sequence then the sequence advances
-        // to the next state and read will fill the next outgoing frame.
-        // Otherwise the sequence resets and becomes ready.
-        void handle(const Canny::Frame& frame) {
-            if (frame.id() != responseId(request_id_)) {
-                // not destined for this sequence
-                return;
-            }
-            if (!matchState(frame.data(), state_)) {
-                // frame does not match the current state
-                return;
-            }
-            uint8_t nextState = next();
-            if (state_ != nextState) {
-                state_ = nextState;
-                sent_ = false;
-            }
-        }
-
-    protected:
-        // The sequence's request ID.
-        uint32_t requestId() const { return request_id_; }
-
-        // The sequence's current state.
-        uint8_t state() const { return state_; }
-
-        // Set the value to send with the state frames that require value.
-        void setValue(uint8_t value) { value_ = value; }
-
-        // Return the next state. If the returned state matches the incoming
-        // rame then the sequence transitions to the new state and a frame for
-        // the state is sent. If this returns the no state transition occurs
-        // and no frame is sent.
-        virtual uint8_t nextE() = 0;
-        virtual uint8_t nextF() = 0;
-    private:
-        const uint32_t request_id_;
-        Faker::Clock* clock_;
-        uint32_t started_;
-        uint8_t value_;
-        uint8_t state_;
-        bool sent_;
-
-        uint8_t next() {
-            switch (request_id_) {
-                case SETTINGS_FRAME_E:
-                    return nextE();
-                case SETTINGS_FRAME_F:
-                    return nextF();
-                default:
-                    return STATE_READY;
-            }
-        }
-};
-
-// Sequence to initialize communication with the BCM.
-class SettingsInit : public SettingsSequence {
-    public:
-        SettingsInit(SettingsFrameId id, Faker::Clock* clock = Faker::Clock::real()) :
-            SettingsSequence(id, clock) {}
-    protected:
-        uint8_t nextE() override {
-            switch (state()) {
-                case STATE_ENTER:
-                    return STATE_INIT_00;
-                case STATE_INIT_00:
-                    return STATE_INIT_20;
-                case STATE_INIT_20:
-                    return STATE_INIT_40;
-                case STATE_INIT_40:
-                    return STATE_INIT_60;
-                case STATE_INIT_60:
-                    return STATE_EXIT;
-                default:
-                    return STATE_READY;
-            }
-        }
-
-        uint8_t nextF() override {
-            switch (state()) {
-                case STATE_ENTER:
-                    return STATE_INIT_00;
-                case STATE_INIT_00:
-                    return STATE_EXIT;
-                default:
-                    return STATE_READY;
-            }
-        }
-};
-
-// Sequence used to retrieve settings from the BCM.
-class SettingsRetrieve : public SettingsSequence {
-    public:
-        SettingsRetrieve(SettingsFrameId id, Faker::Clock* clock = Faker::Clock::real()) :
-            SettingsSequence(id, clock), state2x_(false) {}
-    protected:
-        uint8_t nextE() override {
-            switch (state()) {
-                case STATE_ENTER:
-                    return STATE_RETRIEVE_71E_10;
-                case STATE_RETRIEVE_71E_10:
-                    state2x_ = false;
-                    return STATE_RETRIEVE_71E_2X;
-                case STATE_RETRIEVE_71E_2X:
-                    if (state2x_) {
-                        return STATE_EXIT;
-                    } else {
-                        state2x_ = true;
-                        return STATE_RETRIEVE_71E_2X;
-                    }
-                default:
-                    return STATE_READY;
-            }
-        }
-
-        uint8_t nextF() override {
-            switch (state()) {
-                case STATE_ENTER:
-                    return STATE_RETRIEVE_71F_05;
-                case STATE_RETRIEVE_71F_05:
-                    return STATE_EXIT;
-                default:
-                    return STATE_READY;
-            }
-        }
-
-    private:
-        bool state2x_;
-};
-
-// Sequence used to update a setting in the BCM.
-class SettingsUpdate : public SettingsSequence {
-    public:
-        SettingsUpdate(SettingsFrameId id, Faker::Clock* clock = Faker::Clock::real()) :
-            SettingsSequence(id, clock), update_(0), state2x_(false) {}
-
-        // Set the item to update and its value. 
-        void setPayload(uint8_t update, uint8_t value) {
-            update_ = update;
-            setValue(value);
-        }
-    protected:
-        uint8_t nextE() override {
-            const uint8_t state = this->state();
-            if (state == STATE_ENTER) {
-                return update_;
-            } else if (state == update_) {
-                return STATE_RETRIEVE_71E_10;
-            } else if (state == STATE_RETRIEVE_71E_10) {
-                state2x_ = false;
-                return STATE_RETRIEVE_71E_2X;
-            } else if (state == STATE_RETRIEVE_71E_2X) {
-                if (state2x_) {
-                    return STATE_EXIT;
-                } else {
-                    state2x_ = true;
-                    return STATE_RETRIEVE_71E_2X;
-                }
-            }
+uint8_t SettingsInit::nextF() {
+    switch (state()) {
+        case STATE_ENTER:
+            return STATE_INIT_00;
+        case STATE_INIT_00:
+            return STATE_EXIT;
+        default:
             return STATE_READY;
-        }
+    }
+}
 
-        uint8_t nextF() override {
-            const uint8_t state = this->state();
-            if (state == STATE_ENTER) {
-                return update_;
-            } else if (state == update_) {
-                return STATE_RETRIEVE_71F_05;
-            } else if (state == STATE_RETRIEVE_71F_05) {
-                return STATE_EXIT;
-            }
+uint8_t SettingsRetrieve::next() {
+    switch (state()) {
+        case STATE_ENTER:
+            return STATE_RETRIEVE;
+        case STATE_RETRIEVE:
+            return STATE_EXIT;
+        default:
             return STATE_READY;
-        }
-
-    private:
-        uint8_t update_;
-        bool state2x_;
-};
-
-// Sequence used to reset all settings to factory values.
-class SettingsReset : public SettingsSequence {
-    public:
-        SettingsReset(SettingsFrameId id, Faker::Clock* clock = Faker::Clock::real()) :
-            SettingsSequence(id, clock), state2x_(false) {}
-    protected:
-        uint8_t nextE() override {
-            switch (state()) {
-                case STATE_ENTER:
-                    return STATE_RESET;
-                case STATE_RESET:
-                    return STATE_RETRIEVE_71E_10;
-                case STATE_RETRIEVE_71E_10:
-                    state2x_ = false;
-                    return STATE_RETRIEVE_71E_2X;
-                case STATE_RETRIEVE_71E_2X:
-                    if (state2x_) {
-                        return STATE_EXIT;
-                    } else {
-                        state2x_ = true;
-                        return STATE_RETRIEVE_71E_2X;
-                    }
-                default:
-                    return STATE_READY;
-            }
-        }
+    }
+}
 
-        uint8_t nextF() override {
-            switch (state()) {
-                case STATE_ENTER:
-                    return STATE_RESET;
-                case STATE_RESET:
-                    return STATE_RETRIEVE_71F_05;
-                case STATE_RETRIEVE_71F_05:
-                    return STATE_EXIT;
-                default:
-                    return STATE_READY;
-            }
-        }
+uint8_t SettingsUpdate::next() {
+    const uint8_t state = this->state();
+    if (state == STATE_ENTER) {
+        return update_;
+    } else if (state == update_) {
+        return STATE_RETRIEVE;
+    } else if (state == STATE_RETRIEVE) {
+        return STATE_EXIT;
+    }
+    return STATE_READY;
+}
 
-    private:
-        bool state2x_;
-};
+uint8_t SettingsReset::next() {
+    switch (state()) {
+        case STATE_ENTER:
+            return STATE_RESET;
+        case STATE_RESET:
+            return STATE_RETRIEVE;
+        case STATE_RETRIEVE:
+            return STATE_EXIT;
+        default:
+            return STATE_READY;
+    }
+}
 
 Settings::Settings(bool init, Faker::Clock* clock) :
-        initE_(new SettingsInit(SETTINGS_FRAME_E, clock)),
-        retrieveE_(new SettingsRetrieve(SETTINGS_FRAME_E, clock)),
-        updateE_(new SettingsUpdate(SETTINGS_FRAME_E, clock)),
-        resetE_(new SettingsReset(SETTINGS_FRAME_E, clock)),
-        initF_(new SettingsInit(SETTINGS_FRAME_F, clock)),
-        retrieveF_(new SettingsRetrieve(SETTINGS_FRAME_F, clock)),
-        updateF_(new SettingsUpdate(SETTINGS_FRAME_F, clock)),
-        resetF_(new SettingsReset(SETTINGS_FRAME_F, clock)),
-        available_(false), frame_(0, 0, 8),
-        event_(Event::SETTINGS_STATE, {0x00, 0x00, 0x00, 0x00}) {
-    if (init) {
-        this->init();
-    }
+        transportE_(SETTINGS_FRAME_E, responseId(SETTINGS_FRAME_E), 0, 0x0A, clock),
+        transportF_(SETTINGS_FRAME_F, responseId(SETTINGS_FRAME_F), 0, 0x0A, clock),
+        initE_(SETTINGS_FRAME_E, &transportE_, clock),
+        retrieveE_(SETTINGS_FRAME_E, &transportE_, clock),
+        updateE_(SETTINGS_FRAME_E, &transportE_, clock),
+        resetE_(SETTINGS_FRAME_E, &transportE_, clock),
+        initF_(SETTINGS_FRAME_F, &transportF_, clock),
+        retrieveF_(SETTINGS_FRAME_F, &transportF_, clock),
+        updateF_(SETTINGS_FRAME_F, &transportF_, clock),
+        resetF_(SETTINGS_FRAME_F, &transportF_, clock),
+        availableE_(false), availableF_(false),
+        suspended_(false), ignition_(false), retrieve_pending_(false),
+        init_pending_(init), frame_(0, 0, 8),
+        event_(Event::SETTINGS_STATE, {0x00, 0x00, 0x00, 0x00}) {}
+
+void Settings::flowControl(uint8_t block_size, uint8_t st_min) {
+    transportE_.flowControl(block_size, st_min);
+    transportF_.flowControl(block_size, st_min);
+}
+
+void Settings::observer(SettingsObserver* observer) {
+    initE_.observer(observer);
+    retrieveE_.observer(observer);
+    updateE_.observer(observer);
+    resetE_.observer(observer);
+    initF_.observer(observer);
+    retrieveF_.observer(observer);
+    updateF_.observer(observer);
+    resetF_.observer(observer);
+}
+
+void Settings::power(PowerMode mode) {
+    suspended_ = mode == POWER_SLEEP;
+    if (suspended_) {
+        // The BCM drops its diagnostic session while asleep.
+        initE_.cancel();
+        retrieveE_.cancel();
+        updateE_.cancel();
+        resetE_.cancel();
+        initF_.cancel();
+        retrieveF_.cancel();
+        updateF_.cancel();
+        resetF_.cancel();
+        transportE_.reset();
+        transportF_.reset();
+        retrieve_pending_ = false;
+    } else if (mode == POWER_IGNITION && !ignition_) {
+        init_pending_ = false;
+        init();
+        retrieve_pending_ = true;
+    } else if (init_pending_) {
+        init_pending_ = false;
+        init();
+    }
+    ignition_ = mode == POWER_IGNITION;
 }
 
 void Settings::handle(const Message& msg) {
     switch (msg.type()) {
         case Message::CAN_FRAME:
-            handleFrame(msg.can_frame());
+            handle(FrameView(msg.can_frame()));
             break;
         case Message::SYSTEM_EVENT:
             handleEvent(msg.system_event());
@@ -586,428 +547,302 @@ void Settings::handleEvent(const SystemEvent& event) {
             requestCurrent();
             break;
         case Event::SETTINGS_TOGGLE_AUTO_INTERIOR_ILLUMINATAION:
-            toggleAutoInteriorIllumination();
+            if (settingsEnabled(SETTINGS_FEATURE_AUTO_INTERIOR_ILLUMINATION)) {
+                step(SETTING_AUTO_INTERIOR_ILLUMINATION, 1);
+            }
             break;
         case Event::SETTINGS_TOGGLE_SLIDE_DRIVER_SEAT_BACK_ON_EXIT:
-            toggleSlideDriverSeatBackOnExit();
+            if (settingsEnabled(SETTINGS_FEATURE_SLIDE_DRIVER_SEAT_BACK_ON_EXIT)) {
+                step(SETTING_SLIDE_DRIVER_SEAT_BACK_ON_EXIT, 1);
+            }
             break;
         case Event::SETTINGS_TOGGLE_SPEED_SENSING_WIPER_INTERVAL:
-            toggleSpeedSensingWiperInterval();
+            if (settingsEnabled(SETTINGS_FEATURE_SPEED_SENSING_WIPER_INTERVAL)) {
+                step(SETTING_SPEED_SENSING_WIPER_INTERVAL, 1);
+            }
             break;
         case Event::SETTINGS_NEXT_AUTO_HEADLIGHT_SENSITIVITY:
-            nextAutoHeadlightSensitivity();
+            if (settingsEnabled(SETTINGS_FEATURE_AUTO_HEADLIGHT_SENSITIVITY)) {
+                step(SETTING_AUTO_HEADLIGHT_SENSITIVITY, 1);
+            }
             break;
         case Event::SETTINGS_PREV_AUTO_HEADLIGHT_SENSITIVITY:
-            prevAutoHeadlightSensitivity();
+            if (settingsEnabled(SETTINGS_FEATURE_AUTO_HEADLIGHT_SENSITIVITY)) {
+                step(SETTING_AUTO_HEADLIGHT_SENSITIVITY, -1);
+            }
             break;
         case Event::SETTINGS_NEXT_AUTO_HEADLIGHT_OFF_DELAY:
-            nextAutoHeadlightOffDelay();
+            if (settingsEnabled(SETTINGS_FEATURE_AUTO_HEADLIGHT_OFF_DELAY)) {
+                step(SETTING_AUTO_HEADLIGHT_OFF_DELAY, 1);
+            }
             break;
         case Event::SETTINGS_PREV_AUTO_HEADLIGHT_OFF_DELAY:
-            prevAutoHeadlightOffDelay();
+            if (settingsEnabled(SETTINGS_FEATURE_AUTO_HEADLIGHT_OFF_DELAY)) {
+                step(SETTING_AUTO_HEADLIGHT_OFF_DELAY, -1);
+            }
             break;
         case Event::SETTINGS_TOGGLE_SELECTIVE_DOOR_UNLOCK:
-            toggleSelectiveDoorUnlock();
+            if (settingsEnabled(SETTINGS_FEATURE_SELECTIVE_DOOR_UNLOCK)) {
+                step(SETTING_SELECTIVE_DOOR_UNLOCK, 1);
+            }
             break;
         case Event::SETTINGS_NEXT_AUTO_RELOCK_TIME:
-            nextAutoReLockTime();
+            if (settingsEnabled(SETTINGS_FEATURE_AUTO_RELOCK_TIME)) {
+                step(SETTING_AUTO_RELOCK_TIME, 1);
+            }
             break;
         case Event::SETTINGS_PREV_AUTO_RELOCK_TIME:
-            prevAutoReLockTime();
+            if (settingsEnabled(SETTINGS_FEATURE_AUTO_RELOCK_TIME)) {
+                step(SETTING_AUTO_RELOCK_TIME, -1);
+            }
             break;
         case Event::SETTINGS_TOGGLE_REMOTE_KEY_RESPONSE_HORN:
-            toggleRemoteKeyResponseHorn();
+            if (settingsEnabled(SETTINGS_FEATURE_REMOTE_KEY_RESPONSE_HORN)) {
+                step(SETTING_REMOTE_KEY_RESPONSE_HORN, 1);
+            }
             break;
         case Event::SETTINGS_NEXT_REMOTE_KEY_RESPONSE_LIGHTS:
-            nextRemoteKeyResponseLights();
+            if (settingsEnabled(SETTINGS_FEATURE_REMOTE_KEY_RESPONSE_LIGHTS)) {
+                step(SETTING_REMOTE_KEY_RESPONSE_LIGHTS, 1);
+            }
             break;
         case Event::SETTINGS_PREV_REMOTE_KEY_RESPONSE_LIGHTS:
-            prevRemoteKeyResponseLights();
+            if (settingsEnabled(SETTINGS_FEATURE_REMOTE_KEY_RESPONSE_LIGHTS)) {
+                step(SETTING_REMOTE_KEY_RESPONSE_LIGHTS, -1);
+            }
             break;
         case Event::SETTINGS_FACTORY_RESET:
-            resetSettingsToDefault();
+            if (settingsEnabled(SETTINGS_FEATURE_FACTORY_RESET)) {
+                resetSettingsToDefault();
+            }
             break;
         default:
             break;
     }
 }
 
-void Settings::handleFrame(const Canny::Frame& frame) {
+bool Settings::handle(const FrameView& frame) {
     if (frame.size() < 8) {
-        return;
+        return false;
     }
-    if (frame.id() == responseId(SETTINGS_FRAME_E)) {
-        initE_->handle(frame);
-        retrieveE_->handle(frame);
-        updateE_->handle(frame);
-        resetE_->handle(frame);
-        handleState(frame.data());
-    } else if (frame.id() == responseId(SETTINGS_FRAME_F)) {
-        initF_->handle(frame);
-        retrieveF_->handle(frame);
-        updateF_->handle(frame);
-        resetF_->handle(frame);
-        handleState(frame.data());
+    if (settingsEnabled(SETTINGS_FEATURE_CHANNEL_E) && transportE_.handle(frame)) {
+        const byte* data = transportE_.data();
+        size_t size = transportE_.size();
+        initE_.handle(data, size);
+        retrieveE_.handle(data, size);
+        updateE_.handle(data, size);
+        resetE_.handle(data, size);
+        handleStateE(data, size);
+        return true;
+    } else if (settingsEnabled(SETTINGS_FEATURE_CHANNEL_F) && transportF_.handle(frame)) {
+        const byte* data = transportF_.data();
+        size_t size = transportF_.size();
+        initF_.handle(data, size);
+        retrieveF_.handle(data, size);
+        updateF_.handle(data, size);
+        resetF_.handle(data, size);
+        handleStateF(data, size);
+        return true;
+    }
+    return false;
+}
+
+void Settings::handleStateE(const byte* data, size_t size) {
+    if (size < 14 || !matchPrefix(data, size, 0x61, 0x01)) {
+        return;
     }
+    decodeState(false, data);
+    availableE_ = true;
 }
 
-void Settings::handleState(const byte* data) {
-    if (matchPrefix(data, 0x05)) {
-        handleState05(data);
-        available_ = true;
-    } else if (matchPrefix(data, 0x10)) {
-        handleState10(data);
-        available_ = true;
-    } else if (matchPrefix(data, 0x21)) {
-        handleState21(data);
-        available_ = true;
-    } else if (matchPrefix(data, 0x22)) {
-        handleState22(data);
-        available_ = true;
+void Settings::handleStateF(const byte* data, size_t size) {
+    if (size < 3 || !matchPrefix(data, size, 0x61, 0x01)) {
+        return;
     }
+    decodeState(true, data);
+    availableF_ = true;
 }
 
-void Settings::handleState05(const byte* data) {
-    setSlideDriverSeatBackOnExit(&event_, getBit(data, 3, 0));
-}
-
-void Settings::handleState10(const byte* data) {
-    setAutoInteriorIllumination(&event_, getBit(data, 4, 5));
-    setSelectiveDoorUnlock(&event_, getBit(data, 4, 7));
-    setRemoteKeyResponseHorn(&event_, getBit(data, 7, 3));
-}
-
-void Settings::handleState21(const byte* data) {
+void Settings::decodeState(bool channelF, const byte* data) {
     // Translates incoming state to our own state representation. A 0 value
     // typically represents the default on the BCM side.
-
-    switch ((data[1] >> 6) & 0x03) {
-        case 0x00:
-            setRemoteKeyResponseLights(&event_, LIGHTS_OFF);
-            break;
-        case 0x01:
-            setRemoteKeyResponseLights(&event_, LIGHTS_UNLOCK);
-            break;
-        case 0x02:
-            setRemoteKeyResponseLights(&event_, LIGHTS_LOCK);
-            break;
-        case 0x03:
-            setRemoteKeyResponseLights(&event_, LIGHTS_ON);
-            break;
-    }
-
-    switch ((data[1] >> 4) & 0x03) {
-        case 0x00:
-            setAutoReLockTime(&event_, RELOCK_1M);
-            break;
-        case 0x01:
-            setAutoReLockTime(&event_, RELOCK_OFF);
-            break;
-        case 0x02:
-            setAutoReLockTime(&event_, RELOCK_5M);
-            break;
-    }
-
-    switch ((data[2] >> 2) & 0x03) {
-        case 0x03:
-            setAutoHeadlightSensitivity(&event_, 0);
-            break;
-        case 0x00:
-            setAutoHeadlightSensitivity(&event_, 1);
-            break;
-        case 0x01:
-            setAutoHeadlightSensitivity(&event_, 2);
-            break;
-        case 0x02:
-            setAutoHeadlightSensitivity(&event_, 3);
-            break;
-    }
-
-    switch (((data[2] & 0x01) << 2) | ((data[3] >> 6) & 0x03)) {
-        case 0x01:
-            setAutoHeadlightOffDelay(&event_, DELAY_0S);
-            break;
-        case 0x02:
-            setAutoHeadlightOffDelay(&event_, DELAY_30S);
-            break;
-        case 0x00:
-            setAutoHeadlightOffDelay(&event_, DELAY_45S);
-            break;
-        case 0x03:
-            setAutoHeadlightOffDelay(&event_, DELAY_60S);
-            break;
-        case 0x04:
-            setAutoHeadlightOffDelay(&event_, DELAY_90S);
-            break;
-        case 0x05:
-            setAutoHeadlightOffDelay(&event_, DELAY_120S);
-            break;
-        case 0x06:
-            setAutoHeadlightOffDelay(&event_, DELAY_150S);
-            break;
-        case 0x07:
-            setAutoHeadlightOffDelay(&event_, DELAY_180S);
-            break;
+    SettingDescriptor setting;
+    uint8_t slot = 0;
+    for (uint8_t i = 0; i < SETTING_COUNT; ++i) {
+        if (!settingEnabled(i)) {
+            continue;
+        }
+        if (settingChannelF(i) != channelF) {
+            ++slot;
+            continue;
+        }
+        loadSetting(&setting, slot++);
+        uint16_t word = (data[setting.response_byte] << 8) |
+            data[setting.response_byte + 1];
+        uint8_t wire = (word >> setting.response_shift) & setting.response_mask;
+        uint8_t index = pgm_read_byte(setting.decode + wire);
+        if (index < setting.count) {
+            setEventValue(&event_, setting, pgm_read_byte(setting.logical + index));
+        }
     }
+    setBit(event_.data, 3,
+            channelF ? SETTINGS_STATE_CHANNEL_F : SETTINGS_STATE_CHANNEL_E, true);
 }
 
-void Settings::handleState22(const byte* data) {
-    setSpeedSensingWiperInterval(&event_, !getBit(data, 1, 7));
-}
-
-void Settings::emit(const Caster::Yield<Message>& yield) {
-    if (initE_->read(&frame_)) {
-        yield(frame_);
-    }
-    if (retrieveE_->read(&frame_)) {
-        yield(frame_);
-    }
-    if (updateE_->read(&frame_)) {
-        yield(frame_);
-    }
-    if (resetE_->read(&frame_)) {
-        yield(frame_);
-    }
-    if (initF_->read(&frame_)) {
-        yield(frame_);
-    }
-    if (retrieveF_->read(&frame_)) {
-        yield(frame_);
+template <typename Out>
+void Settings::emitTo(Out& yield, bool frames) {
+    if (suspended_) {
+        return;
     }
-    if (updateF_->read(&frame_)) {
-        yield(frame_);
+    if (init_pending_) {
+        init_pending_ = false;
+        init();
     }
-    if (resetF_->read(&frame_)) {
-        yield(frame_);
+    if (retrieve_pending_ && readyE() && readyF()) {
+        retrieve_pending_ = false;
+        requestCurrent();
     }
-    if (ready() && available_) {
-        available_ = false;
-        yield(event_);
-    }
-}
 
-bool Settings::init() {
-    if (!ready()) {
-        return false;
+    if (settingsEnabled(SETTINGS_FEATURE_CHANNEL_E)) {
+        initE_.send();
+        retrieveE_.send();
+        updateE_.send();
+        resetE_.send();
+        while (frames && transportE_.read(&frame_)) {
+            yield(frame_);
+        }
     }
-    return initE_->trigger() && initF_->trigger();
-}
-
-bool Settings::readyE() const {
-    return initE_->ready() && retrieveE_->ready() &&
-        updateE_->ready() && resetE_->ready();
-}
 
-bool Settings::readyF() const {
-    return initF_->ready() && retrieveF_->ready() &&
-        updateF_->ready() && resetF_->ready();
-}
-
-bool Settings::ready() const {
-    return readyE() && readyF();
-}
+    if (settingsEnabled(SETTINGS_FEATURE_CHANNEL_F)) {
+        initF_.send();
+        retrieveF_.send();
+        updateF_.send();
+        resetF_.send();
+        while (frames && transportF_.read(&frame_)) {
+            yield(frame_);
+        }
+    }
 
-bool Settings::toggleAutoInteriorIllumination() {
-    if (!readyE()) {
-        return false;
+    // Each channel publishes its results as soon as its own sequence
+    // completes. A channel does not wait on the other.
+    bool emitE = readyE() && availableE_;
+    bool emitF = readyF() && availableF_;
+    if (emitE || emitF) {
+        availableE_ &= !emitE;
+        availableF_ &= !emitF;
+        yield(event_);
     }
-    updateE_->setPayload(STATE_AUTO_INTERIOR_ILLUM, !getAutoInteriorIllumination(event_));
-    return updateE_->trigger();
 }
 
-bool Settings::nextAutoHeadlightSensitivity() {
-    return triggerAutoHeadlightSensitivity(getAutoHeadlightSensitivity(event_) + 1);
+void Settings::emit(const Caster::Yield<Message>& yield) {
+    emitTo(yield, true);
 }
 
-bool Settings::prevAutoHeadlightSensitivity() {
-    return triggerAutoHeadlightSensitivity(getAutoHeadlightSensitivity(event_) - 1);
+void Settings::emit(MessageBatch* batch) {
+    emitTo(*batch, true);
 }
 
-bool Settings::triggerAutoHeadlightSensitivity(uint8_t value) {
-    if (!readyE() || value > 3) {
-        return false;
-    }
-    switch (value) {
-        case 0:
-            updateE_->setPayload(STATE_AUTO_HL_SENS, 0x03);
-            break;
-        case 1:
-            updateE_->setPayload(STATE_AUTO_HL_SENS, 0x00);
-            break;
-        case 2:
-            updateE_->setPayload(STATE_AUTO_HL_SENS, 0x01);
-            break;
-        case 3:
-            updateE_->setPayload(STATE_AUTO_HL_SENS, 0x02);
-            break;
-        default:
-            return false;
-    }
-    return updateE_->trigger();
+void Settings::poll(const Caster::Yield<Message>& yield) {
+    emitTo(yield, false);
 }
 
-bool Settings::nextAutoHeadlightOffDelay() {
-    if (!readyE()) {
+bool Settings::encode(FrameSlot* slot) {
+    if (suspended_) {
         return false;
     }
-    switch (getAutoHeadlightOffDelay(event_)) {
-        case DELAY_0S:
-            updateE_->setPayload(STATE_AUTO_HL_DELAY, 0x02);
-            break;
-        case DELAY_30S:
-            updateE_->setPayload(STATE_AUTO_HL_DELAY, 0x00);
-            break;
-        case DELAY_45S:
-            updateE_->setPayload(STATE_AUTO_HL_DELAY, 0x03);
-            break;
-        case DELAY_60S:
-            updateE_->setPayload(STATE_AUTO_HL_DELAY, 0x04);
-            break;
-        case DELAY_90S:
-            updateE_->setPayload(STATE_AUTO_HL_DELAY, 0x05);
-            break;
-        case DELAY_120S:
-            updateE_->setPayload(STATE_AUTO_HL_DELAY, 0x06);
-            break;
-        case DELAY_150S:
-            updateE_->setPayload(STATE_AUTO_HL_DELAY, 0x07);
-            break;
-        case DELAY_180S:
-        default:
-            return false;
-    }
-    return updateE_->trigger();
+    return (settingsEnabled(SETTINGS_FEATURE_CHANNEL_E) && transportE_.read(slot)) ||
+        (settingsEnabled(SETTINGS_FEATURE_CHANNEL_F) && transportF_.read(slot));
 }
 
-bool Settings::prevAutoHeadlightOffDelay() {
-    if (!readyE()) {
-        return false;
+uint32_t Settings::nextDeadline() {
+    if (suspended_) {
+        return DEADLINE_NONE;
     }
-    switch (getAutoHeadlightOffDelay(event_)) {
-        default:
-        case DELAY_0S:
-            return false;
-        case DELAY_30S:
-            updateE_->setPayload(STATE_AUTO_HL_DELAY, 0x01);
-            break;
-        case DELAY_45S:
-            updateE_->setPayload(STATE_AUTO_HL_DELAY, 0x02);
-            break;
-        case DELAY_60S:
-            updateE_->setPayload(STATE_AUTO_HL_DELAY, 0x00);
-            break;
-        case DELAY_90S:
-            updateE_->setPayload(STATE_AUTO_HL_DELAY, 0x03);
-            break;
-        case DELAY_120S:
-            updateE_->setPayload(STATE_AUTO_HL_DELAY, 0x04);
-            break;
-        case DELAY_150S:
-            updateE_->setPayload(STATE_AUTO_HL_DELAY, 0x05);
-            break;
-        case DELAY_180S:
-            updateE_->setPayload(STATE_AUTO_HL_DELAY, 0x06);
-            break;
+    if (init_pending_ || (retrieve_pending_ && readyE() && readyF()) ||
+            (readyE() && availableE_) || (readyF() && availableF_)) {
+        return 0;
     }
-    return updateE_->trigger();
-}
 
-bool Settings::toggleSpeedSensingWiperInterval() {
-    if (!readyE()) {
-        return false;
+    uint32_t next = DEADLINE_NONE;
+    if (settingsEnabled(SETTINGS_FEATURE_CHANNEL_E)) {
+        next = earliestDeadline(next, initE_.deadline());
+        next = earliestDeadline(next, retrieveE_.deadline());
+        next = earliestDeadline(next, updateE_.deadline());
+        next = earliestDeadline(next, resetE_.deadline());
+        next = earliestDeadline(next, transportE_.deadline());
     }
-    updateE_->setPayload(STATE_SPEED_SENS_WIPER, getSpeedSensingWiperInterval(event_));
-    return updateE_->trigger();
-}
-
-bool Settings::toggleRemoteKeyResponseHorn() {
-    if (!readyE()) {
-        return false;
+    if (settingsEnabled(SETTINGS_FEATURE_CHANNEL_F)) {
+        next = earliestDeadline(next, initF_.deadline());
+        next = earliestDeadline(next, retrieveF_.deadline());
+        next = earliestDeadline(next, updateF_.deadline());
+        next = earliestDeadline(next, resetF_.deadline());
+        next = earliestDeadline(next, transportF_.deadline());
     }
-    updateE_->setPayload(STATE_REMOTE_KEY_HORN, !getRemoteKeyResponseHorn(event_));
-    return updateE_->trigger();
+    return next;
 }
 
-bool Settings::nextRemoteKeyResponseLights() {
-    return triggerRemoteKeyResponseLights(getRemoteKeyResponseLights(event_) + 1);
+bool Settings::init() {
+    bool e = settingsEnabled(SETTINGS_FEATURE_CHANNEL_E) &&
+        readyE() && initE_.trigger();
+    bool f = settingsEnabled(SETTINGS_FEATURE_CHANNEL_F) &&
+        readyF() && initF_.trigger();
+    return e || f;
 }
 
-bool Settings::prevRemoteKeyResponseLights() {
-    return triggerRemoteKeyResponseLights(getRemoteKeyResponseLights(event_) - 1);
+bool Settings::readyE() const {
+    return initE_.ready() && retrieveE_.ready() &&
+        updateE_.ready() && resetE_.ready();
 }
 
-bool Settings::triggerRemoteKeyResponseLights(uint8_t value) {
-    if (!readyE() || value > 3) {
-        return false;
-    }
-    updateE_->setPayload(STATE_REMOTE_KEY_LIGHT, value);
-    return updateE_->trigger();
+bool Settings::readyF() const {
+    return initF_.ready() && retrieveF_.ready() &&
+        updateF_.ready() && resetF_.ready();
 }
 
-bool Settings::nextAutoReLockTime() {
-    if (!readyE()) {
+bool Settings::step(uint8_t index, int8_t direction) {
+    uint8_t slot = settingSlot(index);
+    SettingDescriptor setting;
+    loadSetting(&setting, slot);
+    bool channelF = settingChannelF(index);
+    if (channelF ? !readyF() : !readyE()) {
         return false;
     }
-    switch (getAutoReLockTime(event_)) {
-        case RELOCK_OFF:
-            updateE_->setPayload(STATE_AUTO_RELOCK_TIME, 0x00);
-            break;
-        case RELOCK_1M:
-            updateE_->setPayload(STATE_AUTO_RELOCK_TIME, 0x02);
-            break;
-        case RELOCK_5M:
-        default:
-            return false;
-    }
-    return updateE_->trigger();
-}
 
-bool Settings::prevAutoReLockTime() {
-    if (!readyE()) {
-        return false;
-    }
-    switch (getAutoReLockTime(event_)) {
-        default:
-        case RELOCK_OFF:
-            return false;
-        case RELOCK_1M:
-            updateE_->setPayload(STATE_AUTO_RELOCK_TIME, 0x01);
-            break;
-        case RELOCK_5M:
-            updateE_->setPayload(STATE_AUTO_RELOCK_TIME, 0x00);
-            break;
+    uint8_t current = getEventValue(event_, setting);
+    uint8_t pos = 0;
+    while (pos < setting.count && pgm_read_byte(setting.logical + pos) != current) {
+        ++pos;
     }
-    return updateE_->trigger();
-}
-
-bool Settings::toggleSelectiveDoorUnlock() {
-    if (!readyE()) {
+    if (pos >= setting.count) {
         return false;
     }
-    updateE_->setPayload(STATE_SELECT_DOOR_UNLOCK, !getSelectiveDoorUnlock(event_));
-    return updateE_->trigger();
-}
 
-bool Settings::toggleSlideDriverSeatBackOnExit() {
-    if (!readyF()) {
+    int16_t next = pos + direction;
+    if (setting.wrap) {
+        next = (next + setting.count) % setting.count;
+    } else if (next < 0 || next >= setting.count) {
         return false;
     }
-    updateF_->setPayload(STATE_SLIDE_DRIVER_SEAT, !getSlideDriverSeatBackOnExit(event_));
-    return updateF_->trigger();
+
+    SettingsUpdate* update = channelF ? &updateF_ : &updateE_;
+    update->setPayload(STATE_SETTING + slot, pgm_read_byte(setting.wire + next));
+    return update->trigger();
 }
 
 bool Settings::requestCurrent() {
-    if (!ready()) {
-        return false;
-    }
-    return retrieveE_->trigger() && retrieveF_->trigger();
+    bool e = settingsEnabled(SETTINGS_FEATURE_CHANNEL_E) &&
+        readyE() && retrieveE_.trigger();
+    bool f = settingsEnabled(SETTINGS_FEATURE_CHANNEL_F) &&
+        readyF() && retrieveF_.trigger();
+    return e || f;
 }
 
 bool Settings::resetSettingsToDefault() {
-    if (!ready()) {
-        return false;
-    }
-    return resetE_->trigger() && resetF_->trigger();
+    bool e = settingsEnabled(SETTINGS_FEATURE_CHANNEL_E) &&
+        readyE() && resetE_.trigger();
+    bool f = settingsEnabled(SETTINGS_FEATURE_CHANNEL_F) &&
+        readyF() && resetF_.trigger();
+    return e || f;
 }
 
 }  // namespace R51
@@ -6,106 +6,158 @@
 #include <Caster.h>
 #include <Faker.h>
 #include <R51Core.h>
+#include "Batch.h"
+#include "Controller.h"
+#include "Deadline.h"
+#include "Handler.h"
+#include "IsoTp.h"
+#include "Node.h"
+#include "SettingsSequence.h"
 
 namespace R51 {
 
-class SettingsInit;
-class SettingsRetrieve;
-class SettingsUpdate;
-class SettingsReset;
+// Settings which may be compiled into the Settings node.
+enum SettingsFeature : uint16_t {
+    SETTINGS_FEATURE_AUTO_INTERIOR_ILLUMINATION = 1 << 0,
+    SETTINGS_FEATURE_AUTO_HEADLIGHT_SENSITIVITY = 1 << 1,
+    SETTINGS_FEATURE_AUTO_HEADLIGHT_OFF_DELAY = 1 << 2,
+    SETTINGS_FEATURE_SPEED_SENSING_WIPER_INTERVAL = 1 << 3,
+    SETTINGS_FEATURE_REMOTE_KEY_RESPONSE_HORN = 1 << 4,
+    SETTINGS_FEATURE_REMOTE_KEY_RESPONSE_LIGHTS = 1 << 5,
+    SETTINGS_FEATURE_AUTO_RELOCK_TIME = 1 << 6,
+    SETTINGS_FEATURE_SELECTIVE_DOOR_UNLOCK = 1 << 7,
+    SETTINGS_FEATURE_SLIDE_DRIVER_SEAT_BACK_ON_EXIT = 1 << 8,
+    SETTINGS_FEATURE_FACTORY_RESET = 1 << 9,
+
+    // Settings stored on the 0x71E and 0x71F channels.
+    SETTINGS_FEATURE_CHANNEL_E = 0x00FF,
+    SETTINGS_FEATURE_CHANNEL_F = 0x0100,
+
+    SETTINGS_FEATURE_NONE = 0x0000,
+    SETTINGS_FEATURE_ALL = 0x03FF,
+};
+
+// Mask of settings compiled into the Settings node. Code and event handling
+// for settings not in the mask is removed at compile time. The mask must be
+// set globally with a build flag so the library sees it, e.g.
+// -DSETTINGS_FEATURES=R51::SETTINGS_FEATURE_AUTO_INTERIOR_ILLUMINATION
+#ifndef SETTINGS_FEATURES
+#define SETTINGS_FEATURES SETTINGS_FEATURE_ALL
+#endif
+
+// Return true if any of the given settings are compiled in.
+constexpr bool settingsEnabled(uint16_t features) {
+    return (uint16_t(SETTINGS_FEATURES) & features) != 0;
+}
+
+// Bits of the fourth SETTINGS_STATE event byte which are set once the state
+// of the 0x71E and 0x71F channels has been received from the BCM. Settings
+// on a channel whose bit is clear hold zero defaults.
+enum SettingsStateBit : uint8_t {
+    SETTINGS_STATE_CHANNEL_E = 6,
+    SETTINGS_STATE_CHANNEL_F = 7,
+};
 
 // Communicates with the BCM to retrieve and update body control settings.
-class Settings : public Caster::Node<Message> {
+class Settings : public VehicleNode, public Handler, public Controller {
     public:
+        // Create a settings node. If init is true the BCM is initialized
+        // once the vehicle is awake, on the first power() call which is not
+        // POWER_SLEEP or on the first emit if power() has not been called.
         Settings(bool init = true, Faker::Clock* clock = Faker::Clock::real());
 
         // Handle BCM state frames 0x72E and 0x72F.
         void handle(const Message& msg) override;
 
+        // Handle a 0x72E or 0x72F response frame in place. Return true if the
+        // frame completed a response from the BCM.
+        bool handle(const FrameView& frame) override;
+
         // Yield CAN frames to communicate with the vehicle or SETTINGS_STATE
-        // events to indicate a change to the stored settings.
+        // events to indicate a change to the stored settings. The 0x71E and
+        // 0x71F channels run independently and a SETTINGS_STATE event is
+        // yielded as soon as either channel completes with new state. The
+        // event marks which channels have reported with SettingsStateBit.
         void emit(const Caster::Yield<Message>& yield) override;
 
-    private:
-        void handleEvent(const SystemEvent& event);
-        void handleFrame(const Canny::Frame& frame);
-        void handleState(const byte* data);
-        void handleState05(const byte* data);
-        void handleState10(const byte* data);
-        void handleState21(const byte* data);
-        void handleState22(const byte* data);
-
-        SettingsInit* initE_;
-        SettingsRetrieve* retrieveE_;
-        SettingsUpdate* updateE_;
-        SettingsReset* resetE_;
-
-        SettingsInit* initF_;
-        SettingsRetrieve* retrieveF_;
-        SettingsUpdate* updateF_;
-        SettingsReset* resetF_;
-
-        bool available_;
-        Canny::Frame frame_;
-        SystemEvent event_;
-
-        bool readyE() const;
-        bool readyF() const;
-        bool ready() const;
-
-        // Exchange init frames with BCM. 
-        bool init();
-
-        // Request the current settings from the BCM.
-        bool requestCurrent();
-
-        // Toggle the auto interior illumination setting.
-        bool toggleAutoInteriorIllumination();
-
-        // Increase the auto healight sensitivity.
-        bool nextAutoHeadlightSensitivity();
+        // Emit into a batch instead of yielding each message.
+        void emit(MessageBatch* batch);
 
-        // Decrease the auto healight sensitivity.
-        bool prevAutoHeadlightSensitivity();
+        // Emit as above but leave request frames for encode() instead of
+        // yielding them. Use in place of emit() when the driver pulls frames
+        // into its transmit slots.
+        void poll(const Caster::Yield<Message>& yield);
 
-        // Increase the auto headlight off delay time.
-        bool nextAutoHeadlightOffDelay();
+        // Encode the next request or flow control frame into the slot.
+        bool encode(FrameSlot* slot) override;
 
-        // Decrease the auto headlight off delay time.
-        bool prevAutoHeadlightOffDelay();
+        // Return the time until the next request, response timeout, or
+        // flow control frame is due.
+        uint32_t nextDeadline() override;
 
-        // Toggle the speed sensing wiper interval setting.
-        bool toggleSpeedSensingWiperInterval();
+        // Set the ISO-TP block size and STmin advertised to the BCM when
+        // retrieving multi-frame settings responses. Defaults to a block
+        // size of 0 and an STmin of 10ms.
+        void flowControl(uint8_t block_size, uint8_t st_min);
 
-        // Toggle the remote key response horn setting.
-        bool toggleRemoteKeyResponseHorn();
+        // Suspend communication with the BCM while the vehicle sleeps. The
+        // BCM is initialized and the current settings retrieved each time
+        // the ignition is turned on.
+        void power(PowerMode mode) override;
 
-        // Increase the remote key response light timeout.
-        bool nextRemoteKeyResponseLights();
+        // Set the observer notified when a request sequence is abandoned
+        // because the BCM rejected a request or did not respond.
+        void observer(SettingsObserver* observer);
 
-        // Decrease the remote key response light timeout.
-        bool prevRemoteKeyResponseLights();
+    private:
+        template <typename Out>
+        void emitTo(Out& yield, bool frames);
 
-        // Increase the auto re-lock time.
-        bool nextAutoReLockTime();
+        void handleEvent(const SystemEvent& event);
+        void handleStateE(const byte* data, size_t size);
+        void handleStateF(const byte* data, size_t size);
+        void decodeState(bool channelF, const byte* data);
+
+        IsoTp transportE_;
+        IsoTp transportF_;
+
+        SettingsInit initE_;
+        SettingsRetrieve retrieveE_;
+        SettingsUpdate updateE_;
+        SettingsReset resetE_;
+
+        SettingsInit initF_;
+        SettingsRetrieve retrieveF_;
+        SettingsUpdate updateF_;
+        SettingsReset resetF_;
+
+        bool availableE_;
+        bool availableF_;
+        bool suspended_;
+        bool ignition_;
+        bool retrieve_pending_;
+        bool init_pending_;
+        Canny::Frame frame_;
+        SystemEvent event_;
 
-        // Decrease the auto re-lock time.
-        bool prevAutoReLockTime();
+        bool readyE() const;
+        bool readyF() const;
 
-        // Toggle the selective door unlock setting.
-        bool toggleSelectiveDoorUnlock();
+        // Exchange init frames with BCM. Each channel is initialized
+        // independently if it is not busy.
+        bool init();
 
-        // Toggle the "slide driver seat back on exit" setting.
-        bool toggleSlideDriverSeatBackOnExit();
+        // Request the current settings from the BCM. Each channel is
+        // requested independently if it is not busy.
+        bool requestCurrent();
 
         // Reset all settings to factory default.
         bool resetSettingsToDefault();
 
-        // Helper for triggering headlight sensitivity setting changes.
-        bool triggerAutoHeadlightSensitivity(uint8_t value);
-
-        // Helper for triggering remote key repsonse lights setting changes.
-        bool triggerRemoteKeyResponseLights(uint8_t value);
+        // Step the setting at index forward or backward through its values
+        // and send the update to the BCM. Toggles wrap around. Return false
+        // if the channel is busy or the value is already at either end.
+        bool step(uint8_t index, int8_t direction);
 };
 
 }  // namespace R51
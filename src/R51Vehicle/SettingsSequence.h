@@ -0,0 +1,184 @@
+#ifndef _R51_VEHICLE_SETTINGS_SEQUENCE_H_
+#define _R51_VEHICLE_SETTINGS_SEQUENCE_H_
+
+#include <Arduino.h>
+#include <Faker.h>
+#include "Deadline.h"
+#include "IsoTp.h"
+
+namespace R51 {
+
+// Valid frame IDs for settings.
+enum SettingsFrameId : uint32_t {
+    SETTINGS_FRAME_E = 0x71E,
+    SETTINGS_FRAME_F = 0x71F,
+};
+
+// Number of times a request is repeated when the BCM responds that it is
+// busy before the sequence is abandoned.
+#ifndef SETTINGS_BUSY_RETRIES
+#define SETTINGS_BUSY_RETRIES 2
+#endif
+
+// Number of times the timeout of a request is restarted when the BCM
+// responds that its response is pending before the sequence is abandoned.
+#ifndef SETTINGS_PENDING_RETRIES
+#define SETTINGS_PENDING_RETRIES 4
+#endif
+
+// Reasons reported when a sequence is abandoned. Negative responses are
+// reported with the response code sent by the BCM; the codes listed here
+// are the ones the sequence acts on.
+enum SettingsError : uint8_t {
+    // The BCM did not respond in time.
+    SETTINGS_ERROR_TIMEOUT = 0x00,
+    // The BCM is busy and the request should be repeated.
+    SETTINGS_ERROR_BUSY = 0x21,
+    // The BCM received the request and will respond later.
+    SETTINGS_ERROR_PENDING = 0x78,
+};
+
+// Notified when a settings sequence is abandoned before it completes.
+class SettingsObserver {
+    public:
+        virtual ~SettingsObserver() = default;
+
+        // Called when the sequence on request_id is abandoned while waiting
+        // on the response to the given request service. The reason is a
+        // SettingsError or the negative response code sent by the BCM.
+        virtual void failed(uint32_t request_id, uint8_t service, uint8_t reason) = 0;
+};
+
+// Send a sequence of requests for managing settings. Requests and responses
+// are exchanged with the BCM over an ISO-TP transport.
+class SettingsSequence {
+    public:
+        // Create a sequence that communicates over the given frame ID.
+        SettingsSequence(SettingsFrameId id, IsoTp* transport,
+                Faker::Clock* clock = Faker::Clock::real()) :
+            request_id_((uint32_t)id), transport_(transport), clock_(clock),
+            observer_(nullptr), started_(0), value_(0xFF), state_(0), retries_(0),
+            pending_retries_(0), sent_(false) {}
+
+        virtual ~SettingsSequence() = default;
+
+        // Trigger the sequence. The next call to send will queue the first
+        // request of the sequence. The sequence expects the next response to
+        // match otherwise it resets.
+        bool trigger();
+
+        // Return true if the sequence is ready to send.
+        bool ready() const { return state_ == 0; }
+
+        // Queue the next outgoing request in the sequence on the transport if
+        // available. Return true if a request was queued.
+        bool send();
+
+        // Return the time in milliseconds until send() next has a request to
+        // queue or a timeout to report. Return DEADLINE_NONE if the sequence
+        // is ready.
+        uint32_t deadline() const;
+
+        // Handle the next response message in the sequence. If the message
+        // matches the next expected response in the sequence then the
+        // sequence advances to the next state and send will queue the next
+        // request. A negative response to the current request abandons the
+        // sequence immediately unless the BCM is busy, in which case the
+        // request is repeated, or has asked for more time, in which case the
+        // timeout restarts.
+        void handle(const byte* data, size_t size);
+
+        // Set the observer notified when the sequence is abandoned.
+        void observer(SettingsObserver* observer) { observer_ = observer; }
+
+        // Abandon the sequence and return to the ready state.
+        void cancel() {
+            state_ = 0;
+            sent_ = false;
+        }
+
+    protected:
+        // The sequence's request ID.
+        uint32_t requestId() const { return request_id_; }
+
+        // The sequence's current state.
+        uint8_t state() const { return state_; }
+
+        // Set the value to send with the state requests that require value.
+        void setValue(uint8_t value) { value_ = value; }
+
+        // Return the next state. If the returned state matches the incoming
+        // message then the sequence transitions to the new state and a
+        // request for the state is sent. If this returns the current state
+        // then no state transition occurs and no request is sent.
+        virtual uint8_t next() = 0;
+
+    private:
+        const uint32_t request_id_;
+        IsoTp* transport_;
+        Faker::Clock* clock_;
+        SettingsObserver* observer_;
+        uint32_t started_;
+        uint8_t value_;
+        uint8_t state_;
+        uint8_t retries_;
+        uint8_t pending_retries_;
+        bool sent_;
+        byte payload_[3];
+
+        // Abandon the sequence and notify the observer.
+        void fail(uint8_t reason);
+};
+
+// Sequence to initialize communication with the BCM.
+class SettingsInit : public SettingsSequence {
+    public:
+        SettingsInit(SettingsFrameId id, IsoTp* transport, Faker::Clock* clock = Faker::Clock::real()) :
+            SettingsSequence(id, transport, clock) {}
+    protected:
+        uint8_t next() override;
+    private:
+        uint8_t nextE();
+        uint8_t nextF();
+};
+
+// Sequence used to retrieve settings from the BCM.
+class SettingsRetrieve : public SettingsSequence {
+    public:
+        SettingsRetrieve(SettingsFrameId id, IsoTp* transport, Faker::Clock* clock = Faker::Clock::real()) :
+            SettingsSequence(id, transport, clock) {}
+    protected:
+        uint8_t next() override;
+};
+
+// Sequence used to update a setting in the BCM.
+class SettingsUpdate : public SettingsSequence {
+    public:
+        SettingsUpdate(SettingsFrameId id, IsoTp* transport, Faker::Clock* clock = Faker::Clock::real()) :
+            SettingsSequence(id, transport, clock), update_(0) {}
+
+        // Set the item to update and its value.
+        void setPayload(uint8_t update, uint8_t value) {
+            update_ = update;
+            setValue(value);
+        }
+    protected:
+        uint8_t next() override;
+    private:
+        uint8_t update_;
+};
+
+// Sequence used to reset all settings to factory values.
+class SettingsReset : public SettingsSequence {
+    public:
+        SettingsReset(SettingsFrameId id, IsoTp* transport, Faker::Clock* clock = Faker::Clock::real()) :
+            SettingsSequence(id, transport, clock) {
+            setValue(0x00);
+        }
+    protected:
+        uint8_t next() override;
+};
+
+}  // namespace R51
+
+#endif  // _R51_VEHICLE_SETTINGS_SEQUENCE_H_
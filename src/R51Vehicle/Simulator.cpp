@@ -0,0 +1,365 @@
+#include "Simulator.h"
+
+#if defined(EPOXY_DUINO)
+
+#include <Arduino.h>
+#include <Canny.h>
+#include <Caster.h>
+#include <Faker.h>
+#include <R51Core.h>
+
+namespace R51 {
+namespace {
+
+// Factory default settings responses returned by the BCM.
+static const byte DEFAULT_STATE_E[] = {
+    0x61, 0x01, 0x00, 0x1E, 0x24, 0x00,
+    0x10, 0x0C, 0x40, 0x40, 0x01, 0x64, 0x00,
+    0x94, 0x00, 0x00, 0x47,
+};
+static const byte DEFAULT_STATE_F[] = {0x61, 0x01, 0x00, 0x00, 0x00};
+
+// Climate airflow modes in the order they are cycled.
+static const uint8_t AIRFLOW_MODES[] = {0x04, 0x08, 0x0C, 0x10};
+
+// Set a bit field within a byte.
+void setField(byte* data, uint8_t offset, uint8_t shift, uint8_t mask, uint8_t value) {
+    data[offset] = (data[offset] & ~(mask << shift)) | ((value & mask) << shift);
+}
+
+}  // namespace
+
+BCMSimulator::BCMSimulator(uint32_t response_ms, Faker::Clock* clock) :
+    clock_(clock), response_ms_(response_ms),
+    transportE_(0x72E, 0x71E, 0, 0x00, clock),
+    transportF_(0x72F, 0x71F, 0, 0x00, clock),
+    pendingE_(false), pendingF_(false), dueE_(0), dueF_(0),
+    responseE_size_(0), responseF_size_(0), frame_(0, 0, 8) {
+    reset();
+}
+
+void BCMSimulator::reset() {
+    memcpy(stateE_, DEFAULT_STATE_E, sizeof(stateE_));
+    memcpy(stateF_, DEFAULT_STATE_F, sizeof(stateF_));
+}
+
+void BCMSimulator::handle(const Message& msg) {
+    if (msg.type() != Message::CAN_FRAME) {
+        return;
+    }
+    const Canny::Frame& frame = msg.can_frame();
+    if (transportE_.handle(frame)) {
+        responseE_size_ = respond(true, transportE_.data(), transportE_.size(), responseE_);
+        pendingE_ = responseE_size_ > 0;
+        dueE_ = clock_->millis() + response_ms_;
+    } else if (transportF_.handle(frame)) {
+        responseF_size_ = respond(false, transportF_.data(), transportF_.size(), responseF_);
+        pendingF_ = responseF_size_ > 0;
+        dueF_ = clock_->millis() + response_ms_;
+    }
+}
+
+size_t BCMSimulator::respond(bool channelE, const byte* data, size_t size, byte* response) {
+    if (size == 2 && data[0] == 0x10) {
+        // enter and exit
+        response[0] = 0x50;
+        response[1] = data[1];
+        return 2;
+    } else if (size == 2 && data[0] == 0x3B) {
+        // init
+        response[0] = 0x7B;
+        response[1] = data[1];
+        memset(response + 2, 0x00, 4);
+        return 6;
+    } else if (size == 3 && data[0] == 0x3B) {
+        // update or reset
+        if (data[1] == 0x1F) {
+            reset();
+        } else {
+            update(channelE, data[1], data[2]);
+        }
+        response[0] = 0x7B;
+        response[1] = data[1];
+        return 2;
+    } else if (size == 2 && data[0] == 0x21 && data[1] == 0x01) {
+        // retrieve
+        if (channelE) {
+            memcpy(response, stateE_, sizeof(stateE_));
+            return sizeof(stateE_);
+        }
+        memcpy(response, stateF_, sizeof(stateF_));
+        return sizeof(stateF_);
+    } else if (size > 0) {
+        // service not supported
+        response[0] = 0x7F;
+        response[1] = data[0];
+        response[2] = 0x11;
+        return 3;
+    }
+    return 0;
+}
+
+void BCMSimulator::update(bool channelE, uint8_t command, uint8_t value) {
+    if (!channelE) {
+        if (command == 0x01) {
+            setField(stateF_, 2, 0, 0x01, value);
+        }
+        return;
+    }
+    switch (command) {
+        case 0x10:
+            setField(stateE_, 2, 5, 0x01, value);
+            break;
+        case 0x02:
+            setField(stateE_, 2, 7, 0x01, value);
+            break;
+        case 0x2A:
+            setField(stateE_, 5, 3, 0x01, value);
+            break;
+        case 0x2E:
+            setField(stateE_, 6, 6, 0x03, value);
+            break;
+        case 0x2F:
+            setField(stateE_, 6, 4, 0x03, value);
+            break;
+        case 0x37:
+            setField(stateE_, 7, 2, 0x03, value);
+            break;
+        case 0x39:
+            setField(stateE_, 7, 0, 0x01, value >> 2);
+            setField(stateE_, 8, 6, 0x03, value);
+            break;
+        case 0x47:
+            setField(stateE_, 13, 7, 0x01, value);
+            break;
+        default:
+            break;
+    }
+}
+
+void BCMSimulator::emit(const Caster::Yield<Message>& yield) {
+    uint32_t now = clock_->millis();
+    if (pendingE_ && (int32_t)(now - dueE_) >= 0 &&
+            transportE_.send(responseE_, responseE_size_)) {
+        pendingE_ = false;
+    }
+    if (pendingF_ && (int32_t)(now - dueF_) >= 0 &&
+            transportF_.send(responseF_, responseF_size_)) {
+        pendingF_ = false;
+    }
+    while (transportE_.read(&frame_)) {
+        yield(frame_);
+    }
+    while (transportF_.read(&frame_)) {
+        yield(frame_);
+    }
+}
+
+ClimateSimulator::ClimateSimulator(uint32_t period_ms, Faker::Clock* clock) :
+    ticker_(period_ms, clock),
+    system_control_(0x540, 0, 8), fan_control_(0x541, 0, 8),
+    temp_state_(0x54A, 0, 8), system_state_(0x54B, 0, 8),
+    on_(false), auto_(false), ac_(false), dual_(false), defrost_(false),
+    recirculate_(false), mode_(0), fan_speed_(0),
+    driver_temp_(0x3C), passenger_temp_(0x3C), outside_temp_(0x58) {
+    system_control_.data()[0] = 0x80;
+    fan_control_.data()[0] = 0x80;
+}
+
+void ClimateSimulator::handle(const Message& msg) {
+    if (msg.type() != Message::CAN_FRAME || msg.can_frame().size() < 8) {
+        return;
+    }
+    switch (msg.can_frame().id()) {
+        case 0x540:
+            handleSystemControl(msg.can_frame());
+            break;
+        case 0x541:
+            handleFanControl(msg.can_frame());
+            break;
+        default:
+            break;
+    }
+}
+
+void ClimateSimulator::handleSystemControl(const Canny::Frame& frame) {
+    const byte* prev = system_control_.data();
+    const byte* next = frame.data();
+    if (prev[0] == 0x80 || next[0] == 0x80) {
+        // init frames do not toggle anything
+        memcpy(system_control_.data(), next, 8);
+        return;
+    }
+
+    byte changed5 = prev[5] ^ next[5];
+    byte changed6 = prev[6] ^ next[6];
+    if (getBit(&changed6, 0, 7)) {
+        on_ = false;
+        auto_ = false;
+        defrost_ = false;
+    }
+    if (getBit(&changed6, 0, 5)) {
+        if (!on_) {
+            on_ = true;
+            auto_ = true;
+        } else {
+            auto_ = !auto_;
+        }
+        defrost_ = false;
+    }
+    if (getBit(&changed6, 0, 1)) {
+        defrost_ = !defrost_;
+        if (defrost_) {
+            on_ = true;
+        }
+    }
+    if (on_) {
+        if (getBit(&changed5, 0, 3)) {
+            ac_ = !ac_;
+        }
+        if (getBit(&changed6, 0, 3)) {
+            dual_ = !dual_;
+        }
+        if (getBit(&changed6, 0, 0)) {
+            mode_ = (mode_ + 1) % sizeof(AIRFLOW_MODES);
+            auto_ = false;
+            defrost_ = false;
+        }
+        if (getBit(&changed5, 0, 5)) {
+            driver_temp_ += (int8_t)(next[3] - prev[3]);
+            passenger_temp_ += (int8_t)(next[4] - prev[4]);
+            if (!dual_) {
+                passenger_temp_ = driver_temp_;
+            }
+        }
+    }
+    memcpy(system_control_.data(), next, 8);
+}
+
+void ClimateSimulator::handleFanControl(const Canny::Frame& frame) {
+    const byte* prev = fan_control_.data();
+    const byte* next = frame.data();
+    if (prev[0] == 0x80 || next[0] == 0x80) {
+        memcpy(fan_control_.data(), next, 8);
+        return;
+    }
+
+    byte changed0 = prev[0] ^ next[0];
+    byte changed1 = prev[1] ^ next[1];
+    if (getBit(&changed1, 0, 6)) {
+        recirculate_ = !recirculate_;
+    }
+    if (getBit(&changed0, 0, 5)) {
+        if (!on_) {
+            on_ = true;
+        }
+        if (fan_speed_ < 7) {
+            ++fan_speed_;
+        }
+        auto_ = false;
+    }
+    if (getBit(&changed0, 0, 4) && on_ && fan_speed_ > 1) {
+        --fan_speed_;
+        auto_ = false;
+    }
+    memcpy(fan_control_.data(), next, 8);
+}
+
+void ClimateSimulator::fillState() {
+    byte* temp = temp_state_.data();
+    temp[0] = 0x3C;
+    temp[1] = 0x3E;
+    temp[2] = 0x7F;
+    temp[3] = 0x80;
+    temp[4] = on_ ? driver_temp_ : 0x00;
+    temp[5] = on_ ? passenger_temp_ : 0x00;
+    temp[6] = 0x00;
+    temp[7] = outside_temp_;
+
+    byte* system = system_state_.data();
+    memset(system, 0x00, 8);
+    setBit(system, 0, 7, !on_);
+    setBit(system, 0, 0, on_ && auto_);
+    setBit(system, 0, 3, on_ && ac_);
+    if (!on_) {
+        system[1] = 0x00;
+    } else if (defrost_) {
+        system[1] = 0x34;
+    } else {
+        system[1] = AIRFLOW_MODES[mode_];
+        if (auto_ && system[1] != 0x10) {
+            system[1] |= 0x80;
+        }
+    }
+    uint8_t fan_speed = on_ && fan_speed_ == 0 ? 1 : fan_speed_;
+    system[2] = on_ ? fan_speed * 2 - 1 : 0x00;
+    system[3] = 0x24;
+    setBit(system, 3, 4, recirculate_);
+    setBit(system, 3, 7, dual_);
+    system[7] = 0x02;
+}
+
+void ClimateSimulator::emit(const Caster::Yield<Message>& yield) {
+    if (ticker_.active()) {
+        ticker_.reset();
+        fillState();
+        yield(temp_state_);
+        yield(system_state_);
+    }
+}
+
+bool SimulationLoop::attach(Caster::Node<Message>* node) {
+    if (nodes_count_ >= SIM_MAX_NODES) {
+        return false;
+    }
+    nodes_[nodes_count_++] = node;
+    return true;
+}
+
+bool SimulationLoop::inject(const Message& msg) {
+    return push(msg, SIM_MAX_NODES);
+}
+
+bool SimulationLoop::push(const Message& msg, size_t source) {
+    if (queue_count_ >= SIM_MAX_MESSAGES) {
+        ++dropped_;
+        return false;
+    }
+    queue_[queue_count_] = msg;
+    queue_source_[queue_count_] = source;
+    ++queue_count_;
+    return true;
+}
+
+void SimulationLoop::Collector::operator()(const Message& msg) const {
+    loop_->push(msg, source_);
+}
+
+void SimulationLoop::step(uint32_t step_ms) {
+    // Deliver the messages emitted on the previous step. Messages are not
+    // delivered back to the node which emitted them.
+    for (size_t i = 0; i < queue_count_; i++) {
+        for (size_t j = 0; j < nodes_count_; j++) {
+            if (queue_source_[i] != j) {
+                nodes_[j]->handle(queue_[i]);
+            }
+        }
+    }
+    queue_count_ = 0;
+
+    for (size_t j = 0; j < nodes_count_; j++) {
+        nodes_[j]->emit(Collector(this, j));
+    }
+    clock_->delay(step_ms);
+}
+
+void SimulationLoop::run(uint32_t duration_ms, uint32_t step_ms) {
+    uint32_t start = clock_->millis();
+    while (clock_->millis() - start < duration_ms) {
+        step(step_ms);
+    }
+}
+
+}  // namespace R51
+
+#endif  // defined(EPOXY_DUINO)
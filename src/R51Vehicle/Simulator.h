@@ -0,0 +1,197 @@
+#ifndef _R51_VEHICLE_SIMULATOR_H_
+#define _R51_VEHICLE_SIMULATOR_H_
+
+// Vehicle simulation for native test builds.
+#if defined(EPOXY_DUINO)
+
+#include <Arduino.h>
+#include <Canny.h>
+#include <Caster.h>
+#include <Faker.h>
+#include <R51Core.h>
+#include "IsoTp.h"
+
+namespace R51 {
+
+// Maximum number of nodes attached to a simulation loop.
+#ifndef SIM_MAX_NODES
+#define SIM_MAX_NODES 16
+#endif
+
+// Maximum number of messages in flight during a single simulation step.
+#ifndef SIM_MAX_MESSAGES
+#define SIM_MAX_MESSAGES 64
+#endif
+
+// Simulates the BCM side of the 0x71E/0x71F <-> 0x72E/0x72F settings dialog.
+// Responses are sent a fixed delay after each request.
+class BCMSimulator : public Caster::Node<Message> {
+    public:
+        BCMSimulator(uint32_t response_ms = 5, Faker::Clock* clock = Faker::Clock::real());
+
+        // Handle settings requests.
+        void handle(const Message& msg) override;
+
+        // Yield settings responses once the response delay has passed.
+        void emit(const Caster::Yield<Message>& yield) override;
+
+        // Return the settings state returned on the E and F channels. These
+        // start with the factory defaults.
+        const byte* stateE() const { return stateE_; }
+        const byte* stateF() const { return stateF_; }
+
+    private:
+        Faker::Clock* clock_;
+        uint32_t response_ms_;
+        IsoTp transportE_;
+        IsoTp transportF_;
+        bool pendingE_;
+        bool pendingF_;
+        uint32_t dueE_;
+        uint32_t dueF_;
+        byte responseE_[20];
+        size_t responseE_size_;
+        byte responseF_[8];
+        size_t responseF_size_;
+        byte stateE_[17];
+        byte stateF_[5];
+        Canny::Frame frame_;
+
+        void reset();
+        size_t respond(bool channelE, const byte* data, size_t size, byte* response);
+        void update(bool channelE, uint8_t command, uint8_t value);
+};
+
+// Simulates the climate control unit. The unit broadcasts 0x54A and 0x54B
+// state frames and reacts to bit toggles in the 0x540 and 0x541 control
+// frames.
+class ClimateSimulator : public Caster::Node<Message> {
+    public:
+        ClimateSimulator(uint32_t period_ms = 100, Faker::Clock* clock = Faker::Clock::real());
+
+        // Handle 0x540 and 0x541 control frames.
+        void handle(const Message& msg) override;
+
+        // Yield 0x54A and 0x54B state frames on each period.
+        void emit(const Caster::Yield<Message>& yield) override;
+
+        // Simulated state.
+        bool on() const { return on_; }
+        bool autoMode() const { return auto_; }
+        bool ac() const { return ac_; }
+        bool dual() const { return dual_; }
+        bool recirculate() const { return recirculate_; }
+        uint8_t fanSpeed() const { return fan_speed_; }
+        uint8_t driverTemp() const { return driver_temp_; }
+        uint8_t passengerTemp() const { return passenger_temp_; }
+
+        // Set the outside temperature reported by the unit.
+        void outsideTemp(uint8_t temp) { outside_temp_ = temp; }
+
+    private:
+        Ticker ticker_;
+        Canny::Frame system_control_;
+        Canny::Frame fan_control_;
+        Canny::Frame temp_state_;
+        Canny::Frame system_state_;
+        bool on_;
+        bool auto_;
+        bool ac_;
+        bool dual_;
+        bool defrost_;
+        bool recirculate_;
+        uint8_t mode_;
+        uint8_t fan_speed_;
+        uint8_t driver_temp_;
+        uint8_t passenger_temp_;
+        uint8_t outside_temp_;
+
+        void handleSystemControl(const Canny::Frame& frame);
+        void handleFanControl(const Canny::Frame& frame);
+        void fillState();
+};
+
+// Broadcasts a fixed frame on a period. Used to simulate the ECM, IPDM, and
+// TPMS broadcasts.
+class FrameBroadcaster : public Caster::Node<Message> {
+    public:
+        FrameBroadcaster(const Canny::Frame& frame, uint32_t period_ms,
+                Faker::Clock* clock = Faker::Clock::real()) :
+            frame_(frame), ticker_(period_ms, clock) {}
+
+        // Broadcasters ignore incoming messages.
+        void handle(const Message&) override {}
+
+        // Yield the frame on each period.
+        void emit(const Caster::Yield<Message>& yield) override {
+            if (ticker_.active()) {
+                ticker_.reset();
+                yield(frame_);
+            }
+        }
+
+        // Return a pointer to the broadcast frame so its payload can be
+        // changed.
+        Canny::Frame* frame() { return &frame_; }
+
+    private:
+        Canny::Frame frame_;
+        Ticker ticker_;
+};
+
+// Drives a set of nodes in a closed loop in virtual time. Every message
+// emitted by a node is delivered to every other node on the next step.
+class SimulationLoop {
+    public:
+        SimulationLoop(Faker::FakeClock* clock) :
+            clock_(clock), nodes_count_(0), queue_count_(0), dropped_(0) {}
+
+        // Attach a node to the loop. Return false if the loop is full.
+        bool attach(Caster::Node<Message>* node);
+
+        // Inject a message into the loop. It is delivered to every node on
+        // the next step. Return false if the message was dropped because
+        // SIM_MAX_MESSAGES are already in flight.
+        bool inject(const Message& msg);
+
+        // Run a single step: deliver queued messages, call emit on all nodes,
+        // and advance the clock by step_ms.
+        void step(uint32_t step_ms = 1);
+
+        // Run steps until the clock has advanced by duration_ms.
+        void run(uint32_t duration_ms, uint32_t step_ms = 1);
+
+        // Return the current virtual time.
+        uint32_t millis() const { return clock_->millis(); }
+
+        // Return the number of injected or emitted messages dropped because
+        // the queue was full.
+        uint32_t dropped() const { return dropped_; }
+
+    private:
+        class Collector : public Caster::Yield<Message> {
+            public:
+                Collector(SimulationLoop* loop, size_t source) :
+                    loop_(loop), source_(source) {}
+                void operator()(const Message& msg) const override;
+            private:
+                SimulationLoop* loop_;
+                size_t source_;
+        };
+
+        Faker::FakeClock* clock_;
+        Caster::Node<Message>* nodes_[SIM_MAX_NODES];
+        size_t nodes_count_;
+        Message queue_[SIM_MAX_MESSAGES];
+        size_t queue_source_[SIM_MAX_MESSAGES];
+        size_t queue_count_;
+        uint32_t dropped_;
+
+        bool push(const Message& msg, size_t source);
+};
+
+}  // namespace R51
+
+#endif  // defined(EPOXY_DUINO)
+
+#endif  // _R51_VEHICLE_SIMULATOR_H_
@@ -0,0 +1,252 @@
+#ifndef _R51_VEHICLE_SOCKET_CAN_H_
+#define _R51_VEHICLE_SOCKET_CAN_H_
+
+// Linux SocketCAN driver for native builds.
+#if defined(EPOXY_DUINO) && defined(__linux__)
+
+#include <Arduino.h>
+#include <Canny.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <net/if.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "Controller.h"
+#include "Handler.h"
+
+namespace R51 {
+
+// Maximum number of frames read from the socket in a single syscall.
+#ifndef SOCKETCAN_BATCH_SIZE
+#define SOCKETCAN_BATCH_SIZE 32
+#endif
+
+// Reads and writes classic CAN frames on a raw SocketCAN interface. Frames
+// are received in batches with recvmmsg and carry the kernel receive
+// timestamp. Received frames may be viewed in place in the receive buffer
+// and control frames encoded in place into the transmit buffer, which is
+// sent in one sendmmsg call. The socket is non-blocking so callers poll
+// fd() for readiness.
+class SocketCan {
+    public:
+        SocketCan() : fd_(-1), count_(0), reads_(0), dropped_(0) {
+            memset(msgs_, 0, sizeof(msgs_));
+            memset(tx_, 0, sizeof(tx_));
+            memset(tx_msgs_, 0, sizeof(tx_msgs_));
+            for (size_t i = 0; i < SOCKETCAN_BATCH_SIZE; ++i) {
+                iov_[i].iov_base = &raw_[i];
+                iov_[i].iov_len = sizeof(raw_[i]);
+                msgs_[i].msg_hdr.msg_iov = &iov_[i];
+                msgs_[i].msg_hdr.msg_iovlen = 1;
+                msgs_[i].msg_hdr.msg_control = control_[i];
+                tx_iov_[i].iov_base = &tx_[i];
+                tx_iov_[i].iov_len = sizeof(tx_[i]);
+                tx_msgs_[i].msg_hdr.msg_iov = &tx_iov_[i];
+                tx_msgs_[i].msg_hdr.msg_iovlen = 1;
+            }
+        }
+
+        ~SocketCan() { close(); }
+
+        // Open the named interface, e.g. "can0" or "vcan0". Return false on
+        // error with errno set.
+        bool open(const char* ifname) {
+            close();
+            fd_ = ::socket(PF_CAN, SOCK_RAW, CAN_RAW);
+            if (fd_ < 0) {
+                return false;
+            }
+
+            struct ifreq ifr;
+            memset(&ifr, 0, sizeof(ifr));
+            strncpy(ifr.ifr_name, ifname, IFNAMSIZ - 1);
+            struct sockaddr_can addr;
+            memset(&addr, 0, sizeof(addr));
+            int on = 1;
+            if (::ioctl(fd_, SIOCGIFINDEX, &ifr) < 0 ||
+                    ::setsockopt(fd_, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) < 0 ||
+                    ::fcntl(fd_, F_SETFL, ::fcntl(fd_, F_GETFL) | O_NONBLOCK) < 0) {
+                close();
+                return false;
+            }
+            addr.can_family = AF_CAN;
+            addr.can_ifindex = ifr.ifr_ifindex;
+            if (::bind(fd_, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+                close();
+                return false;
+            }
+            return true;
+        }
+
+        // Close the socket.
+        void close() {
+            if (fd_ >= 0) {
+                ::close(fd_);
+                fd_ = -1;
+            }
+            count_ = 0;
+        }
+
+        // Return the socket file descriptor or -1 if closed.
+        int fd() const { return fd_; }
+
+        // Read the pending frames in one syscall. Return the number of frames
+        // now available through view(), frame(), and timestamp(). Error and
+        // remote request frames are skipped.
+        size_t read() {
+            count_ = 0;
+            if (fd_ < 0) {
+                return 0;
+            }
+            for (size_t i = 0; i < SOCKETCAN_BATCH_SIZE; ++i) {
+                msgs_[i].msg_hdr.msg_controllen = sizeof(control_[i]);
+            }
+            int n = ::recvmmsg(fd_, msgs_, SOCKETCAN_BATCH_SIZE, MSG_DONTWAIT, nullptr);
+            if (n <= 0) {
+                return 0;
+            }
+            ++reads_;
+            for (int i = 0; i < n; ++i) {
+                const struct can_frame& raw = raw_[i];
+                if ((raw.can_id & (CAN_ERR_FLAG | CAN_RTR_FLAG)) != 0 ||
+                        msgs_[i].msg_len < sizeof(struct can_frame)) {
+                    continue;
+                }
+                index_[count_] = i;
+                timestamps_[count_] = timestamp(msgs_[i].msg_hdr);
+                ++count_;
+            }
+            return count_;
+        }
+
+        // Return a view of a frame from the most recent read. The view
+        // borrows the receive buffer and is valid until the next read.
+        FrameView view(size_t index) const {
+            const struct can_frame& raw = raw_[index_[index]];
+            bool ext = (raw.can_id & CAN_EFF_FLAG) != 0;
+            return FrameView(raw.can_id & (ext ? CAN_EFF_MASK : CAN_SFF_MASK), ext,
+                    raw.data, raw.can_dlc > 8 ? 8 : raw.can_dlc);
+        }
+
+        // Return a frame from the most recent read. The frame is copied out
+        // of the receive buffer. Prefer view() for nodes which implement
+        // Handler.
+        const Canny::Frame& frame(size_t index) const {
+            FrameView view = this->view(index);
+            Canny::Frame& frame = frames_[index];
+            frame.id(view.id(), view.ext());
+            frame.resize(view.size());
+            memcpy(frame.data(), view.data(), view.size());
+            return frame;
+        }
+
+        // Return the kernel receive time of a frame from the most recent read
+        // in nanoseconds since the epoch.
+        uint64_t timestamp(size_t index) const { return timestamps_[index]; }
+
+        // Write a frame. Return false if the frame could not be queued.
+        bool write(const Canny::Frame& frame) {
+            if (fd_ < 0) {
+                return false;
+            }
+            struct can_frame raw;
+            memset(&raw, 0, sizeof(raw));
+            raw.can_id = frame.id();
+            if (frame.ext()) {
+                raw.can_id |= CAN_EFF_FLAG;
+            }
+            raw.can_dlc = frame.size() > 8 ? 8 : frame.size();
+            memcpy(raw.data, frame.data(), raw.can_dlc);
+            if (::write(fd_, &raw, sizeof(raw)) != sizeof(raw)) {
+                ++dropped_;
+                return false;
+            }
+            return true;
+        }
+
+        // Encode the control frames due from the controller directly into the
+        // transmit buffer and write them in one syscall. Return the number of
+        // frames written. At most SOCKETCAN_BATCH_SIZE frames are written per
+        // call.
+        size_t write(Controller* controller) {
+            if (fd_ < 0) {
+                return 0;
+            }
+            size_t count = 0;
+            while (count < SOCKETCAN_BATCH_SIZE) {
+                struct can_frame& raw = tx_[count];
+                FrameSlot slot(raw.data);
+                if (!controller->encode(&slot)) {
+                    break;
+                }
+                raw.can_id = slot.id();
+                if (slot.ext()) {
+                    raw.can_id |= CAN_EFF_FLAG;
+                }
+                raw.can_dlc = slot.size();
+                ++count;
+            }
+            if (count == 0) {
+                return 0;
+            }
+            int n = ::sendmmsg(fd_, tx_msgs_, count, MSG_DONTWAIT);
+            if (n < 0) {
+                n = 0;
+            }
+            dropped_ += count - n;
+            return n;
+        }
+
+        // Return the number of read syscalls which returned frames.
+        uint32_t reads() const { return reads_; }
+
+        // Return the number of frames which could not be written.
+        uint32_t dropped() const { return dropped_; }
+
+        // Return the current time in nanoseconds since the epoch for
+        // comparison with frame timestamps.
+        static uint64_t now() {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+        }
+
+    private:
+        int fd_;
+        size_t count_;
+        uint32_t reads_;
+        uint32_t dropped_;
+        struct can_frame raw_[SOCKETCAN_BATCH_SIZE];
+        struct iovec iov_[SOCKETCAN_BATCH_SIZE];
+        struct mmsghdr msgs_[SOCKETCAN_BATCH_SIZE];
+        char control_[SOCKETCAN_BATCH_SIZE][CMSG_SPACE(sizeof(struct timespec))];
+        size_t index_[SOCKETCAN_BATCH_SIZE];
+        mutable Canny::Frame frames_[SOCKETCAN_BATCH_SIZE];
+        uint64_t timestamps_[SOCKETCAN_BATCH_SIZE];
+        struct can_frame tx_[SOCKETCAN_BATCH_SIZE];
+        struct iovec tx_iov_[SOCKETCAN_BATCH_SIZE];
+        struct mmsghdr tx_msgs_[SOCKETCAN_BATCH_SIZE];
+
+        static uint64_t timestamp(const struct msghdr& hdr) {
+            for (struct cmsghdr* c = CMSG_FIRSTHDR(&hdr); c != nullptr;
+                    c = CMSG_NXTHDR((struct msghdr*)&hdr, c)) {
+                if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+                    struct timespec ts;
+                    memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+                    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+                }
+            }
+            return now();
+        }
+};
+
+}  // namespace R51
+
+#endif  // defined(EPOXY_DUINO) && defined(__linux__)
+
+#endif  // _R51_VEHICLE_SOCKET_CAN_H_
@@ -7,7 +7,7 @@
 namespace R51 {
 namespace {
 
-uint8_t getPressureValue(const Canny::Frame& frame, int tire) {
+uint8_t getPressureValue(const FrameView& frame, int tire) {
     if (getBit(frame.data(), 7, 7-tire)) {
         return frame.data()[2+tire];
     }
@@ -17,14 +17,15 @@ uint8_t getPressureValue(const Canny::Frame& frame, int tire) {
 }  // namespace
 
 TirePressureState::TirePressureState(uint32_t tick_ms, Faker::Clock* clock) :
-    changed_(false),
+    changed_(false), suspended_(false),
     event_(Event::TIRE_PRESSURE_STATE, {0x00, 0x00, 0x00, 0x00}),
-    ticker_(tick_ms, clock), map_{0, 1, 2, 3} {}
+    heartbeat_(tick_ms, clock), source_(0x385, TIRES_FRAME_PERIOD, clock),
+    map_{0, 1, 2, 3} {}
 
 void TirePressureState::handle(const Message& msg) {
     switch (msg.type()) {
         case Message::CAN_FRAME:
-            handleFrame(msg.can_frame());
+            handle(FrameView(msg.can_frame()));
             break;
         case Message::SYSTEM_EVENT:
             handleEvent(msg.system_event());
@@ -34,18 +35,22 @@ void TirePressureState::handle(const Message& msg) {
     }
 }
 
-void TirePressureState::handleFrame(const Canny::Frame& frame) {
+bool TirePressureState::handle(const FrameView& frame) {
     if (frame.id() != 0x385 || frame.size() != 8) {
-        return;
+        return false;
     }
+    // Publish the current value as soon as the TPMS returns.
+    bool changed = source_.received();
 
     for (int i = 0; i < 4; i++) {
         uint8_t value = getPressureValue(frame, map_[i]);
         if (event_.data[i] != value) {
             event_.data[i] = value;
-            changed_ = true;
+            changed = true;
         }
     }
+    changed_ |= changed;
+    return changed;
 }
 
 void TirePressureState::handleEvent(const SystemEvent& event) {
@@ -74,11 +79,26 @@ void TirePressureState::handleEvent(const SystemEvent& event) {
 }
 
 void TirePressureState::emit(const Caster::Yield<Message>& yield) {
-    if (changed_ || ticker_.active()) {
-        ticker_.reset();
+    bool stale = source_.stale();
+    if (changed_ || (!suspended_ && !stale && heartbeat_.active())) {
+        if (changed_) {
+            heartbeat_.change();
+        }
+        heartbeat_.reset();
         yield(event_);
         changed_ = false;
     }
 }
 
+uint32_t TirePressureState::nextDeadline() {
+    if (changed_) {
+        return 0;
+    }
+    uint32_t next = source_.deadline();
+    if (!suspended_ && !source_.expired()) {
+        next = earliestDeadline(next, heartbeat_.deadline());
+    }
+    return next;
+}
+
 }  // namespace R51
@@ -4,12 +4,24 @@
 #include <Arduino.h>
 #include <Canny.h>
 #include <Caster.h>
+#include <Faker.h>
 #include <R51Core.h>
+#include "Deadline.h"
+#include "Freshness.h"
+#include "Handler.h"
+#include "Heartbeat.h"
+#include "Node.h"
 
 namespace R51 {
 
-// Track tire pressure as reported in the 0x385 CAN frame.
-class TirePressureState : public Caster::Node<Message> {
+// Expected broadcast period of the TPMS 0x385 frame in milliseconds.
+#ifndef TIRES_FRAME_PERIOD
+#define TIRES_FRAME_PERIOD 1000
+#endif
+
+// Track tire pressure as reported in the 0x385 CAN frame. Periodic re-emits
+// stop while the frame is stale.
+class TirePressureState : public VehicleNode, public Handler {
     public:
         TirePressureState(uint32_t tick_ms = 0, Faker::Clock* clock = Faker::Clock::real());
 
@@ -17,16 +29,38 @@ class TirePressureState : public Caster::Node<Message> {
         // changed as a result of handling the frame.
         void handle(const Message& msg) override;
 
+        // Handle a 0x385 state frame in place. Return true if the state
+        // changed.
+        bool handle(const FrameView& frame) override;
+
         // Yield a TIRE_PRESSURE_STATE frame on change or tick.
         void emit(const Caster::Yield<Message>& yield) override;
 
+        // Return the time until the next change or periodic re-emit is
+        // emitted or the 0x385 frame goes stale.
+        uint32_t nextDeadline() override;
+
+        // Suspend periodic re-emits while the vehicle sleeps.
+        void power(PowerMode mode) override { suspended_ = mode == POWER_SLEEP; }
+
+        // Back off periodic re-emits up to max_ms while the state holds.
+        // See Heartbeat.
+        void backoff(uint32_t max_ms, uint8_t fast = HEARTBEAT_FAST_COUNT) {
+            heartbeat_.backoff(max_ms, fast);
+        }
+
+        // Set the observer notified when the TPMS stops or resumes
+        // broadcasting 0x385.
+        void observer(FreshnessObserver* observer) { source_.observer(observer); }
+
     private:
         bool changed_;
+        bool suspended_;
         SystemEvent event_;
-        Ticker ticker_;
+        Heartbeat heartbeat_;
+        Freshness source_;
         uint8_t map_[4];
 
-        void handleFrame(const Canny::Frame& frame);
         void handleEvent(const SystemEvent& event);
 };
 
@@ -11,6 +11,32 @@ enum Units : uint8_t {
     UNITS_US = 1,
 };
 
+// Divide n by d rounding halves away from zero. The divisor must be
+// positive.
+constexpr int32_t roundDiv(int32_t n, int32_t d) {
+    return n >= 0 ? (n + d / 2) / d : -((-n + d / 2) / d);
+}
+
+// Convert a whole degree Celsius temperature to Fahrenheit. Conversions are
+// integer only and round halves away from zero, e.g. 1C is 33.8F and rounds
+// to 34F.
+constexpr int16_t celsiusToFahrenheit(int16_t c) {
+    return roundDiv((int32_t)c * 9, 5) + 32;
+}
+
+// Convert a whole degree Fahrenheit temperature to Celsius. Conversions are
+// integer only and round halves away from zero, e.g. 72F is 22.2C and rounds
+// to 22C.
+constexpr int16_t fahrenheitToCelsius(int16_t f) {
+    return roundDiv(((int32_t)f - 32) * 5, 9);
+}
+
+// Convert a temperature between units.
+constexpr int16_t convertTemp(int16_t value, Units from, Units to) {
+    return from == to ? value :
+        to == UNITS_US ? celsiusToFahrenheit(value) : fahrenheitToCelsius(value);
+}
+
 }  // namespace R51
 
 #endif  // _R51_VEHICLE_UNITS_H_
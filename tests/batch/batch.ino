@@ -0,0 +1,109 @@
+#include <AUnit.h>
+#include <Arduino.h>
+#include <Faker.h>
+#include <R51Test.h>
+#include <R51Vehicle.h>
+
+namespace R51 {
+
+using namespace aunit;
+using ::Canny::Frame;
+using ::Faker::FakeClock;
+
+test(BatchTest, PushAndFlush) {
+    FakeYield yield;
+    Frame frame(0x540, 0, {0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+    SystemEvent event(Event::ENGINE_TEMP_STATE, {0x29});
+
+    MessageBatch batch;
+    assertTrue(batch.push(frame));
+    assertTrue(batch.push(event));
+    assertEqual(batch.size(), 2u);
+    assertTrue(batch.type(0) == Message::CAN_FRAME);
+    assertTrue(batch.type(1) == Message::SYSTEM_EVENT);
+
+    // payloads are copied
+    frame.data()[0] = 0x00;
+    event.data[0] = 0x00;
+
+    batch.flush(yield);
+    assertSize(yield, 2);
+    assertIsCANFrame(yield.messages()[0],
+            Frame(0x540, 0, {0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}));
+    assertIsSystemEvent(yield.messages()[1],
+            SystemEvent(Event::ENGINE_TEMP_STATE, {0x29}));
+
+    batch.clear();
+    assertEqual(batch.size(), 0u);
+}
+
+test(BatchTest, Overflow) {
+    SystemEvent event(Event::ENGINE_TEMP_STATE, {0x29});
+    MessageBatch batch;
+    for (size_t i = 0; i < BATCH_SIZE; ++i) {
+        assertTrue(batch.push(event));
+    }
+    assertFalse(batch.push(event));
+    assertEqual(batch.size(), (size_t)BATCH_SIZE);
+    assertEqual(batch.overflow(), 1u);
+}
+
+test(BatchTest, CollectFromYield) {
+    FakeClock clock;
+    MessageBatch batch;
+    BatchYield yield(&batch);
+
+    EngineTempState ecm(0, &clock);
+    ecm.handle(Frame(0x551, 0, {0x29, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}));
+    ecm.emit(yield);
+    assertEqual(batch.size(), 1u);
+    assertTrue(batch.type(0) == Message::SYSTEM_EVENT);
+    assertEqual(batch.system_event(0).data[0], 0x29);
+}
+
+test(BatchTest, ClimateMatchesYield) {
+    FakeClock clock;
+    FakeYield yield;
+    MessageBatch batch;
+    Climate batched(100, &clock);
+    Climate yielded(100, &clock);
+
+    Frame state54A(0x54A, 0, {0x3C, 0x3E, 0x7F, 0x80, 0x3C, 0x41, 0x00, 0x58});
+    Frame state54B(0x54B, 0, {0x59, 0x8C, 0x05, 0x24, 0x00, 0x00, 0x00, 0x02});
+
+    clock.set(1000);
+    batched.handle(state54A);
+    batched.handle(state54B);
+    yielded.handle(state54A);
+    yielded.handle(state54B);
+    batched.emit(&batch);
+    yielded.emit(yield);
+
+    assertSize(yield, 5);
+    assertEqual(batch.size(), 5u);
+    FakeYield flushed;
+    batch.flush(flushed);
+    for (size_t i = 0; i < 5; ++i) {
+        if (yield.messages()[i].type() == Message::CAN_FRAME) {
+            assertIsCANFrame(flushed.messages()[i], yield.messages()[i].can_frame());
+        } else {
+            assertIsSystemEvent(flushed.messages()[i], yield.messages()[i].system_event());
+        }
+    }
+}
+
+}  // namespace R51
+
+// Test boilerplate.
+void setup() {
+#ifdef ARDUINO
+    delay(1000);
+#endif
+    SERIAL_PORT_MONITOR.begin(115200);
+    while(!SERIAL_PORT_MONITOR);
+}
+
+void loop() {
+    aunit::TestRunner::run();
+    delay(1);
+}
@@ -0,0 +1,273 @@
+#include <AUnit.h>
+#include <Arduino.h>
+#include <Canny.h>
+#include <Caster.h>
+#include <Faker.h>
+#include <R51Core.h>
+#include <R51Test.h>
+#include <R51Vehicle.h>
+
+namespace R51 {
+
+using namespace aunit;
+using ::Canny::Frame;
+using ::Faker::FakeClock;
+
+// Collects printed output and splits it into lines.
+class LinePrint : public Print {
+    public:
+        LinePrint() : size_(0), lines_(0) {
+            memset(buffer_, 0, sizeof(buffer_));
+        }
+
+        size_t write(uint8_t c) override {
+            if (size_ >= sizeof(buffer_) - 1) {
+                return 0;
+            }
+            if (c == '\n') {
+                ++lines_;
+                c = 0;
+            }
+            buffer_[size_++] = c;
+            return 1;
+        }
+
+        // Return the number of complete lines.
+        size_t lines() const { return lines_; }
+
+        // Return the line at index i without its trailing newline.
+        const char* line(size_t i) const {
+            const char* p = buffer_;
+            for (; i > 0 && p < buffer_ + size_; --i) {
+                p += strlen(p) + 1;
+            }
+            return p;
+        }
+
+        void clear() {
+            memset(buffer_, 0, sizeof(buffer_));
+            size_ = 0;
+            lines_ = 0;
+        }
+
+    private:
+        char buffer_[2048];
+        size_t size_;
+        size_t lines_;
+};
+
+// Emit until the dump completes. Return the number of emits.
+size_t drain(BlackBox* box) {
+    FakeYield yield;
+    size_t emits = 0;
+    while (box->dumping()) {
+        box->emit(yield);
+        ++emits;
+    }
+    return emits;
+}
+
+test(BlackBoxTest, DumpLastFramesPerId) {
+    FakeClock clock;
+    LinePrint out;
+    BlackBox box(&out, &clock);
+
+    for (uint8_t i = 0; i < BLACK_BOX_DEPTH + 2; ++i) {
+        clock.set(i * 10);
+        box.handle(Frame(0x551, 0, {i, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}));
+    }
+    box.trigger();
+    drain(&box);
+
+    assertEqual(out.lines(), (size_t)(BLACK_BOX_DEPTH + 2));
+    assertEqual(out.line(0), "# trigger at 50");
+    for (uint8_t i = 0; i < BLACK_BOX_DEPTH; ++i) {
+        uint64_t timestamp;
+        Frame frame;
+        assertTrue(parseCanDump(out.line(i + 1), &timestamp, &frame));
+        assertEqual(timestamp, (uint64_t)(i + 2) * 10000);
+        assertEqual(frame.id(), (uint32_t)0x551);
+        assertEqual(frame.size(), (uint8_t)8);
+        assertEqual(frame.data()[0], (byte)(i + 2));
+    }
+    assertEqual(out.line(BLACK_BOX_DEPTH + 1), "# end");
+    assertEqual(box.dumps(), (uint32_t)1);
+}
+
+test(BlackBoxTest, DumpOldestFirstAcrossIds) {
+    FakeClock clock;
+    LinePrint out;
+    BlackBox box(&out, &clock);
+
+    box.handle(Frame(0x54A, 0, {0x01}));
+    clock.set(1005);
+    box.handle(Frame(0x72E, 0, {0x02, 0x50, 0xC0}));
+    clock.set(1010);
+    box.handle(Frame(0x54A, 0, {0x02}));
+    box.trigger();
+    drain(&box);
+
+    assertEqual(out.lines(), (size_t)5);
+    assertEqual(out.line(1), "(0000000000.000000) blackbox 54A#01");
+    assertEqual(out.line(2), "(0000000001.005000) blackbox 72E#0250C0");
+    assertEqual(out.line(3), "(0000000001.010000) blackbox 54A#02");
+}
+
+test(BlackBoxTest, IgnoreUnrecordedFrames) {
+    FakeClock clock;
+    LinePrint out;
+    BlackBox box(&out, &clock);
+
+    box.handle(Frame(0x540, 0, {0x60, 0x40}));
+    box.handle(Frame(0x551, 1, {0x50}));
+    box.trigger();
+    drain(&box);
+
+    assertEqual(out.lines(), (size_t)2);
+    assertEqual(out.line(0), "# trigger at 0");
+    assertEqual(out.line(1), "# end");
+}
+
+test(BlackBoxTest, DumpOnTriggerEvent) {
+    FakeClock clock;
+    LinePrint out;
+    BlackBox box(&out, &clock);
+    box.triggerEvent(Event::SETTINGS_REQUEST_CURRENT);
+
+    box.handle(SystemEvent(Event::CLIMATE_TOGGLE_AC));
+    assertFalse(box.dumping());
+
+    box.handle(SystemEvent(Event::SETTINGS_REQUEST_CURRENT));
+    assertTrue(box.dumping());
+    drain(&box);
+    assertEqual(out.line(0), "# trigger at 0");
+}
+
+test(BlackBoxTest, DumpIncrementally) {
+    FakeClock clock;
+    FakeYield yield;
+    LinePrint out;
+    BlackBox box(&out, &clock);
+
+    for (uint8_t i = 0; i < BLACK_BOX_DEPTH; ++i) {
+        box.handle(Frame(0x54A, 0, {i}));
+        box.handle(Frame(0x54B, 0, {i}));
+        box.handle(Frame(0x625, 0, {i}));
+    }
+    box.trigger();
+    box.emit(yield);
+    assertEqual(out.lines(), (size_t)BLACK_BOX_DUMP_LINES);
+
+    // frames received while dumping are not recorded
+    box.handle(Frame(0x551, 0, {0x50}));
+    size_t emits = drain(&box) + 1;
+    size_t lines = 3 * BLACK_BOX_DEPTH + 2;
+    assertEqual(out.lines(), lines);
+    assertEqual(emits, (lines + BLACK_BOX_DUMP_LINES - 1) / BLACK_BOX_DUMP_LINES);
+
+    // recording resumes once the dump completes
+    out.clear();
+    clock.set(10);
+    box.handle(Frame(0x551, 0, {0x50}));
+    box.trigger();
+    drain(&box);
+    assertEqual(out.line(out.lines() - 2), "(0000000000.010000) blackbox 551#50");
+}
+
+test(BlackBoxTest, DumpOnUnexpectedAirflowMode) {
+    FakeClock clock;
+    LinePrint out;
+    BlackBox box(&out, &clock);
+    Climate climate(0, &clock);
+    climate.observer(&box);
+
+    Frame known(0x54B, 0, {0x59, 0x84, 0x05, 0x24, 0x00, 0x00, 0x00, 0x02});
+    Frame unknown(0x54B, 0, {0x59, 0x7C, 0x05, 0x24, 0x00, 0x00, 0x00, 0x02});
+
+    climate.handle(known);
+    box.handle(known);
+    assertFalse(box.dumping());
+
+    // the node reports the frame before the black box has recorded it
+    clock.set(100);
+    climate.handle(unknown);
+    box.handle(unknown);
+    assertTrue(box.dumping());
+    drain(&box);
+
+    assertEqual(out.lines(), (size_t)4);
+    assertEqual(out.line(0), "# unexpected 54B at 100");
+    assertEqual(out.line(1), "(0000000000.000000) blackbox 54B#5984052400000002");
+    assertEqual(out.line(2), "(0000000000.100000) blackbox 54B#597C052400000002");
+    assertEqual(out.line(3), "# end");
+}
+
+test(BlackBoxTest, DumpOnSettingsTimeout) {
+    FakeClock clock;
+    FakeYield yield;
+    LinePrint out;
+    BlackBox box(&out, &clock);
+    Settings settings(false, &clock);
+    settings.observer(&box);
+
+    settings.handle(SystemEvent(Event::SETTINGS_TOGGLE_AUTO_INTERIOR_ILLUMINATAION));
+    settings.emit(yield);
+    assertSize(yield, 1);
+    box.handle(yield.messages()[0]);
+
+    clock.delay(500);
+    settings.emit(yield);
+    assertTrue(box.dumping());
+    drain(&box);
+
+    assertEqual(out.lines(), (size_t)3);
+    assertEqual(out.line(0), "# failed 71E service 10 reason 0 at 500");
+    assertEqual(out.line(1), "(0000000000.000000) blackbox 71E#0210C0FFFFFFFFFF");
+}
+
+test(BlackBoxTest, HoldoffAnomalies) {
+    FakeClock clock;
+    LinePrint out;
+    BlackBox box(&out, &clock);
+    Frame frame(0x54B, 0, {0x59, 0x7C, 0x05, 0x24, 0x00, 0x00, 0x00, 0x02});
+    FrameView view(frame);
+
+    box.unexpected(view);
+    drain(&box);
+    assertEqual(box.dumps(), (uint32_t)1);
+
+    // repeated anomalies are suppressed
+    clock.set(BLACK_BOX_HOLDOFF - 1);
+    box.unexpected(view);
+    box.failed(0x71E, 0x10, SETTINGS_ERROR_TIMEOUT);
+    assertFalse(box.dumping());
+    assertEqual(box.suppressed(), (uint32_t)2);
+
+    // explicit triggers are not
+    box.trigger();
+    assertTrue(box.dumping());
+    drain(&box);
+
+    clock.set(2 * BLACK_BOX_HOLDOFF);
+    box.unexpected(view);
+    assertTrue(box.dumping());
+    drain(&box);
+    assertEqual(box.dumps(), (uint32_t)3);
+    assertEqual(box.suppressed(), (uint32_t)2);
+}
+
+}  // namespace R51
+
+// Test boilerplate.
+void setup() {
+#ifdef ARDUINO
+    delay(1000);
+#endif
+    SERIAL_PORT_MONITOR.begin(115200);
+    while(!SERIAL_PORT_MONITOR);
+}
+
+void loop() {
+    aunit::TestRunner::run();
+    delay(1);
+}
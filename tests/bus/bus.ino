@@ -0,0 +1,125 @@
+#include <AUnit.h>
+#include <Arduino.h>
+#include <Faker.h>
+#include <R51Test.h>
+#include <R51Vehicle.h>
+
+namespace R51 {
+
+using namespace aunit;
+using ::Canny::Frame;
+using ::Faker::FakeClock;
+
+test(BusTest, TagFrameId) {
+    assertEqual(busTag(0, 0x625), (uint32_t)0x625);
+    assertEqual(busTag(1, 0x625), (uint32_t)0x20000625);
+    assertEqual(busTag(7, 0x1FFFFFFF), (uint32_t)0xFFFFFFFF);
+    assertEqual(busOf((uint32_t)0x20000625), 1);
+    assertEqual(busOf((uint32_t)0x625), 0);
+    assertEqual(busFrameId(0x20000625), (uint32_t)0x625);
+}
+
+test(BusTest, TagFrame) {
+    Frame f(0x625, 0, {0x00, 0x01});
+    busTag(f, 2);
+    assertEqual(f.id(), (uint32_t)0x40000625);
+    assertEqual(busOf(f), 2);
+    busUntag(f);
+    assertEqual(f.id(), (uint32_t)0x625);
+    assertEqual(busOf(f), 0);
+}
+
+test(BusTest, UntaggedNodeIgnoresOtherBus) {
+    FakeYield yield;
+    Frame f(busTag(1, 0x625), 0, {0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+
+    OnBus<IPDM, 0> ipdm;
+    ipdm.handle(f);
+    ipdm.emit(yield);
+    assertSize(yield, 0);
+}
+
+test(BusTest, TaggedNodeIgnoresOtherBus) {
+    FakeYield yield;
+    Frame f(0x625, 0, {0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+
+    OnBus<IPDM, 1> ipdm;
+    ipdm.handle(f);
+    ipdm.emit(yield);
+    assertSize(yield, 0);
+}
+
+test(BusTest, TaggedNodeHandlesOwnBus) {
+    FakeYield yield;
+    Frame f(busTag(1, 0x625), 0, {0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+    SystemEvent expect(Event::BODY_POWER_STATE, {0x01});
+
+    OnBus<IPDM, 1> ipdm;
+    ipdm.handle(f);
+    ipdm.emit(yield);
+    assertSize(yield, 1);
+    assertIsSystemEvent(yield.messages()[0], expect);
+}
+
+test(BusTest, TaggedNodeYieldsTaggedFrames) {
+    FakeClock clock;
+    FakeYield yield;
+    Frame init540(busTag(2, 0x540), 0, {0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+    Frame init541(busTag(2, 0x541), 0, {0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+
+    OnBus<Climate, 2> climate(0, &clock);
+    clock.set(100);
+    climate.emit(yield);
+    assertSize(yield, 2);
+    assertIsCANFrame(yield.messages()[0], init540);
+    assertIsCANFrame(yield.messages()[1], init541);
+}
+
+test(BusTest, TaggedNodeHandlesInPlace) {
+    FakeClock clock;
+    byte data[] = {0x3C, 0x3E, 0x7F, 0x80, 0x3D, 0x41, 0x00, 0x58};
+
+    OnBus<Climate, 1> climate(0, &clock);
+    assertFalse(climate.handle(FrameView(0x54A, 0, data, sizeof(data))));
+    assertFalse(climate.handle(FrameView(busTag(2, 0x54A), 0, data, sizeof(data))));
+    assertTrue(climate.handle(FrameView(busTag(1, 0x54A), 0, data, sizeof(data))));
+}
+
+test(BusTest, TaggedNodeEncodesTaggedFrames) {
+    FakeClock clock;
+    FakeYield yield;
+    Frame init540(busTag(1, 0x540), 0, {0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+    Frame init541(busTag(1, 0x541), 0, {0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+    byte data[8];
+    FrameSlot slot(data);
+
+    // control frames are left by poll for encode
+    OnBus<Climate, 1> climate(0, &clock);
+    clock.set(100);
+    climate.poll(yield);
+    assertSize(yield, 0);
+
+    assertTrue(climate.encode(&slot));
+    assertEqual(slot.id(), init540.id());
+    assertEqual(memcmp(slot.data(), init540.data(), 8), 0);
+    assertTrue(climate.encode(&slot));
+    assertEqual(slot.id(), init541.id());
+    assertEqual(memcmp(slot.data(), init541.data(), 8), 0);
+    assertFalse(climate.encode(&slot));
+}
+
+}  // namespace R51
+
+// Test boilerplate.
+void setup() {
+#ifdef ARDUINO
+    delay(1000);
+#endif
+    SERIAL_PORT_MONITOR.begin(115200);
+    while(!SERIAL_PORT_MONITOR);
+}
+
+void loop() {
+    aunit::TestRunner::run();
+    delay(1);
+}
@@ -0,0 +1,188 @@
+#include <AUnit.h>
+#include <Arduino.h>
+#include <Caster.h>
+#include <Faker.h>
+#include <R51Test.h>
+#include <R51Vehicle.h>
+#include <stdio.h>
+
+namespace R51 {
+
+using namespace aunit;
+using ::Canny::Frame;
+using ::Faker::FakeClock;
+
+#define LOG_PATH "can_log_test.bin"
+
+// Counts frames passed to the node by ID.
+class CountingNode : public Caster::Node<Message> {
+    public:
+        CountingNode() : tires(0), other(0), emits(0) {}
+
+        void handle(const Message& msg) override {
+            if (msg.type() != Message::CAN_FRAME) {
+                return;
+            }
+            if (msg.can_frame().id() == 0x385) {
+                ++tires;
+            } else {
+                ++other;
+            }
+        }
+
+        void emit(const Caster::Yield<Message>&) override { ++emits; }
+
+        int tires;
+        int other;
+        int emits;
+};
+
+class CanLogTest : public TestOnce {
+    public:
+        void setup() override {
+            TestOnce::setup();
+            remove(LOG_PATH);
+        }
+
+        void teardown() override {
+            remove(LOG_PATH);
+            TestOnce::teardown();
+        }
+
+        // Write 4 blocks of engine frames at 1ms intervals followed by one
+        // block of tire frames.
+        void writeLog() {
+            CanLogWriter writer;
+            assertTrue(writer.open(LOG_PATH));
+            Frame frame(0x551, 0, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+            uint64_t ts = 1000000;
+            for (int i = 0; i < 4 * CAN_LOG_BLOCK_SIZE; ++i) {
+                frame.data()[0] = i;
+                assertTrue(writer.write(ts, frame));
+                ts += 1000;
+            }
+            frame = Frame(0x385, 0, {0x00, 0x00, 0x5C, 0x5D, 0x5C, 0x5E, 0x00, 0xF0});
+            for (int i = 0; i < CAN_LOG_BLOCK_SIZE; ++i) {
+                assertTrue(writer.write(ts, frame));
+                ts += 1000;
+            }
+            assertTrue(writer.close());
+        }
+};
+
+testF(CanLogTest, RoundTrip) {
+    {
+        CanLogWriter writer;
+        assertTrue(writer.open(LOG_PATH));
+        assertTrue(writer.write(1000, Frame(0x551, 0, {0x29, 0x01})));
+        assertTrue(writer.write(2000, Frame(0x18FEF100, 1, {0x01, 0x02, 0x03})));
+        assertTrue(writer.close());
+    }
+
+    CanLogReader reader;
+    assertTrue(reader.open(LOG_PATH));
+    assertEqual(reader.blocks(), 1u);
+    assertEqual((uint32_t)reader.records(), 2u);
+    assertEqual((uint32_t)reader.block(0).start, 1000u);
+    assertEqual((uint32_t)reader.block(0).end, 2000u);
+
+    Frame frame;
+    const CanLogRecord* record = reader.next();
+    assertTrue(record != nullptr);
+    assertEqual((uint32_t)record->timestamp, 1000u);
+    CanLogReader::frame(*record, &frame);
+    assertIsCANFrame(Message(frame), Frame(0x551, 0, {0x29, 0x01}));
+
+    record = reader.next();
+    assertTrue(record != nullptr);
+    assertEqual((uint32_t)record->timestamp, 2000u);
+    CanLogReader::frame(*record, &frame);
+    assertIsCANFrame(Message(frame), Frame(0x18FEF100, 1, {0x01, 0x02, 0x03}));
+
+    assertTrue(reader.next() == nullptr);
+}
+
+testF(CanLogTest, RejectInvalidFile) {
+    FILE* file = fopen(LOG_PATH, "wb");
+    fputs("(1609459200.123456) can0 551#2900000000000000\n", file);
+    fclose(file);
+
+    CanLogReader reader;
+    assertFalse(reader.open(LOG_PATH));
+    assertEqual(reader.blocks(), 0u);
+    assertTrue(reader.next() == nullptr);
+}
+
+testF(CanLogTest, QueryById) {
+    writeLog();
+
+    CanLogReader reader;
+    assertTrue(reader.open(LOG_PATH));
+    assertEqual(reader.blocks(), 5u);
+
+    uint32_t ids[] = {0x385};
+    reader.query(CanLogQuery(0, UINT64_MAX, ids, 1));
+    int count = 0;
+    const CanLogRecord* record;
+    while ((record = reader.next()) != nullptr) {
+        assertEqual(record->frameId(), 0x385u);
+        ++count;
+    }
+    assertEqual(count, CAN_LOG_BLOCK_SIZE);
+    assertEqual(reader.touched(), 1u);
+}
+
+testF(CanLogTest, QueryByTime) {
+    writeLog();
+
+    CanLogReader reader;
+    assertTrue(reader.open(LOG_PATH));
+
+    // The second and third engine blocks.
+    uint64_t start = 1000000 + CAN_LOG_BLOCK_SIZE * 1000;
+    uint64_t end = start + (2 * CAN_LOG_BLOCK_SIZE - 1) * 1000;
+    reader.query(CanLogQuery(start, end));
+    int count = 0;
+    const CanLogRecord* record;
+    while ((record = reader.next()) != nullptr) {
+        assertTrue(record->timestamp >= start);
+        assertTrue(record->timestamp <= end);
+        ++count;
+    }
+    assertEqual(count, 2 * CAN_LOG_BLOCK_SIZE);
+    assertEqual(reader.touched(), 2u);
+}
+
+testF(CanLogTest, Replay) {
+    writeLog();
+
+    CanLogReader reader;
+    assertTrue(reader.open(LOG_PATH));
+
+    FakeClock clock;
+    CountingNode node;
+    FakeYield yield;
+    uint32_t ids[] = {0x385};
+    assertEqual((uint32_t)reader.replay(CanLogQuery(0, UINT64_MAX, ids, 1), &node, yield, &clock),
+            (uint32_t)CAN_LOG_BLOCK_SIZE);
+    assertEqual(node.tires, CAN_LOG_BLOCK_SIZE);
+    assertEqual(node.other, 0);
+    assertEqual(node.emits, CAN_LOG_BLOCK_SIZE);
+    assertEqual(clock.millis(), (uint32_t)(1000 + 5 * CAN_LOG_BLOCK_SIZE - 1));
+}
+
+}  // namespace R51
+
+// Test boilerplate.
+void setup() {
+#ifdef ARDUINO
+    delay(1000);
+#endif
+    SERIAL_PORT_MONITOR.begin(115200);
+    while(!SERIAL_PORT_MONITOR);
+}
+
+void loop() {
+    aunit::TestRunner::run();
+    delay(1);
+}
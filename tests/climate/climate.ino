@@ -13,6 +13,23 @@ using namespace aunit;
 using ::Canny::Frame;
 using ::Faker::FakeClock;
 
+#if defined(R51_TEST_VEHICLE_NODES)
+// Drive the node under test through VehicleNodes as the gateway does.
+template <typename N>
+class TestNode : public N {
+    public:
+        using N::N;
+        using N::handle;
+
+        void handle(const Message& msg) override { VehicleNodes<N>(*this).handle(msg); }
+        void emit(const Caster::Yield<Message>& yield) override { VehicleNodes<N>(*this).emit(yield); }
+};
+#else
+// Call the node under test directly.
+template <typename N>
+using TestNode = N;
+#endif
+
 #define assertYieldFrame(control, frame) ({\
     climate.handle(control); \
     climate.emit(yield); \
@@ -21,6 +38,12 @@ using ::Faker::FakeClock;
     yield.clear(); \
 })
 
+#define assertSlotFrame(slot, frame) ({\
+    assertEqual(slot.id(), frame.id()); \
+    assertEqual(slot.size(), (uint8_t)frame.size()); \
+    assertEqual(memcmp(slot.data(), frame.data(), frame.size()), 0); \
+})
+
 #define assertNoYield(control) ({\
     climate.handle(control); \
     climate.emit(yield); \
@@ -55,7 +78,7 @@ class ClimateTest : public TestOnce {
 };
 
 testF(ClimateTest, Init) {
-    Climate climate(0, &clock);
+    TestNode<Climate> climate(0, &clock);
 
     Frame init540(0x540, 0, {0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
     Frame init541(0x541, 0, {0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
@@ -77,8 +100,80 @@ testF(ClimateTest, Init) {
     assertIsCANFrame(yield.messages()[1], ready541);
 }
 
+testF(ClimateTest, ReadyOnTraffic) {
+    TestNode<Climate> climate(0, &clock);
+
+    Frame init540(0x540, 0, {0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+    Frame init541(0x541, 0, {0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+    Frame ready540(0x540, 0, {0x60, 0x40, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00});
+    Frame ready541(0x541, 0, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+    Frame state54A(0x54A, 0, {0x3C, 0x3E, 0x7F, 0x80, 0x3C, 0x41, 0x00, 0x58});
+
+    clock.set(100);
+    climate.emit(yield);
+    assertSize(yield, 2);
+    assertIsCANFrame(yield.messages()[0], init540);
+    assertIsCANFrame(yield.messages()[1], init541);
+    yield.clear();
+
+    // ready as soon as the unit is seen instead of waiting for the boot delay
+    clock.set(120);
+    climate.handle(state54A);
+    climate.emit(yield);
+    assertSize(yield, 3);
+    assertIsCANFrame(yield.messages()[0], ready540);
+    assertIsCANFrame(yield.messages()[1], ready541);
+}
+
+testF(ClimateTest, ReinitAfterSleep) {
+    TestNode<Climate> climate(0, &clock);
+
+    Frame init540(0x540, 0, {0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+    Frame init541(0x541, 0, {0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+    Frame ready540(0x540, 0, {0x60, 0x40, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00});
+    Frame ready541(0x541, 0, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+    Frame state54A(0x54A, 0, {0x3C, 0x3E, 0x7F, 0x80, 0x3C, 0x41, 0x00, 0x58});
+
+    clock.set(100);
+    climate.emit(yield);
+    clock.set(120);
+    climate.handle(state54A);
+    climate.emit(yield);
+    yield.clear();
+
+    // toggles made while ready are discarded when the unit goes to sleep
+    climate.handle(SystemEvent(Event::CLIMATE_TOGGLE_AC));
+    climate.emit(yield);
+    yield.clear();
+
+    clock.delay(CLIMATE_SLEEP_TIMEOUT);
+    climate.emit(yield);
+    assertSize(yield, 0);
+
+    clock.delay(100);
+    climate.emit(yield);
+    assertSize(yield, 2);
+    assertIsCANFrame(yield.messages()[0], init540);
+    assertIsCANFrame(yield.messages()[1], init541);
+    yield.clear();
+
+    // no boot delay fallback after sleep so wait for the unit
+    clock.delay(1000);
+    climate.emit(yield);
+    assertSize(yield, 2);
+    assertIsCANFrame(yield.messages()[0], init540);
+    assertIsCANFrame(yield.messages()[1], init541);
+    yield.clear();
+
+    climate.handle(state54A);
+    climate.emit(yield);
+    assertSize(yield, 2);
+    assertIsCANFrame(yield.messages()[0], ready540);
+    assertIsCANFrame(yield.messages()[1], ready541);
+}
+
 testF(ClimateTest, TurnOff) {
-    Climate climate(0, &clock);
+    TestNode<Climate> climate(0, &clock);
     initClimate(&climate);
 
     Frame expect;
@@ -92,7 +187,7 @@ testF(ClimateTest, TurnOff) {
 }
 
 testF(ClimateTest, ToggleAuto) {
-    Climate climate(0, &clock);
+    TestNode<Climate> climate(0, &clock);
     initClimate(&climate);
 
     SystemEvent control(Event::CLIMATE_TOGGLE_AUTO);
@@ -106,7 +201,7 @@ testF(ClimateTest, ToggleAuto) {
 }
 
 testF(ClimateTest, ToggleAc) {
-    Climate climate(0, &clock);
+    TestNode<Climate> climate(0, &clock);
     initClimate(&climate);
 
     SystemEvent control(Event::CLIMATE_TOGGLE_AC);
@@ -120,7 +215,7 @@ testF(ClimateTest, ToggleAc) {
 }
 
 testF(ClimateTest, ToggleDual) {
-    Climate climate(0, &clock);
+    TestNode<Climate> climate(0, &clock);
     initClimate(&climate);
 
     SystemEvent control(Event::CLIMATE_TOGGLE_DUAL);
@@ -134,7 +229,7 @@ testF(ClimateTest, ToggleDual) {
 }
 
 testF(ClimateTest, CycleMode) {
-    Climate climate(0, &clock);
+    TestNode<Climate> climate(0, &clock);
     initClimate(&climate);
 
     SystemEvent control(Event::CLIMATE_CYCLE_AIRFLOW_MODE);
@@ -148,7 +243,7 @@ testF(ClimateTest, CycleMode) {
 }
 
 testF(ClimateTest, ToggleDefrost) {
-    Climate climate(0, &clock);
+    TestNode<Climate> climate(0, &clock);
     initClimate(&climate);
 
     SystemEvent control(Event::CLIMATE_TOGGLE_DEFROST);
@@ -162,7 +257,7 @@ testF(ClimateTest, ToggleDefrost) {
 }
 
 testF(ClimateTest, ToggleRecirculate) {
-    Climate climate(0, &clock);
+    TestNode<Climate> climate(0, &clock);
     initClimate(&climate);
 
     SystemEvent control(Event::CLIMATE_TOGGLE_RECIRCULATE);
@@ -176,7 +271,7 @@ testF(ClimateTest, ToggleRecirculate) {
 }
 
 testF(ClimateTest, TriggerFanSpeedUp) {
-    Climate climate(0, &clock);
+    TestNode<Climate> climate(0, &clock);
     initClimate(&climate);
 
     SystemEvent control(Event::CLIMATE_INC_FAN_SPEED);
@@ -190,7 +285,7 @@ testF(ClimateTest, TriggerFanSpeedUp) {
 }
 
 testF(ClimateTest, TriggerFanSpeedDown) {
-    Climate climate(0, &clock);
+    TestNode<Climate> climate(0, &clock);
     initClimate(&climate);
 
     SystemEvent control(Event::CLIMATE_DEC_FAN_SPEED);
@@ -204,7 +299,7 @@ testF(ClimateTest, TriggerFanSpeedDown) {
 }
 
 testF(ClimateTest, TriggerDriverTempWhenOn) {
-    Climate climate(0, &clock);
+    TestNode<Climate> climate(0, &clock);
     initClimate(&climate);
     enableClimate(&climate);
 
@@ -233,7 +328,7 @@ testF(ClimateTest, TriggerDriverTempWhenOn) {
 }
 
 testF(ClimateTest, TriggerDriverTempWhenOff) {
-    Climate climate(0, &clock);
+    TestNode<Climate> climate(0, &clock);
     initClimate(&climate);
 
     SystemEvent control;
@@ -248,7 +343,7 @@ testF(ClimateTest, TriggerDriverTempWhenOff) {
 }
 
 testF(ClimateTest, TriggerPassengerTempWhenOn) {
-    Climate climate(0, &clock);
+    TestNode<Climate> climate(0, &clock);
     initClimate(&climate);
     enableClimate(&climate);
 
@@ -277,7 +372,7 @@ testF(ClimateTest, TriggerPassengerTempWhenOn) {
 }
 
 testF(ClimateTest, TriggerPassengerTempWhenOff) {
-    Climate climate(0, &clock);
+    TestNode<Climate> climate(0, &clock);
     initClimate(&climate);
 
     SystemEvent control;
@@ -292,7 +387,7 @@ testF(ClimateTest, TriggerPassengerTempWhenOff) {
 }
 
 testF(ClimateTest, TickOffState) {
-    Climate climate(100, &clock);
+    TestNode<Climate> climate(100, &clock);
     initClimate(&climate);
     enableClimate(&climate);
 
@@ -324,6 +419,284 @@ testF(ClimateTest, TickOffState) {
     yield.clear();
 }
 
+testF(ClimateTest, ControlAcknowledged) {
+    TestNode<Climate> climate(0, &clock);
+    initClimate(&climate);
+    enableClimate(&climate);
+
+    SystemEvent control(Event::CLIMATE_TOGGLE_AC);
+    Frame expect(0x540, 0, {0x60, 0x40, 0x00, 0x00, 0x00, 0x08, 0x04, 0x00});
+    assertYieldFrame(control, expect);
+
+    clock.delay(50);
+    Frame state54B(0x54B, 0, {0x51, 0x8C, 0x05, 0x24, 0x00, 0x00, 0x00, 0x02});
+    climate.handle(state54B);
+    assertEqual(climate.controlRtt(), 50u);
+
+    clock.delay(CLIMATE_CONTROL_TIMEOUT);
+    climate.emit(yield);
+    assertEqual(climate.controlRetries(), 0u);
+    assertEqual(climate.controlFailures(), 0u);
+}
+
+testF(ClimateTest, ControlRetransmit) {
+    TestNode<Climate> climate(0, &clock);
+    initClimate(&climate);
+    enableClimate(&climate);
+
+    SystemEvent control(Event::CLIMATE_TOGGLE_AC);
+    Frame expect(0x540, 0, {0x60, 0x40, 0x00, 0x00, 0x00, 0x08, 0x04, 0x00});
+    assertYieldFrame(control, expect);
+
+    // no state change so the frame is resent without toggling again
+    clock.delay(CLIMATE_CONTROL_TIMEOUT);
+    climate.emit(yield);
+    assertSize(yield, 2);
+    assertIsCANFrame(yield.messages()[0], expect);
+    assertEqual(climate.controlRetries(), 1u);
+    yield.clear();
+
+    // acknowledge the retry
+    clock.delay(20);
+    Frame state54B(0x54B, 0, {0x51, 0x8C, 0x05, 0x24, 0x00, 0x00, 0x00, 0x02});
+    climate.handle(state54B);
+    assertEqual(climate.controlRtt(), 20u);
+
+    clock.delay(CLIMATE_CONTROL_TIMEOUT);
+    climate.emit(yield);
+    assertEqual(climate.controlRetries(), 1u);
+    assertEqual(climate.controlFailures(), 0u);
+}
+
+testF(ClimateTest, ControlAbandoned) {
+    TestNode<Climate> climate(0, &clock);
+    initClimate(&climate);
+    enableClimate(&climate);
+
+    SystemEvent control(Event::CLIMATE_TOGGLE_RECIRCULATE);
+    climate.handle(control);
+    climate.emit(yield);
+    yield.clear();
+
+    for (int i = 0; i < CLIMATE_CONTROL_RETRIES; i++) {
+        clock.delay(CLIMATE_CONTROL_TIMEOUT);
+        climate.emit(yield);
+        yield.clear();
+    }
+    assertEqual(climate.controlRetries(), (uint32_t)CLIMATE_CONTROL_RETRIES);
+    assertEqual(climate.controlFailures(), 0u);
+
+    // the observed state is re-published after the last retry
+    ClimateTempStateEvent temp;
+    temp.driver_temp(0x3C);
+    temp.passenger_temp(0x41);
+    temp.outside_temp(0x58);
+    temp.units(UNITS_US);
+    clock.delay(CLIMATE_CONTROL_TIMEOUT);
+    climate.emit(yield);
+    assertEqual(climate.controlFailures(), 1u);
+    assertSize(yield, 5);
+    assertIsSystemEvent(yield.messages()[2], temp);
+}
+
+testF(ClimateTest, ControlTempRetransmit) {
+    TestNode<Climate> climate(0, &clock);
+    initClimate(&climate);
+    enableClimate(&climate);
+    Frame state54A(0x54A, 0, {0x3C, 0x3E, 0x7F, 0x80, 0x3C, 0x41, 0x00, 0x58});
+
+    SystemEvent control(Event::CLIMATE_INC_DRIVER_TEMP);
+    Frame expect(0x540, 0, {0x60, 0x40, 0x00, 0x01, 0x00, 0x20, 0x04, 0x00});
+    assertYieldFrame(control, expect);
+
+    // the step is resent unchanged so a unit which acted on it does not step
+    // again
+    for (int i = 0; i < CLIMATE_CONTROL_RETRIES; i++) {
+        clock.delay(CLIMATE_CONTROL_TIMEOUT);
+        climate.handle(state54A);
+        climate.emit(yield);
+        assertIsCANFrame(yield.messages()[0], expect);
+        yield.clear();
+    }
+    assertEqual(climate.controlRetries(), (uint32_t)CLIMATE_CONTROL_RETRIES);
+
+    // the setpoints are resynced with the unit once the step is abandoned
+    clock.delay(CLIMATE_CONTROL_TIMEOUT);
+    climate.handle(state54A);
+    climate.emit(yield);
+    assertEqual(climate.controlFailures(), 1u);
+    expect = Frame(0x540, 0, {0x60, 0x40, 0x00, 0x3C, 0x41, 0x20, 0x04, 0x00});
+    assertIsCANFrame(yield.messages()[0], expect);
+}
+
+testF(ClimateTest, ControlToggleTwice) {
+    TestNode<Climate> climate(0, &clock);
+    initClimate(&climate);
+    enableClimate(&climate);
+
+    SystemEvent control(Event::CLIMATE_TOGGLE_DUAL);
+    climate.handle(control);
+    climate.handle(control);
+    climate.emit(yield);
+    yield.clear();
+
+    clock.delay(CLIMATE_CONTROL_TIMEOUT);
+    climate.emit(yield);
+    assertEqual(climate.controlRetries(), 0u);
+}
+
+testF(ClimateTest, PreferredUnits) {
+    TestNode<Climate> climate(0, &clock);
+    initClimate(&climate);
+    enableClimate(&climate);
+
+    // reported as 60F, 65F, and 88F outside
+    ClimateTempStateEvent temp;
+    temp.driver_temp(16);
+    temp.passenger_temp(18);
+    temp.outside_temp(31);
+    temp.units(UNITS_METRIC);
+
+    climate.units(UNITS_METRIC);
+    climate.emit(yield);
+    assertSize(yield, 1);
+    assertIsSystemEvent(yield.messages()[0], temp);
+    yield.clear();
+
+    // state frames in the vehicle's units are converted
+    Frame state54A(0x54A, 0, {0x3C, 0x3E, 0x7F, 0x80, 0x48, 0x41, 0x00, 0x58});
+    temp.driver_temp(22);
+    climate.handle(state54A);
+    climate.emit(yield);
+    assertSize(yield, 1);
+    assertIsSystemEvent(yield.messages()[0], temp);
+    yield.clear();
+
+    // no re-emit when the preference does not change
+    climate.units(UNITS_METRIC);
+    climate.emit(yield);
+    assertSize(yield, 0);
+
+    temp.driver_temp(0x48);
+    temp.passenger_temp(0x41);
+    temp.outside_temp(0x58);
+    temp.units(UNITS_US);
+    climate.units(UNITS_US);
+    climate.emit(yield);
+    assertSize(yield, 1);
+    assertIsSystemEvent(yield.messages()[0], temp);
+}
+
+testF(ClimateTest, NegativeOutsideTemp) {
+    TestNode<Climate> climate(0, &clock);
+    initClimate(&climate);
+    enableClimate(&climate);
+    climate.emit(yield);
+    yield.clear();
+
+    // reported as 20F outside
+    Frame state54A(0x54A, 0, {0x3C, 0x3E, 0x7F, 0x80, 0x48, 0x41, 0x00, 0x14});
+    ClimateTempStateEvent temp;
+    temp.driver_temp(0x48);
+    temp.passenger_temp(0x41);
+    temp.outside_temp(20);
+    temp.units(UNITS_US);
+    climate.handle(state54A);
+    climate.emit(yield);
+    assertSize(yield, 1);
+    assertIsSystemEvent(yield.messages()[0], temp);
+    yield.clear();
+
+    // published below zero in metric
+    temp.driver_temp(22);
+    temp.passenger_temp(18);
+    temp.outside_temp(-7);
+    temp.units(UNITS_METRIC);
+    climate.units(UNITS_METRIC);
+    climate.emit(yield);
+    assertSize(yield, 1);
+    assertIsSystemEvent(yield.messages()[0], temp);
+    yield.clear();
+
+    // reported as 0F outside
+    state54A.data()[7] = 0x00;
+    temp.outside_temp(-18);
+    climate.handle(state54A);
+    climate.emit(yield);
+    assertSize(yield, 1);
+    assertIsSystemEvent(yield.messages()[0], temp);
+}
+
+testF(ClimateTest, ClampOutsideTempOnPublish) {
+    Climate climate(0, &clock);
+    initClimate(&climate);
+    enableClimate(&climate);
+    climate.units(UNITS_US);
+    climate.emit(yield);
+    yield.clear();
+
+    // reported as 250C outside which is clamped when published in US units
+    Frame state54A(0x54A, 0, {0x3C, 0x3E, 0x7F, 0x40, 0x16, 0x12, 0x00, 0xFA});
+    ClimateTempStateEvent temp;
+    temp.driver_temp(72);
+    temp.passenger_temp(64);
+    temp.outside_temp(CLIMATE_OUTSIDE_TEMP_MAX);
+    temp.units(UNITS_US);
+    climate.handle(state54A);
+    climate.emit(yield);
+    assertSize(yield, 1);
+    assertIsSystemEvent(yield.messages()[0], temp);
+    yield.clear();
+
+    // the reported value is kept unclamped
+    temp.driver_temp(0x16);
+    temp.passenger_temp(0x12);
+    temp.outside_temp(0xFA);
+    temp.units(UNITS_METRIC);
+    climate.units(UNITS_METRIC);
+    climate.emit(yield);
+    assertSize(yield, 1);
+    assertIsSystemEvent(yield.messages()[0], temp);
+}
+
+testF(ClimateTest, PullControlFrames) {
+    TestNode<Climate> climate(0, &clock);
+    initClimate(&climate);
+    enableClimate(&climate);
+
+    byte data[8];
+    FrameSlot slot(data);
+    assertFalse(climate.encode(&slot));
+
+    // state frames are handled in place
+    Frame state54A(0x54A, 0, {0x3C, 0x3E, 0x7F, 0x80, 0x3D, 0x41, 0x00, 0x58});
+    assertTrue(climate.handle(FrameView(state54A)));
+    assertFalse(climate.handle(FrameView(state54A)));
+    climate.poll(yield);
+    assertSize(yield, 1);
+    yield.clear();
+
+    // control frames are left for encode instead of yielded and every byte
+    // of the slot is written
+    Frame expect(0x540, 0, {0x60, 0x40, 0x00, 0x00, 0x00, 0x08, 0x04, 0x00});
+    climate.handle(SystemEvent(Event::CLIMATE_TOGGLE_AC));
+    climate.poll(yield);
+    assertSize(yield, 0);
+    memset(data, 0xFF, sizeof(data));
+    assertTrue(climate.encode(&slot));
+    assertSlotFrame(slot, expect);
+    assertFalse(climate.encode(&slot));
+
+    expect = Frame(0x541, 0, {0x00, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+    climate.handle(SystemEvent(Event::CLIMATE_TOGGLE_RECIRCULATE));
+    climate.poll(yield);
+    assertSize(yield, 0);
+    memset(data, 0xFF, sizeof(data));
+    assertTrue(climate.encode(&slot));
+    assertSlotFrame(slot, expect);
+    assertFalse(climate.encode(&slot));
+}
+
 }  // namespace 
 
 // Test boilerplate.
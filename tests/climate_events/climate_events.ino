@@ -20,6 +20,33 @@ test(ClimateTempStateEventTest, Getters) {
     assertEqual(event.units(), UNITS_US);
 }
 
+test(ClimateTempStateEventTest, NegativeOutsideTemp) {
+    ClimateTempStateEvent event;
+    assertTrue(event.outside_temp(-4));
+    event.units(UNITS_US);
+    assertEqual(event.data[2], 0x00);
+    assertEqual(event.data[4], 0x04);
+    assertEqual(event.outside_temp(), -4);
+
+    assertTrue(event.outside_temp(-20));
+    event.units(UNITS_METRIC);
+    assertEqual(event.data[2], 0x00);
+    assertEqual(event.data[4], 0x14);
+    assertEqual(event.outside_temp(), -20);
+
+    // byte 2 is unchanged for temperatures at or above zero
+    assertTrue(event.outside_temp(0x49));
+    assertEqual(event.data[2], 0x49);
+    assertEqual(event.data[4], 0x00);
+
+    assertTrue(event.outside_temp(CLIMATE_OUTSIDE_TEMP_MIN));
+    assertEqual(event.data[2], 0x00);
+    assertEqual(event.data[4], 0xFF);
+    assertTrue(event.outside_temp(CLIMATE_OUTSIDE_TEMP_MAX));
+    assertEqual(event.data[2], 0xFF);
+    assertEqual(event.data[4], 0x00);
+}
+
 test(ClimateTempStateEventTest, Setters) {
     ClimateTempStateEvent event;
     event.driver_temp(0x40);
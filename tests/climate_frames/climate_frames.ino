@@ -162,6 +162,20 @@ test(ClimateSystemControlFrameTest, DecPassengerTemp) {
     assertTrue(checkFrame(c, expect));
 }
 
+test(ClimateSystemControlFrameTest, SyncTemps) {
+    ClimateSystemControlFrame c;
+
+    c.syncTemps(0x3C, 0x41);
+    Frame expect(0x540, 0, {0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+    assertTrue(checkFrame(c, expect));
+
+    c.ready();
+    c.incDriverTemp();
+    c.syncTemps(0x3C, 0x41);
+    expect.data({0x60, 0x40, 0x00, 0x3C, 0x41, 0x20, 0x04, 0x00});
+    assertTrue(checkFrame(c, expect));
+}
+
 test(ClimateFanControlFrameTest, Init) {
     ClimateFanControlFrame c;
     Frame expect(0x541, 0, {0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
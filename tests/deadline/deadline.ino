@@ -0,0 +1,309 @@
+#include <AUnit.h>
+#include <Arduino.h>
+#include <Canny.h>
+#include <Caster.h>
+#include <Faker.h>
+#include <R51Core.h>
+#include <R51Test.h>
+#include <R51Vehicle.h>
+
+namespace R51 {
+
+using namespace aunit;
+using ::Canny::Frame;
+using ::Faker::FakeClock;
+
+// Length of the simulated drive. The vehicle broadcasts until BROADCAST_MS
+// and is silent for the rest of the drive.
+static const uint32_t DRIVE_MS = 10000;
+static const uint32_t BROADCAST_MS = 5000;
+
+// Time the driver presses the A/C button. The climate unit never acknowledges
+// the press so it is re-issued and abandoned between broadcasts.
+static const uint32_t TOGGLE_MS = 2050;
+
+// Maximum number of outputs recorded per drive.
+static const size_t MAX_RECORDS = 1024;
+
+// A message emitted by the vehicle nodes and the time it was emitted.
+struct Record {
+    uint32_t time;
+    uint8_t type;
+    uint32_t id;
+    byte data[8];
+};
+
+// Records every emitted message with the time it was emitted.
+class RecordingYield : public Caster::Yield<Message> {
+    public:
+        RecordingYield(Faker::Clock* clock) :
+            clock_(clock), count(0), overflow(false) {}
+
+        void operator()(const Message& msg) const override {
+            if (count >= MAX_RECORDS) {
+                overflow = true;
+                return;
+            }
+            Record* record = &records[count++];
+            memset(record, 0, sizeof(Record));
+            record->time = clock_->millis();
+            record->type = msg.type();
+            if (msg.type() == Message::CAN_FRAME) {
+                const Frame& frame = msg.can_frame();
+                record->id = frame.id();
+                memcpy(record->data, frame.data(), frame.size());
+            } else if (msg.type() == Message::SYSTEM_EVENT) {
+                const SystemEvent& event = msg.system_event();
+                record->id = event.id;
+                memcpy(record->data, event.data,
+                        sizeof(event.data) < 8 ? sizeof(event.data) : 8);
+            }
+        }
+
+    private:
+        Faker::Clock* clock_;
+
+    public:
+        mutable Record records[MAX_RECORDS];
+        mutable size_t count;
+        mutable bool overflow;
+};
+
+// The nodes run by the gateway, driven by a scripted drive. Tick intervals
+// are offset from the broadcast period so re-emits fall between inputs.
+class Vehicle {
+    public:
+        Vehicle(Faker::Clock* clock) :
+                power(clock), climate(1010, clock), doors(990, clock),
+                ecm(1030, clock), ipdm(970, clock), tires(1050, clock),
+                settings(true, clock) {
+            ecm.backoff(8000);
+            tires.backoff(8000);
+            power.attach(&climate);
+            power.attach(&doors);
+            power.attach(&ecm);
+            power.attach(&ipdm);
+            power.attach(&tires);
+            power.attach(&settings);
+            scheduler.attach(&power);
+            scheduler.attach(&climate);
+            scheduler.attach(&doors);
+            scheduler.attach(&ecm);
+            scheduler.attach(&ipdm);
+            scheduler.attach(&tires);
+            scheduler.attach(&settings);
+        }
+
+        // Deliver the frames and events scheduled at time t.
+        void receive(uint32_t t) {
+            if (t == TOGGLE_MS) {
+                deliver(SystemEvent(Event::CLIMATE_TOGGLE_AC));
+            }
+            if (t >= BROADCAST_MS || t % 100 != 0) {
+                return;
+            }
+            // the engine warms up and the driver door opens for a second
+            uint8_t coolant = 0x50 + t / 500;
+            uint8_t door = t >= 1000 && t < 2000 ? 0x10 : 0x00;
+            deliver(Frame(0x54A, 0, {0x3C, 0x3E, 0x7F, 0x80, 0x44, 0x44, 0x00, 0x58}));
+            deliver(Frame(0x54B, 0, {0x59, 0x84, 0x05, 0x24, 0x00, 0x00, 0x00, 0x02}));
+            deliver(Frame(0x551, 0, {coolant, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}));
+            deliver(Frame(0x625, 0, {0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}));
+            deliver(Frame(0x60D, 0, {door, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}));
+            if (t % 1000 == 0) {
+                deliver(Frame(0x385, 0, {0x84, 0x0C, 0x82, 0x84, 0x79, 0x77, 0x00, 0xF0}));
+            }
+        }
+
+        // Emit all nodes.
+        void emit(const Caster::Yield<Message>& yield) {
+            power.emit(yield);
+            climate.emit(yield);
+            doors.emit(yield);
+            ecm.emit(yield);
+            ipdm.emit(yield);
+            tires.emit(yield);
+            settings.emit(yield);
+        }
+
+        PowerManager power;
+        Climate climate;
+        Doors doors;
+        EngineTempState ecm;
+        IPDM ipdm;
+        TirePressureState tires;
+        Settings settings;
+        Scheduler scheduler;
+
+    private:
+        void deliver(const Message& msg) {
+            power.handle(msg);
+            climate.handle(msg);
+            doors.handle(msg);
+            ecm.handle(msg);
+            ipdm.handle(msg);
+            tires.handle(msg);
+            settings.handle(msg);
+        }
+};
+
+// Return the time of the next scripted input after t or DEADLINE_NONE.
+uint32_t nextInput(uint32_t t) {
+    uint32_t next = (t / 100 + 1) * 100;
+    if (next >= BROADCAST_MS) {
+        next = DEADLINE_NONE;
+    }
+    return t < TOGGLE_MS ? earliestDeadline(next, TOGGLE_MS) : next;
+}
+
+test(DeadlineTest, HeartbeatDeadline) {
+    FakeClock clock;
+    Heartbeat heartbeat(1000, &clock);
+    assertEqual(heartbeat.deadline(), 1000u);
+
+    clock.set(400);
+    assertEqual(heartbeat.deadline(), 600u);
+
+    clock.set(1200);
+    assertEqual(heartbeat.deadline(), 0u);
+    heartbeat.reset();
+    assertEqual(heartbeat.deadline(), 1000u);
+
+    Heartbeat disabled(0, &clock);
+    assertEqual(disabled.deadline(), DEADLINE_NONE);
+}
+
+test(DeadlineTest, FreshnessDeadline) {
+    FakeClock clock;
+    Freshness source(0x551, 100, &clock);
+    assertEqual(source.deadline(), DEADLINE_NONE);
+
+    source.received();
+    assertEqual(source.deadline(), (uint32_t)(100 * FRESHNESS_STALE_PERIODS));
+
+    clock.set(100 * FRESHNESS_STALE_PERIODS);
+    assertEqual(source.deadline(), 0u);
+    assertTrue(source.stale());
+    assertEqual(source.deadline(), DEADLINE_NONE);
+}
+
+test(DeadlineTest, NodeDeadline) {
+    FakeClock clock;
+    FakeYield yield;
+    Frame f(0x551, 0, {0x50, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+    uint32_t stale_ms = ECM_FRAME_PERIOD * FRESHNESS_STALE_PERIODS;
+
+    EngineTempState ecm(1000, &clock);
+    assertEqual(ecm.nextDeadline(), 1000u);
+
+    // a change is due immediately
+    ecm.handle(f);
+    assertEqual(ecm.nextDeadline(), 0u);
+    ecm.emit(yield);
+    assertSize(yield, 1);
+    assertEqual(ecm.nextDeadline(), earliestDeadline(1000, stale_ms));
+
+    // an unchanged frame pushes out the stale deadline only
+    clock.set(50);
+    ecm.handle(f);
+    assertEqual(ecm.nextDeadline(), earliestDeadline(950, stale_ms));
+
+    // re-emits stop once the frame goes stale
+    clock.set(50 + stale_ms);
+    assertEqual(ecm.nextDeadline(), 0u);
+    ecm.emit(yield);
+    assertEqual(ecm.nextDeadline(), DEADLINE_NONE);
+
+    // only the stale check is scheduled while the vehicle sleeps
+    ecm.handle(f);
+    ecm.emit(yield);
+    ecm.power(POWER_SLEEP);
+    assertEqual(ecm.nextDeadline(), stale_ms);
+}
+
+test(DeadlineTest, SchedulerEarliest) {
+    FakeClock clock;
+
+    EngineTempState ecm(1000, &clock);
+    IPDM ipdm(300, &clock);
+    Scheduler scheduler;
+    assertEqual(scheduler.next(), DEADLINE_NONE);
+    assertTrue(scheduler.attach(&ecm));
+    assertTrue(scheduler.attach(&ipdm));
+    assertEqual(scheduler.next(), 300u);
+
+    ecm.handle(Frame(0x551, 0, {0x50, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}));
+    assertEqual(scheduler.next(), 0u);
+}
+
+// Run the drive once emitting every millisecond and once sleeping until the
+// next deadline or input. The outputs must be identical.
+test(DeadlineTest, ScheduledMatchesBusyLoop) {
+    FakeClock busy_clock;
+    RecordingYield busy_yield(&busy_clock);
+    Vehicle busy_vehicle(&busy_clock);
+    uint32_t busy_loops = 0;
+    for (uint32_t t = 0; t <= DRIVE_MS; ++t) {
+        busy_clock.set(t);
+        busy_vehicle.receive(t);
+        busy_vehicle.emit(busy_yield);
+        ++busy_loops;
+    }
+
+    FakeClock clock;
+    RecordingYield yield(&clock);
+    Vehicle vehicle(&clock);
+    uint32_t loops = 0;
+    uint32_t t = 0;
+    while (t <= DRIVE_MS) {
+        clock.set(t);
+        vehicle.receive(t);
+        vehicle.emit(yield);
+        ++loops;
+
+        // work left due by an emit runs on the next millisecond as it does
+        // in the busy loop
+        uint32_t wait = vehicle.scheduler.next();
+        if (wait == 0) {
+            wait = 1;
+        }
+        t = earliestDeadline(wait == DEADLINE_NONE ? DEADLINE_NONE : t + wait,
+                nextInput(t));
+    }
+
+    assertFalse(busy_yield.overflow);
+    assertFalse(yield.overflow);
+    assertEqual(yield.count, busy_yield.count);
+    for (size_t i = 0; i < yield.count && i < busy_yield.count; ++i) {
+        const Record& a = busy_yield.records[i];
+        const Record& b = yield.records[i];
+        assertEqual(b.time, a.time);
+        assertEqual(b.type, a.type);
+        assertEqual(b.id, a.id);
+        assertEqual(memcmp(b.data, a.data, 8), 0);
+    }
+    assertLess(loops * 10, busy_loops);
+
+    SERIAL_PORT_MONITOR.print("loops: busy ");
+    SERIAL_PORT_MONITOR.print(busy_loops);
+    SERIAL_PORT_MONITOR.print(", scheduled ");
+    SERIAL_PORT_MONITOR.print(loops);
+    SERIAL_PORT_MONITOR.print(", saved ");
+    SERIAL_PORT_MONITOR.println(busy_loops - loops);
+}
+
+}  // namespace R51
+
+// Test boilerplate.
+void setup() {
+#ifdef ARDUINO
+    delay(1000);
+#endif
+    SERIAL_PORT_MONITOR.begin(115200);
+    while(!SERIAL_PORT_MONITOR);
+}
+
+void loop() {
+    aunit::TestRunner::run();
+    delay(1);
+}
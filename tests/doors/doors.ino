@@ -0,0 +1,197 @@
+#include <AUnit.h>
+#include <Arduino.h>
+#include <Faker.h>
+#include <R51Test.h>
+#include <R51Vehicle.h>
+
+namespace R51 {
+
+using namespace aunit;
+using ::Canny::Frame;
+using ::Faker::FakeClock;
+
+test(DoorsTest, IgnoreIncorrectID) {
+    FakeYield yield;
+    Frame f(0x60C, 0, {0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+
+    Doors doors;
+    doors.handle(f);
+    doors.emit(yield);
+    assertSize(yield, 0);
+}
+
+test(DoorsTest, IgnoreIncorrectSize) {
+    FakeYield yield;
+    Frame f(0x60D, 0, {0x10, 0x00});
+
+    Doors doors;
+    doors.handle(f);
+    doors.emit(yield);
+    assertSize(yield, 0);
+}
+
+test(DoorsTest, Tick) {
+    FakeClock clock;
+    FakeYield yield;
+
+    Doors doors(200, &clock);
+    doors.emit(yield);
+    assertSize(yield, 0);
+
+    DoorStateEvent expect;
+    clock.set(200);
+    doors.emit(yield);
+    assertSize(yield, 1);
+    assertIsSystemEvent(yield.messages()[0], expect);
+}
+
+test(DoorsTest, Decode) {
+    FakeYield yield;
+    Frame f(0x60D, 0, {0xF8, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00});
+
+    Doors doors;
+    doors.handle(f);
+    doors.emit(yield);
+
+    DoorStateEvent expect;
+    expect.driver(true);
+    expect.passenger(true);
+    expect.rear_left(true);
+    expect.rear_right(true);
+    expect.hatch(true);
+    expect.locked(true);
+    assertSize(yield, 2);
+    assertIsSystemEvent(yield.messages()[1], expect);
+}
+
+test(DoorsTest, Edges) {
+    FakeClock clock;
+    FakeYield yield;
+    Frame closed(0x60D, 0, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+    Frame open(0x60D, 0, {0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+
+    Doors doors(1000, &clock);
+    doors.handle(closed);
+    doors.emit(yield);
+    assertSize(yield, 0);
+
+    // driver door opens
+    DoorEdgeEvent edge;
+    edge.changed(0x01);
+    edge.state(0x01);
+    DoorStateEvent state;
+    state.driver(true);
+    doors.handle(open);
+    doors.emit(yield);
+    assertSize(yield, 2);
+    assertIsSystemEvent(yield.messages()[0], edge);
+    assertIsSystemEvent(yield.messages()[1], state);
+    assertTrue(edge.rising(DOOR_DRIVER));
+    yield.clear();
+
+    // no edge while the state holds
+    clock.delay(100);
+    doors.handle(open);
+    doors.emit(yield);
+    assertSize(yield, 0);
+
+    // driver door closes
+    edge.state(0x00);
+    assertTrue(edge.falling(DOOR_DRIVER));
+    doors.handle(closed);
+    doors.emit(yield);
+    assertSize(yield, 2);
+    assertIsSystemEvent(yield.messages()[0], edge);
+    assertIsSystemEvent(yield.messages()[1], DoorStateEvent());
+}
+
+test(DoorsTest, EdgeBetweenEmits) {
+    FakeYield yield;
+    Frame closed(0x60D, 0, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+    Frame open(0x60D, 0, {0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+
+    // the hatch opens and closes between emits
+    Doors doors;
+    doors.handle(open);
+    doors.handle(closed);
+    doors.emit(yield);
+
+    DoorEdgeEvent opened;
+    opened.changed(1 << DOOR_HATCH);
+    opened.state(1 << DOOR_HATCH);
+    DoorEdgeEvent closed_edge;
+    closed_edge.changed(1 << DOOR_HATCH);
+    closed_edge.state(0x00);
+    assertSize(yield, 3);
+    assertIsSystemEvent(yield.messages()[0], opened);
+    assertTrue(opened.rising(DOOR_HATCH));
+    assertIsSystemEvent(yield.messages()[1], closed_edge);
+    assertTrue(closed_edge.falling(DOOR_HATCH));
+    assertIsSystemEvent(yield.messages()[2], DoorStateEvent());
+}
+
+test(DoorsTest, EdgeQueueFull) {
+    FakeYield yield;
+    Frame closed(0x60D, 0, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+    Frame driver(0x60D, 0, {0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+    Frame passenger(0x60D, 0, {0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+
+    // the driver door fills the edge queue between emits
+    Doors doors;
+    for (size_t i = 0; i < DOORS_EDGE_QUEUE_SIZE; ++i) {
+        doors.handle(i % 2 == 0 ? driver : closed);
+    }
+
+    // the passenger door edge is merged into the last queued edge
+    doors.handle(passenger);
+    doors.emit(yield);
+
+    DoorEdgeEvent last;
+    last.changed((1 << DOOR_DRIVER) | (1 << DOOR_PASSENGER));
+    last.state(1 << DOOR_PASSENGER);
+    DoorStateEvent state;
+    state.passenger(true);
+    assertSize(yield, DOORS_EDGE_QUEUE_SIZE + 1);
+    assertIsSystemEvent(yield.messages()[DOORS_EDGE_QUEUE_SIZE - 1], last);
+    assertIsSystemEvent(yield.messages()[DOORS_EDGE_QUEUE_SIZE], state);
+}
+
+test(DoorsTest, StopTickWhenStale) {
+    FakeClock clock;
+    FakeYield yield;
+    Frame f(0x60D, 0, {0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+
+    Doors doors(200, &clock);
+    doors.handle(f);
+    doors.emit(yield);
+    assertSize(yield, 2);
+    yield.clear();
+
+    clock.delay(DOORS_FRAME_PERIOD * FRESHNESS_STALE_PERIODS);
+    doors.emit(yield);
+    assertSize(yield, 0);
+
+    // the unchanged state is published without an edge when the BCM returns
+    DoorStateEvent expect;
+    expect.driver(true);
+    doors.handle(f);
+    doors.emit(yield);
+    assertSize(yield, 1);
+    assertIsSystemEvent(yield.messages()[0], expect);
+}
+
+}  // namespace R51
+
+// Test boilerplate.
+void setup() {
+#ifdef ARDUINO
+    delay(1000);
+#endif
+    SERIAL_PORT_MONITOR.begin(115200);
+    while(!SERIAL_PORT_MONITOR);
+}
+
+void loop() {
+    aunit::TestRunner::run();
+    delay(1);
+}
@@ -10,11 +10,28 @@ using namespace aunit;
 using ::Canny::Frame;
 using ::Faker::FakeClock;
 
+#if defined(R51_TEST_VEHICLE_NODES)
+// Drive the node under test through VehicleNodes as the gateway does.
+template <typename N>
+class TestNode : public N {
+    public:
+        using N::N;
+        using N::handle;
+
+        void handle(const Message& msg) override { VehicleNodes<N>(*this).handle(msg); }
+        void emit(const Caster::Yield<Message>& yield) override { VehicleNodes<N>(*this).emit(yield); }
+};
+#else
+// Call the node under test directly.
+template <typename N>
+using TestNode = N;
+#endif
+
 test(EngineTempStateTest, IgnoreIncorrectID) {
     FakeYield yield;
     Frame f(0x550, 0, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
 
-    EngineTempState ecm;
+    TestNode<EngineTempState> ecm;
     ecm.handle(f);
     ecm.emit(yield);
     assertSize(yield, 0);
@@ -24,7 +41,7 @@ test(EngineTempStateTest, IgnoreIncorrectSize) {
     FakeYield yield;
     Frame f(0x551, 0, {});
 
-    EngineTempState ecm;
+    TestNode<EngineTempState> ecm;
     ecm.handle(f);
     ecm.emit(yield);
     assertSize(yield, 0);
@@ -34,7 +51,7 @@ test(EngineTempStateTest, Tick) {
     FakeClock clock;
     FakeYield yield;
 
-    EngineTempState ecm(200, &clock);
+    TestNode<EngineTempState> ecm(200, &clock);
     ecm.emit(yield);
     assertSize(yield, 0);
 
@@ -45,11 +62,67 @@ test(EngineTempStateTest, Tick) {
     assertIsSystemEvent(yield.messages()[0], expect);
 }
 
+// Records availability notifications.
+class AvailabilityRecorder : public FreshnessObserver {
+    public:
+        AvailabilityRecorder() : id(0), state(true), calls(0) {}
+
+        void available(uint32_t id, bool available) override {
+            this->id = id;
+            state = available;
+            ++calls;
+        }
+
+        uint32_t id;
+        bool state;
+        uint8_t calls;
+};
+
+test(EngineTempStateTest, StopTickWhenStale) {
+    FakeClock clock;
+    FakeYield yield;
+    AvailabilityRecorder recorder;
+    Frame f(0x551, 0, {0x29, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+    SystemEvent expect(Event::ENGINE_TEMP_STATE, {0x29});
+
+    TestNode<EngineTempState> ecm(200, &clock);
+    ecm.observer(&recorder);
+    ecm.handle(f);
+    ecm.emit(yield);
+    assertSize(yield, 1);
+    yield.clear();
+
+    clock.delay(200);
+    ecm.emit(yield);
+    assertSize(yield, 1);
+    yield.clear();
+
+    // no re-emit once the ECM is silent for several periods
+    clock.delay(ECM_FRAME_PERIOD * FRESHNESS_STALE_PERIODS);
+    ecm.emit(yield);
+    assertSize(yield, 0);
+    assertEqual(recorder.calls, 1);
+    assertEqual(recorder.id, (uint32_t)0x551);
+    assertFalse(recorder.state);
+
+    clock.delay(200);
+    ecm.emit(yield);
+    assertSize(yield, 0);
+
+    // the unchanged value is published when the ECM returns
+    ecm.handle(f);
+    ecm.emit(yield);
+    assertSize(yield, 1);
+    assertIsSystemEvent(yield.messages()[0], expect);
+    assertEqual(recorder.calls, 2);
+    assertTrue(recorder.state);
+}
+
 test(EngineTempStateTest, PositiveTemp) {
     FakeYield yield;
     Frame f(0x551, 0, {0x29, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
 
-    EngineTempState ecm;
+    TestNode<EngineTempState> ecm;
     ecm.handle(f);
     ecm.emit(yield);
 
@@ -58,11 +131,26 @@ test(EngineTempStateTest, PositiveTemp) {
     assertIsSystemEvent(yield.messages()[0], expect);
 }
 
+test(EngineTempStateTest, HandleInPlace) {
+    FakeYield yield;
+    byte data[] = {0x29, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+    TestNode<EngineTempState> ecm;
+    assertTrue(ecm.handle(FrameView(0x551, 0, data, sizeof(data))));
+    assertFalse(ecm.handle(FrameView(0x551, 0, data, sizeof(data))));
+    assertFalse(ecm.handle(FrameView(0x550, 0, data, sizeof(data))));
+    ecm.emit(yield);
+
+    SystemEvent expect(Event::ENGINE_TEMP_STATE, {0x29});
+    assertSize(yield, 1);
+    assertIsSystemEvent(yield.messages()[0], expect);
+}
+
 test(EngineTempStateTest, MaxTemp) {
     FakeYield yield;
     Frame f(0x551, 0, {0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
 
-    EngineTempState ecm;
+    TestNode<EngineTempState> ecm;
     ecm.handle(f);
     ecm.emit(yield);
 
@@ -71,6 +159,47 @@ test(EngineTempStateTest, MaxTemp) {
     assertIsSystemEvent(yield.messages()[0], expect);
 }
 
+test(EngineTempStateTest, PreferredUnits) {
+    FakeYield yield;
+    Frame f(0x551, 0, {0x82, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+
+    TestNode<EngineTempState> ecm;
+    ecm.handle(f);
+    ecm.emit(yield);
+    yield.clear();
+
+    // 90C is 194F which does not fit the metric offset byte so byte 0 keeps
+    // the Celsius value
+    EngineTempStateEvent expect;
+    expect.coolant_celsius(90);
+    expect.units(UNITS_US);
+    expect.coolant_fahrenheit(194);
+    ecm.units(UNITS_US);
+    ecm.emit(yield);
+    assertSize(yield, 1);
+    assertIsSystemEvent(yield.messages()[0], expect);
+    assertEqual((int)expect.coolant_temp(), 194);
+    assertEqual((int)expect.data[0], 0x82);
+    assertEqual((int)expect.data[2], 0xC2);
+    assertEqual((int)expect.data[3], 0x00);
+    yield.clear();
+
+    f.data()[0] = 0xA0;
+    expect.coolant_celsius(120);
+    expect.coolant_fahrenheit(248);
+    ecm.handle(f);
+    ecm.emit(yield);
+    assertSize(yield, 1);
+    assertIsSystemEvent(yield.messages()[0], expect);
+    assertEqual((int)expect.data[0], 0xA0);
+    yield.clear();
+
+    ecm.units(UNITS_METRIC);
+    ecm.emit(yield);
+    assertSize(yield, 1);
+    assertIsSystemEvent(yield.messages()[0], SystemEvent(Event::ENGINE_TEMP_STATE, {0xA0}));
+}
+
 }  // namespace R51
 
 // Test boilerplate.
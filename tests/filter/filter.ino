@@ -0,0 +1,128 @@
+#include <AUnit.h>
+#include <Arduino.h>
+#include <Faker.h>
+#include <R51Test.h>
+#include <R51Vehicle.h>
+
+namespace R51 {
+
+using namespace aunit;
+using ::Faker::FakeClock;
+
+// Two masks sharing 2 and 4 filters.
+static const uint8_t MCP2515[] = {2, 4};
+
+// Traffic mix recorded with the ignition on.
+static const TrafficSample TRAFFIC[] = {
+    {0x002, 5000}, {0x160, 10000}, {0x180, 10000}, {0x1F9, 10000},
+    {0x280, 5000}, {0x284, 5000}, {0x285, 5000}, {0x35D, 2500},
+    {0x385, 500}, {0x54A, 1000}, {0x54B, 1000}, {0x54C, 1000},
+    {0x551, 1000}, {0x580, 1000}, {0x60D, 1000}, {0x625, 1000},
+};
+static const size_t TRAFFIC_COUNT = sizeof(TRAFFIC) / sizeof(TRAFFIC[0]);
+
+test(FilterTest, RejectExtendedId) {
+    AcceptanceFilter filter(MCP2515, 2);
+    assertFalse(filter.add(0x800));
+    assertFalse(filter.compute());
+}
+
+test(FilterTest, EmptyFilter) {
+    AcceptanceFilter filter(MCP2515, 2);
+    assertFalse(filter.compute());
+}
+
+test(FilterTest, ExactWhenFiltersSuffice) {
+    AcceptanceFilter filter(MCP2515, 2);
+    assertTrue(filter.add(0x625));
+    assertTrue(filter.add(0x551));
+    assertTrue(filter.add(0x385));
+    assertTrue(filter.compute());
+
+    assertEqual(filter.mask(0), 0x7FF);
+    assertEqual(filter.mask(1), 0x7FF);
+    assertTrue(filter.accepts(0x625));
+    assertTrue(filter.accepts(0x551));
+    assertTrue(filter.accepts(0x385));
+    assertFalse(filter.accepts(0x624));
+    assertFalse(filter.accepts(0x550));
+    assertEqual(filter.falsePositiveRate(TRAFFIC, TRAFFIC_COUNT), 0.0f);
+}
+
+test(FilterTest, MergeAdjacentIds) {
+    static const uint8_t single[] = {1};
+    AcceptanceFilter filter(single, 1);
+    filter.add(0x72E);
+    filter.add(0x72F);
+    assertTrue(filter.compute());
+
+    assertEqual(filter.mask(0), 0x7FE);
+    assertEqual(filter.filter(0, 0) & 0x7FE, 0x72E);
+    assertTrue(filter.accepts(0x72E));
+    assertTrue(filter.accepts(0x72F));
+    assertFalse(filter.accepts(0x72D));
+}
+
+test(FilterTest, VehicleNodes) {
+    FakeClock clock;
+    Climate climate(0, &clock);
+    EngineTempState ecm(0, &clock);
+    IPDM ipdm(0, &clock);
+    TirePressureState tires(0, &clock);
+    Settings settings(false, &clock);
+    Doors doors(0, &clock);
+
+    AcceptanceFilter filter(MCP2515, 2);
+    assertTrue(filter.add(climate, ecm, ipdm, tires, settings, doors));
+    assertTrue(filter.compute(TRAFFIC, TRAFFIC_COUNT));
+
+    uint32_t ids[] = {0x54A, 0x54B, 0x551, 0x625, 0x385, 0x72E, 0x72F, 0x60D};
+    for (uint32_t id : ids) {
+        assertTrue(filter.consumes(id));
+        assertTrue(filter.accepts(id));
+    }
+    // high rate frames never reach the CPU
+    assertFalse(filter.accepts(0x160));
+    assertFalse(filter.accepts(0x180));
+    assertFalse(filter.accepts(0x1F9));
+    assertLess(filter.falsePositiveRate(TRAFFIC, TRAFFIC_COUNT), 0.05f);
+}
+
+test(FilterTest, DoorsIds) {
+    static const uint8_t single[] = {1};
+    FakeClock clock;
+    Doors doors(0, &clock);
+    AcceptanceFilter filter(single, 1);
+    assertTrue(filter.add(doors));
+    assertTrue(filter.compute());
+    assertTrue(filter.consumes(0x60D));
+    assertTrue(filter.accepts(0x60D));
+    assertFalse(filter.accepts(0x60C));
+    assertEqual(filter.falsePositiveRate(TRAFFIC, TRAFFIC_COUNT), 0.0f);
+}
+
+test(FilterTest, PowerManagerIds) {
+    static const uint8_t banks[] = {1, 1, 1, 1, 1};
+    PowerManager power;
+    AcceptanceFilter filter(banks, 5);
+    assertTrue(filter.add(power));
+    assertTrue(filter.compute());
+    assertTrue(filter.accepts(0x551));
+    assertEqual(filter.falsePositiveRate(TRAFFIC, TRAFFIC_COUNT), 0.0f);
+}
+
+}  // namespace R51
+
+// Test boilerplate.
+void setup() {
+#ifdef ARDUINO
+    delay(1000);
+#endif
+    SERIAL_PORT_MONITOR.begin(115200);
+    while(!SERIAL_PORT_MONITOR);
+}
+
+void loop() {
+    aunit::TestRunner::run();
+    delay(1);
+}
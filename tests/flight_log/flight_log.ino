@@ -0,0 +1,237 @@
+#include <AUnit.h>
+#include <Arduino.h>
+#include <Faker.h>
+#include <R51Test.h>
+#include <R51Vehicle.h>
+#include <stdio.h>
+
+namespace R51 {
+
+using namespace aunit;
+using ::Canny::Frame;
+using ::Faker::FakeClock;
+
+#define LOG_PATH "flight_log_test.bin"
+
+// Counts page writes made to the underlying file storage.
+class CountingStorage : public FileFlightLogStorage {
+    public:
+        CountingStorage(uint32_t pages) :
+            FileFlightLogStorage(LOG_PATH, pages), writes(0) {}
+
+        bool write(uint32_t page, const byte* data) override {
+            ++writes;
+            return FileFlightLogStorage::write(page, data);
+        }
+
+        int writes;
+};
+
+class FlightLogTest : public TestOnce {
+    public:
+        FakeClock clock;
+
+        void setup() override {
+            TestOnce::setup();
+            remove(LOG_PATH);
+            clock.set(0);
+        }
+
+        void teardown() override {
+            remove(LOG_PATH);
+            TestOnce::teardown();
+        }
+};
+
+testF(FlightLogTest, IgnoreNonStateMessages) {
+    CountingStorage storage(4);
+    FlightLog log(&storage, &clock);
+
+    log.handle(Frame(0x551, 0, {0x29}));
+    log.handle(SystemEvent(Event::CLIMATE_TOGGLE_AC));
+    assertTrue(log.flush());
+    assertEqual(storage.writes, 0);
+
+    uint32_t ts;
+    SystemEvent event;
+    FlightLogReader reader(&storage);
+    assertFalse(reader.next(&ts, &event));
+}
+
+testF(FlightLogTest, RoundTrip) {
+    CountingStorage storage(4);
+    FlightLog log(&storage, &clock);
+
+    SystemEvent engine(Event::ENGINE_TEMP_STATE, {0x29});
+    SystemEvent power(Event::BODY_POWER_STATE, {0x40});
+    SystemEvent tires(Event::TIRE_PRESSURE_STATE, {0x01, 0x00, 0x03, 0x00});
+
+    clock.set(1000);
+    log.handle(engine);
+    clock.set(1010);
+    log.handle(power);
+    clock.set(100000);
+    log.handle(tires);
+    assertTrue(log.flush());
+    assertEqual(storage.writes, 1);
+
+    uint32_t ts;
+    SystemEvent event;
+    FlightLogReader reader(&storage);
+    assertTrue(reader.next(&ts, &event));
+    assertEqual(ts, 1000u);
+    assertIsSystemEvent(Message(event), engine);
+    assertTrue(reader.next(&ts, &event));
+    assertEqual(ts, 1010u);
+    assertIsSystemEvent(Message(event), power);
+    assertTrue(reader.next(&ts, &event));
+    assertEqual(ts, 100000u);
+    assertIsSystemEvent(Message(event), tires);
+    assertFalse(reader.next(&ts, &event));
+}
+
+testF(FlightLogTest, DoorEvents) {
+    CountingStorage storage(4);
+    FlightLog log(&storage, &clock);
+
+    DoorEdgeEvent edge;
+    edge.changed(1 << DOOR_DRIVER);
+    edge.state(1 << DOOR_DRIVER);
+    DoorStateEvent state;
+    state.driver(true);
+    assertTrue(isStateEvent(edge));
+    assertTrue(isStateEvent(state));
+
+    clock.set(1000);
+    log.handle(edge);
+    log.handle(state);
+    assertTrue(log.flush());
+    assertEqual(storage.writes, 1);
+
+    uint32_t ts;
+    SystemEvent event;
+    FlightLogReader reader(&storage);
+    assertTrue(reader.next(&ts, &event));
+    assertEqual(ts, 1000u);
+    assertIsSystemEvent(Message(event), edge);
+    assertTrue(reader.next(&ts, &event));
+    assertIsSystemEvent(Message(event), state);
+    assertFalse(reader.next(&ts, &event));
+}
+
+testF(FlightLogTest, HandleBatch) {
+    CountingStorage storage(4);
+    FlightLog log(&storage, &clock);
+
+    SystemEvent engine(Event::ENGINE_TEMP_STATE, {0x29});
+    SystemEvent power(Event::BODY_POWER_STATE, {0x40});
+
+    MessageBatch batch;
+    batch.push(engine);
+    batch.push(Frame(0x551, 0, {0x29}));
+    batch.push(SystemEvent(Event::CLIMATE_TOGGLE_AC));
+    batch.push(power);
+
+    clock.set(1000);
+    log.handle(batch);
+    assertTrue(log.flush());
+
+    uint32_t ts;
+    SystemEvent event;
+    FlightLogReader reader(&storage);
+    assertTrue(reader.next(&ts, &event));
+    assertIsSystemEvent(Message(event), engine);
+    assertTrue(reader.next(&ts, &event));
+    assertIsSystemEvent(Message(event), power);
+    assertFalse(reader.next(&ts, &event));
+}
+
+testF(FlightLogTest, WritesWholePages) {
+    CountingStorage storage(8);
+    FlightLog log(&storage, &clock);
+
+    // Each record is 4 bytes: length, 1 byte delta, id, 1 byte of data.
+    // A page holds (256 - 9) / 4 = 61 records.
+    SystemEvent engine(Event::ENGINE_TEMP_STATE, {0x29});
+    for (int i = 0; i < 61; i++) {
+        clock.delay(10);
+        log.handle(engine);
+    }
+    assertEqual(storage.writes, 0);
+
+    clock.delay(10);
+    log.handle(engine);
+    assertEqual(storage.writes, 1);
+}
+
+testF(FlightLogTest, WrapAround) {
+    CountingStorage storage(2);
+    FlightLog log(&storage, &clock);
+
+    SystemEvent event(Event::ENGINE_TEMP_STATE, {0x00});
+    for (int i = 0; i < 3; i++) {
+        clock.delay(10);
+        event.data[0] = i;
+        log.handle(event);
+        log.flush();
+    }
+
+    // The oldest page is overwritten by the third.
+    uint32_t ts;
+    SystemEvent read;
+    FlightLogReader reader(&storage);
+    assertTrue(reader.next(&ts, &read));
+    assertEqual(ts, 20u);
+    assertEqual(read.data[0], 1);
+    assertTrue(reader.next(&ts, &read));
+    assertEqual(ts, 30u);
+    assertEqual(read.data[0], 2);
+    assertFalse(reader.next(&ts, &read));
+}
+
+testF(FlightLogTest, ResumeAfterRestart) {
+    SystemEvent first(Event::ENGINE_TEMP_STATE, {0x01});
+    SystemEvent second(Event::ENGINE_TEMP_STATE, {0x02});
+    {
+        CountingStorage storage(4);
+        FlightLog log(&storage, &clock);
+        clock.set(100);
+        log.handle(first);
+        log.flush();
+    }
+    {
+        CountingStorage storage(4);
+        FlightLog log(&storage, &clock);
+        clock.set(50);
+        log.handle(second);
+        log.flush();
+    }
+
+    uint32_t ts;
+    SystemEvent event;
+    CountingStorage storage(4);
+    FlightLogReader reader(&storage);
+    assertTrue(reader.next(&ts, &event));
+    assertEqual(ts, 100u);
+    assertIsSystemEvent(Message(event), first);
+    assertTrue(reader.next(&ts, &event));
+    assertEqual(ts, 50u);
+    assertIsSystemEvent(Message(event), second);
+    assertFalse(reader.next(&ts, &event));
+}
+
+}  // namespace R51
+
+// Test boilerplate.
+void setup() {
+#ifdef ARDUINO
+    delay(1000);
+#endif
+    SERIAL_PORT_MONITOR.begin(115200);
+    while(!SERIAL_PORT_MONITOR);
+}
+
+void loop() {
+    aunit::TestRunner::run();
+    delay(1);
+}
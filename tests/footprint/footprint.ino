@@ -0,0 +1,497 @@
+#include <AUnit.h>
+#include <Arduino.h>
+#include <Canny.h>
+#include <Caster.h>
+#include <Faker.h>
+#include <R51Core.h>
+#include <R51Test.h>
+#include <R51Vehicle.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ucontext.h>
+
+#if !defined(EPOXY_DUINO)
+#error "The footprint test intercepts the heap and only runs natively."
+#endif
+
+// Budgets enforced by the footprint test. Override with EXTRA_CXXFLAGS, e.g.
+// `make EXTRA_CXXFLAGS=-DFOOTPRINT_MAX_NODE_SIZE=512`.
+
+// Maximum sizeof for any node.
+#ifndef FOOTPRINT_MAX_NODE_SIZE
+#define FOOTPRINT_MAX_NODE_SIZE 1024
+#endif
+
+// Maximum sizeof for any event type.
+#ifndef FOOTPRINT_MAX_EVENT_SIZE
+#define FOOTPRINT_MAX_EVENT_SIZE 16
+#endif
+
+// Maximum stack used by a single call to handle() or emit().
+#ifndef FOOTPRINT_MAX_STACK_DEPTH
+#define FOOTPRINT_MAX_STACK_DEPTH 2048
+#endif
+
+// Maximum heap allocations made by a node beyond those made by its
+// Canny::Frame members and by wrapping yielded frames and events in
+// messages. Applies to construction and to steady state separately.
+#ifndef FOOTPRINT_MAX_ALLOCATIONS
+#define FOOTPRINT_MAX_ALLOCATIONS 0
+#endif
+
+// Heap allocation counter. Allocations are only counted between
+// startCounting() and stopCounting().
+namespace {
+
+volatile bool counting = false;
+size_t allocations = 0;
+size_t allocated = 0;
+
+void countAllocation(size_t size) {
+    if (counting) {
+        ++allocations;
+        allocated += size;
+    }
+}
+
+void startCounting() {
+    allocations = 0;
+    allocated = 0;
+    counting = true;
+}
+
+size_t stopCounting() {
+    counting = false;
+    return allocations;
+}
+
+}  // namespace
+
+#if defined(__GLIBC__)
+// Interpose malloc so allocations made through new and by C code are both
+// counted.
+extern "C" {
+
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size) {
+    countAllocation(size);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    countAllocation(count * size);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    countAllocation(size);
+    return __libc_realloc(ptr, size);
+}
+
+}
+#else
+// Fall back to counting allocations made through new.
+void* operator new(size_t size) {
+    countAllocation(size);
+    void* ptr = malloc(size);
+    if (ptr == nullptr) {
+        abort();
+    }
+    return ptr;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    free(ptr);
+}
+#endif
+
+namespace R51 {
+
+using namespace aunit;
+using ::Canny::Frame;
+using ::Faker::FakeClock;
+
+// Stack depth is measured by running each call on a stack owned by the
+// test. The stack is painted before the call and afterwards scanned from its
+// far end for the deepest overwritten byte. Stacks grow down on the hosts
+// the test runs on.
+static const size_t STACK_PROBE_SIZE = 16384;
+static const byte STACK_PAINT = 0xA5;
+
+class StackProbe {
+    public:
+        // Run fn(arg) on the probe stack and return the bytes it used.
+        size_t measure(void (*fn)(void*), void* arg) {
+            memset(stack_, STACK_PAINT, sizeof(stack_));
+            fn_ = fn;
+            arg_ = arg;
+            getcontext(&probe_);
+            probe_.uc_stack.ss_sp = stack_;
+            probe_.uc_stack.ss_size = sizeof(stack_);
+            probe_.uc_link = &caller_;
+            makecontext(&probe_, run, 0);
+            swapcontext(&caller_, &probe_);
+
+            size_t i = 0;
+            while (i < sizeof(stack_) && stack_[i] == STACK_PAINT) {
+                ++i;
+            }
+            return sizeof(stack_) - i;
+        }
+
+    private:
+        // makecontext only passes int arguments so the call is passed
+        // through statics.
+        static void run() { fn_(arg_); }
+
+        static void (*fn_)(void*);
+        static void* arg_;
+
+        alignas(16) byte stack_[STACK_PROBE_SIZE];
+        ucontext_t probe_;
+        ucontext_t caller_;
+};
+
+void (*StackProbe::fn_)(void*) = nullptr;
+void* StackProbe::arg_ = nullptr;
+
+StackProbe stack_probe;
+
+// Counts yielded frames and events.
+class CountingYield : public Caster::Yield<Message> {
+    public:
+        CountingYield() : frames(0), events(0) {}
+
+        void operator()(const Message& msg) const override {
+            switch (msg.type()) {
+                case Message::CAN_FRAME:
+                    ++frames;
+                    break;
+                case Message::SYSTEM_EVENT:
+                    ++events;
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        mutable size_t frames;
+        mutable size_t events;
+};
+
+// In-memory flight log storage.
+class MemoryStorage : public FlightLogStorage {
+    public:
+        MemoryStorage() {
+            memset(pages_, 0xFF, sizeof(pages_));
+        }
+
+        uint32_t pages() const override { return 2; }
+
+        bool read(uint32_t page, byte* data) override {
+            memcpy(data, pages_[page], FLIGHT_LOG_PAGE_SIZE);
+            return true;
+        }
+
+        bool write(uint32_t page, const byte* data) override {
+            memcpy(pages_[page], data, FLIGHT_LOG_PAGE_SIZE);
+            return true;
+        }
+
+    private:
+        byte pages_[2][FLIGHT_LOG_PAGE_SIZE];
+};
+
+// Discards black box dumps.
+class NullPrint : public Print {
+    public:
+        size_t write(uint8_t) override { return 1; }
+};
+
+// Representative traffic delivered to every node in steady state.
+static const size_t STEADY_STATE_ITERATIONS = 100;
+
+class FootprintTest : public TestOnce {
+    protected:
+        void setup() override {
+            inputs_count_ = 0;
+            addInput(Frame(0x54A, 0, {0x3C, 0x3E, 0x7F, 0x80, 0x3C, 0x3C, 0x00, 0x58}));
+            addInput(Frame(0x54B, 0, {0x00, 0x04, 0x03, 0x24, 0x00, 0x00, 0x00, 0x02}));
+            addInput(Frame(0x551, 0, {0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}));
+            addInput(Frame(0x625, 0, {0x00, 0x60, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}));
+            addInput(Frame(0x385, 0, {0x84, 0x0C, 0x01, 0x02, 0x03, 0x04, 0x00, 0xF0}));
+            addInput(Frame(0x72E, 0, {0x02, 0x50, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}));
+            addInput(Frame(0x72F, 0, {0x02, 0x50, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}));
+            addInput(SystemEvent(Event::CLIMATE_TOGGLE_AC));
+            addInput(SystemEvent(Event::TIRE_SWAP_POSITION, {0x00, 0x01}));
+            addInput(SystemEvent(Event::SETTINGS_REQUEST_CURRENT));
+            addInput(SystemEvent(Event::ENGINE_TEMP_STATE, {0x80}));
+
+            // Measure the allocation cost of the building blocks nodes are
+            // allowed to use.
+            startCounting();
+            {
+                Frame frame(0x540, 0, 8);
+            }
+            frame_cost_ = stopCounting();
+
+            Frame frame(0x540, 0, 8);
+            startCounting();
+            {
+                Message msg(frame);
+            }
+            frame_message_cost_ = stopCounting();
+
+            SystemEvent event(Event::SETTINGS_STATE);
+            startCounting();
+            {
+                Message msg(event);
+            }
+            event_message_cost_ = stopCounting();
+        }
+
+        void addInput(const Message& msg) {
+            inputs_[inputs_count_++] = msg;
+        }
+
+        // Report the node's footprint and check it against the budgets. The
+        // node is constructed by the caller between startCounting() and
+        // stopCounting() and the result is passed in as constructed. The
+        // node is expected to hold the given number of frames.
+        void checkNode(const char* name, Caster::Node<Message>* node,
+                size_t size, size_t constructed, size_t frames) {
+            size_t handle_depth = 0;
+            size_t emit_depth = 0;
+            CountingYield yield;
+
+            // Run the traffic once unmeasured so one time costs such as the
+            // dynamic linker resolving library calls are not charged to the
+            // node.
+            CountingYield warmup;
+            for (size_t j = 0; j < inputs_count_; ++j) {
+                measureHandle(node, inputs_[j]);
+            }
+            measureEmit(node, warmup);
+
+            startCounting();
+            for (size_t i = 0; i < STEADY_STATE_ITERATIONS; ++i) {
+                for (size_t j = 0; j < inputs_count_; ++j) {
+                    size_t depth = measureHandle(node, inputs_[j]);
+                    if (depth > handle_depth) {
+                        handle_depth = depth;
+                    }
+                }
+                clock_.delay(10);
+                size_t depth = measureEmit(node, yield);
+                if (depth > emit_depth) {
+                    emit_depth = depth;
+                }
+            }
+            size_t steady = stopCounting();
+
+            size_t constructed_budget = frames * frame_cost_ +
+                FOOTPRINT_MAX_ALLOCATIONS;
+            size_t steady_budget = yield.frames * frame_message_cost_ +
+                yield.events * event_message_cost_ + FOOTPRINT_MAX_ALLOCATIONS;
+
+            printf("footprint: %-18s size=%4zu construct_allocs=%zu/%zu "
+                    "steady_allocs=%zu/%zu handle_stack=%zu emit_stack=%zu\n",
+                    name, size, constructed, constructed_budget,
+                    steady, steady_budget, handle_depth, emit_depth);
+
+            assertLessOrEqual(size, (size_t)FOOTPRINT_MAX_NODE_SIZE);
+            assertLessOrEqual(constructed, constructed_budget);
+            assertLessOrEqual(steady, steady_budget);
+            assertLessOrEqual(handle_depth, (size_t)FOOTPRINT_MAX_STACK_DEPTH);
+            assertLessOrEqual(emit_depth, (size_t)FOOTPRINT_MAX_STACK_DEPTH);
+        }
+
+        FakeClock clock_;
+
+    private:
+        Message inputs_[16];
+        size_t inputs_count_;
+        size_t frame_cost_;
+        size_t frame_message_cost_;
+        size_t event_message_cost_;
+
+        struct HandleCall {
+            Caster::Node<Message>* node;
+            const Message* msg;
+        };
+
+        struct EmitCall {
+            Caster::Node<Message>* node;
+            const CountingYield* yield;
+        };
+
+        size_t measureHandle(Caster::Node<Message>* node, const Message& msg) {
+            HandleCall call = {node, &msg};
+            return stack_probe.measure([](void* arg) {
+                HandleCall* call = (HandleCall*)arg;
+                call->node->handle(*call->msg);
+            }, &call);
+        }
+
+        size_t measureEmit(Caster::Node<Message>* node,
+                const CountingYield& yield) {
+            EmitCall call = {node, &yield};
+            return stack_probe.measure([](void* arg) {
+                EmitCall* call = (EmitCall*)arg;
+                call->node->emit(*call->yield);
+            }, &call);
+        }
+};
+
+#define REPORT_SIZE(T, MAX) \
+    printf("footprint: sizeof(%s)=%zu\n", #T, sizeof(T)); \
+    assertLessOrEqual(sizeof(T), (size_t)(MAX));
+
+test(FootprintSizeTest, Events) {
+    printf("footprint: SETTINGS_FEATURES=0x%04X\n", (unsigned)SETTINGS_FEATURES);
+    REPORT_SIZE(SystemEvent, FOOTPRINT_MAX_EVENT_SIZE);
+    REPORT_SIZE(ClimateTempStateEvent, FOOTPRINT_MAX_EVENT_SIZE);
+    REPORT_SIZE(ClimateAirflowStateEvent, FOOTPRINT_MAX_EVENT_SIZE);
+    REPORT_SIZE(ClimateSystemStateEvent, FOOTPRINT_MAX_EVENT_SIZE);
+}
+
+testF(FootprintTest, Climate) {
+    startCounting();
+    Climate node(50, &clock_);
+    size_t constructed = stopCounting();
+    checkNode("Climate", &node, sizeof(node), constructed, 2);
+}
+
+testF(FootprintTest, EngineTempState) {
+    startCounting();
+    EngineTempState node(50, &clock_);
+    size_t constructed = stopCounting();
+    checkNode("EngineTempState", &node, sizeof(node), constructed, 0);
+}
+
+testF(FootprintTest, IPDM) {
+    startCounting();
+    IPDM node(50, &clock_);
+    size_t constructed = stopCounting();
+    checkNode("IPDM", &node, sizeof(node), constructed, 0);
+}
+
+testF(FootprintTest, TirePressureState) {
+    startCounting();
+    TirePressureState node(50, &clock_);
+    size_t constructed = stopCounting();
+    checkNode("TirePressureState", &node, sizeof(node), constructed, 0);
+}
+
+testF(FootprintTest, Settings) {
+    startCounting();
+    Settings node(true, &clock_);
+    size_t constructed = stopCounting();
+    checkNode("Settings", &node, sizeof(node), constructed, 1);
+}
+
+// Events handled by each optional setting and the command of the request
+// sent to the BCM.
+struct SettingsFeatureEvent {
+    uint16_t feature;
+    Event event;
+    uint8_t command;
+};
+
+static const SettingsFeatureEvent SETTINGS_FEATURE_EVENTS[] = {
+    {SETTINGS_FEATURE_AUTO_INTERIOR_ILLUMINATION, Event::SETTINGS_TOGGLE_AUTO_INTERIOR_ILLUMINATAION, 0x10},
+    {SETTINGS_FEATURE_AUTO_HEADLIGHT_SENSITIVITY, Event::SETTINGS_NEXT_AUTO_HEADLIGHT_SENSITIVITY, 0x37},
+    {SETTINGS_FEATURE_AUTO_HEADLIGHT_OFF_DELAY, Event::SETTINGS_NEXT_AUTO_HEADLIGHT_OFF_DELAY, 0x39},
+    {SETTINGS_FEATURE_SPEED_SENSING_WIPER_INTERVAL, Event::SETTINGS_TOGGLE_SPEED_SENSING_WIPER_INTERVAL, 0x47},
+    {SETTINGS_FEATURE_REMOTE_KEY_RESPONSE_HORN, Event::SETTINGS_TOGGLE_REMOTE_KEY_RESPONSE_HORN, 0x2A},
+    {SETTINGS_FEATURE_REMOTE_KEY_RESPONSE_LIGHTS, Event::SETTINGS_NEXT_REMOTE_KEY_RESPONSE_LIGHTS, 0x2E},
+    {SETTINGS_FEATURE_AUTO_RELOCK_TIME, Event::SETTINGS_NEXT_AUTO_RELOCK_TIME, 0x2F},
+    {SETTINGS_FEATURE_SELECTIVE_DOOR_UNLOCK, Event::SETTINGS_TOGGLE_SELECTIVE_DOOR_UNLOCK, 0x02},
+    {SETTINGS_FEATURE_SLIDE_DRIVER_SEAT_BACK_ON_EXIT, Event::SETTINGS_TOGGLE_SLIDE_DRIVER_SEAT_BACK_ON_EXIT, 0x01},
+    {SETTINGS_FEATURE_FACTORY_RESET, Event::SETTINGS_FACTORY_RESET, 0x1F},
+};
+
+// Settings which are not compiled in must not react to their events.
+testF(FootprintTest, SettingsDisabledFeatures) {
+    for (const auto& item : SETTINGS_FEATURE_EVENTS) {
+        if (settingsEnabled(item.feature)) {
+            continue;
+        }
+        Settings node(false, &clock_);
+        CountingYield yield;
+        node.handle(SystemEvent(item.event));
+        node.emit(yield);
+        assertEqual(yield.frames, (size_t)0);
+    }
+}
+
+// Settings which are compiled in must request their own update from the BCM.
+testF(FootprintTest, SettingsEnabledFeatures) {
+    for (const auto& item : SETTINGS_FEATURE_EVENTS) {
+        if (!settingsEnabled(item.feature)) {
+            continue;
+        }
+        Settings node(false, &clock_);
+        FakeYield yield;
+        node.handle(SystemEvent(item.event));
+        node.emit(yield);
+        // a factory reset enters both channels
+        assertMoreOrEqual(yield.size(), (size_t)1);
+
+        Frame enter = yield.messages()[0].can_frame();
+        Frame response((enter.id() & ~0x010) | 0x020, 0,
+                {0x02, 0x50, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF});
+        yield.clear();
+        node.handle(response);
+        node.emit(yield);
+        assertSize(yield, 1);
+        const Frame& request = yield.messages()[0].can_frame();
+        assertEqual(request.data()[1], (uint8_t)0x3B);
+        assertEqual(request.data()[2], item.command);
+    }
+}
+
+testF(FootprintTest, FlightLog) {
+    MemoryStorage storage;
+    startCounting();
+    FlightLog node(&storage, &clock_);
+    size_t constructed = stopCounting();
+    // The page buffer dominates the flight log so it is budgeted separately.
+    checkNode("FlightLog", &node, sizeof(node) - FLIGHT_LOG_PAGE_SIZE,
+            constructed, 0);
+}
+
+testF(FootprintTest, BlackBox) {
+    NullPrint out;
+    startCounting();
+    BlackBox node(&out, &clock_);
+    size_t constructed = stopCounting();
+    checkNode("BlackBox", &node, sizeof(node), constructed, 0);
+}
+
+}  // namespace R51
+
+// Test boilerplate.
+void setup() {
+#ifdef ARDUINO
+    delay(1000);
+#endif
+    SERIAL_PORT_MONITOR.begin(115200);
+    while(!SERIAL_PORT_MONITOR);
+}
+
+void loop() {
+    aunit::TestRunner::run();
+    delay(1);
+}
@@ -0,0 +1,117 @@
+#include <AUnit.h>
+#include <Arduino.h>
+#include <Faker.h>
+#include <R51Test.h>
+#include <R51Vehicle.h>
+
+namespace R51 {
+
+using namespace aunit;
+using ::Canny::Frame;
+using ::Faker::FakeClock;
+
+test(HeartbeatTest, Disabled) {
+    FakeClock clock;
+    Heartbeat heartbeat(0, &clock);
+    clock.set(10000);
+    assertFalse(heartbeat.active());
+}
+
+test(HeartbeatTest, FixedInterval) {
+    FakeClock clock;
+    Heartbeat heartbeat(100, &clock);
+
+    for (int i = 0; i < 5; ++i) {
+        clock.delay(99);
+        assertFalse(heartbeat.active());
+        clock.delay(1);
+        assertTrue(heartbeat.active());
+        heartbeat.reset();
+        assertEqual(heartbeat.interval(), 100u);
+    }
+}
+
+test(HeartbeatTest, Backoff) {
+    FakeClock clock;
+    Heartbeat heartbeat(100, &clock);
+    heartbeat.backoff(1000, 2);
+
+    // change emit followed by two fast re-emits
+    heartbeat.reset();
+    assertEqual(heartbeat.interval(), 100u);
+    clock.delay(100);
+    assertTrue(heartbeat.active());
+    heartbeat.reset();
+    assertEqual(heartbeat.interval(), 100u);
+    clock.delay(100);
+    assertTrue(heartbeat.active());
+    heartbeat.reset();
+
+    // then back off to the maximum
+    uint32_t expect[] = {200, 400, 800, 1000, 1000};
+    for (uint32_t interval : expect) {
+        assertEqual(heartbeat.interval(), interval);
+        clock.delay(interval - 1);
+        assertFalse(heartbeat.active());
+        clock.delay(1);
+        assertTrue(heartbeat.active());
+        heartbeat.reset();
+    }
+}
+
+test(HeartbeatTest, ChangeResetsInterval) {
+    FakeClock clock;
+    Heartbeat heartbeat(100, &clock);
+    heartbeat.backoff(1000, 1);
+
+    heartbeat.reset();
+    heartbeat.reset();
+    heartbeat.reset();
+    assertEqual(heartbeat.interval(), 400u);
+
+    heartbeat.change();
+    heartbeat.reset();
+    assertEqual(heartbeat.interval(), 100u);
+}
+
+test(HeartbeatTest, NodeBackoff) {
+    FakeClock clock;
+    FakeYield yield;
+    Frame f(0x625, 0, {0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+
+    IPDM ipdm(100, &clock);
+    ipdm.backoff(400, 1);
+    ipdm.handle(f);
+    ipdm.emit(yield);
+    assertSize(yield, 1);
+    yield.clear();
+
+    // one fast re-emit, then 200ms, then 400ms
+    uint32_t expect[] = {100, 200, 400, 400};
+    for (uint32_t interval : expect) {
+        clock.delay(interval - 1);
+        ipdm.handle(f);
+        ipdm.emit(yield);
+        assertSize(yield, 0);
+        clock.delay(1);
+        ipdm.emit(yield);
+        assertSize(yield, 1);
+        yield.clear();
+    }
+}
+
+}  // namespace R51
+
+// Test boilerplate.
+void setup() {
+#ifdef ARDUINO
+    delay(1000);
+#endif
+    SERIAL_PORT_MONITOR.begin(115200);
+    while(!SERIAL_PORT_MONITOR);
+}
+
+void loop() {
+    aunit::TestRunner::run();
+    delay(1);
+}
@@ -10,11 +10,28 @@ using namespace aunit;
 using ::Canny::Frame;
 using ::Faker::FakeClock;
 
+#if defined(R51_TEST_VEHICLE_NODES)
+// Drive the node under test through VehicleNodes as the gateway does.
+template <typename N>
+class TestNode : public N {
+    public:
+        using N::N;
+        using N::handle;
+
+        void handle(const Message& msg) override { VehicleNodes<N>(*this).handle(msg); }
+        void emit(const Caster::Yield<Message>& yield) override { VehicleNodes<N>(*this).emit(yield); }
+};
+#else
+// Call the node under test directly.
+template <typename N>
+using TestNode = N;
+#endif
+
 test(IPDMTest, IgnoreIncorrectID) {
     FakeYield yield;
     Frame f(0x624, 0, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
 
-    IPDM ipdm;
+    TestNode<IPDM> ipdm;
     ipdm.handle(f);
     ipdm.emit(yield);
     assertSize(yield, 0);
@@ -24,7 +41,7 @@ test(IPDMTest, IgnoreIncorrectSize) {
     FakeYield yield;
     Frame f(0x625, 0, {0x00, 0x00, 0x00});
 
-    IPDM ipdm;
+    TestNode<IPDM> ipdm;
     ipdm.handle(f);
     ipdm.emit(yield);
     assertSize(yield, 0);
@@ -34,7 +51,7 @@ test(IPDMTest, Tick) {
     FakeClock clock;
     FakeYield yield;
 
-    IPDM ipdm(200, &clock);
+    TestNode<IPDM> ipdm(200, &clock);
     ipdm.emit(yield);
     assertSize(yield, 0);
 
@@ -49,7 +66,7 @@ test(IPDMTest, Defog) {
     FakeYield yield;
     Frame f(0x625, 0, {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
 
-    IPDM ipdm;
+    TestNode<IPDM> ipdm;
     ipdm.handle(f);
     ipdm.emit(yield);
     
@@ -62,7 +79,7 @@ test(IPDMTest, HighBeams) {
     FakeYield yield;
     Frame f(0x625, 0, {0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
 
-    IPDM ipdm;
+    TestNode<IPDM> ipdm;
     ipdm.handle(f);
     ipdm.emit(yield);
 
@@ -75,7 +92,7 @@ test(IPDMTest, LowBeams) {
     FakeYield yield;
     Frame f(0x625, 0, {0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
 
-    IPDM ipdm;
+    TestNode<IPDM> ipdm;
     ipdm.handle(f);
     ipdm.emit(yield);
 
@@ -88,7 +105,7 @@ test(IPDMTest, FogLights) {
     FakeYield yield;
     Frame f(0x625, 0, {0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
 
-    IPDM ipdm;
+    TestNode<IPDM> ipdm;
     ipdm.handle(f);
     ipdm.emit(yield);
 
@@ -101,7 +118,7 @@ test(IPDMTest, RunningLights) {
     FakeYield yield;
     Frame f(0x625, 0, {0x00, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
 
-    IPDM ipdm;
+    TestNode<IPDM> ipdm;
     ipdm.handle(f);
     ipdm.emit(yield);
 
@@ -114,7 +131,7 @@ test(IPDMTest, ACCompressor) {
     FakeYield yield;
     Frame f(0x625, 0, {0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
 
-    IPDM ipdm;
+    TestNode<IPDM> ipdm;
     ipdm.handle(f);
     ipdm.emit(yield);
 
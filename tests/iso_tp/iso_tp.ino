@@ -0,0 +1,183 @@
+#include <AUnit.h>
+#include <Arduino.h>
+#include <Canny.h>
+#include <Faker.h>
+#include <R51Test.h>
+#include <R51Vehicle.h>
+
+namespace R51 {
+
+using namespace aunit;
+using ::Canny::Frame;
+using ::Faker::FakeClock;
+
+test(IsoTpTest, IgnoreIncorrectID) {
+    IsoTp tp(0x71E, 0x72E);
+    Frame f(0x72F, 0, {0x02, 0x50, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF});
+    assertFalse(tp.handle(f));
+}
+
+test(IsoTpTest, ReceiveSingleFrame) {
+    IsoTp tp(0x71E, 0x72E);
+    Frame f(0x72E, 0, {0x02, 0x50, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF});
+    assertTrue(tp.handle(f));
+    assertEqual(tp.size(), 2u);
+    assertEqual(tp.data()[0], 0x50);
+    assertEqual(tp.data()[1], 0xC0);
+
+    Frame out;
+    assertFalse(tp.read(&out));
+}
+
+test(IsoTpTest, ReceiveMultiFrame) {
+    FakeClock clock;
+    IsoTp tp(0x71E, 0x72E, 0, 0x0A, &clock);
+    Frame out;
+
+    Frame ff(0x72E, 0, {0x10, 0x11, 0x61, 0x01, 0x00, 0x1E, 0x24, 0x00});
+    Frame cf1(0x72E, 0, {0x21, 0x10, 0x0C, 0x40, 0x40, 0x01, 0x64, 0x00});
+    Frame cf2(0x72E, 0, {0x22, 0x94, 0x00, 0x00, 0x47, 0xFF, 0xFF, 0xFF});
+    Frame fc(0x71E, 0, {0x30, 0x00, 0x0A, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF});
+
+    assertFalse(tp.handle(ff));
+    assertTrue(tp.read(&out));
+    assertIsCANFrame(Message(out), fc);
+    assertFalse(tp.read(&out));
+
+    assertFalse(tp.handle(cf1));
+    assertTrue(tp.handle(cf2));
+    assertEqual(tp.size(), 17u);
+    assertEqual(tp.data()[0], 0x61);
+    assertEqual(tp.data()[6], 0x10);
+    assertEqual(tp.data()[13], 0x94);
+    assertEqual(tp.data()[16], 0x47);
+}
+
+test(IsoTpTest, ReceiveBlockSize) {
+    FakeClock clock;
+    IsoTp tp(0x71E, 0x72E, 1, 0x00, &clock);
+    Frame out;
+
+    Frame ff(0x72E, 0, {0x10, 0x11, 0x61, 0x01, 0x00, 0x1E, 0x24, 0x00});
+    Frame cf1(0x72E, 0, {0x21, 0x10, 0x0C, 0x40, 0x40, 0x01, 0x64, 0x00});
+    Frame cf2(0x72E, 0, {0x22, 0x94, 0x00, 0x00, 0x47, 0xFF, 0xFF, 0xFF});
+    Frame fc(0x71E, 0, {0x30, 0x01, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF});
+
+    tp.handle(ff);
+    assertTrue(tp.read(&out));
+    assertIsCANFrame(Message(out), fc);
+
+    // A new flow control frame is required after each block.
+    assertFalse(tp.handle(cf1));
+    assertTrue(tp.read(&out));
+    assertIsCANFrame(Message(out), fc);
+
+    assertTrue(tp.handle(cf2));
+    assertFalse(tp.read(&out));
+}
+
+test(IsoTpTest, ReceiveSequenceError) {
+    FakeClock clock;
+    IsoTp tp(0x71E, 0x72E, 0, 0x0A, &clock);
+    Frame out;
+
+    Frame ff(0x72E, 0, {0x10, 0x11, 0x61, 0x01, 0x00, 0x1E, 0x24, 0x00});
+    Frame cf2(0x72E, 0, {0x22, 0x94, 0x00, 0x00, 0x47, 0xFF, 0xFF, 0xFF});
+    Frame cf1(0x72E, 0, {0x21, 0x10, 0x0C, 0x40, 0x40, 0x01, 0x64, 0x00});
+
+    tp.handle(ff);
+    tp.read(&out);
+    assertFalse(tp.handle(cf2));
+    assertFalse(tp.handle(cf1));
+}
+
+test(IsoTpTest, ReceiveOverflow) {
+    IsoTp tp(0x71E, 0x72E);
+    Frame out;
+
+    Frame ff(0x72E, 0, {0x1F, 0xFF, 0x61, 0x01, 0x00, 0x1E, 0x24, 0x00});
+    Frame fc(0x71E, 0, {0x32, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF});
+
+    assertFalse(tp.handle(ff));
+    assertTrue(tp.read(&out));
+    assertIsCANFrame(Message(out), fc);
+    assertFalse(tp.read(&out));
+}
+
+test(IsoTpTest, SendSingleFrame) {
+    IsoTp tp(0x71E, 0x72E);
+    Frame out;
+    Frame expect(0x71E, 0, {0x02, 0x10, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF});
+
+    byte payload[] = {0x10, 0xC0};
+    assertTrue(tp.send(payload, sizeof(payload)));
+    assertFalse(tp.idle());
+    assertTrue(tp.read(&out));
+    assertIsCANFrame(Message(out), expect);
+    assertTrue(tp.idle());
+    assertFalse(tp.read(&out));
+}
+
+test(IsoTpTest, SendSingleFrameToSlot) {
+    IsoTp tp(0x71E, 0x72E);
+    byte data[8];
+    FrameSlot slot(data);
+    byte expect[] = {0x02, 0x10, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+    byte payload[] = {0x10, 0xC0};
+    assertTrue(tp.send(payload, sizeof(payload)));
+    assertTrue(tp.read(&slot));
+    assertEqual(slot.id(), (uint32_t)0x71E);
+    assertEqual(slot.ext(), (uint8_t)0);
+    assertEqual(slot.size(), (uint8_t)8);
+    assertEqual(memcmp(data, expect, sizeof(expect)), 0);
+    assertTrue(tp.idle());
+    assertFalse(tp.read(&slot));
+}
+
+test(IsoTpTest, SendMultiFrame) {
+    FakeClock clock;
+    IsoTp tp(0x71E, 0x72E, 0, 0x0A, &clock);
+    Frame out;
+
+    byte payload[] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+        0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F};
+    Frame ff(0x71E, 0, {0x10, 0x0F, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06});
+    Frame cf1(0x71E, 0, {0x21, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D});
+    Frame cf2(0x71E, 0, {0x22, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF});
+    Frame fc(0x72E, 0, {0x30, 0x00, 0x05, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF});
+
+    assertTrue(tp.send(payload, sizeof(payload)));
+    assertTrue(tp.read(&out));
+    assertIsCANFrame(Message(out), ff);
+
+    // Wait for flow control.
+    assertFalse(tp.read(&out));
+    tp.handle(fc);
+
+    assertTrue(tp.read(&out));
+    assertIsCANFrame(Message(out), cf1);
+
+    // Respect STmin.
+    assertFalse(tp.read(&out));
+    clock.delay(5);
+    assertTrue(tp.read(&out));
+    assertIsCANFrame(Message(out), cf2);
+    assertTrue(tp.idle());
+}
+
+}  // namespace R51
+
+// Test boilerplate.
+void setup() {
+#ifdef ARDUINO
+    delay(1000);
+#endif
+    SERIAL_PORT_MONITOR.begin(115200);
+    while(!SERIAL_PORT_MONITOR);
+}
+
+void loop() {
+    aunit::TestRunner::run();
+    delay(1);
+}
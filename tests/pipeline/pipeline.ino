@@ -0,0 +1,211 @@
+#include <AUnit.h>
+#include <Arduino.h>
+#include <Faker.h>
+#include <R51Test.h>
+#include <R51Vehicle.h>
+
+namespace R51 {
+
+using namespace aunit;
+using ::Canny::Frame;
+using ::Faker::FakeClock;
+
+// A message flattened for comparison.
+struct Record {
+    uint8_t type;
+    uint32_t id;
+    uint8_t size;
+    uint8_t data[8];
+};
+
+// Records yielded messages.
+class RecordingYield : public Caster::Yield<Message> {
+    public:
+        RecordingYield() : count(0) {}
+
+        void operator()(const Message& msg) const override {
+            if (count >= 32) {
+                ++count;
+                return;
+            }
+            Record& r = records[count++];
+            memset(&r, 0, sizeof(r));
+            r.type = msg.type();
+            if (msg.type() == Message::CAN_FRAME) {
+                r.id = msg.can_frame().id();
+                r.size = msg.can_frame().size() < 8 ? msg.can_frame().size() : 8;
+                memcpy(r.data, msg.can_frame().data(), r.size);
+            } else {
+                r.id = msg.system_event().id;
+                r.size = sizeof(msg.system_event().data) < 8 ?
+                    sizeof(msg.system_event().data) : 8;
+                memcpy(r.data, msg.system_event().data, r.size);
+            }
+        }
+
+        void clear() { count = 0; }
+
+        mutable Record records[32];
+        mutable size_t count;
+};
+
+// The vehicle nodes driven by a gateway.
+class Vehicle {
+    public:
+        Vehicle(FakeClock* clock) :
+            climate(100, clock), ecm(200, clock), ipdm(200, clock),
+            tires(200, clock), settings(true, clock) {}
+
+        Climate climate;
+        EngineTempState ecm;
+        IPDM ipdm;
+        TirePressureState tires;
+        Settings settings;
+};
+
+class PipelineTest : public TestOnce {
+    public:
+        FakeClock clock;
+        uint32_t seed;
+
+        void setup() override {
+            TestOnce::setup();
+            clock.set(0);
+            seed = 0x51;
+        }
+
+        uint8_t random8() {
+            seed = seed * 1103515245 + 12345;
+            return seed >> 16;
+        }
+
+        // Fill msg with a random vehicle frame or control event.
+        void randomFrame(Frame* frame) {
+            static const uint32_t ids[] = {0x54A, 0x54B, 0x551, 0x625, 0x385, 0x72E, 0x72F, 0x100};
+            frame->id(ids[random8() % 8], 0);
+            frame->resize(8);
+            for (int i = 0; i < 8; ++i) {
+                frame->data()[i] = random8() % 4 == 0 ? random8() : 0;
+            }
+        }
+
+        SystemEvent randomEvent() {
+            static const Event events[] = {
+                Event::CLIMATE_TOGGLE_AC,
+                Event::CLIMATE_TOGGLE_AUTO,
+                Event::CLIMATE_INC_FAN_SPEED,
+                Event::CLIMATE_DEC_DRIVER_TEMP,
+                Event::TIRE_SWAP_POSITION,
+                Event::SETTINGS_REQUEST_CURRENT,
+                Event::SETTINGS_TOGGLE_AUTO_INTERIOR_ILLUMINATAION,
+            };
+            SystemEvent event(events[random8() % 7], {random8(), 0x00});
+            return event;
+        }
+};
+
+testF(PipelineTest, MatchesVirtualDispatch) {
+    Vehicle a(&clock);
+    Vehicle b(&clock);
+    Caster::Node<Message>* nodes[] = {&a.climate, &a.ecm, &a.ipdm, &a.tires, &a.settings};
+    VehicleNodes<Climate, EngineTempState, IPDM, TirePressureState, Settings> pipeline(
+            b.climate, b.ecm, b.ipdm, b.tires, b.settings);
+
+    RecordingYield expect;
+    RecordingYield actual;
+    Frame frame(0, 0, 8);
+    size_t total = 0;
+    for (int step = 0; step < 5000; ++step) {
+        clock.delay(random8() % 50);
+
+        uint8_t action = random8() % 4;
+        if (action < 2) {
+            randomFrame(&frame);
+            for (auto* node : nodes) {
+                node->handle(frame);
+            }
+            pipeline.handle(frame);
+        } else if (action == 2) {
+            SystemEvent event = randomEvent();
+            for (auto* node : nodes) {
+                node->handle(event);
+            }
+            pipeline.handle(event);
+        }
+
+        expect.clear();
+        actual.clear();
+        for (auto* node : nodes) {
+            node->emit(expect);
+        }
+        pipeline.emit(actual);
+
+        assertEqual(actual.count, expect.count);
+        for (size_t i = 0; i < expect.count && i < 32; ++i) {
+            assertEqual(memcmp(&actual.records[i], &expect.records[i], sizeof(Record)), 0);
+        }
+        total += expect.count;
+    }
+    // make sure the replay exercised the nodes
+    assertMore(total, (size_t)1000);
+}
+
+testF(PipelineTest, EmptyPipeline) {
+    RecordingYield yield;
+    VehicleNodes<> pipeline;
+    pipeline.handle(Frame(0x551, 0, {0x29}));
+    pipeline.emit(yield);
+    assertEqual(yield.count, (size_t)0);
+    assertEqual(pipeline.nextDeadline(), DEADLINE_NONE);
+}
+
+testF(PipelineTest, FoldsVehicleNodeHooks) {
+    Vehicle v(&clock);
+    VehicleNode* nodes[] = {&v.climate, &v.ecm, &v.ipdm, &v.tires, &v.settings};
+    VehicleNodes<Climate, EngineTempState, IPDM, TirePressureState, Settings> pipeline(
+            v.climate, v.ecm, v.ipdm, v.tires, v.settings);
+    RecordingYield yield;
+
+    // the deadline is the earliest of the nodes
+    pipeline.emit(yield);
+    clock.delay(10);
+    uint32_t expect = DEADLINE_NONE;
+    for (auto* node : nodes) {
+        expect = earliestDeadline(expect, node->nextDeadline());
+    }
+    assertEqual(pipeline.nextDeadline(), expect);
+
+    // units are passed to each node
+    pipeline.units(UNITS_US);
+    pipeline.handle(Frame(0x551, 0, {0x82}));
+    yield.clear();
+    v.ecm.emit(yield);
+    EngineTempStateEvent coolant;
+    coolant.coolant_celsius(90);
+    coolant.units(UNITS_US);
+    coolant.coolant_fahrenheit(194);
+    assertEqual(yield.count, (size_t)1);
+    assertEqual(memcmp(yield.records[0].data, coolant.data, sizeof(coolant.data)), 0);
+
+    // power is passed to each node
+    pipeline.power(POWER_SLEEP);
+    assertEqual(v.settings.nextDeadline(), DEADLINE_NONE);
+    pipeline.power(POWER_IGNITION);
+    assertEqual(v.settings.nextDeadline(), (uint32_t)0);
+}
+
+}  // namespace R51
+
+// Test boilerplate.
+void setup() {
+#ifdef ARDUINO
+    delay(1000);
+#endif
+    SERIAL_PORT_MONITOR.begin(115200);
+    while(!SERIAL_PORT_MONITOR);
+}
+
+void loop() {
+    aunit::TestRunner::run();
+    delay(1);
+}
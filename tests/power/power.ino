@@ -0,0 +1,271 @@
+#include <AUnit.h>
+#include <Arduino.h>
+#include <Faker.h>
+#include <R51Test.h>
+#include <R51Vehicle.h>
+
+namespace R51 {
+
+using namespace aunit;
+using ::Canny::Frame;
+using ::Faker::FakeClock;
+
+// Records the power mode notifications it receives.
+class PowerRecorder : public VehicleNode {
+    public:
+        PowerRecorder(uint8_t* order, uint8_t* count, uint8_t id) :
+            mode(POWER_AWAKE), calls(0), order_(order), count_(count), id_(id) {}
+
+        void handle(const Message&) override {}
+        void emit(const Caster::Yield<Message>&) override {}
+
+        void power(PowerMode mode) override {
+            this->mode = mode;
+            ++calls;
+            order_[(*count_)++] = id_;
+        }
+
+        PowerMode mode;
+        uint8_t calls;
+
+    private:
+        uint8_t* order_;
+        uint8_t* count_;
+        uint8_t id_;
+};
+
+class PowerTest : public TestOnce {
+    public:
+        FakeClock clock;
+        FakeYield yield;
+        uint8_t order[16];
+        uint8_t count;
+
+        void setup() override {
+            TestOnce::setup();
+            clock.set(0);
+            yield.clear();
+            memset(order, 0, sizeof(order));
+            count = 0;
+        }
+};
+
+testF(PowerTest, AttachNotifiesSleep) {
+    PowerManager manager(&clock);
+    PowerRecorder node(order, &count, 1);
+
+    assertTrue(manager.attach(&node));
+    assertEqual(node.calls, 1);
+    assertEqual(node.mode, POWER_SLEEP);
+}
+
+testF(PowerTest, AttachFull) {
+    PowerManager manager(&clock);
+    PowerRecorder node(order, &count, 1);
+
+    for (size_t i = 0; i < POWER_MAX_NODES; ++i) {
+        assertTrue(manager.attach(&node));
+    }
+    assertFalse(manager.attach(&node));
+}
+
+testF(PowerTest, AwakeOnBodyTraffic) {
+    PowerManager manager(&clock);
+    PowerRecorder node(order, &count, 1);
+    manager.attach(&node);
+
+    manager.handle(Frame(0x625, 0, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}));
+    manager.emit(yield);
+    assertEqual(manager.mode(), POWER_AWAKE);
+    assertEqual(node.mode, POWER_AWAKE);
+    assertEqual(node.calls, 2);
+    assertSize(yield, 0);
+
+    // repeated traffic does not notify again
+    manager.handle(Frame(0x625, 0, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}));
+    manager.emit(yield);
+    assertEqual(node.calls, 2);
+}
+
+testF(PowerTest, IgnoreOwnTraffic) {
+    PowerManager manager(&clock);
+    PowerRecorder node(order, &count, 1);
+    manager.attach(&node);
+
+    manager.handle(Frame(0x540, 0, {0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}));
+    manager.handle(Frame(0x71E, 0, {0x02, 0x10, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}));
+    manager.emit(yield);
+    assertEqual(manager.mode(), POWER_SLEEP);
+    assertEqual(node.calls, 1);
+}
+
+testF(PowerTest, IgnitionOnEngineTraffic) {
+    PowerManager manager(&clock);
+    PowerRecorder node(order, &count, 1);
+    manager.attach(&node);
+
+    manager.handle(Frame(0x551, 0, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}));
+    manager.emit(yield);
+    assertEqual(node.mode, POWER_IGNITION);
+
+    // ignition drops back to awake while the body is still broadcasting
+    clock.delay(POWER_IGNITION_TIMEOUT);
+    manager.emit(yield);
+    assertEqual(node.mode, POWER_AWAKE);
+
+    clock.delay(POWER_SLEEP_TIMEOUT - POWER_IGNITION_TIMEOUT);
+    manager.emit(yield);
+    assertEqual(node.mode, POWER_SLEEP);
+}
+
+testF(PowerTest, SleepInReverseOrder) {
+    PowerManager manager(&clock);
+    PowerRecorder first(order, &count, 1);
+    PowerRecorder second(order, &count, 2);
+    manager.attach(&first);
+    manager.attach(&second);
+
+    manager.handle(Frame(0x54A, 0, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}));
+    manager.emit(yield);
+    clock.delay(POWER_SLEEP_TIMEOUT - 1);
+    manager.emit(yield);
+    assertEqual(manager.mode(), POWER_AWAKE);
+
+    clock.delay(1);
+    manager.emit(yield);
+    assertEqual(manager.mode(), POWER_SLEEP);
+
+    assertEqual(count, 6);
+    // attach
+    assertEqual(order[0], 1);
+    assertEqual(order[1], 2);
+    // wake
+    assertEqual(order[2], 1);
+    assertEqual(order[3], 2);
+    // sleep
+    assertEqual(order[4], 2);
+    assertEqual(order[5], 1);
+}
+
+testF(PowerTest, ClimateSuspended) {
+    Climate climate(0, &clock);
+    climate.power(POWER_SLEEP);
+
+    clock.set(5000);
+    climate.emit(yield);
+    assertSize(yield, 0);
+
+    Frame init540(0x540, 0, {0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+    Frame init541(0x541, 0, {0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+
+    // init handshake runs again on wake
+    climate.power(POWER_AWAKE);
+    clock.delay(100);
+    climate.emit(yield);
+    assertSize(yield, 2);
+    assertIsCANFrame(yield.messages()[0], init540);
+    assertIsCANFrame(yield.messages()[1], init541);
+}
+
+testF(PowerTest, ECMSuspended) {
+    EngineTempState ecm(200, &clock);
+    ecm.power(POWER_SLEEP);
+
+    clock.delay(200);
+    ecm.emit(yield);
+    assertSize(yield, 0);
+
+    // changes are still published while suspended
+    ecm.handle(Frame(0x551, 0, {0x50, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}));
+    ecm.emit(yield);
+    assertSize(yield, 1);
+    yield.clear();
+
+    ecm.power(POWER_AWAKE);
+    clock.delay(200);
+    ecm.emit(yield);
+    assertSize(yield, 1);
+}
+
+testF(PowerTest, DoorsSuspendedInPlace) {
+    PowerManager manager(&clock);
+    Doors doors(200, &clock);
+    manager.attach(&doors);
+
+    // periodic re-emits stop while the vehicle sleeps
+    clock.set(200);
+    doors.emit(yield);
+    assertSize(yield, 0);
+
+    // broadcasts handled in place wake the vehicle
+    Frame f(0x625, 0, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+    assertTrue(manager.handle(FrameView(f)));
+    manager.emit(yield);
+    assertEqual(manager.mode(), POWER_AWAKE);
+    clock.delay(200);
+    doors.emit(yield);
+    assertSize(yield, 1);
+    assertIsSystemEvent(yield.messages()[0], DoorStateEvent());
+}
+
+testF(PowerTest, SettingsDeferInit) {
+    PowerManager manager(&clock);
+    Settings settings(true, &clock);
+    manager.attach(&settings);
+
+    // nothing is sent while the vehicle sleeps
+    settings.emit(yield);
+    assertSize(yield, 0);
+    assertEqual(settings.nextDeadline(), DEADLINE_NONE);
+
+    // init starts once the vehicle wakes
+    Frame enterE(0x71E, 0, {0x02, 0x10, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF});
+    Frame enterF(0x71F, 0, {0x02, 0x10, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF});
+    settings.power(POWER_AWAKE);
+    settings.emit(yield);
+    assertSize(yield, 2);
+    assertIsCANFrame(yield.messages()[0], enterE);
+    assertIsCANFrame(yield.messages()[1], enterF);
+}
+
+testF(PowerTest, SettingsWaitForIgnition) {
+    Settings settings(false, &clock);
+    settings.power(POWER_SLEEP);
+    settings.emit(yield);
+    assertSize(yield, 0);
+
+    settings.power(POWER_AWAKE);
+    settings.emit(yield);
+    assertSize(yield, 0);
+
+    Frame enterE(0x71E, 0, {0x02, 0x10, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF});
+    Frame enterF(0x71F, 0, {0x02, 0x10, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF});
+
+    settings.power(POWER_IGNITION);
+    settings.emit(yield);
+    assertSize(yield, 2);
+    assertIsCANFrame(yield.messages()[0], enterE);
+    assertIsCANFrame(yield.messages()[1], enterF);
+    yield.clear();
+
+    // sleeping abandons the exchange
+    settings.power(POWER_SLEEP);
+    settings.emit(yield);
+    assertSize(yield, 0);
+}
+
+}  // namespace R51
+
+// Test boilerplate.
+void setup() {
+#ifdef ARDUINO
+    delay(1000);
+#endif
+    SERIAL_PORT_MONITOR.begin(115200);
+    while(!SERIAL_PORT_MONITOR);
+}
+
+void loop() {
+    aunit::TestRunner::run();
+    delay(1);
+}
@@ -10,6 +10,41 @@ using namespace aunit;
 using ::Canny::Frame;
 using ::Faker::FakeClock;
 
+#if defined(R51_TEST_VEHICLE_NODES)
+// Drive the node under test through VehicleNodes as the gateway does.
+template <typename N>
+class TestNode : public N {
+    public:
+        using N::N;
+        using N::handle;
+
+        void handle(const Message& msg) override { VehicleNodes<N>(*this).handle(msg); }
+        void emit(const Caster::Yield<Message>& yield) override { VehicleNodes<N>(*this).emit(yield); }
+};
+#else
+// Call the node under test directly.
+template <typename N>
+using TestNode = N;
+#endif
+
+// Records abandoned settings sequences.
+class FailureRecorder : public SettingsObserver {
+    public:
+        FailureRecorder() : request_id(0), service(0), reason(0xFF), calls(0) {}
+
+        void failed(uint32_t request_id, uint8_t service, uint8_t reason) override {
+            this->request_id = request_id;
+            this->service = service;
+            this->reason = reason;
+            ++calls;
+        }
+
+        uint32_t request_id;
+        uint8_t service;
+        uint8_t reason;
+        uint8_t calls;
+};
+
 class SettingsTest : public TestOnce {
     public:
         Faker::FakeClock clock;
@@ -191,7 +226,7 @@ testF(SettingsTest, Init) {
     Frame frameF;
 
     // Trigger settings initialization.
-    Settings settings(true, &clock);
+    TestNode<Settings> settings(true, &clock);
     settings.emit(yield);
 
     // Receive enter frames.
@@ -274,7 +309,7 @@ testF(SettingsTest, Init) {
 
 testF(SettingsTest, RequestCurrent) {
     FakeYield yield;
-    Settings settings(false, &clock);
+    TestNode<Settings> settings(false, &clock);
 
     Frame frameE;
     Frame frameF;
@@ -330,11 +365,14 @@ testF(SettingsTest, RequestCurrent) {
     fillExitResponse(&frameF, 0x72F);
     settings.handle(frameF);
 
-    // Receive E exit frame.
+    // Receive E exit frame. The F channel completed so its state is
+    // published without waiting on E.
+    event = SystemEvent(Event::SETTINGS_STATE, {0x00, 0x00, 0x00, 0xC0});
     settings.emit(yield);
     fillExitRequest(&frameE, 0x71E);
-    assertSize(yield, 1);
+    assertSize(yield, 2);
     assertIsCANFrame(yield.messages()[0], frameE);
+    assertIsSystemEvent(yield.messages()[1], event);
     yield.clear();
 
     // Simulate response.
@@ -342,7 +380,92 @@ testF(SettingsTest, RequestCurrent) {
     settings.handle(frameE);
 
     // Ensure settings are at default.
-    event = SystemEvent(Event::SETTINGS_STATE, {0x00, 0x00, 0x00, 0x00});
+    event = SystemEvent(Event::SETTINGS_STATE, {0x00, 0x00, 0x00, 0xC0});
+    settings.emit(yield);
+    assertSize(yield, 1);
+    assertIsSystemEvent(yield.messages()[0], event);
+}
+
+testF(SettingsTest, FlowControl) {
+    FakeYield yield;
+    TestNode<Settings> settings(false, &clock);
+    settings.flowControl(2, 0x00);
+
+    Frame frameE;
+    Frame frameF;
+
+    // Send control event to trigger retrieve.
+    SystemEvent event(Event::SETTINGS_REQUEST_CURRENT);
+    settings.handle(event);
+
+    // Exchange enter frames.
+    settings.emit(yield);
+    yield.clear();
+    fillEnterResponse(&frameE, 0x72E);
+    settings.handle(frameE);
+    fillEnterResponse(&frameF, 0x72F);
+    settings.handle(frameF);
+
+    // Receive state request frames.
+    settings.emit(yield);
+    assertSize(yield, 2);
+    yield.clear();
+
+    // Flow control advertises the configured block size and STmin.
+    fillFrame(&frameE, 0x72E, {0x10, 0x11, 0x61, 0x01, 0x00, 0x1E, 0x24, 0x00});
+    settings.handle(frameE);
+    settings.emit(yield);
+    fillFrame(&frameE, 0x71E, {0x30, 0x02, 0x00});
+    assertSize(yield, 1);
+    assertIsCANFrame(yield.messages()[0], frameE);
+}
+
+testF(SettingsTest, IndependentChannels) {
+    FakeYield yield;
+    TestNode<Settings> settings(false, &clock);
+
+    Frame frameE;
+    Frame frameF;
+
+    // Start an update on the E channel.
+    SystemEvent event(Event::SETTINGS_TOGGLE_AUTO_INTERIOR_ILLUMINATAION);
+    settings.handle(event);
+
+    // Request current settings while E is busy. F is retrieved immediately.
+    event = SystemEvent(Event::SETTINGS_REQUEST_CURRENT);
+    settings.handle(event);
+
+    settings.emit(yield);
+    fillEnterRequest(&frameE, 0x71E);
+    fillEnterRequest(&frameF, 0x71F);
+    assertSize(yield, 2);
+    assertIsCANFrame(yield.messages()[0], frameE);
+    assertIsCANFrame(yield.messages()[1], frameF);
+    yield.clear();
+
+    // Complete the F exchange.
+    fillEnterResponse(&frameF, 0x72F);
+    settings.handle(frameF);
+    settings.emit(yield);
+    fillState0221Request(&frameF, 0x71F);
+    assertSize(yield, 1);
+    assertIsCANFrame(yield.messages()[0], frameF);
+    yield.clear();
+
+    fillFrame(&frameF, 0x72F, {0x05, 0x61, 0x01, 0x01, 0x00, 0x00, 0xFF, 0xFF});
+    settings.handle(frameF);
+    settings.emit(yield);
+    fillExitRequest(&frameF, 0x71F);
+    assertSize(yield, 1);
+    assertIsCANFrame(yield.messages()[0], frameF);
+    yield.clear();
+
+    fillExitResponse(&frameF, 0x72F);
+    settings.handle(frameF);
+
+    // F state is published while E is still waiting on the BCM. The E
+    // settings hold defaults so only the F channel is marked as received.
+    event = SystemEvent(Event::SETTINGS_STATE, {0x02, 0x00, 0x00, 0x80});
     settings.emit(yield);
     assertSize(yield, 1);
     assertIsSystemEvent(yield.messages()[0], event);
@@ -350,7 +473,7 @@ testF(SettingsTest, RequestCurrent) {
 
 testF(SettingsTest, FactoryReset) {
     FakeYield yield;
-    Settings settings(false, &clock);
+    TestNode<Settings> settings(false, &clock);
 
     Frame frameE;
     Frame frameF;
@@ -421,11 +544,14 @@ testF(SettingsTest, FactoryReset) {
     fillExitResponse(&frameF, 0x72F);
     settings.handle(frameF);
 
-    // Receive E exit frame.
+    // Receive E exit frame. The F channel completed so its state is
+    // published without waiting on E.
+    event = SystemEvent(Event::SETTINGS_STATE, {0x00, 0x00, 0x00, 0xC0});
     settings.emit(yield);
     fillExitRequest(&frameE, 0x71E);
-    assertSize(yield, 1);
+    assertSize(yield, 2);
     assertIsCANFrame(yield.messages()[0], frameE);
+    assertIsSystemEvent(yield.messages()[1], event);
     yield.clear();
 
     // Simulate response.
@@ -433,18 +559,18 @@ testF(SettingsTest, FactoryReset) {
     settings.handle(frameE);
 
     // Ensure settings are at default.
-    event = SystemEvent(Event::SETTINGS_STATE, {0x00, 0x00, 0x00, 0x00});
+    event = SystemEvent(Event::SETTINGS_STATE, {0x00, 0x00, 0x00, 0xC0});
     settings.emit(yield);
     assertSize(yield, 1);
     assertIsSystemEvent(yield.messages()[0], event);
 }
 
 testF(SettingsTest, ToggleAutoInteriorIllumination) {
-    Settings settings(false, &clock);
+    TestNode<Settings> settings(false, &clock);
 
     // Initial state.
     SystemEvent control(Event::SETTINGS_TOGGLE_AUTO_INTERIOR_ILLUMINATAION);
-    SystemEvent expect(Event::SETTINGS_STATE, {0x00, 0x00, 0x00, 0x00});
+    SystemEvent expect(Event::SETTINGS_STATE, {0x00, 0x00, 0x00, 0x40});
     Frame state10 = {0x72E, 8, {0x10, 0x11, 0x61, 0x01, 0x00, 0x1E, 0x24, 0x00}};
     Frame state21 = {0x72E, 8, {0x21, 0x10, 0x0C, 0x40, 0x40, 0x01, 0x64, 0x00}};
     Frame state22 = {0x72E, 8, {0x22, 0x94, 0x00, 0x00, 0x47, 0xFF, 0xFF, 0xFF}};
@@ -466,11 +592,11 @@ testF(SettingsTest, ToggleAutoInteriorIllumination) {
 }
 
 testF(SettingsTest, ToggleSlideDriverSeat) {
-    Settings settings(false, &clock);
+    TestNode<Settings> settings(false, &clock);
 
     // Initial state.
     SystemEvent control(Event::SETTINGS_TOGGLE_SLIDE_DRIVER_SEAT_BACK_ON_EXIT);
-    SystemEvent expect(Event::SETTINGS_STATE, {0x00, 0x00, 0x00, 0x00});
+    SystemEvent expect(Event::SETTINGS_STATE, {0x00, 0x00, 0x00, 0x80});
     Frame state05 = {0x72F, 8, {0x05, 0x61, 0x01, 0x00, 0x00, 0x00, 0xFF, 0xFF}};
 
     // Toggle setting on.
@@ -490,11 +616,11 @@ testF(SettingsTest, ToggleSlideDriverSeat) {
 }
 
 testF(SettingsTest, ToggleSpeedSensingWipers) {
-    Settings settings(false, &clock);
+    TestNode<Settings> settings(false, &clock);
 
     // Initial state.
     SystemEvent control(Event::SETTINGS_TOGGLE_SPEED_SENSING_WIPER_INTERVAL);
-    SystemEvent expect(Event::SETTINGS_STATE, {0x00, 0x00, 0x00, 0x00});
+    SystemEvent expect(Event::SETTINGS_STATE, {0x00, 0x00, 0x00, 0x40});
     Frame state10 = {0x72E, 8, {0x10, 0x11, 0x61, 0x01, 0x00, 0x1E, 0x24, 0x00}};
     Frame state21 = {0x72E, 8, {0x21, 0x10, 0x0C, 0x40, 0x40, 0x01, 0x64, 0x00}};
     Frame state22 = {0x72E, 8, {0x22, 0x94, 0x00, 0x00, 0x47, 0xFF, 0xFF, 0xFF}};
@@ -516,11 +642,11 @@ testF(SettingsTest, ToggleSpeedSensingWipers) {
 }
 
 testF(SettingsTest, AutoHeadlightSensitivity) {
-    Settings settings(false, &clock);
+    TestNode<Settings> settings(false, &clock);
 
     // Initial state.
     SystemEvent control(Event::SETTINGS_NEXT_AUTO_HEADLIGHT_SENSITIVITY);
-    SystemEvent expect(Event::SETTINGS_STATE, {0x00, 0x00, 0x00, 0x00});
+    SystemEvent expect(Event::SETTINGS_STATE, {0x00, 0x00, 0x00, 0x40});
     Frame state10 = {0x72E, 8, {0x10, 0x11, 0x61, 0x01, 0x00, 0x1E, 0x24, 0x00}};
     Frame state21 = {0x72E, 8, {0x21, 0x10, 0x0C, 0x40, 0x40, 0x01, 0x64, 0x00}};
     Frame state22 = {0x72E, 8, {0x22, 0x94, 0x00, 0x00, 0x47, 0xFF, 0xFF, 0xFF}};
@@ -564,12 +690,12 @@ testF(SettingsTest, AutoHeadlightSensitivity) {
 }
 
 testF(SettingsTest, AutoHeadlightOffDelay) {
-    Settings settings(false, &clock);
+    TestNode<Settings> settings(false, &clock);
 
     // Initial state.
     byte value = 0x00;
     SystemEvent control(Event::SETTINGS_NEXT_AUTO_HEADLIGHT_OFF_DELAY);
-    SystemEvent expect(Event::SETTINGS_STATE, {0x00, 0x00, 0x00, 0x00});
+    SystemEvent expect(Event::SETTINGS_STATE, {0x00, 0x00, 0x00, 0x40});
     Frame state10 = {0x72E, 8, {0x10, 0x11, 0x61, 0x01, 0x00, 0x1E, 0x24, 0x00}};
     Frame state21 = {0x72E, 8, {0x21, 0x10, 0x0C, 0x40, 0x40, 0x01, 0x64, 0x00}};
     Frame state22 = {0x72E, 8, {0x22, 0x94, 0x00, 0x00, 0x47, 0xFF, 0xFF, 0xFF}};
@@ -667,11 +793,11 @@ testF(SettingsTest, AutoHeadlightOffDelay) {
 }
 
 testF(SettingsTest, ToggleSelectiveDoorUnlock) {
-    Settings settings(false, &clock);
+    TestNode<Settings> settings(false, &clock);
 
     // Initial state.
     SystemEvent control(Event::SETTINGS_TOGGLE_SELECTIVE_DOOR_UNLOCK);
-    SystemEvent expect(Event::SETTINGS_STATE, {0x00, 0x00, 0x00, 0x00});
+    SystemEvent expect(Event::SETTINGS_STATE, {0x00, 0x00, 0x00, 0x40});
     Frame state10 = {0x72E, 8, {0x10, 0x11, 0x61, 0x01, 0x00, 0x1E, 0x24, 0x00}};
     Frame state21 = {0x72E, 8, {0x21, 0x10, 0x0C, 0x40, 0x40, 0x01, 0x64, 0x00}};
     Frame state22 = {0x72E, 8, {0x22, 0x94, 0x00, 0x00, 0x47, 0xFF, 0xFF, 0xFF}};
@@ -693,12 +819,12 @@ testF(SettingsTest, ToggleSelectiveDoorUnlock) {
 }
 
 testF(SettingsTest, AutoReLockTime) {
-    Settings settings(false, &clock);
+    TestNode<Settings> settings(false, &clock);
 
     // Initial state.
     byte value = 0x00;
     SystemEvent control(Event::SETTINGS_NEXT_AUTO_RELOCK_TIME);
-    SystemEvent expect(Event::SETTINGS_STATE, {0x00, 0x00, 0x00, 0x00});
+    SystemEvent expect(Event::SETTINGS_STATE, {0x00, 0x00, 0x00, 0x40});
     Frame state10 = {0x72E, 8, {0x10, 0x11, 0x61, 0x01, 0x00, 0x1E, 0x24, 0x00}};
     Frame state21 = {0x72E, 8, {0x21, 0x10, 0x0C, 0x40, 0x40, 0x01, 0x64, 0x00}};
     Frame state22 = {0x72E, 8, {0x22, 0x94, 0x00, 0x00, 0x47, 0xFF, 0xFF, 0xFF}};
@@ -736,11 +862,11 @@ testF(SettingsTest, AutoReLockTime) {
 }
 
 testF(SettingsTest, RemoteKeyResponseHorn) {
-    Settings settings(false, &clock);
+    TestNode<Settings> settings(false, &clock);
 
     // Initial state.
     SystemEvent control(Event::SETTINGS_TOGGLE_REMOTE_KEY_RESPONSE_HORN);
-    SystemEvent expect(Event::SETTINGS_STATE, {0x00, 0x00, 0x00, 0x00});
+    SystemEvent expect(Event::SETTINGS_STATE, {0x00, 0x00, 0x00, 0x40});
     Frame state10 = {0x72E, 8, {0x10, 0x11, 0x61, 0x01, 0x00, 0x1E, 0x24, 0x00}};
     Frame state21 = {0x72E, 8, {0x21, 0x10, 0x0C, 0x40, 0x40, 0x01, 0x64, 0x00}};
     Frame state22 = {0x72E, 8, {0x22, 0x94, 0x00, 0x00, 0x47, 0xFF, 0xFF, 0xFF}};
@@ -762,31 +888,31 @@ testF(SettingsTest, RemoteKeyResponseHorn) {
 }
 
 testF(SettingsTest, RemoteKeyResponseLights) {
-    Settings settings(false, &clock);
+    TestNode<Settings> settings(false, &clock);
 
     // Initial state.
     byte value = 0x00;
     SystemEvent control(Event::SETTINGS_NEXT_REMOTE_KEY_RESPONSE_LIGHTS);
-    SystemEvent expect(Event::SETTINGS_STATE, {0x00, 0x00, 0x00, 0x00});
+    SystemEvent expect(Event::SETTINGS_STATE, {0x00, 0x00, 0x00, 0x40});
     Frame state10 = {0x72E, 8, {0x10, 0x11, 0x61, 0x01, 0x00, 0x1E, 0x24, 0x00}};
     Frame state21 = {0x72E, 8, {0x21, 0x10, 0x0C, 0x40, 0x40, 0x01, 0x64, 0x00}};
     Frame state22 = {0x72E, 8, {0x22, 0x94, 0x00, 0x00, 0x47, 0xFF, 0xFF, 0xFF}};
 
     // Increase setting to "unlock".
     value = 0x01;
-    expect.data[3] = 1 << 2;
+    expect.data[3] = 0x40 | (1 << 2);
     setRemoteKeyResponseLights(&state21, value);
     checkUpdate(&settings, control, 0x71E, 0x2E, value, state10, state21, state22, expect);
 
     // Increase setting to "lock".
     value = 0x02;
-    expect.data[3] = 2 << 2;
+    expect.data[3] = 0x40 | (2 << 2);
     setRemoteKeyResponseLights(&state21, value);
     checkUpdate(&settings, control, 0x71E, 0x2E, value, state10, state21, state22, expect);
 
     // Increase setting to "on".
     value = 0x03;
-    expect.data[3] = 3 << 2;
+    expect.data[3] = 0x40 | (3 << 2);
     setRemoteKeyResponseLights(&state21, value);
     checkUpdate(&settings, control, 0x71E, 0x2E, value, state10, state21, state22, expect);
 
@@ -796,19 +922,19 @@ testF(SettingsTest, RemoteKeyResponseLights) {
     // Decrease setting to "lock".
     control.id = (uint8_t)Event::SETTINGS_PREV_REMOTE_KEY_RESPONSE_LIGHTS;
     value = 0x02;
-    expect.data[3] = 2 << 2;
+    expect.data[3] = 0x40 | (2 << 2);
     setRemoteKeyResponseLights(&state21, value);
     checkUpdate(&settings, control, 0x71E, 0x2E, value, state10, state21, state22, expect);
 
     // Decrease setting to "unlock".
     value = 0x01;
-    expect.data[3] = 1 << 2;
+    expect.data[3] = 0x40 | (1 << 2);
     setRemoteKeyResponseLights(&state21, value);
     checkUpdate(&settings, control, 0x71E, 0x2E, value, state10, state21, state22, expect);
 
     // Decrease setting to "off".
     value = 0x00;
-    expect.data[3] = 0 << 2;
+    expect.data[3] = 0x40 | (0 << 2);
     setRemoteKeyResponseLights(&state21, value);
     checkUpdate(&settings, control, 0x71E, 0x2E, value, state10, state21, state22, expect);
 
@@ -816,6 +942,186 @@ testF(SettingsTest, RemoteKeyResponseLights) {
     checkNoop(&settings, control);
 }
 
+testF(SettingsTest, NegativeResponseAborts) {
+    FakeYield yield;
+    FailureRecorder recorder;
+    Frame frame;
+    SystemEvent control(Event::SETTINGS_TOGGLE_AUTO_INTERIOR_ILLUMINATAION);
+
+    TestNode<Settings> settings(false, &clock);
+    settings.observer(&recorder);
+    settings.handle(control);
+    settings.emit(yield);
+    yield.clear();
+    fillEnterResponse(&frame, 0x72E);
+    settings.handle(frame);
+    settings.emit(yield);
+    fillUpdateRequest(&frame, 0x71E, 0x10, 0x01);
+    assertSize(yield, 1);
+    assertIsCANFrame(yield.messages()[0], frame);
+    yield.clear();
+
+    // BCM rejects the update with conditionsNotCorrect.
+    fillFrame(&frame, 0x72E, {0x03, 0x7F, 0x3B, 0x22});
+    settings.handle(frame);
+    assertEqual(recorder.calls, 1);
+    assertEqual(recorder.request_id, (uint32_t)0x71E);
+    assertEqual(recorder.service, 0x3B);
+    assertEqual(recorder.reason, 0x22);
+    settings.emit(yield);
+    assertSize(yield, 0);
+
+    // The channel accepts a new request without waiting for the timeout.
+    settings.handle(control);
+    settings.emit(yield);
+    fillEnterRequest(&frame, 0x71E);
+    assertSize(yield, 1);
+    assertIsCANFrame(yield.messages()[0], frame);
+}
+
+testF(SettingsTest, BusyRetry) {
+    FakeYield yield;
+    FailureRecorder recorder;
+    Frame request;
+    Frame busy;
+    fillEnterRequest(&request, 0x71E);
+    fillFrame(&busy, 0x72E, {0x03, 0x7F, 0x10, 0x21});
+
+    TestNode<Settings> settings(false, &clock);
+    settings.observer(&recorder);
+    settings.handle(SystemEvent(Event::SETTINGS_TOGGLE_AUTO_INTERIOR_ILLUMINATAION));
+    settings.emit(yield);
+    assertSize(yield, 1);
+    yield.clear();
+
+    // The request is repeated while the BCM is busy.
+    for (int i = 0; i < SETTINGS_BUSY_RETRIES; ++i) {
+        settings.handle(busy);
+        settings.emit(yield);
+        assertSize(yield, 1);
+        assertIsCANFrame(yield.messages()[0], request);
+        yield.clear();
+    }
+    assertEqual(recorder.calls, 0);
+
+    // Then abandoned.
+    settings.handle(busy);
+    settings.emit(yield);
+    assertSize(yield, 0);
+    assertEqual(recorder.calls, 1);
+    assertEqual(recorder.service, 0x10);
+    assertEqual(recorder.reason, (uint8_t)SETTINGS_ERROR_BUSY);
+}
+
+testF(SettingsTest, ResponsePending) {
+    FakeYield yield;
+    FailureRecorder recorder;
+    Frame frame;
+
+    TestNode<Settings> settings(false, &clock);
+    settings.observer(&recorder);
+    settings.handle(SystemEvent(Event::SETTINGS_TOGGLE_AUTO_INTERIOR_ILLUMINATAION));
+    settings.emit(yield);
+    yield.clear();
+
+    // The BCM asks for more time which restarts the timeout.
+    clock.delay(400);
+    fillFrame(&frame, 0x72E, {0x03, 0x7F, 0x10, 0x78});
+    settings.handle(frame);
+    clock.delay(200);
+    settings.emit(yield);
+    assertSize(yield, 0);
+    assertEqual(recorder.calls, 0);
+
+    fillEnterResponse(&frame, 0x72E);
+    settings.handle(frame);
+    settings.emit(yield);
+    fillUpdateRequest(&frame, 0x71E, 0x10, 0x01);
+    assertSize(yield, 1);
+    assertIsCANFrame(yield.messages()[0], frame);
+}
+
+testF(SettingsTest, ResponsePendingExhausted) {
+    FakeYield yield;
+    FailureRecorder recorder;
+    Frame pending;
+    fillFrame(&pending, 0x72E, {0x03, 0x7F, 0x10, 0x78});
+
+    TestNode<Settings> settings(false, &clock);
+    settings.observer(&recorder);
+    settings.handle(SystemEvent(Event::SETTINGS_TOGGLE_AUTO_INTERIOR_ILLUMINATAION));
+    settings.emit(yield);
+    yield.clear();
+
+    // The timeout is restarted a limited number of times.
+    for (int i = 0; i < SETTINGS_PENDING_RETRIES; ++i) {
+        clock.delay(400);
+        settings.handle(pending);
+        settings.emit(yield);
+        assertSize(yield, 0);
+    }
+    assertEqual(recorder.calls, 0);
+
+    // Then the sequence is abandoned.
+    settings.handle(pending);
+    assertEqual(recorder.calls, 1);
+    assertEqual(recorder.request_id, (uint32_t)0x71E);
+    assertEqual(recorder.service, 0x10);
+    assertEqual(recorder.reason, (uint8_t)SETTINGS_ERROR_PENDING);
+}
+
+testF(SettingsTest, PullRequestFrames) {
+    FakeYield yield;
+    Frame frameE;
+    Frame frameF;
+    byte data[8];
+    FrameSlot slot(data);
+
+    // Request frames are left for encode instead of yielded.
+    TestNode<Settings> settings(true, &clock);
+    settings.poll(yield);
+    assertSize(yield, 0);
+
+    fillEnterRequest(&frameE, 0x71E);
+    fillEnterRequest(&frameF, 0x71F);
+    assertTrue(settings.encode(&slot));
+    assertEqual(slot.id(), (uint32_t)0x71E);
+    assertEqual(memcmp(data, frameE.data(), 8), 0);
+    assertTrue(settings.encode(&slot));
+    assertEqual(slot.id(), (uint32_t)0x71F);
+    assertEqual(memcmp(data, frameF.data(), 8), 0);
+    assertFalse(settings.encode(&slot));
+
+    // Responses are handled in place.
+    fillEnterResponse(&frameE, 0x72E);
+    assertTrue(settings.handle(FrameView(frameE)));
+    settings.poll(yield);
+    fillFrame(&frameE, 0x71E, {0x02, 0x3B, 0x00});
+    assertTrue(settings.encode(&slot));
+    assertEqual(slot.id(), (uint32_t)0x71E);
+    assertEqual(memcmp(data, frameE.data(), 8), 0);
+    assertFalse(settings.encode(&slot));
+}
+
+testF(SettingsTest, TimeoutReported) {
+    FakeYield yield;
+    FailureRecorder recorder;
+
+    TestNode<Settings> settings(false, &clock);
+    settings.observer(&recorder);
+    settings.handle(SystemEvent(Event::SETTINGS_TOGGLE_AUTO_INTERIOR_ILLUMINATAION));
+    settings.emit(yield);
+    yield.clear();
+
+    clock.delay(500);
+    settings.emit(yield);
+    assertSize(yield, 0);
+    assertEqual(recorder.calls, 1);
+    assertEqual(recorder.request_id, (uint32_t)0x71E);
+    assertEqual(recorder.service, 0x10);
+    assertEqual(recorder.reason, (uint8_t)SETTINGS_ERROR_TIMEOUT);
+}
+
 }  // namespace R51
 
 // Test boilerplate.
@@ -0,0 +1,220 @@
+#include <AUnit.h>
+#include <Arduino.h>
+#include <Canny.h>
+#include <Caster.h>
+#include <Faker.h>
+#include <R51Core.h>
+#include <R51Test.h>
+#include <R51Vehicle.h>
+
+namespace R51 {
+
+using namespace aunit;
+using ::Canny::Frame;
+using ::Faker::FakeClock;
+
+// Records the arrival time of a specific system event.
+class Recorder : public Caster::Node<Message> {
+    public:
+        Recorder(Event id, Faker::Clock* clock) :
+            id_(id), clock_(clock), count(0), time(0) {}
+
+        void handle(const Message& msg) override {
+            if (msg.type() != Message::SYSTEM_EVENT ||
+                    msg.system_event().id != (uint8_t)id_) {
+                return;
+            }
+            event = msg.system_event();
+            time = clock_->millis();
+            ++count;
+        }
+
+        void emit(const Caster::Yield<Message>&) override {}
+
+        void clear() {
+            count = 0;
+            time = 0;
+        }
+
+    private:
+        Event id_;
+        Faker::Clock* clock_;
+
+    public:
+        int count;
+        uint32_t time;
+        SystemEvent event;
+};
+
+// Run the loop until the recorder has seen an event or the timeout expires.
+// Returns the time elapsed.
+uint32_t runUntil(SimulationLoop* loop, Recorder* recorder, uint32_t timeout) {
+    uint32_t start = loop->millis();
+    while (recorder->count == 0 && loop->millis() - start < timeout) {
+        loop->step();
+    }
+    return loop->millis() - start;
+}
+
+class SimulatorTest : public TestOnce {
+    public:
+        FakeClock clock;
+
+        void setup() override {
+            TestOnce::setup();
+            clock.set(0);
+        }
+
+        // Measure the time taken to retrieve settings from the BCM.
+        uint32_t measureSettingsSession() {
+            clock.set(0);
+            Settings settings(true, &clock);
+            BCMSimulator bcm(5, &clock);
+            Recorder recorder(Event::SETTINGS_STATE, &clock);
+
+            SimulationLoop loop(&clock);
+            loop.attach(&settings);
+            loop.attach(&bcm);
+            loop.attach(&recorder);
+
+            // complete the init exchange
+            loop.run(500);
+
+            uint32_t start = loop.millis();
+            loop.inject(SystemEvent(Event::SETTINGS_REQUEST_CURRENT));
+            runUntil(&loop, &recorder, 1000);
+            if (loop.dropped() > 0) {
+                return 0;
+            }
+            return recorder.count > 0 ? recorder.time - start : 0;
+        }
+};
+
+testF(SimulatorTest, SettingsSession) {
+    uint32_t duration = measureSettingsSession();
+    assertMore(duration, 0u);
+    assertLess(duration, 100u);
+
+    // Virtual time makes the measurement deterministic.
+    assertEqual(measureSettingsSession(), duration);
+}
+
+testF(SimulatorTest, SettingsUpdate) {
+    Settings settings(true, &clock);
+    BCMSimulator bcm(5, &clock);
+    Recorder recorder(Event::SETTINGS_STATE, &clock);
+
+    SimulationLoop loop(&clock);
+    loop.attach(&settings);
+    loop.attach(&bcm);
+    loop.attach(&recorder);
+    loop.run(500);
+
+    loop.inject(SystemEvent(Event::SETTINGS_TOGGLE_AUTO_INTERIOR_ILLUMINATAION));
+    runUntil(&loop, &recorder, 1000);
+    assertEqual(recorder.count, 1);
+    assertTrue(getBit(bcm.stateE(), 2, 5));
+    assertTrue(getBit(recorder.event.data, 0, 0));
+
+    // only the updated channel has reported its state
+    assertTrue(getBit(recorder.event.data, 3, SETTINGS_STATE_CHANNEL_E));
+    assertFalse(getBit(recorder.event.data, 3, SETTINGS_STATE_CHANNEL_F));
+    assertEqual(loop.dropped(), 0u);
+}
+
+testF(SimulatorTest, ClimateRoundTrip) {
+    Climate climate(0, &clock);
+    ClimateSimulator unit(100, &clock);
+    Recorder recorder(Event::CLIMATE_SYSTEM_STATE, &clock);
+
+    SimulationLoop loop(&clock);
+    loop.attach(&climate);
+    loop.attach(&unit);
+    loop.attach(&recorder);
+
+    // complete the control init exchange
+    loop.run(1000);
+    assertFalse(unit.on());
+    recorder.clear();
+
+    uint32_t start = loop.millis();
+    loop.inject(SystemEvent(Event::CLIMATE_TOGGLE_AUTO));
+    runUntil(&loop, &recorder, 1000);
+    assertEqual(recorder.count, 1);
+    assertTrue(unit.on());
+    assertTrue(unit.autoMode());
+
+    ClimateSystemStateEvent expect;
+    expect.mode(CLIMATE_SYSTEM_AUTO);
+    assertIsSystemEvent(Message(recorder.event), expect);
+
+    // The round trip is bounded by the unit's broadcast period.
+    uint32_t rtt = recorder.time - start;
+    assertLessOrEqual(rtt, 110u);
+    assertEqual(loop.dropped(), 0u);
+}
+
+testF(SimulatorTest, Broadcasters) {
+    EngineTempState ecm(0, &clock);
+    IPDM ipdm(0, &clock);
+    TirePressureState tires(0, &clock);
+    FrameBroadcaster ecmFrame(Frame(0x551, 0, {0x29, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}), 100, &clock);
+    FrameBroadcaster ipdmFrame(Frame(0x625, 0, {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}), 100, &clock);
+    FrameBroadcaster tpmsFrame(Frame(0x385, 0, {0x00, 0x00, 0x01, 0x02, 0x03, 0x04, 0x00, 0xF0}), 1000, &clock);
+    Recorder ecmRecorder(Event::ENGINE_TEMP_STATE, &clock);
+    Recorder ipdmRecorder(Event::BODY_POWER_STATE, &clock);
+    Recorder tpmsRecorder(Event::TIRE_PRESSURE_STATE, &clock);
+
+    SimulationLoop loop(&clock);
+    loop.attach(&ecm);
+    loop.attach(&ipdm);
+    loop.attach(&tires);
+    loop.attach(&ecmFrame);
+    loop.attach(&ipdmFrame);
+    loop.attach(&tpmsFrame);
+    loop.attach(&ecmRecorder);
+    loop.attach(&ipdmRecorder);
+    loop.attach(&tpmsRecorder);
+    loop.run(1100);
+
+    assertEqual(ecmRecorder.count, 1);
+    assertEqual(ecmRecorder.event.data[0], 0x29);
+    assertEqual(ipdmRecorder.count, 1);
+    assertEqual(ipdmRecorder.event.data[0], 0x40);
+    assertEqual(tpmsRecorder.count, 1);
+    assertEqual(tpmsRecorder.event.data[0], 0x01);
+    assertEqual(loop.dropped(), 0u);
+}
+
+testF(SimulatorTest, QueueOverflow) {
+    Recorder recorder(Event::CLIMATE_TOGGLE_AUTO, &clock);
+    SimulationLoop loop(&clock);
+    loop.attach(&recorder);
+
+    for (size_t i = 0; i < SIM_MAX_MESSAGES; ++i) {
+        assertTrue(loop.inject(SystemEvent(Event::CLIMATE_TOGGLE_AUTO)));
+    }
+    assertFalse(loop.inject(SystemEvent(Event::CLIMATE_TOGGLE_AUTO)));
+    assertEqual(loop.dropped(), 1u);
+
+    loop.step();
+    assertEqual(recorder.count, SIM_MAX_MESSAGES);
+    assertTrue(loop.inject(SystemEvent(Event::CLIMATE_TOGGLE_AUTO)));
+    assertEqual(loop.dropped(), 1u);
+}
+
+}  // namespace R51
+
+// Test boilerplate.
+void setup() {
+#ifdef ARDUINO
+    delay(1000);
+#endif
+    SERIAL_PORT_MONITOR.begin(115200);
+    while(!SERIAL_PORT_MONITOR);
+}
+
+void loop() {
+    aunit::TestRunner::run();
+    delay(1);
+}
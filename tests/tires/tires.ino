@@ -10,11 +10,28 @@ using namespace aunit;
 using ::Canny::Frame;
 using ::Faker::FakeClock;
 
+#if defined(R51_TEST_VEHICLE_NODES)
+// Drive the node under test through VehicleNodes as the gateway does.
+template <typename N>
+class TestNode : public N {
+    public:
+        using N::N;
+        using N::handle;
+
+        void handle(const Message& msg) override { VehicleNodes<N>(*this).handle(msg); }
+        void emit(const Caster::Yield<Message>& yield) override { VehicleNodes<N>(*this).emit(yield); }
+};
+#else
+// Call the node under test directly.
+template <typename N>
+using TestNode = N;
+#endif
+
 test(TirePressureState, IgnoreIncorrectID) {
     FakeYield yield;
     Frame f(0x384, 0, {0x84, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
 
-    TirePressureState tire;
+    TestNode<TirePressureState> tire;
     tire.handle(f);
     tire.emit(yield);
     assertSize(yield, 0);
@@ -24,7 +41,7 @@ test(TirePressureStateTest, IgnoreIncorrectSize) {
     FakeYield yield;
     Frame f(0x385, 0, {});
 
-    TirePressureState tire;
+    TestNode<TirePressureState> tire;
     tire.handle(f);
     tire.emit(yield);
     assertSize(yield, 0);
@@ -34,7 +51,7 @@ test(TirePressureStateTest, Tick) {
     FakeClock clock;
     FakeYield yield;
 
-    TirePressureState tire(200, &clock);
+    TestNode<TirePressureState> tire(200, &clock);
     tire.emit(yield);
     assertSize(yield, 0);
 
@@ -48,7 +65,7 @@ test(TirePressureStateTest, AllSet) {
     FakeYield yield;
     Frame f(0x385, 0, {0x84, 0x0C, 0x82, 0x84, 0x79, 0x77, 0x00, 0xF0});
 
-    TirePressureState tire;
+    TestNode<TirePressureState> tire;
     tire.handle(f);
     tire.emit(yield);
 
@@ -60,7 +77,7 @@ test(TirePressureStateTest, Tire1Set) {
     FakeYield yield;
     Frame f(0x385, 0, {0x84, 0x0C, 0x82, 0x00, 0x00, 0x00, 0x00, 0x80});
 
-    TirePressureState tire;
+    TestNode<TirePressureState> tire;
     tire.handle(f);
     tire.emit(yield);
 
@@ -72,7 +89,7 @@ test(TirePressureStateTest, Tire2Set) {
     FakeYield yield;
     Frame f(0x385, 0, {0x84, 0x0C, 0x00, 0xA0, 0x00, 0x00, 0x00, 0x40});
 
-    TirePressureState tire;
+    TestNode<TirePressureState> tire;
     tire.handle(f);
     tire.emit(yield);
 
@@ -84,7 +101,7 @@ test(TirePressureStateTest, Tire3Set) {
     FakeYield yield;
     Frame f(0x385, 0, {0x84, 0x0C, 0x00, 0x00, 0x75, 0x00, 0x00, 0x20});
 
-    TirePressureState tire;
+    TestNode<TirePressureState> tire;
     tire.handle(f);
     tire.emit(yield);
 
@@ -96,7 +113,7 @@ test(TirePressureStateTest, Tire4Set) {
     FakeYield yield;
     Frame f(0x385, 0, {0x84, 0x0C, 0x00, 0x00, 0x00, 0x77, 0x00, 0x10});
 
-    TirePressureState tire;
+    TestNode<TirePressureState> tire;
     tire.handle(f);
     tire.emit(yield);
 
@@ -106,7 +123,7 @@ test(TirePressureStateTest, Tire4Set) {
 
 test(TirePressureStateTest, Swap) {
     FakeYield yield;
-    TirePressureState tire;
+    TestNode<TirePressureState> tire;
     Frame f;
     SystemEvent control;
     SystemEvent expect;
@@ -0,0 +1,75 @@
+#include <AUnit.h>
+#include <Arduino.h>
+#include <R51Vehicle.h>
+
+namespace R51 {
+
+using namespace aunit;
+
+// Conversions are usable in constant expressions.
+static_assert(celsiusToFahrenheit(100) == 212, "boiling point");
+static_assert(fahrenheitToCelsius(32) == 0, "freezing point");
+
+test(UnitsTest, RoundDivision) {
+    assertEqual(roundDiv(5, 2), (int32_t)3);
+    assertEqual(roundDiv(4, 3), (int32_t)1);
+    assertEqual(roundDiv(-5, 2), (int32_t)-3);
+    assertEqual(roundDiv(-4, 3), (int32_t)-1);
+    assertEqual(roundDiv(0, 7), (int32_t)0);
+}
+
+test(UnitsTest, CelsiusToFahrenheit) {
+    assertEqual(celsiusToFahrenheit(-40), (int16_t)-40);
+    assertEqual(celsiusToFahrenheit(0), (int16_t)32);
+    // 33.8F
+    assertEqual(celsiusToFahrenheit(1), (int16_t)34);
+    // 71.6F
+    assertEqual(celsiusToFahrenheit(22), (int16_t)72);
+    // -0.4F
+    assertEqual(celsiusToFahrenheit(-18), (int16_t)0);
+    // 418.8F
+    assertEqual(celsiusToFahrenheit(215), (int16_t)419);
+}
+
+test(UnitsTest, FahrenheitToCelsius) {
+    assertEqual(fahrenheitToCelsius(-40), (int16_t)-40);
+    assertEqual(fahrenheitToCelsius(32), (int16_t)0);
+    // 15.6C
+    assertEqual(fahrenheitToCelsius(60), (int16_t)16);
+    // 22.2C
+    assertEqual(fahrenheitToCelsius(72), (int16_t)22);
+    // 32.2C
+    assertEqual(fahrenheitToCelsius(90), (int16_t)32);
+    // -17.8C
+    assertEqual(fahrenheitToCelsius(0), (int16_t)-18);
+}
+
+test(UnitsTest, ConvertTemp) {
+    assertEqual(convertTemp(22, UNITS_METRIC, UNITS_METRIC), (int16_t)22);
+    assertEqual(convertTemp(72, UNITS_US, UNITS_US), (int16_t)72);
+    assertEqual(convertTemp(22, UNITS_METRIC, UNITS_US), (int16_t)72);
+    assertEqual(convertTemp(72, UNITS_US, UNITS_METRIC), (int16_t)22);
+}
+
+test(UnitsTest, RoundTripCelsius) {
+    // Every whole Celsius value survives a round trip through Fahrenheit.
+    for (int16_t c = -40; c <= 215; ++c) {
+        assertEqual(fahrenheitToCelsius(celsiusToFahrenheit(c)), c);
+    }
+}
+
+}  // namespace R51
+
+// Test boilerplate.
+void setup() {
+#ifdef ARDUINO
+    delay(1000);
+#endif
+    SERIAL_PORT_MONITOR.begin(115200);
+    while(!SERIAL_PORT_MONITOR);
+}
+
+void loop() {
+    aunit::TestRunner::run();
+    delay(1);
+}
@@ -0,0 +1,139 @@
+// Convert between candump -l text logs and indexed binary CAN logs.
+//
+// convert writes a binary log from a candump log. dump prints the frames of
+// a binary log in candump format, optionally limited to a set of frame IDs
+// and a time range, and reports how many blocks were read to stderr.
+
+#include <Arduino.h>
+#include <Canny.h>
+#include <R51Vehicle.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern int epoxy_argc;
+extern const char* const* epoxy_argv;
+
+namespace R51 {
+
+// Maximum number of IDs accepted by --ids.
+static const size_t MAX_IDS = 32;
+
+int convert(const char* in, const char* out) {
+    FILE* file = fopen(in, "r");
+    if (file == nullptr) {
+        fprintf(stderr, "failed to open %s\n", in);
+        return 1;
+    }
+    CanLogWriter writer;
+    if (!writer.open(out)) {
+        fprintf(stderr, "failed to create %s\n", out);
+        fclose(file);
+        return 1;
+    }
+
+    char line[256];
+    uint64_t timestamp;
+    uint32_t frames = 0;
+    uint32_t skipped = 0;
+    Canny::Frame frame(0, 0, 8);
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        if (!parseCanDump(line, &timestamp, &frame)) {
+            ++skipped;
+            continue;
+        }
+        if (!writer.write(timestamp, frame)) {
+            fprintf(stderr, "failed to write %s\n", out);
+            fclose(file);
+            return 1;
+        }
+        ++frames;
+    }
+    fclose(file);
+    if (!writer.close()) {
+        fprintf(stderr, "failed to write %s\n", out);
+        return 1;
+    }
+    fprintf(stderr, "converted %lu frames, skipped %lu lines\n",
+            (unsigned long)frames, (unsigned long)skipped);
+    return 0;
+}
+
+int dump(const char* path, const CanLogQuery& query) {
+    CanLogReader reader;
+    if (!reader.open(path)) {
+        fprintf(stderr, "failed to read %s\n", path);
+        return 1;
+    }
+
+    char line[64];
+    uint64_t count = 0;
+    Canny::Frame frame(0, 0, 8);
+    const CanLogRecord* record;
+    reader.query(query);
+    while ((record = reader.next()) != nullptr) {
+        CanLogReader::frame(*record, &frame);
+        formatCanDump(line, sizeof(line), record->timestamp, "can0", frame);
+        puts(line);
+        ++count;
+    }
+    fprintf(stderr, "read %lu of %lu frames from %lu of %lu blocks\n",
+            (unsigned long)count, (unsigned long)reader.records(),
+            (unsigned long)reader.touched(), (unsigned long)reader.blocks());
+    return 0;
+}
+
+}  // namespace R51
+
+void usage() {
+    fprintf(stderr, "usage: %s convert <candump log> <binary log>\n", epoxy_argv[0]);
+    fprintf(stderr, "       %s dump [--ids 385,551] [--from sec] [--to sec] <binary log>\n",
+            epoxy_argv[0]);
+    exit(2);
+}
+
+void setup() {
+    if (epoxy_argc == 4 && strcmp(epoxy_argv[1], "convert") == 0) {
+        exit(R51::convert(epoxy_argv[2], epoxy_argv[3]));
+    }
+    if (epoxy_argc < 3 || strcmp(epoxy_argv[1], "dump") != 0) {
+        usage();
+    }
+
+    uint32_t ids[R51::MAX_IDS];
+    R51::CanLogQuery query;
+    query.ids = ids;
+    int arg = 2;
+    for (; arg + 1 < epoxy_argc; arg += 2) {
+        const char* value = epoxy_argv[arg + 1];
+        if (strcmp(epoxy_argv[arg], "--ids") == 0) {
+            char* end = (char*)value;
+            while (*end != 0 && query.id_count < R51::MAX_IDS) {
+                const char* start = end;
+                ids[query.id_count++] = strtoul(start, &end, 16);
+                if (end == start || (*end != ',' && *end != 0)) {
+                    usage();
+                }
+                // IDs which do not fit in 11 bits are extended.
+                if (ids[query.id_count - 1] > 0x7FF) {
+                    ids[query.id_count - 1] |= R51::CAN_LOG_EXT;
+                }
+                if (*end == ',') {
+                    ++end;
+                }
+            }
+        } else if (strcmp(epoxy_argv[arg], "--from") == 0) {
+            query.start = strtod(value, nullptr) * 1e6;
+        } else if (strcmp(epoxy_argv[arg], "--to") == 0) {
+            query.end = strtod(value, nullptr) * 1e6;
+        } else {
+            break;
+        }
+    }
+    if (arg + 1 != epoxy_argc) {
+        usage();
+    }
+    exit(R51::dump(epoxy_argv[arg], query));
+}
+
+void loop() {}
@@ -0,0 +1,455 @@
+// Decode a candump -l log through the vehicle nodes and write one CSV time
+// series per signal to an output directory, e.g. engine_coolant_temp.csv:
+//   <seconds>,<value>
+//
+// The log is parsed in parallel chunks and then sharded by node. Each node
+// only depends on its own frame IDs so each shard is replayed by its own
+// node instance on its own thread. The shards' events are merged back into
+// the order a single-threaded replay would have produced. --verify runs the
+// single-threaded replay as well and checks that the results match exactly.
+//
+// Nodes are replayed without periodic re-emits so every event is caused by
+// a frame from its own shard.
+
+#include <Arduino.h>
+#include <Canny.h>
+#include <Caster.h>
+#include <Faker.h>
+#include <R51Core.h>
+#include <R51Vehicle.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+extern int epoxy_argc;
+extern const char* const* epoxy_argv;
+
+namespace R51 {
+
+using ::Faker::FakeClock;
+
+// A frame from the log.
+struct Record {
+    uint64_t timestamp;
+    uint32_t index;
+    uint32_t id;
+    uint8_t size;
+    byte data[8];
+};
+
+// An emitted event ordered by the frame which caused it, then by the node
+// which emitted it, then by the order the node emitted it in.
+struct Output {
+    uint64_t timestamp;
+    uint32_t index;
+    uint8_t node;
+    uint16_t seq;
+    SystemEvent event;
+
+    bool operator<(const Output& other) const {
+        if (index != other.index) {
+            return index < other.index;
+        }
+        if (node != other.node) {
+            return node < other.node;
+        }
+        return seq < other.seq;
+    }
+};
+
+// Nodes in the order a gateway drives them.
+enum Shard : uint8_t {
+    SHARD_CLIMATE,
+    SHARD_ECM,
+    SHARD_IPDM,
+    SHARD_TIRES,
+    SHARD_COUNT,
+};
+
+// Return the shard that consumes a frame ID or SHARD_COUNT if none do.
+uint8_t shardOf(uint32_t id) {
+    switch (id) {
+        case 0x54A:
+        case 0x54B:
+            return SHARD_CLIMATE;
+        case 0x551:
+            return SHARD_ECM;
+        case 0x625:
+            return SHARD_IPDM;
+        case 0x385:
+            return SHARD_TIRES;
+        default:
+            return SHARD_COUNT;
+    }
+}
+
+// Collects emitted events for the frame being replayed.
+class OutputYield : public Caster::Yield<Message> {
+    public:
+        OutputYield(std::vector<Output>* out) : out_(out), timestamp(0), index(0), node(0), seq(0) {}
+
+        void operator()(const Message& msg) const override {
+            if (msg.type() != Message::SYSTEM_EVENT) {
+                return;
+            }
+            out_->push_back({timestamp, index, node, seq++, msg.system_event()});
+        }
+
+    private:
+        std::vector<Output>* out_;
+
+    public:
+        uint64_t timestamp;
+        uint32_t index;
+        uint8_t node;
+        mutable uint16_t seq;
+};
+
+// The vehicle nodes replayed without periodic re-emits.
+class Vehicle {
+    public:
+        Vehicle(FakeClock* clock) :
+            climate(0, clock), ecm(0, clock), ipdm(0, clock), tires(0, clock) {}
+
+        Caster::Node<Message>* node(uint8_t shard) {
+            switch (shard) {
+                case SHARD_CLIMATE:
+                    return &climate;
+                case SHARD_ECM:
+                    return &ecm;
+                case SHARD_IPDM:
+                    return &ipdm;
+                case SHARD_TIRES:
+                default:
+                    return &tires;
+            }
+        }
+
+    private:
+        Climate climate;
+        EngineTempState ecm;
+        IPDM ipdm;
+        TirePressureState tires;
+};
+
+// Frames parsed from a chunk of the log, split by shard.
+struct Chunk {
+    const char* begin;
+    const char* end;
+    uint32_t frames;
+    std::vector<Record> shards[SHARD_COUNT];
+};
+
+void parseChunk(Chunk* chunk) {
+    Canny::Frame frame(0, 0, 8);
+    char line[128];
+    const char* p = chunk->begin;
+    chunk->frames = 0;
+    while (p < chunk->end) {
+        const char* eol = (const char*)memchr(p, '\n', chunk->end - p);
+        if (eol == nullptr) {
+            eol = chunk->end;
+        }
+        size_t n = eol - p < (ptrdiff_t)sizeof(line) - 1 ? eol - p : sizeof(line) - 1;
+        memcpy(line, p, n);
+        line[n] = 0;
+        p = eol + 1;
+
+        Record record;
+        if (!parseCanDump(line, &record.timestamp, &frame)) {
+            continue;
+        }
+        record.index = chunk->frames++;
+        uint8_t shard = shardOf(frame.id());
+        if (shard == SHARD_COUNT) {
+            continue;
+        }
+        record.id = frame.id();
+        record.size = frame.size();
+        memcpy(record.data, frame.data(), frame.size());
+        chunk->shards[shard].push_back(record);
+    }
+}
+
+void replay(const Record& record, Caster::Node<Message>* node, FakeClock* clock,
+        OutputYield* yield) {
+    Canny::Frame frame(record.id, 0, record.size);
+    memcpy(frame.data(), record.data, record.size);
+    clock->set(record.timestamp / 1000);
+    yield->timestamp = record.timestamp;
+    yield->index = record.index;
+    yield->seq = 0;
+    node->handle(frame);
+    node->emit(*yield);
+}
+
+void replayShard(uint8_t shard, std::vector<Chunk>* chunks, std::vector<Output>* out) {
+    FakeClock clock;
+    Vehicle vehicle(&clock);
+    Caster::Node<Message>* node = vehicle.node(shard);
+    OutputYield yield(out);
+    yield.node = shard;
+    for (const Chunk& chunk : *chunks) {
+        for (const Record& record : chunk.shards[shard]) {
+            replay(record, node, &clock, &yield);
+        }
+    }
+}
+
+// Decode the log on the given number of threads.
+std::vector<Output> decodeParallel(const char* data, size_t size, unsigned threads) {
+    // Split the log into chunks on line boundaries.
+    std::vector<Chunk> chunks(threads);
+    const char* p = data;
+    const char* end = data + size;
+    for (unsigned i = 0; i < threads; ++i) {
+        const char* chunk_end = i + 1 == threads ? end : data + size * (i + 1) / threads;
+        if (chunk_end < p) {
+            chunk_end = p;
+        }
+        while (chunk_end < end && chunk_end[-1] != '\n') {
+            ++chunk_end;
+        }
+        chunks[i].begin = p;
+        chunks[i].end = chunk_end;
+        p = chunk_end;
+    }
+
+    std::vector<std::thread> workers;
+    for (Chunk& chunk : chunks) {
+        workers.emplace_back(parseChunk, &chunk);
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+
+    // Convert chunk-local frame indexes to log indexes.
+    uint32_t base = 0;
+    for (Chunk& chunk : chunks) {
+        for (auto& shard : chunk.shards) {
+            for (Record& record : shard) {
+                record.index += base;
+            }
+        }
+        base += chunk.frames;
+    }
+
+    std::vector<Output> shards[SHARD_COUNT];
+    for (uint8_t shard = 0; shard < SHARD_COUNT; ++shard) {
+        workers.emplace_back(replayShard, shard, &chunks, &shards[shard]);
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    // Merge the shards which are each already in order.
+    std::vector<Output> out;
+    size_t heads[SHARD_COUNT] = {0};
+    while (true) {
+        int next = -1;
+        for (uint8_t shard = 0; shard < SHARD_COUNT; ++shard) {
+            if (heads[shard] < shards[shard].size() && (next < 0 ||
+                    shards[shard][heads[shard]] < shards[next][heads[next]])) {
+                next = shard;
+            }
+        }
+        if (next < 0) {
+            break;
+        }
+        out.push_back(shards[next][heads[next]++]);
+    }
+    return out;
+}
+
+// Decode the log one frame at a time through every node.
+std::vector<Output> decodeSerial(const char* data, size_t size) {
+    Chunk chunk;
+    chunk.begin = data;
+    chunk.end = data + size;
+    parseChunk(&chunk);
+
+    // Restore log order across shards.
+    std::vector<Record> records;
+    for (auto& shard : chunk.shards) {
+        records.insert(records.end(), shard.begin(), shard.end());
+    }
+    std::sort(records.begin(), records.end(),
+            [](const Record& a, const Record& b) { return a.index < b.index; });
+
+    std::vector<Output> out;
+    FakeClock clock;
+    Vehicle vehicle(&clock);
+    OutputYield yield(&out);
+    for (const Record& record : records) {
+        Canny::Frame frame(record.id, 0, record.size);
+        memcpy(frame.data(), record.data, record.size);
+        clock.set(record.timestamp / 1000);
+        yield.timestamp = record.timestamp;
+        yield.index = record.index;
+        for (uint8_t shard = 0; shard < SHARD_COUNT; ++shard) {
+            vehicle.node(shard)->handle(frame);
+        }
+        for (uint8_t shard = 0; shard < SHARD_COUNT; ++shard) {
+            yield.node = shard;
+            yield.seq = 0;
+            vehicle.node(shard)->emit(yield);
+        }
+    }
+    return out;
+}
+
+bool same(const std::vector<Output>& a, const std::vector<Output>& b) {
+    if (a.size() != b.size()) {
+        fprintf(stderr, "verify: %zu events, expected %zu\n", a.size(), b.size());
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].timestamp != b[i].timestamp || a[i].event.id != b[i].event.id ||
+                memcmp(a[i].event.data, b[i].event.data, sizeof(a[i].event.data)) != 0) {
+            fprintf(stderr, "verify: event %zu differs\n", i);
+            return false;
+        }
+    }
+    return true;
+}
+
+// A signal extracted from an event payload.
+struct Signal {
+    Event event;
+    uint8_t byte;
+    uint8_t shift;
+    uint8_t mask;
+    int16_t offset;
+    const char* name;
+};
+
+static const Signal SIGNALS[] = {
+    {Event::ENGINE_TEMP_STATE, 0, 0, 0xFF, -40, "engine_coolant_temp"},
+    {Event::BODY_POWER_STATE, 0, 0, 0x01, 0, "high_beams"},
+    {Event::BODY_POWER_STATE, 0, 1, 0x01, 0, "low_beams"},
+    {Event::BODY_POWER_STATE, 0, 2, 0x01, 0, "running_lights"},
+    {Event::BODY_POWER_STATE, 0, 3, 0x01, 0, "fog_lights"},
+    {Event::BODY_POWER_STATE, 0, 6, 0x01, 0, "defog_heaters"},
+    {Event::BODY_POWER_STATE, 0, 7, 0x01, 0, "ac_compressor"},
+    {Event::TIRE_PRESSURE_STATE, 0, 0, 0xFF, 0, "tire_pressure_1"},
+    {Event::TIRE_PRESSURE_STATE, 1, 0, 0xFF, 0, "tire_pressure_2"},
+    {Event::TIRE_PRESSURE_STATE, 2, 0, 0xFF, 0, "tire_pressure_3"},
+    {Event::TIRE_PRESSURE_STATE, 3, 0, 0xFF, 0, "tire_pressure_4"},
+    {Event::CLIMATE_TEMP_STATE, 0, 0, 0xFF, 0, "climate_driver_temp"},
+    {Event::CLIMATE_TEMP_STATE, 1, 0, 0xFF, 0, "climate_passenger_temp"},
+    {Event::CLIMATE_TEMP_STATE, 2, 0, 0xFF, 0, "climate_outside_temp"},
+    {Event::CLIMATE_TEMP_STATE, 3, 0, 0xFF, 0, "climate_units"},
+    {Event::CLIMATE_TEMP_STATE, 4, 0, 0xFF, 0, "climate_outside_temp_below_zero"},
+    {Event::CLIMATE_AIRFLOW_STATE, 0, 0, 0xFF, 0, "climate_fan_speed"},
+    {Event::CLIMATE_AIRFLOW_STATE, 1, 0, 0x01, 0, "climate_face"},
+    {Event::CLIMATE_AIRFLOW_STATE, 1, 1, 0x01, 0, "climate_feet"},
+    {Event::CLIMATE_AIRFLOW_STATE, 1, 2, 0x01, 0, "climate_windshield"},
+    {Event::CLIMATE_AIRFLOW_STATE, 1, 3, 0x01, 0, "climate_recirculate"},
+    {Event::CLIMATE_SYSTEM_STATE, 0, 0, 0x03, 0, "climate_mode"},
+    {Event::CLIMATE_SYSTEM_STATE, 0, 2, 0x01, 0, "climate_ac"},
+    {Event::CLIMATE_SYSTEM_STATE, 0, 3, 0x01, 0, "climate_dual"},
+};
+static const size_t SIGNAL_COUNT = sizeof(SIGNALS) / sizeof(SIGNALS[0]);
+
+// Write a CSV file per signal. A row is written each time the signal's value
+// changes.
+bool writeSignals(const std::vector<Output>& events, const char* dir) {
+    mkdir(dir, 0755);
+    for (size_t s = 0; s < SIGNAL_COUNT; ++s) {
+        const Signal& signal = SIGNALS[s];
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s.csv", dir, signal.name);
+        FILE* file = fopen(path, "w");
+        if (file == nullptr) {
+            fprintf(stderr, "failed to open %s\n", path);
+            return false;
+        }
+        bool first = true;
+        int value = 0;
+        for (const Output& out : events) {
+            if (out.event.id != (uint8_t)signal.event) {
+                continue;
+            }
+            int v = ((out.event.data[signal.byte] >> signal.shift) & signal.mask) + signal.offset;
+            if (first || v != value) {
+                fprintf(file, "%llu.%06llu,%d\n",
+                        (unsigned long long)(out.timestamp / 1000000),
+                        (unsigned long long)(out.timestamp % 1000000), v);
+                value = v;
+                first = false;
+            }
+        }
+        fclose(file);
+    }
+    return true;
+}
+
+double seconds(unsigned long start_us) {
+    return (micros() - start_us) / 1e6;
+}
+
+int decode(const char* path, const char* dir, unsigned threads, bool verify) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        fprintf(stderr, "failed to open %s\n", path);
+        return 1;
+    }
+    fseek(file, 0, SEEK_END);
+    size_t size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    std::vector<char> data(size);
+    if (fread(data.data(), 1, size, file) != size) {
+        fprintf(stderr, "failed to read %s\n", path);
+        fclose(file);
+        return 1;
+    }
+    fclose(file);
+
+    unsigned long start = micros();
+    std::vector<Output> events = decodeParallel(data.data(), size, threads);
+    double elapsed = seconds(start);
+    fprintf(stderr, "parallel: %zu events in %.3fs on %u threads (%.1f MB/s)\n",
+            events.size(), elapsed, threads, size / 1e6 / elapsed);
+
+    if (verify) {
+        start = micros();
+        std::vector<Output> expect = decodeSerial(data.data(), size);
+        elapsed = seconds(start);
+        fprintf(stderr, "serial:   %zu events in %.3fs (%.1f MB/s)\n",
+                expect.size(), elapsed, size / 1e6 / elapsed);
+        if (!same(events, expect)) {
+            return 1;
+        }
+        fprintf(stderr, "verify:   ok\n");
+    }
+    return writeSignals(events, dir) ? 0 : 1;
+}
+
+}  // namespace R51
+
+void setup() {
+    unsigned threads = std::thread::hardware_concurrency();
+    bool verify = false;
+    int arg = 1;
+    for (; arg < epoxy_argc && epoxy_argv[arg][0] == '-'; ++arg) {
+        if (strcmp(epoxy_argv[arg], "-j") == 0 && arg + 1 < epoxy_argc) {
+            threads = strtoul(epoxy_argv[++arg], nullptr, 0);
+        } else if (strcmp(epoxy_argv[arg], "--verify") == 0) {
+            verify = true;
+        } else {
+            break;
+        }
+    }
+    if (epoxy_argc - arg != 2) {
+        fprintf(stderr, "usage: %s [-j threads] [--verify] <log> <output dir>\n", epoxy_argv[0]);
+        exit(2);
+    }
+    exit(R51::decode(epoxy_argv[arg], epoxy_argv[arg + 1], threads < 1 ? 1 : threads, verify));
+}
+
+void loop() {}
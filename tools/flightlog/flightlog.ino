@@ -0,0 +1,77 @@
+// Decode a flight log image written by R51::FlightLog and print each record
+// as a timestamped event.
+//
+// Output format, one event per line:
+//   <millis> <event name> <data bytes in hex>
+
+#include <Arduino.h>
+#include <R51Core.h>
+#include <R51Vehicle.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+extern int epoxy_argc;
+extern const char* const* epoxy_argv;
+
+namespace R51 {
+
+const char* eventName(uint8_t id) {
+    switch ((VehicleEvent)id) {
+        case VehicleEvent::DOOR_STATE:
+            return "DOOR_STATE";
+        case VehicleEvent::DOOR_EDGE:
+            return "DOOR_EDGE";
+        default:
+            break;
+    }
+    switch ((Event)id) {
+        case Event::CLIMATE_TEMP_STATE:
+            return "CLIMATE_TEMP_STATE";
+        case Event::CLIMATE_AIRFLOW_STATE:
+            return "CLIMATE_AIRFLOW_STATE";
+        case Event::CLIMATE_SYSTEM_STATE:
+            return "CLIMATE_SYSTEM_STATE";
+        case Event::ENGINE_TEMP_STATE:
+            return "ENGINE_TEMP_STATE";
+        case Event::BODY_POWER_STATE:
+            return "BODY_POWER_STATE";
+        case Event::TIRE_PRESSURE_STATE:
+            return "TIRE_PRESSURE_STATE";
+        case Event::SETTINGS_STATE:
+            return "SETTINGS_STATE";
+        default:
+            return "UNKNOWN";
+    }
+}
+
+int decode(const char* path, uint32_t pages) {
+    FileFlightLogStorage storage(path, pages);
+    if (!storage.ok()) {
+        fprintf(stderr, "failed to open %s\n", path);
+        return 1;
+    }
+
+    uint32_t timestamp;
+    SystemEvent event;
+    FlightLogReader reader(&storage);
+    while (reader.next(&timestamp, &event)) {
+        printf("%10u %-22s %02X", timestamp, eventName(event.id), event.id);
+        for (size_t i = 0; i < sizeof(event.data); i++) {
+            printf(" %02X", event.data[i]);
+        }
+        printf("\n");
+    }
+    return 0;
+}
+
+}  // namespace R51
+
+void setup() {
+    if (epoxy_argc != 3) {
+        fprintf(stderr, "usage: %s <log.bin> <pages>\n", epoxy_argv[0]);
+        exit(2);
+    }
+    exit(R51::decode(epoxy_argv[1], strtoul(epoxy_argv[2], nullptr, 0)));
+}
+
+void loop() {}
@@ -0,0 +1,414 @@
+// Run the vehicle nodes on a Linux head unit. Frames are read from a
+// SocketCAN interface in batches and handled in place in the receive buffer.
+// Control frames (0x540, 0x541, 0x71E, and 0x71F) are encoded directly into
+// the transmit buffer and written back out. Decoded events are published to
+// clients connected to a Unix socket. Between frames the loop sleeps until
+// the earliest node deadline instead of polling on a fixed interval.
+//
+// Client protocol, one event per line in hex:
+//   gateway -> client: <millis> <event id> <data bytes>
+//   client -> gateway: <event id> <data bytes>
+//
+// Throughput and latency statistics are printed to stderr on SIGINT or
+// SIGTERM. Latency is measured from the kernel receive timestamp of a frame
+// to the end of the emit pass which follows it.
+//
+// The recent frames of each vehicle frame ID are kept in a black box and
+// written to stderr on SIGUSR1, when the climate unit sends a payload the
+// gateway cannot decode, or when a settings request fails. Requests written
+// by the gateway itself are not recorded.
+//
+// Load mode writes a mix of vehicle broadcast frames to an interface as fast
+// as it will accept them:
+//   gateway --load <iface> <count>
+
+#include <Arduino.h>
+#include <Canny.h>
+#include <Caster.h>
+#include <R51Core.h>
+#include <R51Vehicle.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+extern int epoxy_argc;
+extern const char* const* epoxy_argv;
+
+namespace R51 {
+
+// Maximum number of connected clients.
+static const size_t MAX_CLIENTS = 8;
+
+// Size of the per-client line buffer.
+static const size_t LINE_SIZE = 64;
+
+// Poll timeout used when no node has a deadline. Sleeps until a frame or
+// client arrives.
+static const int IDLE_MS = -1;
+
+static volatile sig_atomic_t running = 1;
+static volatile sig_atomic_t dump_requested = 0;
+
+void stop(int) {
+    running = 0;
+}
+
+void requestDump(int) {
+    dump_requested = 1;
+}
+
+// Writes black box dumps to a stdio stream.
+class FilePrint : public Print {
+    public:
+        FilePrint(FILE* file) : file_(file) {}
+
+        size_t write(uint8_t c) override {
+            return fputc(c, file_) == EOF ? 0 : 1;
+        }
+
+        size_t write(const uint8_t* buffer, size_t size) override {
+            return fwrite(buffer, 1, size, file_);
+        }
+
+    private:
+        FILE* file_;
+};
+
+// Publishes events to clients on a Unix socket and parses events sent by
+// clients.
+class EventServer {
+    public:
+        EventServer() : listen_(-1), count_(0) {}
+
+        ~EventServer() {
+            for (size_t i = 0; i < count_; ++i) {
+                close(clients_[i].fd);
+            }
+            if (listen_ >= 0) {
+                close(listen_);
+            }
+        }
+
+        bool open(const char* path) {
+            struct sockaddr_un addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.sun_family = AF_UNIX;
+            strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+            unlink(path);
+
+            listen_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+            return listen_ >= 0 &&
+                bind(listen_, (struct sockaddr*)&addr, sizeof(addr)) == 0 &&
+                listen(listen_, MAX_CLIENTS) == 0;
+        }
+
+        // Fill poll descriptors for the listening socket and each client.
+        // Return the number filled.
+        size_t fill(struct pollfd* fds) const {
+            fds[0] = {listen_, POLLIN, 0};
+            for (size_t i = 0; i < count_; ++i) {
+                fds[i + 1] = {clients_[i].fd, POLLIN, 0};
+            }
+            return count_ + 1;
+        }
+
+        // Accept pending clients and pass events read from clients to the
+        // node.
+        void service(const struct pollfd* fds, Caster::Node<Message>* node) {
+            for (size_t i = count_; i > 0; --i) {
+                if (fds[i].revents != 0 && !receive(i - 1, node)) {
+                    drop(i - 1);
+                }
+            }
+            if (fds[0].revents & POLLIN) {
+                accept();
+            }
+        }
+
+        void publish(const SystemEvent& event) {
+            char line[LINE_SIZE];
+            int n = snprintf(line, sizeof(line), "%lu %02X", millis(), event.id);
+            for (size_t i = 0; i < sizeof(event.data); ++i) {
+                n += snprintf(line + n, sizeof(line) - n, " %02X", event.data[i]);
+            }
+            n += snprintf(line + n, sizeof(line) - n, "\n");
+            for (size_t i = count_; i > 0; --i) {
+                // Slow clients are dropped rather than stalling the bus.
+                if (send(clients_[i - 1].fd, line, n, MSG_NOSIGNAL | MSG_DONTWAIT) != n) {
+                    drop(i - 1);
+                }
+            }
+        }
+
+    private:
+        struct Client {
+            int fd;
+            size_t size;
+            char line[LINE_SIZE];
+        };
+
+        int listen_;
+        Client clients_[MAX_CLIENTS];
+        size_t count_;
+
+        void accept() {
+            int fd;
+            while ((fd = accept4(listen_, nullptr, nullptr, SOCK_NONBLOCK)) >= 0) {
+                if (count_ >= MAX_CLIENTS) {
+                    close(fd);
+                    continue;
+                }
+                clients_[count_].fd = fd;
+                clients_[count_].size = 0;
+                ++count_;
+            }
+        }
+
+        void drop(size_t index) {
+            close(clients_[index].fd);
+            clients_[index] = clients_[--count_];
+        }
+
+        bool receive(size_t index, Caster::Node<Message>* node) {
+            Client& client = clients_[index];
+            char buffer[256];
+            ssize_t n = recv(client.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+                return false;
+            }
+            for (ssize_t i = 0; i < n; ++i) {
+                if (buffer[i] != '\n') {
+                    if (client.size < LINE_SIZE - 1) {
+                        client.line[client.size++] = buffer[i];
+                    }
+                    continue;
+                }
+                client.line[client.size] = 0;
+                client.size = 0;
+                SystemEvent event;
+                if (parse(client.line, &event)) {
+                    node->handle(event);
+                }
+            }
+            return true;
+        }
+
+        static bool parse(const char* line, SystemEvent* event) {
+            char* end;
+            unsigned long id = strtoul(line, &end, 16);
+            if (end == line || id > 0xFF) {
+                return false;
+            }
+            event->id = id;
+            memset(event->data, 0, sizeof(event->data));
+            for (size_t i = 0; i < sizeof(event->data); ++i) {
+                const char* start = end;
+                unsigned long value = strtoul(start, &end, 16);
+                if (end == start) {
+                    break;
+                }
+                event->data[i] = value;
+            }
+            return true;
+        }
+};
+
+// Routes node events to event clients. Control frames are pulled from the
+// nodes into the CAN transmit buffer instead of being yielded.
+class GatewayYield : public Caster::Yield<Message> {
+    public:
+        GatewayYield(EventServer* server) : server_(server), events(0) {}
+
+        void operator()(const Message& msg) const override {
+            if (msg.type() == Message::SYSTEM_EVENT) {
+                server_->publish(msg.system_event());
+                ++events;
+            }
+        }
+
+    private:
+        EventServer* server_;
+
+    public:
+        mutable uint32_t events;
+};
+
+int run(const char* ifname, const char* path) {
+    SocketCan can;
+    if (!can.open(ifname)) {
+        fprintf(stderr, "failed to open %s: %s\n", ifname, strerror(errno));
+        return 1;
+    }
+    EventServer server;
+    if (!server.open(path)) {
+        fprintf(stderr, "failed to listen on %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    Climate climate(1000);
+    EngineTempState ecm(1000);
+    IPDM ipdm(1000);
+    TirePressureState tires(1000);
+    Settings settings;
+    Doors doors(1000);
+    // Periodic traffic is suspended while the vehicle sleeps.
+    PowerManager power;
+    power.attach(&climate);
+    power.attach(&ecm);
+    power.attach(&ipdm);
+    power.attach(&tires);
+    power.attach(&settings);
+    power.attach(&doors);
+    // Events sent by clients are passed to every node.
+    VehicleNodes<Climate, EngineTempState, IPDM, TirePressureState, Settings> nodes(
+            climate, ecm, ipdm, tires, settings);
+    GatewayYield yield(&server);
+    FilePrint dump_out(stderr);
+    BlackBox blackbox(&dump_out);
+    climate.observer(&blackbox);
+    settings.observer(&blackbox);
+    // The loop sleeps until a frame or client arrives or a node is due.
+    Scheduler scheduler;
+    scheduler.attach(&power);
+    scheduler.attach(&climate);
+    scheduler.attach(&ecm);
+    scheduler.attach(&ipdm);
+    scheduler.attach(&tires);
+    scheduler.attach(&settings);
+    scheduler.attach(&doors);
+    scheduler.attach(&blackbox);
+
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+    signal(SIGUSR1, requestDump);
+
+    uint64_t frames = 0;
+    uint64_t writes = 0;
+    uint64_t latency_sum = 0;
+    uint64_t latency_max = 0;
+    uint64_t wakes = 0;
+    uint64_t start = SocketCan::now();
+    struct pollfd fds[MAX_CLIENTS + 2];
+    while (running) {
+        fds[0] = {can.fd(), POLLIN, 0};
+        size_t count = server.fill(fds + 1) + 1;
+        uint32_t deadline = scheduler.next();
+        int timeout = deadline == DEADLINE_NONE ? IDLE_MS : (int)deadline;
+        if (poll(fds, count, timeout) < 0 && errno != EINTR) {
+            perror("poll");
+            break;
+        }
+        ++wakes;
+        server.service(fds + 1, &nodes);
+        if (dump_requested) {
+            dump_requested = 0;
+            blackbox.trigger();
+        }
+
+        size_t n = can.read();
+        for (size_t i = 0; i < n; ++i) {
+            FrameView frame = can.view(i);
+            power.handle(frame);
+            climate.handle(frame);
+            ecm.handle(frame);
+            ipdm.handle(frame);
+            tires.handle(frame);
+            settings.handle(frame);
+            doors.handle(frame);
+            blackbox.handle(frame);
+        }
+        power.emit(yield);
+        climate.poll(yield);
+        ecm.emit(yield);
+        ipdm.emit(yield);
+        tires.emit(yield);
+        settings.poll(yield);
+        doors.emit(yield);
+        blackbox.emit(yield);
+        writes += can.write(&climate);
+        writes += can.write(&settings);
+
+        uint64_t now = SocketCan::now();
+        for (size_t i = 0; i < n; ++i) {
+            uint64_t latency = now - can.timestamp(i);
+            latency_sum += latency;
+            if (latency > latency_max) {
+                latency_max = latency;
+            }
+        }
+        frames += n;
+    }
+
+    double elapsed = (SocketCan::now() - start) / 1e9;
+    fprintf(stderr, "frames:     %llu in %.1fs (%.0f frames/s)\n",
+            (unsigned long long)frames, elapsed, frames / elapsed);
+    fprintf(stderr, "reads:      %lu (%.1f frames/read)\n", (unsigned long)can.reads(),
+            can.reads() == 0 ? 0.0 : (double)frames / can.reads());
+    fprintf(stderr, "latency:    %.1fus avg, %.1fus max\n",
+            frames == 0 ? 0.0 : latency_sum / 1e3 / frames, latency_max / 1e3);
+    fprintf(stderr, "events:     %lu\n", (unsigned long)yield.events);
+    fprintf(stderr, "wakes:      %llu (%.1f/s)\n", (unsigned long long)wakes,
+            wakes / elapsed);
+    fprintf(stderr, "writes:     %lu (%lu dropped)\n", (unsigned long)writes,
+            (unsigned long)can.dropped());
+    unlink(path);
+    return 0;
+}
+
+int load(const char* ifname, uint32_t count) {
+    static const Canny::Frame FRAMES[] = {
+        Canny::Frame(0x54A, 0, {0x3C, 0x3E, 0x7F, 0x80, 0x44, 0x44, 0x00, 0x58}),
+        Canny::Frame(0x54B, 0, {0x59, 0x84, 0x05, 0x24, 0x00, 0x00, 0x00, 0x02}),
+        Canny::Frame(0x551, 0, {0x50, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}),
+        Canny::Frame(0x625, 0, {0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}),
+        Canny::Frame(0x385, 0, {0x00, 0x00, 0x5C, 0x5D, 0x5C, 0x5E, 0x00, 0xF0}),
+        Canny::Frame(0x160, 0, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}),
+    };
+    static const size_t FRAME_COUNT = sizeof(FRAMES) / sizeof(FRAMES[0]);
+
+    SocketCan can;
+    if (!can.open(ifname)) {
+        fprintf(stderr, "failed to open %s: %s\n", ifname, strerror(errno));
+        return 1;
+    }
+
+    Canny::Frame frame;
+    uint64_t start = SocketCan::now();
+    for (uint32_t i = 0; i < count; ++i) {
+        frame = FRAMES[i % FRAME_COUNT];
+        // Vary the engine temperature so each frame produces an event.
+        if (frame.id() == 0x551) {
+            frame.data()[0] = i;
+        }
+        while (!can.write(frame)) {
+            struct pollfd fd = {can.fd(), POLLOUT, 0};
+            poll(&fd, 1, 100);
+        }
+    }
+    double elapsed = (SocketCan::now() - start) / 1e9;
+    fprintf(stderr, "sent %lu frames in %.2fs (%.0f frames/s)\n",
+            (unsigned long)count, elapsed, count / elapsed);
+    return 0;
+}
+
+}  // namespace R51
+
+void setup() {
+    if (epoxy_argc == 4 && strcmp(epoxy_argv[1], "--load") == 0) {
+        exit(R51::load(epoxy_argv[2], strtoul(epoxy_argv[3], nullptr, 0)));
+    }
+    if (epoxy_argc != 3) {
+        fprintf(stderr, "usage: %s <iface> <socket path>\n", epoxy_argv[0]);
+        fprintf(stderr, "       %s --load <iface> <count>\n", epoxy_argv[0]);
+        exit(2);
+    }
+    exit(R51::run(epoxy_argv[1], epoxy_argv[2]));
+}
+
+void loop() {}